@@ -140,6 +140,7 @@ static void mark_screen_rdonly(struct task_struct * tsk)
 	pud_t *pud;
 	pmd_t *pmd;
 	pte_t *pte, *mapped;
+	spinlock_t *ptl;
 	int i;
 
 	preempt_disable();
@@ -168,6 +169,7 @@ static void mark_screen_rdonly(struct task_struct * tsk)
 		pmd_clear(pmd);
 		goto out;
 	}
+	ptl = pte_lock_nested(tsk->mm, pmd);
 	pte = mapped = pte_offset_map(pmd, 0xA0000);
 	for (i = 0; i < 32; i++) {
 		if (pte_present(*pte))
@@ -175,6 +177,7 @@ static void mark_screen_rdonly(struct task_struct * tsk)
 		pte++;
 	}
 	pte_unmap(mapped);
+	pte_unlock_nested(ptl);
 out:
 	spin_unlock(&tsk->mm->page_table_lock);
 	preempt_enable();
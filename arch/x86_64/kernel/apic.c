@@ -26,6 +26,7 @@
 #include <linux/mc146818rtc.h>
 #include <linux/kernel_stat.h>
 #include <linux/sysdev.h>
+#include <linux/clockchips.h>
 
 #include <asm/atomic.h>
 #include <asm/smp.h>
@@ -45,6 +46,8 @@ static DEFINE_PER_CPU(int, prof_multiplier) = 1;
 static DEFINE_PER_CPU(int, prof_old_multiplier) = 1;
 static DEFINE_PER_CPU(int, prof_counter) = 1;
 
+static DEFINE_PER_CPU(struct clock_event_device, lapic_events);
+
 static void apic_pm_activate(void);
 
 void enable_NMI_through_LVT0 (void * dummy)
@@ -643,6 +646,8 @@ void __init init_apic_mappings(void)
  * this function twice on the boot CPU, once with a bogus timeout
  * value, second time for real. The other (noncalibrating) CPUs
  * call this function only once, with the real, calibrated value.
+ * In one-shot mode the timer fires once and is then rearmed by
+ * writing the count register (see lapic_next_event()).
  *
  * We do reads before writes even if unnecessary, to get around the
  * P5 APIC double write bug.
@@ -650,12 +655,14 @@ void __init init_apic_mappings(void)
 
 #define APIC_DIVISOR 16
 
-void __setup_APIC_LVTT(unsigned int clocks)
+void __setup_APIC_LVTT(unsigned int clocks, int oneshot)
 {
 	unsigned int lvtt_value, tmp_value, ver;
 
 	ver = GET_APIC_VERSION(apic_read(APIC_LVR));
-	lvtt_value = APIC_LVT_TIMER_PERIODIC | LOCAL_TIMER_VECTOR;
+	lvtt_value = LOCAL_TIMER_VECTOR;
+	if (!oneshot)
+		lvtt_value |= APIC_LVT_TIMER_PERIODIC;
 	if (!APIC_INTEGRATED(ver))
 		lvtt_value |= SET_APIC_TIMER_BASE(APIC_TIMER_BASE_DIV);
 	apic_write_around(APIC_LVTT, lvtt_value);
@@ -679,7 +686,7 @@ static void setup_APIC_timer(unsigned int clocks)
 
 	/* For some reasons this doesn't work on Simics, so fake it for now */ 
 	if (!strstr(boot_cpu_data.x86_model_id, "Screwdriver")) { 
-	__setup_APIC_LVTT(clocks);
+	__setup_APIC_LVTT(clocks, 0);
 		return;
 	} 
 
@@ -703,7 +710,7 @@ static void setup_APIC_timer(unsigned int clocks)
 		} while (c2 - c1 < 300);
 	}
 
-	__setup_APIC_LVTT(clocks);
+	__setup_APIC_LVTT(clocks, 0);
 
 	local_irq_restore(flags);
 }
@@ -732,7 +739,7 @@ int __init calibrate_APIC_clock(void)
 	 * value into the APIC clock, we just want to get the
 	 * counter running for calibration.
 	 */
-	__setup_APIC_LVTT(1000000000);
+	__setup_APIC_LVTT(1000000000, 0);
 
 	apic_start = apic_read(APIC_TMCCT);
 	rdtscl(tsc_start);
@@ -752,6 +759,47 @@ int __init calibrate_APIC_clock(void)
 
 static unsigned int calibration_result;
 
+/*
+ * The local APIC timer as a clock event device, for the high
+ * resolution timer code.  One count of the timer is APIC_DIVISOR
+ * bus clocks.
+ */
+static void lapic_next_event(unsigned long delta,
+			     struct clock_event_device *evt)
+{
+	apic_write_around(APIC_TMICT, delta);
+}
+
+static void lapic_timer_setup(enum clock_event_mode mode,
+			      struct clock_event_device *evt)
+{
+	unsigned long flags;
+
+	local_irq_save(flags);
+	__setup_APIC_LVTT(calibration_result, mode == CLOCK_EVT_MODE_ONESHOT);
+	local_irq_restore(flags);
+}
+
+static void setup_APIC_clock_events(void)
+{
+	struct clock_event_device *evt = &__get_cpu_var(lapic_events);
+	u64 mult;
+
+	evt->name = "lapic";
+	evt->shift = 32;
+	mult = (u64) (calibration_result / APIC_DIVISOR) << evt->shift;
+	do_div(mult, TICK_NSEC);
+	evt->mult = mult;
+	evt->max_delta_ns = clockevent_delta2ns(0x7FFFFF, evt);
+	evt->min_delta_ns = clockevent_delta2ns(0xF, evt);
+	evt->tick_ns = TICK_NSEC;
+	evt->set_mode = lapic_timer_setup;
+	evt->set_next_event = lapic_next_event;
+	evt->tick = smp_local_timer_interrupt;
+
+	clockevents_register_device(evt);
+}
+
 void __init setup_boot_APIC_clock (void)
 {
 	if (disable_apic_timer) { 
@@ -769,6 +817,7 @@ void __init setup_boot_APIC_clock (void)
 	 * Now set up the timer for real.
 	 */
 	setup_APIC_timer(calibration_result);
+	setup_APIC_clock_events();
 
 	local_irq_enable();
 }
@@ -777,6 +826,7 @@ void __init setup_secondary_APIC_clock(void)
 {
 	local_irq_disable(); /* FIXME: Do we need this? --RR */
 	setup_APIC_timer(calibration_result);
+	setup_APIC_clock_events();
 	local_irq_enable();
 }
 
@@ -857,8 +907,19 @@ void smp_local_timer_interrupt(struct pt_regs *regs)
 		per_cpu(prof_counter, cpu) = per_cpu(prof_multiplier, cpu);
 		if (per_cpu(prof_counter, cpu) != 
 		    per_cpu(prof_old_multiplier, cpu)) {
-			__setup_APIC_LVTT(calibration_result/
-					per_cpu(prof_counter, cpu));
+			struct clock_event_device *evt =
+				&per_cpu(lapic_events, cpu);
+
+			/*
+			 * In one-shot mode the local tick is emulated by
+			 * the hrtimer code; just change its period.
+			 */
+			if (evt->mode == CLOCK_EVT_MODE_ONESHOT)
+				evt->tick_ns = TICK_NSEC /
+					per_cpu(prof_counter, cpu);
+			else
+				__setup_APIC_LVTT(calibration_result/
+					per_cpu(prof_counter, cpu), 0);
 			per_cpu(prof_old_multiplier, cpu) =
 				per_cpu(prof_counter, cpu);
 		}
@@ -890,6 +951,8 @@ void smp_local_timer_interrupt(struct pt_regs *regs)
  */
 void smp_apic_timer_interrupt(struct pt_regs *regs)
 {
+	struct clock_event_device *evt = &__get_cpu_var(lapic_events);
+
 	/*
 	 * the NMI deadlock-detector uses this.
 	 */
@@ -906,7 +969,14 @@ void smp_apic_timer_interrupt(struct pt_regs *regs)
 	 * interrupt lock, which is the WrongThing (tm) to do.
 	 */
 	irq_enter();
-	smp_local_timer_interrupt(regs);
+	/*
+	 * Once the hrtimer code has taken the timer over, it decides
+	 * what this interrupt is for (the emulated local tick included).
+	 */
+	if (evt->event_handler)
+		evt->event_handler(evt, regs);
+	else
+		smp_local_timer_interrupt(regs);
 	irq_exit();
 }
 
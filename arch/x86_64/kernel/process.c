@@ -162,8 +162,10 @@ void cpu_idle (void)
 			idle = pm_idle;
 			if (!idle)
 				idle = default_idle;
+			hrtimer_stop_sched_tick();
 			idle();
 		}
+		hrtimer_restart_sched_tick();
 		schedule();
 	}
 }
@@ -26,6 +26,7 @@
 #include <linux/slab.h>
 #include <linux/timer.h>
 #include <linux/aio.h>
+#include <linux/poll.h>
 #include <linux/highmem.h>
 #include <linux/workqueue.h>
 #include <linux/security.h>
@@ -388,12 +389,9 @@ void fastcall __put_ioctx(struct kioctx *ctx)
  * This prevents races between the aio code path referencing the
  * req (after submitting it) and aio_complete() freeing the req.
  */
-static struct kiocb *FASTCALL(__aio_get_req(struct kioctx *ctx));
-static struct kiocb fastcall *__aio_get_req(struct kioctx *ctx)
+static struct kiocb *aio_alloc_req(struct kioctx *ctx)
 {
-	struct kiocb *req = NULL;
-	struct aio_ring *ring;
-	int okay = 0;
+	struct kiocb *req;
 
 	req = kmem_cache_alloc(kiocb_cachep, GFP_KERNEL);
 	if (unlikely(!req))
@@ -403,12 +401,27 @@ static struct kiocb fastcall *__aio_get_req(struct kioctx *ctx)
 	req->ki_users = 2;
 	req->ki_key = 0;
 	req->ki_ctx = ctx;
+	req->ki_filp = NULL;
 	req->ki_cancel = NULL;
 	req->ki_retry = NULL;
 	req->ki_obj.user = NULL;
 	req->ki_dtor = NULL;
+	req->ki_iovec = NULL;
 	req->private = NULL;
 	INIT_LIST_HEAD(&req->ki_run_list);
+	return req;
+}
+
+static struct kiocb *FASTCALL(__aio_get_req(struct kioctx *ctx));
+static struct kiocb fastcall *__aio_get_req(struct kioctx *ctx)
+{
+	struct kiocb *req = NULL;
+	struct aio_ring *ring;
+	int okay = 0;
+
+	req = aio_alloc_req(ctx);
+	if (unlikely(!req))
+		return NULL;
 
 	/* Check if the completion queue has enough free space to
 	 * accept an event from this io.
@@ -432,6 +445,42 @@ static struct kiocb fastcall *__aio_get_req(struct kioctx *ctx)
 	return req;
 }
 
+/* __aio_get_req_batch
+ *	Like __aio_get_req, but for up to nr requests at once: the kiocbs
+ * are allocated up front and their completion ring slots are reserved
+ * under a single ctx_lock hold.  Returns the number of requests stored
+ * in reqs, which is short if memory or ring space ran out.
+ */
+static int __aio_get_req_batch(struct kioctx *ctx, struct kiocb **reqs, int nr)
+{
+	struct aio_ring *ring;
+	unsigned avail;
+	int i, got;
+
+	for (i = 0; i < nr; i++) {
+		reqs[i] = aio_alloc_req(ctx);
+		if (unlikely(!reqs[i]))
+			break;
+	}
+	nr = i;
+
+	spin_lock_irq(&ctx->ctx_lock);
+	ring = kmap_atomic(ctx->ring_info.ring_pages[0], KM_USER0);
+	avail = aio_ring_avail(&ctx->ring_info, ring);
+	for (got = 0; got < nr && ctx->reqs_active < avail; got++) {
+		list_add(&reqs[got]->ki_list, &ctx->active_reqs);
+		get_ioctx(ctx);
+		ctx->reqs_active++;
+	}
+	kunmap_atomic(ring, KM_USER0);
+	spin_unlock_irq(&ctx->ctx_lock);
+
+	for (i = got; i < nr; i++)
+		kmem_cache_free(kiocb_cachep, reqs[i]);
+
+	return got;
+}
+
 static inline struct kiocb *aio_get_req(struct kioctx *ctx)
 {
 	struct kiocb *req;
@@ -447,10 +496,27 @@ static inline struct kiocb *aio_get_req(struct kioctx *ctx)
 	return req;
 }
 
+static inline int aio_get_req_batch(struct kioctx *ctx, struct kiocb **reqs,
+				    int nr)
+{
+	int got;
+
+	/* see aio_get_req */
+	got = __aio_get_req_batch(ctx, reqs, nr);
+	if (unlikely(!got)) {
+		aio_fput_routine(NULL);
+		got = __aio_get_req_batch(ctx, reqs, nr);
+	}
+	return got;
+}
+
 static inline void really_put_req(struct kioctx *ctx, struct kiocb *req)
 {
 	if (req->ki_dtor)
 		req->ki_dtor(req);
+	if (req->ki_iovec != &req->ki_inline_vec)
+		kfree(req->ki_iovec);
+	req->ki_iovec = NULL;
 	req->ki_ctx = NULL;
 	req->ki_filp = NULL;
 	req->ki_obj.user = NULL;
@@ -724,13 +790,13 @@ static ssize_t aio_run_iocb(struct kiocb *iocb)
 	 * the aio_wake_function callback).
 	 */
 	BUG_ON(current->io_wait != NULL);
-	current->io_wait = &iocb->ki_wait;
+	current->io_wait = &iocb->ki_wait.wait;
 	ret = retry(iocb);
 	current->io_wait = NULL;
 
 	if (-EIOCBRETRY != ret) {
  		if (-EIOCBQUEUED != ret) {
-			BUG_ON(!list_empty(&iocb->ki_wait.task_list));
+			BUG_ON(!list_empty(&iocb->ki_wait.wait.task_list));
 			aio_complete(iocb, ret, 0);
 			/* must not access the iocb after this */
 		}
@@ -739,7 +805,7 @@ static ssize_t aio_run_iocb(struct kiocb *iocb)
 		 * Issue an additional retry to avoid waiting forever if
 		 * no waits were queued (e.g. in case of a short read).
 		 */
-		if (list_empty(&iocb->ki_wait.task_list))
+		if (list_empty(&iocb->ki_wait.wait.task_list))
 			kiocbSetKicked(iocb);
 	}
 out:
@@ -885,7 +951,7 @@ void queue_kicked_iocb(struct kiocb *iocb)
 	unsigned long flags;
 	int run = 0;
 
-	WARN_ON((!list_empty(&iocb->ki_wait.task_list)));
+	WARN_ON((!list_empty(&iocb->ki_wait.wait.task_list)));
 
 	spin_lock_irqsave(&ctx->ctx_lock, flags);
 	run = __queue_kicked_iocb(iocb);
@@ -1376,6 +1442,114 @@ static ssize_t aio_pwrite(struct kiocb *iocb)
 	return ret;
 }
 
+/*
+ * aio_advance_iovec:
+ *	Consume ret bytes from the front of the kiocb's private copy of
+ *	the iovec, so that the next retry resumes where this one stopped.
+ */
+static void aio_advance_iovec(struct kiocb *iocb, ssize_t ret)
+{
+	struct iovec *iov = &iocb->ki_iovec[iocb->ki_cur_seg];
+
+	iocb->ki_left -= ret;
+	while (ret > 0) {
+		BUG_ON(iocb->ki_cur_seg >= iocb->ki_nr_segs);
+		if ((size_t)ret < iov->iov_len) {
+			iov->iov_base += ret;
+			iov->iov_len -= ret;
+			break;
+		}
+		ret -= iov->iov_len;
+		iov->iov_base += iov->iov_len;
+		iov->iov_len = 0;
+		iocb->ki_cur_seg++;
+		iov++;
+	}
+}
+
+/*
+ * Retry method for IOCB_CMD_PREADV and IOCB_CMD_PWRITEV (also used
+ * for first time submit).  Works like aio_pread/aio_pwrite, but on
+ * the unfinished tail of the iovec.
+ */
+static ssize_t aio_rw_vect_retry(struct kiocb *iocb)
+{
+	struct file *file = iocb->ki_filp;
+	struct inode *inode = file->f_mapping->host;
+	ssize_t (*rw_op)(struct kiocb *, const struct iovec *,
+			 unsigned long, loff_t);
+	ssize_t ret = 0;
+
+	if (iocb->ki_opcode == IOCB_CMD_PREADV)
+		rw_op = file->f_op->aio_readv;
+	else
+		rw_op = file->f_op->aio_writev;
+
+	ret = rw_op(iocb, &iocb->ki_iovec[iocb->ki_cur_seg],
+		    iocb->ki_nr_segs - iocb->ki_cur_seg, iocb->ki_pos);
+
+	if (ret > 0) {
+		aio_advance_iovec(iocb, ret);
+		/* short reads from pipes and sockets complete, see aio_pread */
+		if (iocb->ki_opcode == IOCB_CMD_PWRITEV ||
+		    (!S_ISFIFO(inode->i_mode) && !S_ISSOCK(inode->i_mode)))
+			ret = -EIOCBRETRY;
+	}
+
+	/* This means we must have transferred all that we could */
+	/* No need to retry anymore */
+	if ((ret == 0) || (iocb->ki_left == 0))
+		ret = iocb->ki_nbytes - iocb->ki_left;
+
+	return ret;
+}
+
+/*
+ * aio_setup_vectored_rw:
+ *	Copy in and check the iovec of a vectored request.  On entry
+ *	ki_buf points to the user iovec and ki_nbytes holds the number
+ *	of segments; on success ki_nbytes and ki_left are the total
+ *	length of the transfer.
+ */
+static ssize_t aio_setup_vectored_rw(int type, struct kiocb *kiocb)
+{
+	struct iovec __user *uiov = (struct iovec __user *)kiocb->ki_buf;
+	unsigned long nr_segs = kiocb->ki_nbytes;
+	struct iovec *iov;
+	ssize_t tot_len = 0;
+	unsigned long seg;
+
+	if (unlikely(!nr_segs || nr_segs > UIO_MAXIOV))
+		return -EINVAL;
+
+	iov = &kiocb->ki_inline_vec;
+	if (nr_segs > 1) {
+		iov = kmalloc(nr_segs * sizeof(*iov), GFP_KERNEL);
+		if (unlikely(!iov))
+			return -ENOMEM;
+	}
+	/* freed by really_put_req from here on */
+	kiocb->ki_iovec = iov;
+
+	if (unlikely(copy_from_user(iov, uiov, nr_segs * sizeof(*iov))))
+		return -EFAULT;
+
+	for (seg = 0; seg < nr_segs; seg++) {
+		ssize_t len = (ssize_t)iov[seg].iov_len;
+
+		if (unlikely(len < 0 || (ssize_t)(tot_len + len) < tot_len))
+			return -EINVAL;
+		if (unlikely(!access_ok(type, iov[seg].iov_base, len)))
+			return -EFAULT;
+		tot_len += len;
+	}
+
+	kiocb->ki_nr_segs = nr_segs;
+	kiocb->ki_cur_seg = 0;
+	kiocb->ki_nbytes = kiocb->ki_left = tot_len;
+	return 0;
+}
+
 static ssize_t aio_fdsync(struct kiocb *iocb)
 {
 	struct file *file = iocb->ki_filp;
@@ -1396,6 +1570,105 @@ static ssize_t aio_fsync(struct kiocb *iocb)
 	return ret;
 }
 
+/*
+ * Poll table used by aio_poll to queue the iocb wait queue entry on
+ * the wait queue of the polled file.
+ */
+struct aio_poll_table {
+	poll_table		pt;
+	struct kiocb		*iocb;
+	int			nr_queued;
+};
+
+static void aio_poll_queue_proc(struct file *file, wait_queue_head_t *whead,
+				poll_table *pt)
+{
+	struct aio_poll_table *apt = container_of(pt, struct aio_poll_table, pt);
+	struct kiocb *iocb = apt->iocb;
+	wait_queue_t *wait = &iocb->ki_wait.wait;
+
+	/*
+	 * An iocb has a single wait queue entry, so we can only wait on
+	 * the first wait queue the file hands to us. This is fine for
+	 * sockets and pipes, that use one wait queue for all the events.
+	 */
+	if (apt->nr_queued++ || !list_empty(&wait->task_list))
+		return;
+
+	iocb->ki_wait.key.flags = NULL;
+	iocb->private = whead;
+	add_wait_queue(whead, wait);
+}
+
+/*
+ * Dequeue the iocb from the polled file wait queue. Returns 1 if it
+ * was still queued. Whoever dequeues the entry (this function, or
+ * aio_wake_function on a wakeup) owns the next step of the iocb.
+ */
+static int aio_poll_dequeue(struct kiocb *iocb)
+{
+	wait_queue_head_t *whead = iocb->private;
+	wait_queue_t *wait = &iocb->ki_wait.wait;
+	unsigned long flags;
+	int queued = 0;
+
+	if (!whead)
+		return 0;
+
+	spin_lock_irqsave(&whead->lock, flags);
+	if (!list_empty(&wait->task_list)) {
+		list_del_init(&wait->task_list);
+		queued = 1;
+	}
+	spin_unlock_irqrestore(&whead->lock, flags);
+	return queued;
+}
+
+/*
+ * Retry method for IOCB_CMD_POLL: completes with the ready events
+ * mask once any of the events passed in aio_buf is signalled, and
+ * otherwise waits on the file wait queue for a kick.
+ */
+static ssize_t aio_poll(struct kiocb *iocb)
+{
+	struct file *file = iocb->ki_filp;
+	unsigned int events = (unsigned long)iocb->ki_buf | POLLERR | POLLHUP;
+	struct aio_poll_table apt;
+	unsigned int mask;
+
+	apt.iocb = iocb;
+	apt.nr_queued = 0;
+	init_poll_funcptr(&apt.pt, aio_poll_queue_proc);
+
+	mask = file->f_op->poll(file, &apt.pt) & events;
+	if (mask) {
+		aio_poll_dequeue(iocb);
+		return mask;
+	}
+
+	/*
+	 * If we have been cancelled while queueing, complete the iocb now,
+	 * unless aio_poll_cancel already dequeued it and kicked a retry.
+	 */
+	if (kiocbIsCancelled(iocb) && aio_poll_dequeue(iocb))
+		return -EINTR;
+
+	return -EIOCBRETRY;
+}
+
+static int aio_poll_cancel(struct kiocb *iocb, struct io_event *res)
+{
+	/*
+	 * If the iocb is waiting, kick it: the retry will see it cancelled
+	 * and complete it. Otherwise a retry is already pending or running.
+	 */
+	if (aio_poll_dequeue(iocb))
+		kick_iocb(iocb);
+
+	aio_put_req(iocb);
+	return -EAGAIN;
+}
+
 /*
  * aio_setup_iocb:
  *	Performs the initial checks and aio retry method
@@ -1431,6 +1704,28 @@ ssize_t aio_setup_iocb(struct kiocb *kiocb)
 		if (file->f_op->aio_write)
 			kiocb->ki_retry = aio_pwrite;
 		break;
+	case IOCB_CMD_PREADV:
+		ret = -EBADF;
+		if (unlikely(!(file->f_mode & FMODE_READ)))
+			break;
+		ret = aio_setup_vectored_rw(VERIFY_WRITE, kiocb);
+		if (ret)
+			break;
+		ret = -EINVAL;
+		if (file->f_op->aio_readv)
+			kiocb->ki_retry = aio_rw_vect_retry;
+		break;
+	case IOCB_CMD_PWRITEV:
+		ret = -EBADF;
+		if (unlikely(!(file->f_mode & FMODE_WRITE)))
+			break;
+		ret = aio_setup_vectored_rw(VERIFY_READ, kiocb);
+		if (ret)
+			break;
+		ret = -EINVAL;
+		if (file->f_op->aio_writev)
+			kiocb->ki_retry = aio_rw_vect_retry;
+		break;
 	case IOCB_CMD_FDSYNC:
 		ret = -EINVAL;
 		if (file->f_op->aio_fsync)
@@ -1441,6 +1736,13 @@ ssize_t aio_setup_iocb(struct kiocb *kiocb)
 		if (file->f_op->aio_fsync)
 			kiocb->ki_retry = aio_fsync;
 		break;
+	case IOCB_CMD_POLL:
+		ret = -EINVAL;
+		if (file->f_op->poll) {
+			kiocb->ki_retry = aio_poll;
+			kiocb->ki_cancel = aio_poll_cancel;
+		}
+		break;
 	default:
 		dprintk("EINVAL: io_submit: no operation provided\n");
 		ret = -EINVAL;
@@ -1463,6 +1765,10 @@ ssize_t aio_setup_iocb(struct kiocb *kiocb)
  * 	instead of a synchronous wait when an i/o blocking
  *	condition is encountered during aio).
  *
+ *	When waiting on a page bit (see lock_page_async), the
+ *	entry is keyed like a wait_bit_queue and wakeups for other
+ *	pages sharing the same hashed wait queue are ignored.
+ *
  * Note:
  * This routine is executed with the wait queue lock held.
  * Since kick_iocb acquires iocb->ctx->ctx_lock, it nests
@@ -1472,17 +1778,30 @@ ssize_t aio_setup_iocb(struct kiocb *kiocb)
  */
 int aio_wake_function(wait_queue_t *wait, unsigned mode, int sync, void *key)
 {
-	struct kiocb *iocb = container_of(wait, struct kiocb, ki_wait);
+	struct kiocb *iocb = io_wait_to_kiocb(wait);
+	struct wait_bit_key *bit_key = key;
+
+	if (iocb->ki_wait.key.flags && bit_key &&
+	    (iocb->ki_wait.key.flags != bit_key->flags ||
+	     iocb->ki_wait.key.bit_nr != bit_key->bit_nr ||
+	     test_bit(bit_key->bit_nr, bit_key->flags)))
+		return 0;
 
 	list_del_init(&wait->task_list);
 	kick_iocb(iocb);
 	return 1;
 }
 
-int fastcall io_submit_one(struct kioctx *ctx, struct iocb __user *user_iocb,
-			 struct iocb *iocb)
+/*
+ * aio_prep_req:
+ *	Fill in a freshly allocated kiocb from the user's iocb and set
+ *	up its retry method.  On failure the caller disposes of the
+ *	kiocb: with two aio_put_req()s once ki_filp is set, or with
+ *	aio_put_unused_reqs() before that.
+ */
+static int aio_prep_req(struct kiocb *req, struct iocb __user *user_iocb,
+			struct iocb *iocb)
 {
-	struct kiocb *req;
 	struct file *file;
 	ssize_t ret;
 
@@ -1507,18 +1826,12 @@ int fastcall io_submit_one(struct kioctx *ctx, struct iocb __user *user_iocb,
 	if (unlikely(!file))
 		return -EBADF;
 
-	req = aio_get_req(ctx);		/* returns with 2 references to req */
-	if (unlikely(!req)) {
-		fput(file);
-		return -EAGAIN;
-	}
-
 	req->ki_filp = file;
 	iocb->aio_key = req->ki_key;
 	ret = put_user(iocb->aio_key, &user_iocb->aio_key);
 	if (unlikely(ret)) {
 		dprintk("EFAULT: aio_key\n");
-		goto out_put_req;
+		return ret;
 	}
 
 	req->ki_obj.user = user_iocb;
@@ -1528,8 +1841,9 @@ int fastcall io_submit_one(struct kioctx *ctx, struct iocb __user *user_iocb,
 	req->ki_buf = (char __user *)(unsigned long)iocb->aio_buf;
 	req->ki_left = req->ki_nbytes = iocb->aio_nbytes;
 	req->ki_opcode = iocb->aio_lio_opcode;
-	init_waitqueue_func_entry(&req->ki_wait, aio_wake_function);
-	INIT_LIST_HEAD(&req->ki_wait.task_list);
+	init_waitqueue_func_entry(&req->ki_wait.wait, aio_wake_function);
+	INIT_LIST_HEAD(&req->ki_wait.wait.task_list);
+	req->ki_wait.key.flags = NULL;
 	req->ki_run_list.next = req->ki_run_list.prev = NULL;
 	req->ki_retry = NULL;
 	req->ki_retried = 0;
@@ -1538,26 +1852,81 @@ int fastcall io_submit_one(struct kioctx *ctx, struct iocb __user *user_iocb,
 	aio_run = 0;
 	aio_wakeups = 0;
 
-	ret = aio_setup_iocb(req);
+	return aio_setup_iocb(req);
+}
 
-	if (ret)
-		goto out_put_req;
+/*
+ * aio_put_unused_reqs:
+ *	Give back kiocbs obtained from aio_get_req_batch() that never
+ *	got a file attached.
+ */
+static void aio_put_unused_reqs(struct kioctx *ctx, struct kiocb **reqs,
+				int nr)
+{
+	int i;
 
 	spin_lock_irq(&ctx->ctx_lock);
-	list_add_tail(&req->ki_run_list, &ctx->run_list);
+	for (i = 0; i < nr; i++) {
+		list_del(&reqs[i]->ki_list);
+		really_put_req(ctx, reqs[i]);
+	}
+	spin_unlock_irq(&ctx->ctx_lock);
+	for (i = 0; i < nr; i++)
+		put_ioctx(ctx);
+}
+
+/*
+ * aio_run_new_reqs:
+ *	Queue nr prepared kiocbs on the run list and drain it, then drop
+ *	the submission references, all in a single ctx_lock hold.
+ */
+static void aio_run_new_reqs(struct kioctx *ctx, struct kiocb **reqs, int nr)
+{
+	int i, puts = 0;
+
+	spin_lock_irq(&ctx->ctx_lock);
+	for (i = 0; i < nr; i++)
+		list_add_tail(&reqs[i]->ki_run_list, &ctx->run_list);
 	/* drain the run list */
 	while (__aio_run_iocbs(ctx))
 		;
+	for (i = 0; i < nr; i++)
+		puts += __aio_put_req(ctx, reqs[i]);	/* drop extra ref */
 	spin_unlock_irq(&ctx->ctx_lock);
-	aio_put_req(req);	/* drop extra ref to req */
+	while (puts--)
+		put_ioctx(ctx);
+}
+
+int fastcall io_submit_one(struct kioctx *ctx, struct iocb __user *user_iocb,
+			 struct iocb *iocb)
+{
+	struct kiocb *req;
+	ssize_t ret;
+
+	req = aio_get_req(ctx);		/* returns with 2 references to req */
+	if (unlikely(!req))
+		return -EAGAIN;
+
+	ret = aio_prep_req(req, user_iocb, iocb);
+	if (ret)
+		goto out_put_req;
+
+	aio_run_new_reqs(ctx, &req, 1);
 	return 0;
 
 out_put_req:
+	if (!req->ki_filp) {
+		aio_put_unused_reqs(ctx, &req, 1);
+		return ret;
+	}
 	aio_put_req(req);	/* drop extra ref to req */
 	aio_put_req(req);	/* drop i/o ref to req */
 	return ret;
 }
 
+/* Number of iocbs io_submit allocates and queues at a time */
+#define AIO_SUBMIT_BATCH	16
+
 /* sys_io_submit:
  *	Queue the nr iocbs pointed to by iocbpp for processing.  Returns
  *	the number of iocbs queued.  May return -EINVAL if the aio_context
@@ -1569,13 +1938,18 @@ out_put_req:
  *	iocb is invalid.  May fail with -EAGAIN if insufficient resources
  *	are available to queue any iocbs.  Will return 0 if nr is 0.  Will
  *	fail with -ENOSYS if not implemented.
+ *
+ *	The iocbs are handled in batches of AIO_SUBMIT_BATCH: the kiocbs
+ *	of a batch are allocated and accounted against the completion ring
+ *	together, and the whole batch is started under one ctx_lock hold.
  */
 asmlinkage long sys_io_submit(aio_context_t ctx_id, long nr,
 			      struct iocb __user * __user *iocbpp)
 {
+	struct kiocb *reqs[AIO_SUBMIT_BATCH];
 	struct kioctx *ctx;
 	long ret = 0;
-	int i;
+	int i = 0;
 
 	if (unlikely(nr < 0))
 		return -EINVAL;
@@ -1593,21 +1967,48 @@ asmlinkage long sys_io_submit(aio_context_t ctx_id, long nr,
 	 * AKPM: should this return a partial result if some of the IOs were
 	 * successfully submitted?
 	 */
-	for (i=0; i<nr; i++) {
-		struct iocb __user *user_iocb;
-		struct iocb tmp;
+	while (i < nr) {
+		int got, j;
 
-		if (unlikely(__get_user(user_iocb, iocbpp + i))) {
-			ret = -EFAULT;
+		got = aio_get_req_batch(ctx, reqs,
+					min_t(long, nr - i, AIO_SUBMIT_BATCH));
+		if (unlikely(!got)) {
+			ret = -EAGAIN;
 			break;
 		}
 
-		if (unlikely(copy_from_user(&tmp, user_iocb, sizeof(tmp)))) {
-			ret = -EFAULT;
-			break;
+		for (j = 0; j < got; j++) {
+			struct iocb __user *user_iocb;
+			struct iocb tmp;
+
+			if (unlikely(__get_user(user_iocb, iocbpp + i + j))) {
+				ret = -EFAULT;
+				break;
+			}
+
+			if (unlikely(copy_from_user(&tmp, user_iocb,
+						    sizeof(tmp)))) {
+				ret = -EFAULT;
+				break;
+			}
+
+			ret = aio_prep_req(reqs[j], user_iocb, &tmp);
+			if (ret)
+				break;
 		}
 
-		ret = io_submit_one(ctx, user_iocb, &tmp);
+		/* start what was set up before any failure */
+		if (j)
+			aio_run_new_reqs(ctx, reqs, j);
+		i += j;
+
+		if (j < got && reqs[j]->ki_filp) {
+			aio_put_req(reqs[j]);	/* drop extra ref to req */
+			aio_put_req(reqs[j]);	/* drop i/o ref to req */
+			j++;
+		}
+		if (j < got)
+			aio_put_unused_reqs(ctx, reqs + j, got - j);
 		if (ret)
 			break;
 	}
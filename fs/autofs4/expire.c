@@ -292,8 +292,10 @@ next:
 		DPRINTK("returning %p %.*s",
 			expired, (int)expired->d_name.len, expired->d_name.name);
 		spin_lock(&dcache_lock);
+		spin_lock(&expired->d_parent->d_lock);
 		list_del(&expired->d_parent->d_subdirs);
 		list_add(&expired->d_parent->d_subdirs, &expired->d_child);
+		spin_unlock(&expired->d_parent->d_lock);
 		spin_unlock(&dcache_lock);
 		return expired;
 	}
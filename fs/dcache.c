@@ -32,6 +32,8 @@
 #include <linux/seqlock.h>
 #include <linux/swap.h>
 #include <linux/bootmem.h>
+#include <linux/percpu.h>
+#include <linux/sysctl.h>
 
 /* #define DCACHE_DEBUG 1 */
 
@@ -60,13 +62,31 @@ static kmem_cache_t *dentry_cache;
 static unsigned int d_hash_mask;
 static unsigned int d_hash_shift;
 static struct hlist_head *dentry_hashtable;
-static LIST_HEAD(dentry_unused);
+
+/*
+ * The hash chains (and the sb->s_anon lists of disconnected dentries)
+ * are protected by an array of bucket locks, so that dentries hashed
+ * and unhashed on different CPUs rarely meet on the same lock.  A lock
+ * is picked by the address of the chain head.  Nests inside d_lock.
+ */
+#define D_HASH_LOCK_BITS	8
+#define D_HASH_LOCKS		(1 << D_HASH_LOCK_BITS)
+
+static spinlock_t dcache_hash_locks[D_HASH_LOCKS] __cacheline_aligned_in_smp;
+
+static inline spinlock_t *d_hash_lock(struct hlist_head *head)
+{
+	return &dcache_hash_locks[hash_ptr(head, D_HASH_LOCK_BITS)];
+}
 
 /* Statistics gathering. */
 struct dentry_stat_t dentry_stat = {
 	.age_limit = 45,
 };
 
+/* dentry_stat.nr_dentry is summed from this by proc_nr_dentry() */
+static DEFINE_PER_CPU(int, nr_dentry);
+
 static void d_callback(struct rcu_head *head)
 {
 	struct dentry * dentry = container_of(head, struct dentry, d_rcu);
@@ -77,8 +97,7 @@ static void d_callback(struct rcu_head *head)
 }
 
 /*
- * no dcache_lock, please.  The caller must decrement dentry_stat.nr_dentry
- * inside dcache_lock.
+ * no dcache_lock, please.  The caller must have decremented nr_dentry.
  */
 static void d_free(struct dentry *dentry)
 {
@@ -87,6 +106,18 @@ static void d_free(struct dentry *dentry)
  	call_rcu(&dentry->d_rcu, d_callback);
 }
 
+/*
+ * Change d_inode of a dentry that RCU path walkers may be looking at.
+ * The sequence bump tells them to drop anything they read through the
+ * old value.  Called with d_lock held, which serializes d_seq writers.
+ */
+static inline void d_set_inode(struct dentry *dentry, struct inode *inode)
+{
+	write_seqcount_begin(&dentry->d_seq);
+	dentry->d_inode = inode;
+	write_seqcount_end(&dentry->d_seq);
+}
+
 /*
  * Release the dentry's inode, using the filesystem
  * d_iput() operation if defined.
@@ -96,7 +127,7 @@ static inline void dentry_iput(struct dentry * dentry)
 {
 	struct inode *inode = dentry->d_inode;
 	if (inode) {
-		dentry->d_inode = NULL;
+		d_set_inode(dentry, NULL);
 		list_del_init(&dentry->d_alias);
 		spin_unlock(&dentry->d_lock);
 		spin_unlock(&dcache_lock);
@@ -110,6 +141,76 @@ static inline void dentry_iput(struct dentry * dentry)
 	}
 }
 
+/*
+ * The unused dentries of a superblock sit on its s_dentry_lru list,
+ * under s_dentry_lru_lock.  The list is allowed to hold dentries that
+ * are in use again (see d_lookup()); whoever walks it skips them.
+ */
+static void dentry_lru_add(struct dentry *dentry)
+{
+	struct super_block *sb = dentry->d_sb;
+
+	spin_lock(&sb->s_dentry_lru_lock);
+	if (list_empty(&dentry->d_lru)) {
+		list_add(&dentry->d_lru, &sb->s_dentry_lru);
+		sb->s_nr_dentry_unused++;
+	}
+	spin_unlock(&sb->s_dentry_lru_lock);
+}
+
+/* Put a dentry at the cold end of the list, where pruning starts */
+static void dentry_lru_add_tail(struct dentry *dentry)
+{
+	struct super_block *sb = dentry->d_sb;
+
+	spin_lock(&sb->s_dentry_lru_lock);
+	if (list_empty(&dentry->d_lru))
+		sb->s_nr_dentry_unused++;
+	list_move_tail(&dentry->d_lru, &sb->s_dentry_lru);
+	spin_unlock(&sb->s_dentry_lru_lock);
+}
+
+static void dentry_lru_del(struct dentry *dentry)
+{
+	struct super_block *sb = dentry->d_sb;
+
+	if (list_empty(&dentry->d_lru))
+		return;
+	spin_lock(&sb->s_dentry_lru_lock);
+	if (!list_empty(&dentry->d_lru)) {
+		list_del_init(&dentry->d_lru);
+		sb->s_nr_dentry_unused--;
+	}
+	spin_unlock(&sb->s_dentry_lru_lock);
+}
+
+/*
+ * Add a dentry to its parent's list of children.  Called with
+ * parent->d_lock held; walkers holding only dcache_lock may be
+ * looking at the list.
+ */
+static inline void d_link_child(struct dentry *dentry)
+{
+	list_add_rcu(&dentry->d_child, &dentry->d_parent->d_subdirs);
+}
+
+/*
+ * Take a dentry off its parent's list of children.  Called with
+ * dcache_lock and dentry->d_lock held.
+ */
+static void d_unlink_child(struct dentry *dentry)
+{
+	struct dentry *parent = dentry->d_parent;
+
+	if (parent == dentry) {
+		list_del(&dentry->d_child);
+		return;
+	}
+	spin_lock(&parent->d_lock);
+	list_del(&dentry->d_child);
+	spin_unlock(&parent->d_lock);
+}
+
 /* 
  * This is dput
  *
@@ -147,50 +248,51 @@ void dput(struct dentry *dentry)
 repeat:
 	if (atomic_read(&dentry->d_count) == 1)
 		might_sleep();
-	if (!atomic_dec_and_lock(&dentry->d_count, &dcache_lock))
-		return;
-
-	spin_lock(&dentry->d_lock);
-	if (atomic_read(&dentry->d_count)) {
-		spin_unlock(&dentry->d_lock);
-		spin_unlock(&dcache_lock);
+	if (!atomic_dec_and_lock(&dentry->d_count, &dentry->d_lock))
 		return;
-	}
 
 	/*
 	 * AV: ->d_delete() is _NOT_ allowed to block now.
 	 */
 	if (dentry->d_op && dentry->d_op->d_delete) {
 		if (dentry->d_op->d_delete(dentry))
-			goto unhash_it;
+			__d_drop(dentry);
 	}
 	/* Unreachable? Get rid of it */
  	if (d_unhashed(dentry))
 		goto kill_it;
   	if (list_empty(&dentry->d_lru)) {
   		dentry->d_flags |= DCACHE_REFERENCED;
-  		list_add(&dentry->d_lru, &dentry_unused);
-  		dentry_stat.nr_unused++;
+		dentry_lru_add(dentry);
   	}
  	spin_unlock(&dentry->d_lock);
-	spin_unlock(&dcache_lock);
 	return;
 
-unhash_it:
-	__d_drop(dentry);
-
 kill_it: {
 		struct dentry *parent;
 
-		/* If dentry was on d_lru list
-		 * delete it from there
+		/*
+		 * Taking the dentry off the tree needs dcache_lock, which
+		 * nests outside d_lock.  If we have to drop d_lock to get
+		 * it, hold a reference meanwhile so that prune_dcache()
+		 * keeps away, and leave the dentry to whoever picked it up
+		 * in the window.
 		 */
-  		if (!list_empty(&dentry->d_lru)) {
-  			list_del(&dentry->d_lru);
-  			dentry_stat.nr_unused--;
-  		}
-  		list_del(&dentry->d_child);
-		dentry_stat.nr_dentry--;	/* For d_free, below */
+		if (!spin_trylock(&dcache_lock)) {
+			atomic_inc(&dentry->d_count);
+			spin_unlock(&dentry->d_lock);
+			spin_lock(&dcache_lock);
+			spin_lock(&dentry->d_lock);
+			if (!atomic_dec_and_test(&dentry->d_count))
+				goto busy;
+		} else if (atomic_read(&dentry->d_count))
+			goto busy;
+
+		__d_drop(dentry);
+		dentry_lru_del(dentry);
+		d_unlink_child(dentry);
+		get_cpu_var(nr_dentry)--;	/* For d_free, below */
+		put_cpu_var(nr_dentry);
 		/*drops the locks, at that point nobody can reach this dentry */
 		dentry_iput(dentry);
 		parent = dentry->d_parent;
@@ -200,6 +302,9 @@ kill_it: {
 		dentry = parent;
 		goto repeat;
 	}
+busy:
+	spin_unlock(&dentry->d_lock);
+	spin_unlock(&dcache_lock);
 }
 
 /**
@@ -264,10 +369,7 @@ int d_invalidate(struct dentry * dentry)
 static inline struct dentry * __dget_locked(struct dentry *dentry)
 {
 	atomic_inc(&dentry->d_count);
-	if (!list_empty(&dentry->d_lru)) {
-		dentry_stat.nr_unused--;
-		list_del_init(&dentry->d_lru);
-	}
+	dentry_lru_del(dentry);
 	return dentry;
 }
 
@@ -340,13 +442,16 @@ restart:
 	tmp = head;
 	while ((tmp = tmp->next) != head) {
 		struct dentry *dentry = list_entry(tmp, struct dentry, d_alias);
+		spin_lock(&dentry->d_lock);
 		if (!atomic_read(&dentry->d_count)) {
 			__dget_locked(dentry);
 			__d_drop(dentry);
+			spin_unlock(&dentry->d_lock);
 			spin_unlock(&dcache_lock);
 			dput(dentry);
 			goto restart;
 		}
+		spin_unlock(&dentry->d_lock);
 	}
 	spin_unlock(&dcache_lock);
 }
@@ -355,15 +460,17 @@ restart:
  * Throw away a dentry - free the inode, dput the parent.
  * This requires that the LRU list has already been
  * removed.
- * Called with dcache_lock, drops it and then regains.
+ * Called with dcache_lock and d_lock, drops them and then
+ * regains dcache_lock.
  */
 static inline void prune_one_dentry(struct dentry * dentry)
 {
 	struct dentry * parent;
 
 	__d_drop(dentry);
-	list_del(&dentry->d_child);
-	dentry_stat.nr_dentry--;	/* For d_free, below */
+	d_unlink_child(dentry);
+	get_cpu_var(nr_dentry)--;	/* For d_free, below */
+	put_cpu_var(nr_dentry);
 	dentry_iput(dentry);
 	parent = dentry->d_parent;
 	d_free(dentry);
@@ -372,71 +479,119 @@ static inline void prune_one_dentry(struct dentry * dentry)
 	spin_lock(&dcache_lock);
 }
 
-/**
- * prune_dcache - shrink the dcache
- * @count: number of entries to try and free
- *
- * Shrink the dcache. This is done when we need
- * more memory, or simply when we need to unmount
- * something (at which point we need to unuse
- * all dentries).
- *
- * This function may fail to free any resources if
- * all the dentries are in use.
+/*
+ * Free up to @count unused dentries from the cold end of the unused
+ * list of @sb.  Recently referenced dentries get another trip round
+ * the list, unless @all is set.  Called with dcache_lock held.
  */
- 
-static void prune_dcache(int count)
+static void __prune_dcache_sb(struct super_block *sb, int count, int all)
 {
-	spin_lock(&dcache_lock);
-	for (; count ; count--) {
+	while (count > 0) {
 		struct dentry *dentry;
-		struct list_head *tmp;
 
 		cond_resched_lock(&dcache_lock);
 
-		tmp = dentry_unused.prev;
-		if (tmp == &dentry_unused)
+		spin_lock(&sb->s_dentry_lru_lock);
+		if (list_empty(&sb->s_dentry_lru)) {
+			spin_unlock(&sb->s_dentry_lru_lock);
 			break;
-		list_del_init(tmp);
-		prefetch(dentry_unused.prev);
- 		dentry_stat.nr_unused--;
-		dentry = list_entry(tmp, struct dentry, d_lru);
+		}
+		dentry = list_entry(sb->s_dentry_lru.prev, struct dentry, d_lru);
+		/* d_lock nests outside the LRU lock: back off and retry */
+		if (!spin_trylock(&dentry->d_lock)) {
+			spin_unlock(&sb->s_dentry_lru_lock);
+			cpu_relax();
+			continue;
+		}
+		list_del_init(&dentry->d_lru);
+		sb->s_nr_dentry_unused--;
+		spin_unlock(&sb->s_dentry_lru_lock);
+		count--;
 
- 		spin_lock(&dentry->d_lock);
 		/*
 		 * We found an inuse dentry which was not removed from
-		 * dentry_unused because of laziness during lookup.  Do not free
-		 * it - just keep it off the dentry_unused list.
+		 * the unused list because of laziness during lookup.  Do
+		 * not free it - just keep it off the unused list.
 		 */
  		if (atomic_read(&dentry->d_count)) {
  			spin_unlock(&dentry->d_lock);
 			continue;
 		}
 		/* If the dentry was recently referenced, don't free it. */
-		if (dentry->d_flags & DCACHE_REFERENCED) {
+		if (!all && (dentry->d_flags & DCACHE_REFERENCED)) {
 			dentry->d_flags &= ~DCACHE_REFERENCED;
- 			list_add(&dentry->d_lru, &dentry_unused);
- 			dentry_stat.nr_unused++;
+			dentry_lru_add(dentry);
  			spin_unlock(&dentry->d_lock);
 			continue;
 		}
 		prune_one_dentry(dentry);
 	}
-	spin_unlock(&dcache_lock);
 }
 
-/*
- * Shrink the dcache for the specified super block.
- * This allows us to unmount a device without disturbing
- * the dcache for the other devices.
+/* Number of dentries on the unused lists of all superblocks */
+static int dentry_unused_count(void)
+{
+	struct super_block *sb;
+	int unused = 0;
+
+	spin_lock(&sb_lock);
+	list_for_each_entry(sb, &super_blocks, s_list)
+		unused += sb->s_nr_dentry_unused;
+	spin_unlock(&sb_lock);
+	return unused;
+}
+
+/**
+ * prune_dcache - shrink the dcache
+ * @count: number of entries to try and free
  *
- * This implementation makes just two traversals of the
- * unused list.  On the first pass we move the selected
- * dentries to the most recent end, and on the second
- * pass we free them.  The second pass must restart after
- * each dput(), but since the target dentries are all at
- * the end, it's really just a single traversal.
+ * Shrink the dcache when we need more memory.  The unused lists
+ * are kept per superblock, so each superblock gives up a share of
+ * @count proportional to the number of unused dentries it has.
+ *
+ * This function may fail to free any resources if
+ * all the dentries are in use.
  */
+ 
+static void prune_dcache(int count)
+{
+	struct super_block *sb;
+	int unused = dentry_unused_count();
+	int ratio;
+
+	if (!unused)
+		return;
+	ratio = count < unused ? unused / count : 1;
+
+	spin_lock(&sb_lock);
+restart:
+	list_for_each_entry(sb, &super_blocks, s_list) {
+		int nr = sb->s_nr_dentry_unused;
+
+		if (!nr)
+			continue;
+		nr = nr / ratio + 1;
+		sb->s_count++;
+		spin_unlock(&sb_lock);
+		/*
+		 * Leave superblocks being set up or torn down alone; see
+		 * generic_shutdown_super().
+		 */
+		if (down_read_trylock(&sb->s_umount)) {
+			if (sb->s_root) {
+				spin_lock(&dcache_lock);
+				__prune_dcache_sb(sb, nr, 0);
+				spin_unlock(&dcache_lock);
+			}
+			up_read(&sb->s_umount);
+		}
+		count -= nr;
+		spin_lock(&sb_lock);
+		if (__put_super_and_need_restart(sb) && count > 0)
+			goto restart;
+	}
+	spin_unlock(&sb_lock);
+}
 
 /**
  * shrink_dcache_sb - shrink dcache for a superblock
@@ -449,46 +604,8 @@ static void prune_dcache(int count)
 
 void shrink_dcache_sb(struct super_block * sb)
 {
-	struct list_head *tmp, *next;
-	struct dentry *dentry;
-
-	/*
-	 * Pass one ... move the dentries for the specified
-	 * superblock to the most recent end of the unused list.
-	 */
 	spin_lock(&dcache_lock);
-	next = dentry_unused.next;
-	while (next != &dentry_unused) {
-		tmp = next;
-		next = tmp->next;
-		dentry = list_entry(tmp, struct dentry, d_lru);
-		if (dentry->d_sb != sb)
-			continue;
-		list_del(tmp);
-		list_add(tmp, &dentry_unused);
-	}
-
-	/*
-	 * Pass two ... free the dentries for this superblock.
-	 */
-repeat:
-	next = dentry_unused.next;
-	while (next != &dentry_unused) {
-		tmp = next;
-		next = tmp->next;
-		dentry = list_entry(tmp, struct dentry, d_lru);
-		if (dentry->d_sb != sb)
-			continue;
-		dentry_stat.nr_unused--;
-		list_del_init(tmp);
-		spin_lock(&dentry->d_lock);
-		if (atomic_read(&dentry->d_count)) {
-			spin_unlock(&dentry->d_lock);
-			continue;
-		}
-		prune_one_dentry(dentry);
-		goto repeat;
-	}
+	__prune_dcache_sb(sb, INT_MAX, 1);
 	spin_unlock(&dcache_lock);
 }
 
@@ -547,7 +664,7 @@ positive:
 /*
  * Search the dentry child list for the specified parent,
  * and move any unused dentries to the end of the unused
- * list for prune_dcache(). We descend to the next level
+ * list of the superblock. We descend to the next level
  * whenever the d_subdirs list is non-empty and continue
  * searching.
  *
@@ -573,19 +690,15 @@ resume:
 		struct dentry *dentry = list_entry(tmp, struct dentry, d_child);
 		next = tmp->next;
 
-		if (!list_empty(&dentry->d_lru)) {
-			dentry_stat.nr_unused--;
-			list_del_init(&dentry->d_lru);
-		}
 		/* 
 		 * move only zero ref count dentries to the end 
-		 * of the unused list for prune_dcache
+		 * of the unused list for pruning
 		 */
 		if (!atomic_read(&dentry->d_count)) {
-			list_add(&dentry->d_lru, dentry_unused.prev);
-			dentry_stat.nr_unused++;
+			dentry_lru_add_tail(dentry);
 			found++;
-		}
+		} else
+			dentry_lru_del(dentry);
 
 		/*
 		 * We can return to the caller if we have found some (this
@@ -635,8 +748,11 @@ void shrink_dcache_parent(struct dentry * parent)
 {
 	int found;
 
-	while ((found = select_parent(parent)) != 0)
-		prune_dcache(found);
+	while ((found = select_parent(parent)) != 0) {
+		spin_lock(&dcache_lock);
+		__prune_dcache_sb(parent->d_sb, found, 0);
+		spin_unlock(&dcache_lock);
+	}
 }
 
 /**
@@ -646,35 +762,35 @@ void shrink_dcache_parent(struct dentry * parent)
  * Prune the dentries that are anonymous
  *
  * parsing d_hash list does not hlist_for_each_rcu() as it
- * done under dcache_lock.
+ * done under its hash lock.
  *
  */
 void shrink_dcache_anon(struct hlist_head *head)
 {
+	struct super_block *sb = container_of(head, struct super_block, s_anon);
+	spinlock_t *lock = d_hash_lock(head);
 	struct hlist_node *lp;
 	int found;
 	do {
 		found = 0;
 		spin_lock(&dcache_lock);
+		spin_lock(lock);
 		hlist_for_each(lp, head) {
 			struct dentry *this = hlist_entry(lp, struct dentry, d_hash);
-			if (!list_empty(&this->d_lru)) {
-				dentry_stat.nr_unused--;
-				list_del_init(&this->d_lru);
-			}
 
 			/* 
 			 * move only zero ref count dentries to the end 
-			 * of the unused list for prune_dcache
+			 * of the unused list for pruning
 			 */
 			if (!atomic_read(&this->d_count)) {
-				list_add_tail(&this->d_lru, &dentry_unused);
-				dentry_stat.nr_unused++;
+				dentry_lru_add_tail(this);
 				found++;
-			}
+			} else
+				dentry_lru_del(this);
 		}
+		spin_unlock(lock);
+		__prune_dcache_sb(sb, found, 0);
 		spin_unlock(&dcache_lock);
-		prune_dcache(found);
 	} while(found);
 }
 
@@ -697,7 +813,23 @@ static int shrink_dcache_memory(int nr, unsigned int gfp_mask)
 			return -1;
 		prune_dcache(nr);
 	}
-	return (dentry_stat.nr_unused / 100) * sysctl_vfs_cache_pressure;
+	return (dentry_unused_count() / 100) * sysctl_vfs_cache_pressure;
+}
+
+/*
+ * The counters behind dentry_stat are spread out, add them up for
+ * /proc/sys/fs/dentry-state.
+ */
+int proc_nr_dentry(ctl_table *table, int write, struct file *filp,
+		   void __user *buffer, size_t *lenp, loff_t *ppos)
+{
+	int cpu, nr = 0;
+
+	for_each_cpu(cpu)
+		nr += per_cpu(nr_dentry, cpu);
+	dentry_stat.nr_dentry = nr < 0 ? 0 : nr;
+	dentry_stat.nr_unused = dentry_unused_count();
+	return proc_dointvec(table, write, filp, buffer, lenp, ppos);
 }
 
 /**
@@ -738,6 +870,7 @@ struct dentry *d_alloc(struct dentry * parent, const struct qstr *name)
 	atomic_set(&dentry->d_count, 1);
 	dentry->d_flags = DCACHE_UNHASHED;
 	spin_lock_init(&dentry->d_lock);
+	seqcount_init(&dentry->d_seq);
 	dentry->d_inode = NULL;
 	dentry->d_parent = NULL;
 	dentry->d_sb = NULL;
@@ -753,15 +886,15 @@ struct dentry *d_alloc(struct dentry * parent, const struct qstr *name)
 	if (parent) {
 		dentry->d_parent = dget(parent);
 		dentry->d_sb = parent->d_sb;
+		spin_lock(&parent->d_lock);
+		d_link_child(dentry);
+		spin_unlock(&parent->d_lock);
 	} else {
 		INIT_LIST_HEAD(&dentry->d_child);
 	}
 
-	spin_lock(&dcache_lock);
-	if (parent)
-		list_add(&dentry->d_child, &parent->d_subdirs);
-	dentry_stat.nr_dentry++;
-	spin_unlock(&dcache_lock);
+	get_cpu_var(nr_dentry)++;
+	put_cpu_var(nr_dentry);
 
 	return dentry;
 }
@@ -797,7 +930,9 @@ void d_instantiate(struct dentry *entry, struct inode * inode)
 	spin_lock(&dcache_lock);
 	if (inode)
 		list_add(&entry->d_alias, &inode->i_dentry);
-	entry->d_inode = inode;
+	spin_lock(&entry->d_lock);
+	d_set_inode(entry, inode);
+	spin_unlock(&entry->d_lock);
 	spin_unlock(&dcache_lock);
 	security_d_instantiate(entry, inode);
 }
@@ -843,7 +978,9 @@ struct dentry *d_instantiate_unique(struct dentry *entry, struct inode *inode)
 	}
 	list_add(&entry->d_alias, &inode->i_dentry);
 do_negative:
-	entry->d_inode = inode;
+	spin_lock(&entry->d_lock);
+	d_set_inode(entry, inode);
+	spin_unlock(&entry->d_lock);
 	spin_unlock(&dcache_lock);
 	security_d_instantiate(entry, inode);
 	return NULL;
@@ -884,6 +1021,45 @@ static inline struct hlist_head *d_hash(struct dentry *parent,
 	return dentry_hashtable + (hash & D_HASHMASK);
 }
 
+/* The chain a hashed dentry is on; stable under its d_lock */
+static inline struct hlist_head *d_hash_head(struct dentry *dentry)
+{
+	if (IS_ROOT(dentry))
+		return &dentry->d_sb->s_anon;
+	return d_hash(dentry->d_parent, dentry->d_name.hash);
+}
+
+/**
+ * __d_drop - unhash a dentry
+ * @dentry: dentry to unhash
+ *
+ * See d_drop().  Called with dentry->d_lock held.
+ */
+void __d_drop(struct dentry *dentry)
+{
+	if (!(dentry->d_flags & DCACHE_UNHASHED)) {
+		spinlock_t *lock = d_hash_lock(d_hash_head(dentry));
+
+		write_seqcount_begin(&dentry->d_seq);
+		spin_lock(lock);
+		dentry->d_flags |= DCACHE_UNHASHED;
+		hlist_del_rcu(&dentry->d_hash);
+		spin_unlock(lock);
+		write_seqcount_end(&dentry->d_seq);
+	}
+}
+
+/* Called with dentry->d_lock held */
+static void __d_rehash(struct dentry * entry, struct hlist_head *list)
+{
+	spinlock_t *lock = d_hash_lock(list);
+
+	spin_lock(lock);
+ 	entry->d_flags &= ~DCACHE_UNHASHED;
+ 	hlist_add_head_rcu(&entry->d_hash, list);
+	spin_unlock(lock);
+}
+
 /**
  * d_alloc_anon - allocate an anonymous dentry
  * @inode: inode to allocate the dentry for
@@ -930,11 +1106,10 @@ struct dentry * d_alloc_anon(struct inode *inode)
 		spin_lock(&res->d_lock);
 		res->d_sb = inode->i_sb;
 		res->d_parent = res;
-		res->d_inode = inode;
+		d_set_inode(res, inode);
 		res->d_flags |= DCACHE_DISCONNECTED;
-		res->d_flags &= ~DCACHE_UNHASHED;
 		list_add(&res->d_alias, &inode->i_dentry);
-		hlist_add_head(&res->d_hash, &inode->i_sb->s_anon);
+		__d_rehash(res, &inode->i_sb->s_anon);
 		spin_unlock(&res->d_lock);
 
 		inode = NULL; /* don't drop reference */
@@ -982,7 +1157,9 @@ struct dentry *d_splice_alias(struct inode *inode, struct dentry *dentry)
 		} else {
 			/* d_instantiate takes dcache_lock, so we do it by hand */
 			list_add(&dentry->d_alias, &inode->i_dentry);
-			dentry->d_inode = inode;
+			spin_lock(&dentry->d_lock);
+			d_set_inode(dentry, inode);
+			spin_unlock(&dentry->d_lock);
 			spin_unlock(&dcache_lock);
 			security_d_instantiate(dentry, inode);
 			d_rehash(dentry);
@@ -1013,10 +1190,10 @@ struct dentry *d_splice_alias(struct inode *inode, struct dentry *dentry)
  * rcu_read_lock() and rcu_read_unlock() are used to disable preemption while
  * lookup is going on.
  *
- * dentry_unused list is not updated even if lookup finds the required dentry
- * in there. It is updated in places such as prune_dcache, shrink_dcache_sb,
- * select_parent and __dget_locked. This laziness saves lookup from dcache_lock
- * acquisition.
+ * The superblock's unused list is not updated even if lookup finds the
+ * required dentry in there. It is updated in places such as prune_dcache,
+ * shrink_dcache_sb, select_parent and __dget_locked. This laziness saves
+ * lookup from taking the LRU lock.
  *
  * d_lookup() is protected against the concurrent renames in some unrelated
  * directory using the seqlockt_t rename_lock.
@@ -1097,6 +1274,55 @@ next:
  	return found;
 }
 
+/**
+ * __d_lookup_rcu - search for a dentry without taking a reference
+ * @parent: parent dentry
+ * @name: qstr of name we wish to find
+ * @seqp: returns the d_seq value the dentry was found under
+ *
+ * For the RCU path walk: must be called under rcu_read_lock(), and
+ * only for a parent without ->d_compare.  Nothing read here is stable;
+ * the caller has to check read_seqcount_retry() on the returned
+ * dentry's d_seq with *@seqp before trusting the result or anything
+ * it reads through it.  A miss may be a false negative caused by a
+ * concurrent d_move().
+ */
+struct dentry * __d_lookup_rcu(struct dentry * parent, struct qstr * name,
+			       unsigned *seqp)
+{
+	unsigned int len = name->len;
+	unsigned int hash = name->hash;
+	const unsigned char *str = name->name;
+	struct hlist_head *head = d_hash(parent,hash);
+	struct hlist_node *node;
+
+	hlist_for_each_rcu(node, head) {
+		struct dentry *dentry;
+		struct qstr *qstr;
+		unsigned seq;
+
+		dentry = hlist_entry(node, struct dentry, d_hash);
+
+		if (dentry->d_name.hash != hash)
+			continue;
+
+		seq = read_seqcount_begin(&dentry->d_seq);
+		if (dentry->d_parent != parent)
+			continue;
+		if (d_unhashed(dentry))
+			continue;
+		qstr = &dentry->d_name;
+		if (qstr->len != len)
+			continue;
+		if (memcmp(qstr->name, str, len))
+			continue;
+
+		*seqp = seq;
+		return dentry;
+	}
+	return NULL;
+}
+
 /**
  * d_validate - verify dentry provided from insecure source
  * @dentry: The dentry alleged to be valid child of @dparent
@@ -1113,6 +1339,7 @@ int d_validate(struct dentry *dentry, struct dentry *dparent)
 {
 	struct hlist_head *base;
 	struct hlist_node *lhp;
+	spinlock_t *lock;
 
 	/* Check whether the ptr might be valid at all.. */
 	if (!kmem_ptr_validate(dentry_cache, dentry))
@@ -1123,16 +1350,20 @@ int d_validate(struct dentry *dentry, struct dentry *dparent)
 
 	spin_lock(&dcache_lock);
 	base = d_hash(dparent, dentry->d_name.hash);
+	lock = d_hash_lock(base);
+	spin_lock(lock);
 	hlist_for_each(lhp,base) { 
 		/* hlist_for_each_rcu() not required for d_hash list
-		 * as it is parsed under dcache_lock
+		 * as it is parsed under its hash lock
 		 */
 		if (dentry == hlist_entry(lhp, struct dentry, d_hash)) {
 			__dget_locked(dentry);
+			spin_unlock(lock);
 			spin_unlock(&dcache_lock);
 			return 1;
 		}
 	}
+	spin_unlock(lock);
 	spin_unlock(&dcache_lock);
 out:
 	return 0;
@@ -1178,13 +1409,6 @@ void d_delete(struct dentry * dentry)
 	spin_unlock(&dcache_lock);
 }
 
-static void __d_rehash(struct dentry * entry, struct hlist_head *list)
-{
-
- 	entry->d_flags &= ~DCACHE_UNHASHED;
- 	hlist_add_head_rcu(&entry->d_hash, list);
-}
-
 /**
  * d_rehash	- add an entry back to the hash
  * @entry: dentry to add to the hash
@@ -1194,13 +1418,9 @@ static void __d_rehash(struct dentry * entry, struct hlist_head *list)
  
 void d_rehash(struct dentry * entry)
 {
-	struct hlist_head *list = d_hash(entry->d_parent, entry->d_name.hash);
-
-	spin_lock(&dcache_lock);
 	spin_lock(&entry->d_lock);
-	__d_rehash(entry, list);
+	__d_rehash(entry, d_hash(entry->d_parent, entry->d_name.hash));
 	spin_unlock(&entry->d_lock);
-	spin_unlock(&dcache_lock);
 }
 
 #define do_switch(x,y) do { \
@@ -1278,6 +1498,7 @@ static void switch_names(struct dentry *dentry, struct dentry *target)
 void d_move(struct dentry * dentry, struct dentry * target)
 {
 	struct hlist_head *list;
+	spinlock_t *lock;
 
 	if (!dentry->d_inode)
 		printk(KERN_WARNING "VFS: moving negative dcache entry\n");
@@ -1295,21 +1516,27 @@ void d_move(struct dentry * dentry, struct dentry * target)
 		spin_lock(&target->d_lock);
 	}
 
+	/* Unhash the target: dput() will then get rid of it */
+	__d_drop(target);
+
+	write_seqcount_begin(&dentry->d_seq);
+	write_seqcount_begin(&target->d_seq);
+
 	/* Move the dentry to the target hash queue, if on different bucket */
 	if (dentry->d_flags & DCACHE_UNHASHED)
 		goto already_unhashed;
 
+	lock = d_hash_lock(d_hash_head(dentry));
+	spin_lock(lock);
 	hlist_del_rcu(&dentry->d_hash);
+	spin_unlock(lock);
 
 already_unhashed:
 	list = d_hash(target->d_parent, target->d_name.hash);
 	__d_rehash(dentry, list);
 
-	/* Unhash the target: dput() will then get rid of it */
-	__d_drop(target);
-
-	list_del(&dentry->d_child);
-	list_del(&target->d_child);
+	d_unlink_child(dentry);
+	d_unlink_child(target);
 
 	/* Switch the names.. */
 	switch_names(dentry, target);
@@ -1325,10 +1552,16 @@ already_unhashed:
 		do_switch(dentry->d_parent, target->d_parent);
 
 		/* And add them back to the (new) parent lists */
-		list_add(&target->d_child, &target->d_parent->d_subdirs);
+		spin_lock(&target->d_parent->d_lock);
+		d_link_child(target);
+		spin_unlock(&target->d_parent->d_lock);
 	}
 
-	list_add(&dentry->d_child, &dentry->d_parent->d_subdirs);
+	spin_lock(&dentry->d_parent->d_lock);
+	d_link_child(dentry);
+	spin_unlock(&dentry->d_parent->d_lock);
+	write_seqcount_end(&target->d_seq);
+	write_seqcount_end(&dentry->d_seq);
 	spin_unlock(&target->d_lock);
 	spin_unlock(&dentry->d_lock);
 	write_sequnlock(&rename_lock);
@@ -1641,6 +1874,9 @@ static void __init dcache_init_early(void)
 {
 	int loop;
 
+	for (loop = 0; loop < D_HASH_LOCKS; loop++)
+		spin_lock_init(&dcache_hash_locks[loop]);
+
 	/* If hashes are distributed across NUMA nodes, defer
 	 * hash allocation until vmalloc space is available.
 	 */
@@ -1727,7 +1963,7 @@ void __init vfs_caches_init(unsigned long mempages)
 			SLAB_HWCACHE_ALIGN|SLAB_PANIC, NULL, NULL);
 
 	filp_cachep = kmem_cache_create("filp", sizeof(struct file), 0,
-			SLAB_HWCACHE_ALIGN|SLAB_PANIC, filp_ctor, filp_dtor);
+			SLAB_HWCACHE_ALIGN|SLAB_PANIC, NULL, NULL);
 
 	dcache_init(mempages);
 	inode_init(mempages);
@@ -1737,6 +1973,7 @@ void __init vfs_caches_init(unsigned long mempages)
 	chrdev_init();
 }
 
+EXPORT_SYMBOL(__d_drop);
 EXPORT_SYMBOL(d_alloc);
 EXPORT_SYMBOL(d_alloc_anon);
 EXPORT_SYMBOL(d_alloc_root);
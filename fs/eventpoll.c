@@ -21,6 +21,7 @@
 #include <linux/errno.h>
 #include <linux/mm.h>
 #include <linux/slab.h>
+#include <linux/vmalloc.h>
 #include <linux/poll.h>
 #include <linux/smp_lock.h>
 #include <linux/string.h>
@@ -72,6 +73,12 @@
  * Events that require holding "epsem" are very rare, while for
  * normal operations the epoll private "ep->sem" will guarantee
  * a greater scalability.
+ * Eventpoll files created with EPOLL_SHARDED keep one ready list per CPU,
+ * each one protected by its own spinlock ( shard->lock ). The poll callback
+ * queues items on the shard of the CPU it runs on without taking "ep->lock",
+ * and the event collection loop drains the local shard first and then
+ * steals from the other ones. When nested, "shard->lock" is acquired after
+ * "ep->lock".
  */
 
 
@@ -96,7 +103,7 @@
 #endif /* #if DEBUG_EPI != 0 */
 
 /* Epoll private bits inside the event mask */
-#define EP_PRIVATE_BITS (EPOLLONESHOT | EPOLLET)
+#define EP_PRIVATE_BITS (EPOLLEXCLUSIVE | EPOLLONESHOT | EPOLLET)
 
 /* Maximum number of poll wake up nests we are allowing */
 #define EP_MAX_POLLWAKE_NESTS 4
@@ -151,6 +158,17 @@
 /* Tells if the epoll_ctl(2) operation needs an event copy from userspace */
 #define EP_OP_HASH_EVENT(op) ((op) != EPOLL_CTL_DEL)
 
+/* Maximum size of the shared ready ring, in pages */
+#define EP_MAX_RING_PAGES 256
+
+/* Bits inside the "state" member of the "struct epitem" ( EPOLL_SHARDED ) */
+#define EPI_QUEUED 0	/* Item is linked to a ready list shard */
+#define EPI_TXBUSY 1	/* Item is linked to a transfer list */
+
+/* Tells if the shared ready ring contains events not yet consumed */
+#define EP_RING_PENDING(ep) ((ep)->ring && \
+			     (ep)->ring->head % (ep)->ring_nr != (ep)->ring_tail)
+
 
 struct epoll_filefd {
 	struct file *file;
@@ -179,6 +197,17 @@ struct poll_safewake {
 	spinlock_t lock;
 };
 
+/*
+ * Per-CPU ready list, used by eventpoll files created with EPOLL_SHARDED.
+ */
+struct ep_rdlshard {
+	/* Protects the "rdllist" member and the "shard" member of the items */
+	spinlock_t lock;
+
+	/* List of ready file descriptors queued from this CPU */
+	struct list_head rdllist;
+} ____cacheline_aligned_in_smp;
+
 /*
  * This structure is stored inside the "private_data" member of the file
  * structure and rapresent the main data sructure for the eventpoll
@@ -207,6 +236,25 @@ struct eventpoll {
 
 	/* RB-Tree root used to store monitored fd structs */
 	struct rb_root rbr;
+
+	/*
+	 * Shared ready ring ( vmalloc()ed ), setup by the first mmap() of
+	 * the eventpoll file and released inside ep_free().
+	 */
+	struct epoll_ring *ring;
+
+	/* Size in bytes of the ring mapping */
+	unsigned long ring_size;
+
+	/* Trusted copies of the number of slots and of the producer index */
+	unsigned int ring_nr;
+	unsigned int ring_tail;
+
+	/*
+	 * Per-CPU ready lists ( alloc_percpu()ed ), used instead of "rdllist"
+	 * if the file has been created with EPOLL_SHARDED.
+	 */
+	struct ep_rdlshard *shards;
 };
 
 /* Wait structure used by the poll hooks */
@@ -270,6 +318,12 @@ struct epitem {
 	 * to pin items empty events set.
 	 */
 	unsigned int revents;
+
+	/* EPI_* bits, used by EPOLL_SHARDED files only */
+	unsigned long state;
+
+	/* Ready list shard this item is queued on ( EPOLL_SHARDED ) */
+	struct ep_rdlshard *shard;
 };
 
 /* Wrapper struct used by poll queueing */
@@ -283,7 +337,7 @@ struct ep_pqueue {
 static void ep_poll_safewake_init(struct poll_safewake *psw);
 static void ep_poll_safewake(struct poll_safewake *psw, wait_queue_head_t *wq);
 static int ep_getfd(int *efd, struct inode **einode, struct file **efile);
-static int ep_file_init(struct file *file);
+static int ep_file_init(struct file *file, int flags);
 static void ep_free(struct eventpoll *ep);
 static struct epitem *ep_find(struct eventpoll *ep, struct file *file, int fd);
 static void ep_use_epitem(struct epitem *epi);
@@ -298,14 +352,32 @@ static int ep_modify(struct eventpoll *ep, struct epitem *epi,
 static void ep_unregister_pollwait(struct eventpoll *ep, struct epitem *epi);
 static int ep_unlink(struct eventpoll *ep, struct epitem *epi);
 static int ep_remove(struct eventpoll *ep, struct epitem *epi);
+static int ep_shard_queue(struct eventpoll *ep, struct epitem *epi);
+static void ep_shard_dequeue(struct epitem *epi);
+static int ep_rdllist_linked(struct eventpoll *ep, struct epitem *epi);
+static int ep_rdllist_add(struct eventpoll *ep, struct epitem *epi);
+static void ep_rdllist_del(struct eventpoll *ep, struct epitem *epi);
+static int ep_rdllist_empty(struct eventpoll *ep);
+static void ep_wake_waiters(struct eventpoll *ep, struct epitem *epi);
+static int ep_poll_callback_sharded(struct eventpoll *ep, struct epitem *epi);
 static int ep_poll_callback(wait_queue_t *wait, unsigned mode, int sync, void *key);
 static int ep_eventpoll_close(struct inode *inode, struct file *file);
 static unsigned int ep_eventpoll_poll(struct file *file, poll_table *wait);
+static struct page *ep_ring_nopage(struct vm_area_struct *vma,
+				   unsigned long address, int *type);
+static int ep_eventpoll_mmap(struct file *file, struct vm_area_struct *vma);
+static int ep_ring_push(struct eventpoll *ep, struct epitem *epi);
+static int ep_ring_transfer(struct eventpoll *ep,
+			    struct epoll_event __user *events, int maxevents);
 static int ep_collect_ready_items(struct eventpoll *ep,
 				  struct list_head *txlist, int maxevents);
+static int ep_collect_sharded_items(struct eventpoll *ep,
+				    struct list_head *txlist, int maxevents);
 static int ep_send_events(struct eventpoll *ep, struct list_head *txlist,
 			  struct epoll_event __user *events);
 static void ep_reinject_items(struct eventpoll *ep, struct list_head *txlist);
+static void ep_reinject_sharded_items(struct eventpoll *ep,
+				      struct list_head *txlist);
 static int ep_events_transfer(struct eventpoll *ep,
 			      struct epoll_event __user *events,
 			      int maxevents);
@@ -337,7 +409,13 @@ static struct vfsmount *eventpoll_mnt;
 /* File callbacks that implement the eventpoll file behaviour */
 static struct file_operations eventpoll_fops = {
 	.release	= ep_eventpoll_close,
-	.poll		= ep_eventpoll_poll
+	.poll		= ep_eventpoll_poll,
+	.mmap		= ep_eventpoll_mmap
+};
+
+/* Memory callbacks used to map the shared ready ring inside userspace */
+static struct vm_operations_struct eventpoll_ring_vmops = {
+	.nopage		= ep_ring_nopage
 };
 
 /*
@@ -475,16 +553,35 @@ void eventpoll_release_file(struct file *file)
  */
 asmlinkage long sys_epoll_create(int size)
 {
-	int error, fd;
-	struct inode *inode;
-	struct file *file;
 
 	DNPRINTK(3, (KERN_INFO "[%p] eventpoll: sys_epoll_create(%d)\n",
 		     current, size));
 
 	/* Sanity check on the size parameter */
-	error = -EINVAL;
 	if (size <= 0)
+		return -EINVAL;
+
+	return sys_epoll_create1(0);
+}
+
+
+/*
+ * Same as sys_epoll_create(), but without the size hint and with a set
+ * of flags that select the behaviour of the eventpoll file. It is the
+ * kernel part of the userspace epoll_create1(2).
+ */
+asmlinkage long sys_epoll_create1(int flags)
+{
+	int error, fd;
+	struct inode *inode;
+	struct file *file;
+
+	DNPRINTK(3, (KERN_INFO "[%p] eventpoll: sys_epoll_create1(%d)\n",
+		     current, flags));
+
+	/* Sanity check on the flags parameter */
+	error = -EINVAL;
+	if (flags & ~EPOLL_SHARDED)
 		goto eexit_1;
 
 	/*
@@ -496,21 +593,21 @@ asmlinkage long sys_epoll_create(int size)
 		goto eexit_1;
 
 	/* Setup the file internal data structure ( "struct eventpoll" ) */
-	error = ep_file_init(file);
+	error = ep_file_init(file, flags);
 	if (error)
 		goto eexit_2;
 
 
-	DNPRINTK(3, (KERN_INFO "[%p] eventpoll: sys_epoll_create(%d) = %d\n",
-		     current, size, fd));
+	DNPRINTK(3, (KERN_INFO "[%p] eventpoll: sys_epoll_create1(%d) = %d\n",
+		     current, flags, fd));
 
 	return fd;
 
 eexit_2:
 	sys_close(fd);
 eexit_1:
-	DNPRINTK(3, (KERN_INFO "[%p] eventpoll: sys_epoll_create(%d) = %d\n",
-		     current, size, error));
+	DNPRINTK(3, (KERN_INFO "[%p] eventpoll: sys_epoll_create1(%d) = %d\n",
+		     current, flags, error));
 	return error;
 }
 
@@ -724,9 +821,10 @@ static int ep_getfd(int *efd, struct inode **einode, struct file **efile)
 	file->f_mapping = inode->i_mapping;
 
 	file->f_pos = 0;
-	file->f_flags = O_RDONLY;
+	file->f_flags = O_RDWR;
 	file->f_op = &eventpoll_fops;
-	file->f_mode = FMODE_READ;
+	/* Write access is needed to mmap() the ready ring with MAP_SHARED */
+	file->f_mode = FMODE_READ | FMODE_WRITE;
 	file->f_version = 0;
 	file->private_data = NULL;
 
@@ -749,9 +847,11 @@ eexit_1:
 }
 
 
-static int ep_file_init(struct file *file)
+static int ep_file_init(struct file *file, int flags)
 {
+	int cpu;
 	struct eventpoll *ep;
+	struct ep_rdlshard *shard;
 
 	if (!(ep = kmalloc(sizeof(struct eventpoll), GFP_KERNEL)))
 		return -ENOMEM;
@@ -764,6 +864,18 @@ static int ep_file_init(struct file *file)
 	INIT_LIST_HEAD(&ep->rdllist);
 	ep->rbr = RB_ROOT;
 
+	if (flags & EPOLL_SHARDED) {
+		if (!(ep->shards = alloc_percpu(struct ep_rdlshard))) {
+			kfree(ep);
+			return -ENOMEM;
+		}
+		for_each_cpu(cpu) {
+			shard = per_cpu_ptr(ep->shards, cpu);
+			spin_lock_init(&shard->lock);
+			INIT_LIST_HEAD(&shard->rdllist);
+		}
+	}
+
 	file->private_data = ep;
 
 	DNPRINTK(3, (KERN_INFO "[%p] eventpoll: ep_file_init() ep=%p\n",
@@ -812,6 +924,15 @@ static void ep_free(struct eventpoll *ep)
 	}
 
 	up(&epsem);
+
+	/*
+	 * No mapping of the ring can be alive at this point, since every
+	 * mapping holds a reference to the eventpoll file.
+	 */
+	if (ep->ring)
+		vfree(ep->ring);
+	if (ep->shards)
+		free_percpu(ep->shards);
 }
 
 
@@ -943,6 +1064,8 @@ static int ep_insert(struct eventpoll *ep, struct epoll_event *event,
 	epi->event = *event;
 	atomic_set(&epi->usecnt, 1);
 	epi->nwait = 0;
+	epi->state = 0;
+	epi->shard = NULL;
 
 	/* Initialize the poll table using the queue callback */
 	epq.epi = epi;
@@ -975,12 +1098,11 @@ static int ep_insert(struct eventpoll *ep, struct epoll_event *event,
 	ep_rbtree_insert(ep, epi);
 
 	/* If the file is already "ready" we drop it inside the ready list */
-	if ((revents & event->events) && !EP_IS_LINKED(&epi->rdllink)) {
-		list_add_tail(&epi->rdllink, &ep->rdllist);
+	if ((revents & event->events) && ep_rdllist_add(ep, epi)) {
 
 		/* Notify waiting tasks that events are available */
 		if (waitqueue_active(&ep->wq))
-			wake_up(&ep->wq);
+			ep_wake_waiters(ep, epi);
 		if (waitqueue_active(&ep->poll_wait))
 			pwake++;
 	}
@@ -1004,8 +1126,7 @@ eexit_2:
 	 * allocated wait queue.
 	 */
 	write_lock_irqsave(&ep->lock, flags);
-	if (EP_IS_LINKED(&epi->rdllink))
-		EP_LIST_DEL(&epi->rdllink);
+	ep_rdllist_del(ep, epi);
 	write_unlock_irqrestore(&ep->lock, flags);
 
 	EPI_MEM_FREE(epi);
@@ -1054,12 +1175,10 @@ static int ep_modify(struct eventpoll *ep, struct epitem *epi, struct epoll_even
 		 * registered inside the ready list, unlink it.
 		 */
 		if (revents & event->events) {
-			if (!EP_IS_LINKED(&epi->rdllink)) {
-				list_add_tail(&epi->rdllink, &ep->rdllist);
-
+			if (ep_rdllist_add(ep, epi)) {
 				/* Notify waiting tasks that events are available */
 				if (waitqueue_active(&ep->wq))
-					wake_up(&ep->wq);
+					ep_wake_waiters(ep, epi);
 				if (waitqueue_active(&ep->poll_wait))
 					pwake++;
 			}
@@ -1136,8 +1255,7 @@ static int ep_unlink(struct eventpoll *ep, struct epitem *epi)
 	 * If the item we are going to remove is inside the ready file descriptors
 	 * we want to remove it from this list to avoid stale events.
 	 */
-	if (EP_IS_LINKED(&epi->rdllink))
-		EP_LIST_DEL(&epi->rdllink);
+	ep_rdllist_del(ep, epi);
 
 	error = 0;
 eexit_1:
@@ -1198,6 +1316,155 @@ eexit_1:
 }
 
 
+/*
+ * Queue an item inside the ready list shard of the current CPU. Returns
+ * zero if the item was already queued on some shard. Used only by
+ * EPOLL_SHARDED files, and it can be called without holding "ep->lock".
+ */
+static int ep_shard_queue(struct eventpoll *ep, struct epitem *epi)
+{
+	unsigned long flags;
+	struct ep_rdlshard *shard;
+
+	if (test_and_set_bit(EPI_QUEUED, &epi->state))
+		return 0;
+
+	/*
+	 * Being migrated to another CPU after reading the CPU number is
+	 * harmless, we would just end up using a remote shard.
+	 */
+	shard = per_cpu_ptr(ep->shards, _smp_processor_id());
+
+	spin_lock_irqsave(&shard->lock, flags);
+	list_add_tail(&epi->rdllink, &shard->rdllist);
+	epi->shard = shard;
+	spin_unlock_irqrestore(&shard->lock, flags);
+
+	return 1;
+}
+
+
+/*
+ * Removes an item from the ready list shard it is queued on. This must
+ * be called when no poll callback can be running for the item ( that is,
+ * after ep_unregister_pollwait() ), otherwise "epi->shard" might still
+ * be unset for an item being queued.
+ */
+static void ep_shard_dequeue(struct epitem *epi)
+{
+	unsigned long flags;
+	struct ep_rdlshard *shard = epi->shard;
+
+	if (shard) {
+		spin_lock_irqsave(&shard->lock, flags);
+		EP_LIST_DEL(&epi->rdllink);
+		epi->shard = NULL;
+		clear_bit(EPI_QUEUED, &epi->state);
+		spin_unlock_irqrestore(&shard->lock, flags);
+	}
+}
+
+
+/*
+ * The following functions hide the ready list implementation ( single list
+ * or per-CPU shards ) to the callers. For non EPOLL_SHARDED files they
+ * must be called with write IRQ lock on "ep->lock".
+ */
+static int ep_rdllist_linked(struct eventpoll *ep, struct epitem *epi)
+{
+
+	if (ep->shards)
+		return test_bit(EPI_QUEUED, &epi->state);
+	return EP_IS_LINKED(&epi->rdllink);
+}
+
+
+/* Returns zero if the item was already linked to the ready list */
+static int ep_rdllist_add(struct eventpoll *ep, struct epitem *epi)
+{
+
+	if (ep->shards)
+		return ep_shard_queue(ep, epi);
+	if (EP_IS_LINKED(&epi->rdllink))
+		return 0;
+	list_add_tail(&epi->rdllink, &ep->rdllist);
+	return 1;
+}
+
+
+static void ep_rdllist_del(struct eventpoll *ep, struct epitem *epi)
+{
+
+	if (ep->shards)
+		ep_shard_dequeue(epi);
+	else if (EP_IS_LINKED(&epi->rdllink))
+		EP_LIST_DEL(&epi->rdllink);
+}
+
+
+/*
+ * Tells if the ready list is empty. Shards are checked without holding
+ * their locks, so the result is just an hint for EPOLL_SHARDED files.
+ */
+static int ep_rdllist_empty(struct eventpoll *ep)
+{
+	int cpu;
+
+	if (!ep->shards)
+		return list_empty(&ep->rdllist);
+
+	for_each_cpu(cpu)
+		if (!list_empty(&per_cpu_ptr(ep->shards, cpu)->rdllist))
+			return 0;
+	return 1;
+}
+
+
+/*
+ * Wake up the tasks sleeping inside ep_poll(). Those tasks sleep exclusive,
+ * so for EPOLLEXCLUSIVE items we wake up only one of them, avoiding the
+ * thundering herd on eventpoll files shared by many threads. The other
+ * items keep waking up all the waiters.
+ */
+static void ep_wake_waiters(struct eventpoll *ep, struct epitem *epi)
+{
+
+	if (epi->event.events & EPOLLEXCLUSIVE)
+		wake_up(&ep->wq);
+	else
+		wake_up_all(&ep->wq);
+}
+
+
+/*
+ * Poll callback used by EPOLL_SHARDED files that do not have a shared
+ * ready ring. Since it does not need "ep->lock", callbacks running on
+ * different CPUs will only touch their own ready list shard.
+ */
+static int ep_poll_callback_sharded(struct eventpoll *ep, struct epitem *epi)
+{
+
+	/* See the comment inside ep_poll_callback() about disabled items */
+	if (!(epi->event.events & ~EP_PRIVATE_BITS))
+		return 1;
+
+	ep_shard_queue(ep, epi);
+
+	/*
+	 * Waiters check the shards after having set their task state, and
+	 * we need the item to be visible before checking for waiters.
+	 */
+	smp_mb();
+
+	if (waitqueue_active(&ep->wq))
+		ep_wake_waiters(ep, epi);
+	if (waitqueue_active(&ep->poll_wait))
+		ep_poll_safewake(&psw, &ep->poll_wait);
+
+	return 1;
+}
+
+
 /*
  * This is the callback that is passed to the wait queue wakeup
  * machanism. It is called by the stored file descriptors when they
@@ -1213,6 +1480,13 @@ static int ep_poll_callback(wait_queue_t *wait, unsigned mode, int sync, void *k
 	DNPRINTK(3, (KERN_INFO "[%p] eventpoll: poll_callback(%p) epi=%p ep=%p\n",
 		     current, epi->file, epi, ep));
 
+	/*
+	 * The shared ready ring needs "ep->lock" to serialize producers, so
+	 * sharded files with a ring go through the common path.
+	 */
+	if (ep->shards && !ep->ring)
+		return ep_poll_callback_sharded(ep, epi);
+
 	write_lock_irqsave(&ep->lock, flags);
 
 	/*
@@ -1225,10 +1499,25 @@ static int ep_poll_callback(wait_queue_t *wait, unsigned mode, int sync, void *k
 		goto is_disabled;
 
 	/* If this file is already in the ready list we exit soon */
-	if (EP_IS_LINKED(&epi->rdllink))
+	if (ep_rdllist_linked(ep, epi))
 		goto is_linked;
 
-	list_add_tail(&epi->rdllink, &ep->rdllist);
+	/*
+	 * Edge triggered items do not need to be re-polled before being
+	 * reported, so we can push them directly inside the shared ready
+	 * ring ( if any ). If the ring is full we fall back to the ready list.
+	 */
+	if ((epi->event.events & EPOLLET) && ep->ring && ep_ring_push(ep, epi)) {
+		if (epi->event.events & EPOLLONESHOT)
+			epi->event.events &= EP_PRIVATE_BITS;
+		goto is_linked;
+	}
+
+	ep_rdllist_add(ep, epi);
+
+	/* Sharded waiters do not hold "ep->lock" while checking the shards */
+	if (ep->shards)
+		smp_mb();
 
 is_linked:
 	/*
@@ -1236,7 +1525,7 @@ is_linked:
 	 * wait list.
 	 */
 	if (waitqueue_active(&ep->wq))
-		wake_up(&ep->wq);
+		ep_wake_waiters(ep, epi);
 	if (waitqueue_active(&ep->poll_wait))
 		pwake++;
 
@@ -1276,7 +1565,7 @@ static unsigned int ep_eventpoll_poll(struct file *file, poll_table *wait)
 
 	/* Check our condition */
 	read_lock_irqsave(&ep->lock, flags);
-	if (!list_empty(&ep->rdllist))
+	if (!ep_rdllist_empty(ep) || EP_RING_PENDING(ep))
 		pollflags = POLLIN | POLLRDNORM;
 	read_unlock_irqrestore(&ep->lock, flags);
 
@@ -1284,6 +1573,161 @@ static unsigned int ep_eventpoll_poll(struct file *file, poll_table *wait)
 }
 
 
+static struct page *ep_ring_nopage(struct vm_area_struct *vma,
+				   unsigned long address, int *type)
+{
+	struct eventpoll *ep = vma->vm_file->private_data;
+	unsigned long offset = address - vma->vm_start;
+	struct page *page;
+
+	if (offset >= ep->ring_size)
+		return NOPAGE_SIGBUS;
+
+	page = vmalloc_to_page((char *) ep->ring + offset);
+	get_page(page);
+	if (type)
+		*type = VM_FAULT_MINOR;
+
+	return page;
+}
+
+
+/*
+ * Map the shared ready ring inside the caller address space. The first
+ * mmap() allocates the ring, by sizing it from the length of the mapping.
+ * Later mappings must have the same size of the first one.
+ */
+static int ep_eventpoll_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	int error;
+	unsigned long flags, size = vma->vm_end - vma->vm_start;
+	struct eventpoll *ep = file->private_data;
+	struct epoll_ring *ring;
+
+	/* The ring is shared with the kernel, so it cannot be copy-on-write */
+	if (!(vma->vm_flags & VM_SHARED) || vma->vm_pgoff)
+		return -EINVAL;
+
+	if (size < PAGE_SIZE || size > EP_MAX_RING_PAGES * PAGE_SIZE)
+		return -EINVAL;
+
+	down_write(&ep->sem);
+
+	error = -EINVAL;
+	if (ep->ring) {
+		if (size != ep->ring_size)
+			goto eexit_1;
+	} else {
+		error = -ENOMEM;
+		if (!(ring = vmalloc(size)))
+			goto eexit_1;
+		memset(ring, 0, size);
+
+		ring->magic = EPOLL_RING_MAGIC;
+		ring->nr = (size - sizeof(struct epoll_ring)) /
+			sizeof(struct epoll_event);
+		ring->header_length = sizeof(struct epoll_ring);
+
+		/* Make the ring visible to ep_poll_callback() */
+		write_lock_irqsave(&ep->lock, flags);
+		ep->ring_nr = ring->nr;
+		ep->ring_tail = 0;
+		ep->ring_size = size;
+		ep->ring = ring;
+		write_unlock_irqrestore(&ep->lock, flags);
+	}
+
+	vma->vm_ops = &eventpoll_ring_vmops;
+	vma->vm_flags |= VM_RESERVED | VM_DONTEXPAND;
+	error = 0;
+
+eexit_1:
+	up_write(&ep->sem);
+
+	DNPRINTK(3, (KERN_INFO "[%p] eventpoll: mmap() ep=%p size=%lu = %d\n",
+		     current, ep, size, error));
+
+	return error;
+}
+
+
+/*
+ * Push a ready item inside the shared ring. Returns zero if the ring is
+ * full. This function must be called with write IRQ lock on "ep->lock".
+ */
+static int ep_ring_push(struct eventpoll *ep, struct epitem *epi)
+{
+	struct epoll_ring *ring = ep->ring;
+	struct epoll_event *slot;
+	unsigned int tail = ep->ring_tail;
+
+	if ((tail + 1) % ep->ring_nr == ring->head % ep->ring_nr) {
+		ring->overflow++;
+		return 0;
+	}
+
+	slot = &ring->events[tail];
+	slot->events = epi->event.events & ~EP_PRIVATE_BITS;
+	slot->data = epi->event.data;
+
+	/* The slot must be visible before the consumer can see the new tail */
+	smp_wmb();
+	ep->ring_tail = (tail + 1) % ep->ring_nr;
+	ring->tail = ep->ring_tail;
+
+	return 1;
+}
+
+
+/*
+ * Drain the shared ready ring into the user buffer. Slots are contiguous,
+ * so this needs at most two copies ( one if the ring did not wrap ). The
+ * ring slots between "head" and "tail" are never touched by the producer,
+ * so we can copy them without holding "ep->lock". Concurrent consumers
+ * inside sys_epoll_wait() are detected by re-checking "head" before
+ * committing it. Userspace must not harvest the ring while another thread
+ * is consuming it through sys_epoll_wait().
+ */
+static int ep_ring_transfer(struct eventpoll *ep,
+			    struct epoll_event __user *events, int maxevents)
+{
+	int eventcnt, n;
+	unsigned long flags;
+	unsigned int head, start, tail, nr = ep->ring_nr;
+	struct epoll_ring *ring = ep->ring;
+
+retry:
+	read_lock_irqsave(&ep->lock, flags);
+	start = head = ring->head % nr;
+	tail = ep->ring_tail;
+	read_unlock_irqrestore(&ep->lock, flags);
+
+	/* Pairs with the smp_wmb() inside ep_ring_push() */
+	smp_rmb();
+
+	for (eventcnt = 0; eventcnt < maxevents && head != tail;) {
+		n = (tail > head ? tail: nr) - head;
+		if (n > maxevents - eventcnt)
+			n = maxevents - eventcnt;
+		if (__copy_to_user(&events[eventcnt], &ring->events[head],
+				   n * sizeof(struct epoll_event)))
+			return -EFAULT;
+		eventcnt += n;
+		head = (head + n) % nr;
+	}
+
+	write_lock_irqsave(&ep->lock, flags);
+	if (ring->head % nr != start) {
+		write_unlock_irqrestore(&ep->lock, flags);
+		goto retry;
+	}
+	ring->head = head;
+	write_unlock_irqrestore(&ep->lock, flags);
+
+	return eventcnt;
+}
+
+
 /*
  * Since we have to release the lock during the __copy_to_user() operation and
  * during the f_op->poll() call, we try to collect the maximum number of items
@@ -1296,6 +1740,9 @@ static int ep_collect_ready_items(struct eventpoll *ep, struct list_head *txlist
 	struct list_head *lsthead = &ep->rdllist, *lnk;
 	struct epitem *epi;
 
+	if (ep->shards)
+		return ep_collect_sharded_items(ep, txlist, maxevents);
+
 	write_lock_irqsave(&ep->lock, flags);
 
 	for (nepi = 0, lnk = lsthead->next; lnk != lsthead && nepi < maxevents;) {
@@ -1329,6 +1776,57 @@ static int ep_collect_ready_items(struct eventpoll *ep, struct list_head *txlist
 }
 
 
+/*
+ * Same as ep_collect_ready_items(), for EPOLL_SHARDED files. We drain the
+ * shard of the current CPU first, and then we steal items from the other
+ * shards. Since we do not hold "ep->lock", the EPI_TXBUSY bit replaces the
+ * "txlink" check to prevent two tasks from collecting the same item.
+ */
+static int ep_collect_sharded_items(struct eventpoll *ep,
+				    struct list_head *txlist, int maxevents)
+{
+	int nepi, i, cpu, this_cpu = _smp_processor_id();
+	unsigned long flags;
+	struct list_head *lsthead, *lnk;
+	struct ep_rdlshard *shard;
+	struct epitem *epi;
+
+	for (nepi = 0, i = 0; i < NR_CPUS && nepi < maxevents; i++) {
+		cpu = (this_cpu + i) % NR_CPUS;
+		if (!cpu_possible(cpu))
+			continue;
+		shard = per_cpu_ptr(ep->shards, cpu);
+		lsthead = &shard->rdllist;
+
+		/* Avoid touching the lock of empty remote shards */
+		if (list_empty(lsthead))
+			continue;
+
+		spin_lock_irqsave(&shard->lock, flags);
+
+		for (lnk = lsthead->next; lnk != lsthead && nepi < maxevents;) {
+			epi = list_entry(lnk, struct epitem, rdllink);
+
+			lnk = lnk->next;
+
+			if (!test_and_set_bit(EPI_TXBUSY, &epi->state)) {
+				epi->revents = epi->event.events;
+				list_add(&epi->txlink, txlist);
+				nepi++;
+
+				EP_LIST_DEL(&epi->rdllink);
+				epi->shard = NULL;
+				clear_bit(EPI_QUEUED, &epi->state);
+			}
+		}
+
+		spin_unlock_irqrestore(&shard->lock, flags);
+	}
+
+	return nepi;
+}
+
+
 /*
  * This function is called without holding the "ep->lock" since the call to
  * __copy_to_user() might sleep, and also f_op->poll() might reenable the IRQ
@@ -1392,6 +1890,11 @@ static void ep_reinject_items(struct eventpoll *ep, struct list_head *txlist)
 	unsigned long flags;
 	struct epitem *epi;
 
+	if (ep->shards) {
+		ep_reinject_sharded_items(ep, txlist);
+		return;
+	}
+
 	write_lock_irqsave(&ep->lock, flags);
 
 	while (!list_empty(txlist)) {
@@ -1433,6 +1936,42 @@ static void ep_reinject_items(struct eventpoll *ep, struct list_head *txlist)
 }
 
 
+/*
+ * Same as ep_reinject_items(), for EPOLL_SHARDED files. Items are pushed
+ * back inside the shard of the current CPU.
+ */
+static void ep_reinject_sharded_items(struct eventpoll *ep,
+				      struct list_head *txlist)
+{
+	int ricnt = 0;
+	struct epitem *epi;
+
+	while (!list_empty(txlist)) {
+		epi = list_entry(txlist->next, struct epitem, txlink);
+
+		EP_LIST_DEL(&epi->txlink);
+
+		if (EP_RB_LINKED(&epi->rbn) && !(epi->event.events & EPOLLET) &&
+		    (epi->revents & epi->event.events) && ep_shard_queue(ep, epi))
+			ricnt++;
+
+		/* The item can be collected again from now on */
+		smp_mb__before_clear_bit();
+		clear_bit(EPI_TXBUSY, &epi->state);
+	}
+
+	if (ricnt) {
+		/* Same as inside ep_poll_callback_sharded() */
+		smp_mb();
+
+		if (waitqueue_active(&ep->wq))
+			wake_up(&ep->wq);
+		if (waitqueue_active(&ep->poll_wait))
+			ep_poll_safewake(&psw, &ep->poll_wait);
+	}
+}
+
+
 /*
  * Perform the transfer of events to user space.
  */
@@ -1468,7 +2007,7 @@ static int ep_events_transfer(struct eventpoll *ep,
 static int ep_poll(struct eventpoll *ep, struct epoll_event __user *events,
 		   int maxevents, long timeout)
 {
-	int res, eavail;
+	int res, eavail, ravail, eventcnt;
 	unsigned long flags;
 	long jtimeout;
 	wait_queue_t wait;
@@ -1485,14 +2024,14 @@ retry:
 	write_lock_irqsave(&ep->lock, flags);
 
 	res = 0;
-	if (list_empty(&ep->rdllist)) {
+	if (ep_rdllist_empty(ep) && !EP_RING_PENDING(ep)) {
 		/*
 		 * We don't have any available event to return to the caller.
 		 * We need to sleep here, and we will be wake up by
 		 * ep_poll_callback() when events will become available.
 		 */
 		init_waitqueue_entry(&wait, current);
-		add_wait_queue(&ep->wq, &wait);
+		add_wait_queue_exclusive(&ep->wq, &wait);
 
 		for (;;) {
 			/*
@@ -1501,7 +2040,8 @@ retry:
 			 * to TASK_INTERRUPTIBLE before doing the checks.
 			 */
 			set_current_state(TASK_INTERRUPTIBLE);
-			if (!list_empty(&ep->rdllist) || !jtimeout)
+			if (!ep_rdllist_empty(ep) || EP_RING_PENDING(ep) ||
+			    !jtimeout)
 				break;
 			if (signal_pending(current)) {
 				res = -EINTR;
@@ -1518,19 +2058,38 @@ retry:
 	}
 
 	/* Is it worth to try to dig for events ? */
-	eavail = !list_empty(&ep->rdllist);
+	eavail = !ep_rdllist_empty(ep);
+	ravail = EP_RING_PENDING(ep);
 
 	write_unlock_irqrestore(&ep->lock, flags);
 
 	/*
-	 * Try to transfer events to user space. In case we get 0 events and
-	 * there's still timeout left over, we go trying again in search of
-	 * more luck.
+	 * Try to transfer events to user space, starting from the shared ring
+	 * since its events are older than the ones in the ready list. In case
+	 * we get 0 events and there's still timeout left over, we go trying
+	 * again in search of more luck.
 	 */
-	if (!res && eavail &&
-	    !(res = ep_events_transfer(ep, events, maxevents)) && jtimeout)
+	if (!res && ravail)
+		res = ep_ring_transfer(ep, events, maxevents);
+	if (res >= 0 && res < maxevents && eavail) {
+		eventcnt = ep_events_transfer(ep, events + res, maxevents - res);
+		if (eventcnt >= 0)
+			res += eventcnt;
+		else if (!res)
+			res = eventcnt;
+	}
+	if (!res && (eavail || ravail) && jtimeout)
 		goto retry;
 
+	/*
+	 * We sleep exclusive, so a wakeup might have been directed to us only.
+	 * If we are leaving events behind ( because of "maxevents", a signal
+	 * or an expired timeout ) we pass the wakeup to another waiter.
+	 */
+	if (waitqueue_active(&ep->wq) &&
+	    (!ep_rdllist_empty(ep) || EP_RING_PENDING(ep)))
+		wake_up(&ep->wq);
+
 	return res;
 }
 
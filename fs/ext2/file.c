@@ -52,6 +52,10 @@ struct file_operations ext2_file_operations = {
 	.fsync		= ext2_sync_file,
 	.readv		= generic_file_readv,
 	.writev		= generic_file_writev,
+	.aio_readv	= generic_file_aio_readv,
+	.aio_writev	= generic_file_aio_writev,
+	.splice_read	= generic_file_splice_read,
+	.splice_write	= generic_file_splice_write,
 	.sendfile	= generic_file_sendfile,
 };
 
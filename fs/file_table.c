@@ -16,6 +16,9 @@
 #include <linux/eventpoll.h>
 #include <linux/mount.h>
 #include <linux/cdev.h>
+#include <linux/percpu.h>
+#include <linux/percpu_counter.h>
+#include <linux/sysctl.h>
 
 /* sysctl tunables... */
 struct files_stat_struct files_stat = {
@@ -27,33 +30,40 @@ EXPORT_SYMBOL(files_stat); /* Needed by unix.o */
 /* public. Not pretty! */
  __cacheline_aligned_in_smp DEFINE_SPINLOCK(files_lock);
 
-static DEFINE_SPINLOCK(filp_count_lock);
+/*
+ * The open files of a superblock are spread over per-cpu lists, each
+ * protected by the lock of its cpu, so that open() and close() on
+ * different cpus do not share a lock.  A file stays on the list of the
+ * cpu it was opened on; f_sb_list_cpu remembers which one that is.
+ */
+static DEFINE_PER_CPU(spinlock_t, files_cpu_lock) = SPIN_LOCK_UNLOCKED;
 
-/* slab constructors and destructors are called from arbitrary
- * context and must be fully threaded - use a local spinlock
- * to protect files_stat.nr_files
+/*
+ * Number of files in use.  Only summed up exactly when we are about to
+ * refuse a file because of max_files, and for /proc/sys/fs/file-nr.
  */
-void filp_ctor(void * objp, struct kmem_cache_s *cachep, unsigned long cflags)
+static struct percpu_counter nr_files;
+
+/*
+ * Return the approximate number of files in use.
+ */
+int get_nr_files(void)
 {
-	if ((cflags & (SLAB_CTOR_VERIFY|SLAB_CTOR_CONSTRUCTOR)) ==
-	    SLAB_CTOR_CONSTRUCTOR) {
-		unsigned long flags;
-		spin_lock_irqsave(&filp_count_lock, flags);
-		files_stat.nr_files++;
-		spin_unlock_irqrestore(&filp_count_lock, flags);
-	}
+	return percpu_counter_read_positive(&nr_files);
 }
 
-void filp_dtor(void * objp, struct kmem_cache_s *cachep, unsigned long dflags)
+EXPORT_SYMBOL_GPL(get_nr_files);
+
+int proc_nr_files(ctl_table *table, int write, struct file *filp,
+		  void __user *buffer, size_t *lenp, loff_t *ppos)
 {
-	unsigned long flags;
-	spin_lock_irqsave(&filp_count_lock, flags);
-	files_stat.nr_files--;
-	spin_unlock_irqrestore(&filp_count_lock, flags);
+	files_stat.nr_files = percpu_counter_sum(&nr_files);
+	return proc_dointvec(table, write, filp, buffer, lenp, ppos);
 }
 
 static inline void file_free(struct file *f)
 {
+	percpu_counter_dec(&nr_files);
 	kmem_cache_free(filp_cachep, f);
 }
 
@@ -67,12 +77,15 @@ static int old_max;
 	struct file * f;
 
 	/*
-	 * Privileged users can go above max_files
+	 * Privileged users can go above max_files.  The cheap count may be
+	 * off by a few per cpu, so do the exact one before failing.
 	 */
-	if (files_stat.nr_files < files_stat.max_files ||
+	if (get_nr_files() < files_stat.max_files ||
+	    percpu_counter_sum(&nr_files) < files_stat.max_files ||
 				capable(CAP_SYS_ADMIN)) {
 		f = kmem_cache_alloc(filp_cachep, GFP_KERNEL);
 		if (f) {
+			percpu_counter_inc(&nr_files);
 			memset(f, 0, sizeof(*f));
 			if (security_file_alloc(f)) {
 				file_free(f);
@@ -85,6 +98,7 @@ static int old_max;
 			rwlock_init(&f->f_owner.lock);
 			/* f->f_version: 0 */
 			INIT_LIST_HEAD(&f->f_list);
+			f->f_sb_list_cpu = -1;
 			f->f_maxcount = INT_MAX;
 			return f;
 		}
@@ -198,18 +212,73 @@ void put_filp(struct file *file)
 	}
 }
 
+/*
+ * Put a newly opened file on the list of open files of @sb, on the
+ * part of it belonging to the current cpu.
+ */
+void file_sb_list_add(struct file *file, struct super_block *sb)
+{
+	int cpu = get_cpu();
+	spinlock_t *lock = &per_cpu(files_cpu_lock, cpu);
+
+	spin_lock(lock);
+	file->f_sb_list_cpu = cpu;
+	list_add(&file->f_list, per_cpu_ptr(sb->s_files, cpu));
+	spin_unlock(lock);
+	put_cpu();
+}
+
+/*
+ * Lock all the per-cpu parts of the superblock file lists.  Preemption
+ * is disabled once and the locks are then taken raw: going through
+ * spin_lock() would raise the preempt count once per cpu, which
+ * overflows it with a large NR_CPUS.
+ */
+void sb_file_list_lock(void)
+{
+	int cpu;
+
+	preempt_disable();
+	for_each_cpu(cpu)
+		_raw_spin_lock(&per_cpu(files_cpu_lock, cpu));
+}
+
+void sb_file_list_unlock(void)
+{
+	int cpu;
+
+	for_each_cpu(cpu)
+		_raw_spin_unlock(&per_cpu(files_cpu_lock, cpu));
+	preempt_enable();
+}
+
+/*
+ * Move a file to some list other than a superblock's, under files_lock.
+ */
 void file_move(struct file *file, struct list_head *list)
 {
 	if (!list)
 		return;
+	file_kill(file);
 	file_list_lock();
-	list_move(&file->f_list, list);
+	list_add(&file->f_list, list);
 	file_list_unlock();
 }
 
 void file_kill(struct file *file)
 {
-	if (!list_empty(&file->f_list)) {
+	int cpu = file->f_sb_list_cpu;
+
+	if (list_empty(&file->f_list))
+		return;
+	if (cpu >= 0) {
+		spinlock_t *lock = &per_cpu(files_cpu_lock, cpu);
+
+		spin_lock(lock);
+		list_del_init(&file->f_list);
+		file->f_sb_list_cpu = -1;
+		spin_unlock(lock);
+	} else {
 		file_list_lock();
 		list_del_init(&file->f_list);
 		file_list_unlock();
@@ -218,12 +287,11 @@ void file_kill(struct file *file)
 
 int fs_may_remount_ro(struct super_block *sb)
 {
-	struct list_head *p;
+	struct file *file;
 
 	/* Check that no files are currently opened for writing. */
-	file_list_lock();
-	list_for_each(p, &sb->s_files) {
-		struct file *file = list_entry(p, struct file, f_list);
+	sb_file_list_lock();
+	do_file_list_for_each_entry(sb, file) {
 		struct inode *inode = file->f_dentry->d_inode;
 
 		/* File with pending delete? */
@@ -233,11 +301,11 @@ int fs_may_remount_ro(struct super_block *sb)
 		/* Writeable file? */
 		if (S_ISREG(inode->i_mode) && (file->f_mode & FMODE_WRITE))
 			goto too_bad;
-	}
-	file_list_unlock();
+	} while_file_list_for_each_entry;
+	sb_file_list_unlock();
 	return 1; /* Tis' cool bro. */
 too_bad:
-	file_list_unlock();
+	sb_file_list_unlock();
 	return 0;
 }
 
@@ -252,4 +320,5 @@ void __init files_init(unsigned long mempages)
 	files_stat.max_files = n; 
 	if (files_stat.max_files < NR_FILE)
 		files_stat.max_files = NR_FILE;
+	percpu_counter_init(&nr_files);
 } 
@@ -93,6 +93,7 @@ loff_t dcache_dir_lseek(struct file *file, loff_t offset, int origin)
 			loff_t n = file->f_pos - 2;
 
 			spin_lock(&dcache_lock);
+			spin_lock(&file->f_dentry->d_lock);
 			list_del(&cursor->d_child);
 			p = file->f_dentry->d_subdirs.next;
 			while (n && p != &file->f_dentry->d_subdirs) {
@@ -103,6 +104,7 @@ loff_t dcache_dir_lseek(struct file *file, loff_t offset, int origin)
 				p = p->next;
 			}
 			list_add_tail(&cursor->d_child, p);
+			spin_unlock(&file->f_dentry->d_lock);
 			spin_unlock(&dcache_lock);
 		}
 	}
@@ -147,6 +149,7 @@ int dcache_readdir(struct file * filp, void * dirent, filldir_t filldir)
 			/* fallthrough */
 		default:
 			spin_lock(&dcache_lock);
+			spin_lock(&dentry->d_lock);
 			if (filp->f_pos == 2) {
 				list_del(q);
 				list_add(q, &dentry->d_subdirs);
@@ -157,16 +160,19 @@ int dcache_readdir(struct file * filp, void * dirent, filldir_t filldir)
 				if (d_unhashed(next) || !next->d_inode)
 					continue;
 
+				spin_unlock(&dentry->d_lock);
 				spin_unlock(&dcache_lock);
 				if (filldir(dirent, next->d_name.name, next->d_name.len, filp->f_pos, next->d_inode->i_ino, dt_type(next->d_inode)) < 0)
 					return 0;
 				spin_lock(&dcache_lock);
+				spin_lock(&dentry->d_lock);
 				/* next is still alive */
 				list_del(q);
 				list_add(q, p);
 				p = q;
 				filp->f_pos++;
 			}
+			spin_unlock(&dentry->d_lock);
 			spin_unlock(&dcache_lock);
 	}
 	return 0;
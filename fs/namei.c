@@ -369,6 +369,31 @@ ok:
 	return security_inode_permission(inode, MAY_EXEC, nd);
 }
 
+/*
+ * Variant of exec_permission_lite() for the RCU path walk.  The inode
+ * is not pinned: anything short of a plain DAC grant (->permission,
+ * capabilities, a security module without an RCU-safe hook) returns
+ * -EAGAIN and leaves the decision to the refcounted walk.
+ */
+static inline int exec_permission_rcu(struct inode *inode,
+				      struct nameidata *nd)
+{
+	umode_t	mode = inode->i_mode;
+
+	if (inode->i_op && inode->i_op->permission)
+		return -EAGAIN;
+
+	if (current->fsuid == inode->i_uid)
+		mode >>= 6;
+	else if (in_group_p(inode->i_gid))
+		mode >>= 3;
+
+	if (!(mode & MAY_EXEC))
+		return -EAGAIN;
+
+	return security_inode_permission_rcu(inode, MAY_EXEC, nd);
+}
+
 /*
  * This is called when everything else fails, and we actually have
  * to go to the low-level filesystem to find out what we should do..
@@ -673,6 +698,160 @@ fail:
 	return PTR_ERR(dentry);
 }
 
+/*
+ * RCU path walk.
+ *
+ * Every component resolved by the loop in link_path_walk() costs a
+ * dget()/dput() pair on the dentry and a spinlock in __d_lookup(), all
+ * of which bounce cachelines between CPUs walking the same directories
+ * (the root, /usr, /usr/lib...).  When the path is entirely in the
+ * dcache we can do better: walk it under rcu_read_lock() without
+ * touching d_count or d_lock, and only take a reference on the dentry
+ * we end up at.
+ *
+ * Nothing read during such a walk is stable.  Dentries are freed by
+ * RCU, so they stay around, and on filesystems flagged FS_RCU_WALK the
+ * inode slab is SLAB_DESTROY_BY_RCU, so an inode may be freed and
+ * reused under us but is still an inode of that filesystem.  Whatever
+ * we read through a dentry is checked against its d_seq, which is
+ * bumped when d_inode, the name or the parent changes, or when the
+ * dentry is unhashed; the parent's d_seq is rechecked after each step
+ * so that the permission we granted on its inode still holds.  Renames
+ * are caught with rename_lock.
+ *
+ * Anything out of the ordinary - "." and "..", mountpoints, symlinks,
+ * ->d_hash/->d_compare/->d_revalidate, ->permission, a negative or
+ * missing dentry, a failed check - simply ends the walk: we legitimize
+ * the last dentry known to be good and let link_path_walk() carry on
+ * from there the usual way.
+ *
+ * Returns 1 if the whole path was resolved, with nd->dentry pointing at
+ * the result.  Otherwise returns 0, with nd->dentry and *namep possibly
+ * advanced to an intermediate directory.
+ */
+static int rcu_walk(const char **namep, struct nameidata *nd,
+		    unsigned int lookup_flags)
+{
+	const char *name = *namep;
+	const char *stop_name = NULL;
+	struct dentry *parent, *stop = NULL;
+	unsigned pseq, rseq, stop_seq = 0;
+	int done = 0;
+
+	if (!(nd->dentry->d_sb->s_type->fs_flags & FS_RCU_WALK))
+		return 0;
+
+	rcu_read_lock();
+	rseq = read_seqbegin(&rename_lock);
+	parent = nd->dentry;
+	pseq = read_seqcount_begin(&parent->d_seq);
+	for (;;) {
+		struct dentry *dentry;
+		struct inode *inode;
+		struct inode_operations *iop;
+		unsigned long hash;
+		struct qstr this;
+		unsigned int c;
+		unsigned seq;
+		int last;
+
+		inode = parent->d_inode;
+		if (!inode || exec_permission_rcu(inode, nd))
+			break;
+
+		this.name = name;
+		c = *(const unsigned char *)name;
+		hash = init_name_hash();
+		do {
+			name++;
+			hash = partial_name_hash(c, hash);
+			c = *(const unsigned char *)name;
+		} while (c && (c != '/'));
+		this.len = name - (const char *) this.name;
+		this.hash = end_name_hash(hash);
+
+		last = !c;
+		if (!last) {
+			while (*++name == '/');
+			if (!*name)
+				break;
+		} else if (lookup_flags & LOOKUP_PARENT)
+			break;
+
+		if (this.name[0] == '.' &&
+		    (this.len == 1 || (this.len == 2 && this.name[1] == '.')))
+			break;
+		if (parent->d_op &&
+		    (parent->d_op->d_hash || parent->d_op->d_compare))
+			break;
+
+		dentry = __d_lookup_rcu(parent, &this, &seq);
+		if (!dentry)
+			break;
+		if (dentry->d_op && dentry->d_op->d_revalidate)
+			break;
+		if (d_mountpoint(dentry))
+			break;
+		inode = dentry->d_inode;
+		if (!inode)
+			break;
+		iop = inode->i_op;
+		if (!iop)
+			break;
+		if (read_seqcount_retry(&dentry->d_seq, seq) ||
+		    read_seqcount_retry(&parent->d_seq, pseq))
+			break;
+
+		if (!last) {
+			if (iop->follow_link || !iop->lookup)
+				break;
+		} else {
+			if ((lookup_flags & LOOKUP_FOLLOW) && iop->follow_link)
+				break;
+			if ((lookup_flags & LOOKUP_DIRECTORY) && !iop->lookup)
+				break;
+		}
+
+		stop = dentry;
+		stop_seq = seq;
+		stop_name = name;
+		if (last) {
+			done = 1;
+			break;
+		}
+		parent = dentry;
+		pseq = seq;
+	}
+
+	if (!stop)
+		goto out_unlock;
+
+	spin_lock(&stop->d_lock);
+	if (read_seqcount_retry(&stop->d_seq, stop_seq) || d_unhashed(stop)) {
+		spin_unlock(&stop->d_lock);
+		goto out_unlock;
+	}
+	atomic_inc(&stop->d_count);
+	spin_unlock(&stop->d_lock);
+	if (read_seqretry(&rename_lock, rseq)) {
+		rcu_read_unlock();
+		dput(stop);
+		return 0;
+	}
+	rcu_read_unlock();
+
+	dput(nd->dentry);
+	nd->dentry = stop;
+	*namep = stop_name;
+	if (done)
+		nd->flags &= ~LOOKUP_CONTINUE;
+	return done;
+
+out_unlock:
+	rcu_read_unlock();
+	return 0;
+}
+
 /*
  * Name resolution.
  *
@@ -695,10 +874,14 @@ int fastcall link_path_walk(const char * name, struct nameidata *nd)
 	if (!*name) // スラッシュのみ
 		goto return_reval;
 
-	inode = nd->dentry->d_inode;
 	if (nd->depth) // シンボリックリンクを追跡する
 		lookup_flags = LOOKUP_FOLLOW;
 
+	/* Resolve what we can without references, see rcu_walk() */
+	if (rcu_walk(&name, nd, lookup_flags))
+		return 0;
+	inode = nd->dentry->d_inode;
+
 	/* At this point we know we have a real path component. */
 	for(;;) {
 		unsigned long hash;
@@ -1697,7 +1880,9 @@ void dentry_unhash(struct dentry *dentry)
 		if (atomic_read(&dentry->d_count) != 2)
 			break;
 	case 2:
+		spin_lock(&dentry->d_lock);
 		__d_drop(dentry);
+		spin_unlock(&dentry->d_lock);
 	}
 	spin_unlock(&dcache_lock);
 }
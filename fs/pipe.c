@@ -90,7 +90,12 @@ static void anon_pipe_buf_release(struct pipe_inode_info *info, struct pipe_buff
 {
 	struct page *page = buf->page;
 
-	if (info->tmp_page) {
+	/*
+	 * Keep the page as a one-deep allocation cache only if nobody
+	 * else holds it: a page spliced to a socket may still be
+	 * queued for transmission and must not be written to again.
+	 */
+	if (info->tmp_page || page_count(page) != 1) {
 		__free_page(page);
 		return;
 	}
@@ -160,7 +165,7 @@ pipe_readv(struct file *filp, const struct iovec *_iov,
 			if (!buf->len) {
 				buf->ops = NULL;
 				ops->release(info, buf);
-				curbuf = (curbuf + 1) & (PIPE_BUFFERS-1);
+				curbuf = (curbuf + 1) & (info->buffers-1);
 				info->curbuf = curbuf;
 				info->nrbufs = --bufs;
 				do_wakeup = 1;
@@ -243,7 +248,7 @@ pipe_writev(struct file *filp, const struct iovec *_iov,
 
 	/* We try to merge small writes */
 	if (info->nrbufs && total_len < PAGE_SIZE) {
-		int lastbuf = (info->curbuf + info->nrbufs - 1) & (PIPE_BUFFERS-1);
+		int lastbuf = (info->curbuf + info->nrbufs - 1) & (info->buffers-1);
 		struct pipe_buffer *buf = info->bufs + lastbuf;
 		struct pipe_buf_operations *ops = buf->ops;
 		int offset = buf->offset + buf->len;
@@ -270,9 +275,9 @@ pipe_writev(struct file *filp, const struct iovec *_iov,
 			break;
 		}
 		bufs = info->nrbufs;
-		if (bufs < PIPE_BUFFERS) {
+		if (bufs < info->buffers) {
 			ssize_t chars;
-			int newbuf = (info->curbuf + bufs) & (PIPE_BUFFERS-1);
+			int newbuf = (info->curbuf + bufs) & (info->buffers-1);
 			struct pipe_buffer *buf = info->bufs + newbuf;
 			struct page *page = info->tmp_page;
 			int error;
@@ -315,7 +320,7 @@ pipe_writev(struct file *filp, const struct iovec *_iov,
 			if (!total_len)
 				break;
 		}
-		if (bufs < PIPE_BUFFERS)
+		if (bufs < info->buffers)
 			continue;
 		if (filp->f_flags & O_NONBLOCK) {
 			if (!ret) ret = -EAGAIN;
@@ -382,7 +387,7 @@ pipe_ioctl(struct inode *pino, struct file *filp,
 			nrbufs = info->nrbufs;
 			while (--nrbufs >= 0) {
 				count += info->bufs[buf].len;
-				buf = (buf+1) & (PIPE_BUFFERS-1);
+				buf = (buf+1) & (info->buffers-1);
 			}
 			up(PIPE_SEM(*inode));
 			return put_user(count, (int __user *)arg);
@@ -412,7 +417,7 @@ pipe_poll(struct file *filp, poll_table *wait)
 	}
 
 	if (filp->f_mode & FMODE_WRITE) {
-		mask |= (nrbufs < PIPE_BUFFERS) ? POLLOUT | POLLWRNORM : 0;
+		mask |= (nrbufs < info->buffers) ? POLLOUT | POLLWRNORM : 0;
 		if (!PIPE_READERS(*inode))
 			mask |= POLLERR;
 	}
@@ -635,19 +640,104 @@ struct file_operations rdwr_pipe_fops = {
 	.fasync		= pipe_rdwr_fasync,
 };
 
+/*
+ * Largest ring an unprivileged user may ask for with F_SETPIPE_SZ, in
+ * bytes (/proc/sys/fs/pipe-max-size).
+ */
+int pipe_max_size = 1024 * 1024;
+int pipe_min_size = PAGE_SIZE;
+
+/*
+ * Resize the ring of a pipe to nr_bufs buffers, which must be a power
+ * of two and hold what is in the pipe now.  Called with the pipe's
+ * semaphore held.
+ */
+static long pipe_set_size(struct inode *inode, unsigned int nr_bufs)
+{
+	struct pipe_inode_info *info = inode->i_pipe;
+	struct pipe_buffer *bufs;
+	unsigned int head, tail;
+
+	if (nr_bufs < info->nrbufs)
+		return -EBUSY;
+
+	bufs = kmalloc(nr_bufs * sizeof(struct pipe_buffer), GFP_KERNEL);
+	if (unlikely(!bufs))
+		return -ENOMEM;
+	memset(bufs, 0, nr_bufs * sizeof(struct pipe_buffer));
+
+	/* Move the occupied slots to the front of the new ring */
+	head = info->curbuf;
+	tail = 0;
+	if (info->nrbufs) {
+		tail = info->buffers - head;
+		if (tail > info->nrbufs)
+			tail = info->nrbufs;
+		memcpy(bufs, info->bufs + head,
+		       tail * sizeof(struct pipe_buffer));
+		memcpy(bufs + tail, info->bufs,
+		       (info->nrbufs - tail) * sizeof(struct pipe_buffer));
+	}
+
+	kfree(info->bufs);
+	info->bufs = bufs;
+	info->curbuf = 0;
+	info->buffers = nr_bufs;
+	return nr_bufs * PAGE_SIZE;
+}
+
+long pipe_fcntl(struct file *file, unsigned int cmd, unsigned long arg)
+{
+	struct inode *inode = file->f_dentry->d_inode;
+	unsigned int nr_bufs;
+	long ret;
+
+	if (!inode->i_pipe)
+		return -EBADF;
+
+	down(PIPE_SEM(*inode));
+
+	switch (cmd) {
+	case F_SETPIPE_SZ:
+		ret = -EINVAL;
+		if (!arg || arg > INT_MAX)
+			break;
+		nr_bufs = roundup_pow_of_two((arg + PAGE_SIZE - 1) >> PAGE_SHIFT);
+		ret = -EPERM;
+		if (nr_bufs * PAGE_SIZE > pipe_max_size &&
+		    !capable(CAP_SYS_RESOURCE))
+			break;
+		ret = pipe_set_size(inode, nr_bufs);
+		/* writers may be waiting for room */
+		if (ret > 0)
+			wake_up_interruptible(PIPE_WAIT(*inode));
+		break;
+	case F_GETPIPE_SZ:
+		ret = inode->i_pipe->buffers * PAGE_SIZE;
+		break;
+	default:
+		ret = -EINVAL;
+		break;
+	}
+
+	up(PIPE_SEM(*inode));
+	return ret;
+}
+
 void free_pipe_info(struct inode *inode)
 {
 	int i;
 	struct pipe_inode_info *info = inode->i_pipe;
 
 	inode->i_pipe = NULL;
-	for (i = 0; i < PIPE_BUFFERS; i++) {
+	for (i = 0; i < info->buffers; i++) {
 		struct pipe_buffer *buf = info->bufs + i;
 		if (buf->ops)
 			buf->ops->release(info, buf);
 	}
 	if (info->tmp_page)
 		__free_page(info->tmp_page);
+	kfree(info->bufs);
 	kfree(info);
 }
 
@@ -659,12 +749,20 @@ struct inode* pipe_new(struct inode* inode)
 	if (!info)
 		goto fail_page;
 	memset(info, 0, sizeof(*info));
+	info->bufs = kmalloc(PIPE_DEF_BUFFERS * sizeof(struct pipe_buffer),
+			     GFP_KERNEL);
+	if (!info->bufs)
+		goto fail_info;
+	memset(info->bufs, 0, PIPE_DEF_BUFFERS * sizeof(struct pipe_buffer));
+	info->buffers = PIPE_DEF_BUFFERS;
 	inode->i_pipe = info;
 
 	init_waitqueue_head(PIPE_WAIT(*inode));
 	PIPE_RCOUNTER(*inode) = PIPE_WCOUNTER(*inode) = 1;
 
 	return inode;
+fail_info:
+	kfree(info);
 fail_page:
 	return NULL;
 }
@@ -512,15 +512,14 @@ static int proc_register(struct proc_dir_entry * dir, struct proc_dir_entry * dp
  */
 static void proc_kill_inodes(struct proc_dir_entry *de)
 {
-	struct list_head *p;
+	struct file *filp;
 	struct super_block *sb = proc_mnt->mnt_sb;
 
 	/*
 	 * Actually it's a partial revoke().
 	 */
-	file_list_lock();
-	list_for_each(p, &sb->s_files) {
-		struct file * filp = list_entry(p, struct file, f_list);
+	sb_file_list_lock();
+	do_file_list_for_each_entry(sb, filp) {
 		struct dentry * dentry = filp->f_dentry;
 		struct inode * inode;
 		struct file_operations *fops;
@@ -533,8 +532,8 @@ static void proc_kill_inodes(struct proc_dir_entry *de)
 		fops = filp->f_op;
 		filp->f_op = NULL;
 		fops_put(fops);
-	}
-	file_list_unlock();
+	} while_file_list_for_each_entry;
+	sb_file_list_unlock();
 }
 
 static struct proc_dir_entry *proc_create(struct proc_dir_entry **parent,
@@ -0,0 +1,612 @@
+/*
+ *  linux/fs/splice.c
+ *
+ * "splice": move data between a pipe and a file or socket without
+ * copying it through user space.
+ *
+ * The pipe is used as an in-kernel buffer of page references.  Page
+ * cache pages are inserted into the pipe as they are, and pipe buffers
+ * are handed to ->sendpage() of the output file, so a file -> pipe ->
+ * socket pipeline moves page references around and never copies the
+ * data.  Splicing to a regular file copies into its page cache, which
+ * is the one copy a write(2) would have done anyway.
+ *
+ * This generalizes sendfile(2): any file that implements ->splice_read
+ * can feed a pipe, and any file that implements ->splice_write can
+ * drain one.
+ */
+#include <linux/fs.h>
+#include <linux/file.h>
+#include <linux/pagemap.h>
+#include <linux/pipe_fs_i.h>
+#include <linux/swap.h>
+#include <linux/writeback.h>
+#include <linux/module.h>
+#include <linux/syscalls.h>
+#include <linux/security.h>
+#include <linux/highmem.h>
+
+#include <asm/uaccess.h>
+
+/*
+ * Passed to the move_from_pipe() actors: the current chunk length, the
+ * bytes left to transfer, the splice flags, the output file and its
+ * current position.
+ */
+struct splice_desc {
+	size_t len, total_len;
+	unsigned int flags;
+	struct file *file;
+	loff_t pos;
+};
+
+typedef int (splice_actor)(struct pipe_inode_info *, struct pipe_buffer *,
+			   struct splice_desc *);
+
+/*
+ * Page cache pages are only put into a pipe once they are uptodate, and
+ * the pipe holds a reference to them; they are never recycled as the
+ * pipe's tmp_page and never merged into.
+ */
+static void *page_cache_pipe_buf_map(struct file *file,
+				     struct pipe_inode_info *info,
+				     struct pipe_buffer *buf)
+{
+	return kmap(buf->page);
+}
+
+static void page_cache_pipe_buf_unmap(struct pipe_inode_info *info,
+				      struct pipe_buffer *buf)
+{
+	kunmap(buf->page);
+}
+
+static void page_cache_pipe_buf_release(struct pipe_inode_info *info,
+					struct pipe_buffer *buf)
+{
+	page_cache_release(buf->page);
+}
+
+static struct pipe_buf_operations page_cache_pipe_buf_ops = {
+	.can_merge = 0,
+	.map = page_cache_pipe_buf_map,
+	.unmap = page_cache_pipe_buf_unmap,
+	.release = page_cache_pipe_buf_release,
+};
+
+/*
+ * Link nr_pages pages into the pipe, the first one starting at offset,
+ * for len bytes in total.  Sleeps for room like pipe_writev() does
+ * unless SPLICE_F_NONBLOCK is given.  The references of the pages that
+ * did not make it into the pipe are dropped.
+ */
+static ssize_t move_to_pipe(struct inode *inode, struct page **pages,
+			    int nr_pages, unsigned long offset,
+			    unsigned long len, unsigned int flags)
+{
+	struct pipe_inode_info *info;
+	int do_wakeup = 0, i = 0;
+	ssize_t ret = 0;
+
+	down(PIPE_SEM(*inode));
+	info = inode->i_pipe;
+
+	for (;;) {
+		int bufs;
+
+		if (!PIPE_READERS(*inode)) {
+			send_sig(SIGPIPE, current, 0);
+			if (!ret) ret = -EPIPE;
+			break;
+		}
+
+		bufs = info->nrbufs;
+		if (bufs < info->buffers) {
+			int newbuf = (info->curbuf + bufs) & (info->buffers-1);
+			struct pipe_buffer *buf = info->bufs + newbuf;
+			unsigned long this_len;
+
+			this_len = PAGE_CACHE_SIZE - offset;
+			if (this_len > len)
+				this_len = len;
+
+			buf->page = pages[i++];
+			buf->offset = offset;
+			buf->len = this_len;
+			buf->ops = &page_cache_pipe_buf_ops;
+			info->nrbufs = ++bufs;
+			do_wakeup = 1;
+
+			ret += this_len;
+			len -= this_len;
+			offset = 0;
+			if (i == nr_pages)
+				break;
+			if (bufs < info->buffers)
+				continue;
+		}
+
+		if (flags & SPLICE_F_NONBLOCK) {
+			if (!ret) ret = -EAGAIN;
+			break;
+		}
+		if (signal_pending(current)) {
+			if (!ret) ret = -ERESTARTSYS;
+			break;
+		}
+		if (do_wakeup) {
+			wake_up_interruptible_sync(PIPE_WAIT(*inode));
+			kill_fasync(PIPE_FASYNC_READERS(*inode), SIGIO, POLL_IN);
+			do_wakeup = 0;
+		}
+		PIPE_WAITING_WRITERS(*inode)++;
+		pipe_wait(inode);
+		PIPE_WAITING_WRITERS(*inode)--;
+	}
+
+	up(PIPE_SEM(*inode));
+
+	if (do_wakeup) {
+		wake_up_interruptible(PIPE_WAIT(*inode));
+		kill_fasync(PIPE_FASYNC_READERS(*inode), SIGIO, POLL_IN);
+	}
+
+	while (i < nr_pages)
+		page_cache_release(pages[i++]);
+
+	return ret;
+}
+
+/*
+ * Fill the pipe with at most one ring worth of page cache pages, reading
+ * them in if needed.
+ */
+static ssize_t __generic_file_splice_read(struct file *in, loff_t *ppos,
+					  struct inode *pipe, size_t len,
+					  unsigned int flags)
+{
+	struct address_space *mapping = in->f_mapping;
+	struct page *pages[PIPE_DEF_BUFFERS];
+	unsigned long offset, index;
+	loff_t isize, pos = *ppos;
+	int nr_pages, i;
+
+	isize = i_size_read(mapping->host);
+	if (pos >= isize)
+		return 0;
+	if (len > isize - pos)
+		len = isize - pos;
+
+	index = pos >> PAGE_CACHE_SHIFT;
+	offset = pos & ~PAGE_CACHE_MASK;
+	nr_pages = (len + offset + PAGE_CACHE_SIZE - 1) >> PAGE_CACHE_SHIFT;
+	if (nr_pages > PIPE_DEF_BUFFERS)
+		nr_pages = PIPE_DEF_BUFFERS;
+
+	page_cache_readahead(mapping, &in->f_ra, in, index, nr_pages);
+
+	for (i = 0; i < nr_pages; i++) {
+		struct page *page;
+
+		page = read_cache_page(mapping, index + i,
+				(filler_t *)mapping->a_ops->readpage, in);
+		if (IS_ERR(page)) {
+			if (!i)
+				return PTR_ERR(page);
+			break;
+		}
+		wait_on_page_locked(page);
+		if (!PageUptodate(page)) {
+			page_cache_release(page);
+			if (!i)
+				return -EIO;
+			break;
+		}
+		pages[i] = page;
+	}
+
+	if (len > (i << PAGE_CACHE_SHIFT) - offset)
+		len = (i << PAGE_CACHE_SHIFT) - offset;
+
+	return move_to_pipe(pipe, pages, i, offset, len, flags);
+}
+
+/**
+ * generic_file_splice_read - splice data from a file into a pipe
+ * @in:		file to splice from
+ * @ppos:	position in @in, advanced by the amount spliced
+ * @pipe:	pipe inode to splice to
+ * @len:	number of bytes to splice
+ * @flags:	SPLICE_F_* flags
+ *
+ * Moves references to @in's page cache pages into @pipe, without
+ * copying the data.
+ */
+ssize_t generic_file_splice_read(struct file *in, loff_t *ppos,
+				 struct inode *pipe, size_t len,
+				 unsigned int flags)
+{
+	ssize_t spliced = 0, ret = 0;
+
+	while (len) {
+		ret = __generic_file_splice_read(in, ppos, pipe, len, flags);
+		if (ret <= 0)
+			break;
+
+		*ppos += ret;
+		len -= ret;
+		spliced += ret;
+
+		if (flags & SPLICE_F_NONBLOCK) {
+			ret = -EAGAIN;
+			break;
+		}
+	}
+
+	if (spliced) {
+		file_accessed(in);
+		return spliced;
+	}
+	return ret;
+}
+
+EXPORT_SYMBOL(generic_file_splice_read);
+
+/*
+ * Send a pipe buffer to ->sendpage() of the output file, normally a
+ * socket.  The page is passed by reference, so this is zero-copy all
+ * the way to the network card for devices that can do scatter/gather.
+ * A non-blocking socket may take only part of it: only that part is
+ * consumed from the buffer.
+ */
+static int pipe_to_sendpage(struct pipe_inode_info *info,
+			    struct pipe_buffer *buf, struct splice_desc *sd)
+{
+	struct file *file = sd->file;
+	loff_t pos = sd->pos;
+	int more, ret;
+
+	more = (sd->flags & SPLICE_F_MORE) || sd->len < sd->total_len;
+
+	ret = file->f_op->sendpage(file, buf->page, buf->offset, sd->len,
+				   &pos, more);
+	if (ret < 0)
+		return ret;
+	if (!ret)
+		return -EIO;
+	sd->len = ret;
+	return 0;
+}
+
+/*
+ * Copy a pipe buffer into the page cache of the output file.  Called
+ * with the output inode's i_sem held.
+ */
+static int pipe_to_file(struct pipe_inode_info *info, struct pipe_buffer *buf,
+			struct splice_desc *sd)
+{
+	struct file *file = sd->file;
+	struct address_space *mapping = file->f_mapping;
+	struct inode *inode = mapping->host;
+	unsigned int offset;
+	struct page *page;
+	char *src, *dst;
+	int ret;
+
+	offset = sd->pos & ~PAGE_CACHE_MASK;
+	/* one page cache page at a time */
+	if (sd->len > PAGE_CACHE_SIZE - offset)
+		sd->len = PAGE_CACHE_SIZE - offset;
+
+	page = grab_cache_page(mapping, sd->pos >> PAGE_CACHE_SHIFT);
+	if (unlikely(!page))
+		return -ENOMEM;
+
+	ret = mapping->a_ops->prepare_write(file, page, offset,
+					    offset + sd->len);
+	if (unlikely(ret)) {
+		loff_t isize = i_size_read(inode);
+
+		/* blocks may have been instantiated outside i_size */
+		if (sd->pos + sd->len > isize)
+			vmtruncate(inode, isize);
+		goto out;
+	}
+
+	src = buf->ops->map(file, info, buf);
+	dst = kmap_atomic(page, KM_USER0);
+	memcpy(dst + offset, src + buf->offset, sd->len);
+	flush_dcache_page(page);
+	kunmap_atomic(dst, KM_USER0);
+	buf->ops->unmap(info, buf);
+
+	ret = mapping->a_ops->commit_write(file, page, offset,
+					   offset + sd->len);
+	if (ret > 0)
+		ret = 0;
+	if (!ret)
+		mark_page_accessed(page);
+out:
+	unlock_page(page);
+	page_cache_release(page);
+	if (!ret)
+		balance_dirty_pages_ratelimited(mapping);
+	return ret;
+}
+
+/*
+ * Feed the buffers of the pipe to actor until len bytes have been
+ * consumed, waiting for writers like pipe_readv() does.  The actor may
+ * shorten sd->len to consume only part of a buffer.
+ */
+static ssize_t move_from_pipe(struct inode *inode, struct file *out,
+			      loff_t *ppos, size_t len, unsigned int flags,
+			      splice_actor *actor)
+{
+	struct pipe_inode_info *info;
+	struct splice_desc sd;
+	int do_wakeup = 0;
+	ssize_t ret = 0;
+
+	sd.total_len = len;
+	sd.flags = flags;
+	sd.file = out;
+	sd.pos = *ppos;
+
+	down(PIPE_SEM(*inode));
+	info = inode->i_pipe;
+
+	for (;;) {
+		int bufs = info->nrbufs;
+
+		if (bufs) {
+			int curbuf = info->curbuf;
+			struct pipe_buffer *buf = info->bufs + curbuf;
+			struct pipe_buf_operations *ops = buf->ops;
+			int error;
+
+			sd.len = buf->len;
+			if (sd.len > sd.total_len)
+				sd.len = sd.total_len;
+
+			error = actor(info, buf, &sd);
+			if (error) {
+				if (!ret) ret = error;
+				break;
+			}
+
+			ret += sd.len;
+			buf->offset += sd.len;
+			buf->len -= sd.len;
+			if (!buf->len) {
+				buf->ops = NULL;
+				ops->release(info, buf);
+				curbuf = (curbuf + 1) & (info->buffers-1);
+				info->curbuf = curbuf;
+				info->nrbufs = --bufs;
+				do_wakeup = 1;
+			}
+
+			sd.pos += sd.len;
+			sd.total_len -= sd.len;
+			if (!sd.total_len)
+				break;
+		}
+
+		if (bufs)
+			continue;
+		if (!PIPE_WRITERS(*inode))
+			break;
+		if (!PIPE_WAITING_WRITERS(*inode)) {
+			if (ret)
+				break;
+			if (flags & SPLICE_F_NONBLOCK) {
+				ret = -EAGAIN;
+				break;
+			}
+		}
+		if (signal_pending(current)) {
+			if (!ret) ret = -ERESTARTSYS;
+			break;
+		}
+		if (do_wakeup) {
+			wake_up_interruptible_sync(PIPE_WAIT(*inode));
+			kill_fasync(PIPE_FASYNC_WRITERS(*inode), SIGIO, POLL_OUT);
+			do_wakeup = 0;
+		}
+		pipe_wait(inode);
+	}
+
+	up(PIPE_SEM(*inode));
+
+	if (do_wakeup) {
+		wake_up_interruptible(PIPE_WAIT(*inode));
+		kill_fasync(PIPE_FASYNC_WRITERS(*inode), SIGIO, POLL_OUT);
+	}
+
+	*ppos = sd.pos;
+	return ret;
+}
+
+/**
+ * generic_file_splice_write - splice data from a pipe to a file
+ * @pipe:	pipe inode to splice from
+ * @out:	file to write to
+ * @ppos:	position in @out, advanced by the amount spliced
+ * @len:	number of bytes to splice
+ * @flags:	SPLICE_F_* flags
+ *
+ * Writes the pipe buffers into @out's page cache.
+ */
+ssize_t generic_file_splice_write(struct inode *pipe, struct file *out,
+				  loff_t *ppos, size_t len, unsigned int flags)
+{
+	struct address_space *mapping = out->f_mapping;
+	struct inode *inode = mapping->host;
+	ssize_t ret;
+	int err;
+
+	down(&inode->i_sem);
+	ret = generic_write_checks(out, ppos, &len, 0);
+	if (!ret && len) {
+		ret = remove_suid(out->f_dentry);
+		if (!ret) {
+			inode_update_time(inode, 1);
+			ret = move_from_pipe(pipe, out, ppos, len, flags,
+					     pipe_to_file);
+		}
+	}
+	up(&inode->i_sem);
+
+	if (ret > 0 && ((out->f_flags & O_SYNC) || IS_SYNC(inode))) {
+		err = sync_page_range(inode, mapping, *ppos - ret, ret);
+		if (err < 0)
+			ret = err;
+	}
+	return ret;
+}
+
+EXPORT_SYMBOL(generic_file_splice_write);
+
+/**
+ * generic_splice_sendpage - splice data from a pipe to a socket
+ * @pipe:	pipe inode to splice from
+ * @out:	socket to write to
+ * @ppos:	position in @out
+ * @len:	number of bytes to splice
+ * @flags:	SPLICE_F_* flags
+ *
+ * Hands the pipe buffers to @out's ->sendpage() by reference.
+ */
+ssize_t generic_splice_sendpage(struct inode *pipe, struct file *out,
+				loff_t *ppos, size_t len, unsigned int flags)
+{
+	return move_from_pipe(pipe, out, ppos, len, flags, pipe_to_sendpage);
+}
+
+EXPORT_SYMBOL(generic_splice_sendpage);
+
+/*
+ * Read the file position to use for the non-pipe end of a splice:
+ * either the user supplied offset, for files that allow positioned i/o,
+ * or the file's f_pos.
+ */
+static loff_t *splice_get_pos(struct file *file, loff_t __user *off,
+			      loff_t *pos, int mode)
+{
+	if (!off)
+		return &file->f_pos;
+	if (!(file->f_mode & mode))
+		return ERR_PTR(-ESPIPE);
+	if (copy_from_user(pos, off, sizeof(loff_t)))
+		return ERR_PTR(-EFAULT);
+	return pos;
+}
+
+static long do_splice(struct file *in, loff_t __user *off_in,
+		      struct file *out, loff_t __user *off_out,
+		      size_t len, unsigned int flags)
+{
+	struct inode *ipipe = in->f_dentry->d_inode->i_pipe ?
+				in->f_dentry->d_inode : NULL;
+	struct inode *opipe = out->f_dentry->d_inode->i_pipe ?
+				out->f_dentry->d_inode : NULL;
+	loff_t pos, *ppos;
+	long ret;
+
+	if (ipipe && !opipe) {
+		if (off_in)
+			return -ESPIPE;
+		if (!out->f_op || !out->f_op->splice_write)
+			return -EINVAL;
+
+		ppos = splice_get_pos(out, off_out, &pos, FMODE_PWRITE);
+		if (IS_ERR(ppos))
+			return PTR_ERR(ppos);
+		ret = rw_verify_area(WRITE, out, ppos, len);
+		if (ret)
+			return ret;
+		ret = security_file_permission(out, MAY_WRITE);
+		if (ret)
+			return ret;
+
+		ret = out->f_op->splice_write(ipipe, out, ppos, len, flags);
+		if (ret > 0)
+			current->wchar += ret;
+		current->syscw++;
+
+		if (off_out && put_user(pos, off_out))
+			ret = -EFAULT;
+		return ret;
+	}
+
+	if (opipe && !ipipe) {
+		if (off_out)
+			return -ESPIPE;
+		if (!in->f_op || !in->f_op->splice_read)
+			return -EINVAL;
+
+		ppos = splice_get_pos(in, off_in, &pos, FMODE_PREAD);
+		if (IS_ERR(ppos))
+			return PTR_ERR(ppos);
+		ret = rw_verify_area(READ, in, ppos, len);
+		if (ret)
+			return ret;
+		ret = security_file_permission(in, MAY_READ);
+		if (ret)
+			return ret;
+
+		ret = in->f_op->splice_read(in, ppos, opipe, len, flags);
+		if (ret > 0)
+			current->rchar += ret;
+		current->syscr++;
+
+		if (off_in && put_user(pos, off_in))
+			ret = -EFAULT;
+		return ret;
+	}
+
+	return -EINVAL;
+}
+
+/*
+ * sys_splice:
+ *	Move up to len bytes between fd_in and fd_out, one of which must
+ *	be a pipe.  off_in/off_out, if not NULL, give the position in the
+ *	non-pipe file and are updated; otherwise its file position is used.
+ */
+asmlinkage long sys_splice(int fd_in, loff_t __user *off_in,
+			   int fd_out, loff_t __user *off_out,
+			   size_t len, unsigned int flags)
+{
+	struct file *in, *out;
+	int fput_in, fput_out;
+	long ret;
+
+	if (unlikely(flags & ~SPLICE_F_ALL))
+		return -EINVAL;
+	if (unlikely(!len))
+		return 0;
+
+	ret = -EBADF;
+	in = fget_light(fd_in, &fput_in);
+	if (!in)
+		goto out;
+	if (!(in->f_mode & FMODE_READ))
+		goto fput_in;
+
+	out = fget_light(fd_out, &fput_out);
+	if (!out)
+		goto fput_in;
+	if (!(out->f_mode & FMODE_WRITE))
+		goto fput_out;
+
+	ret = do_splice(in, off_in, out, off_out, len, flags);
+
+fput_out:
+	fput_light(out, fput_out);
+fput_in:
+	fput_light(in, fput_in);
+out:
+	return ret;
+}
@@ -67,9 +67,22 @@ static struct super_block *alloc_super(void)
 		}
 		INIT_LIST_HEAD(&s->s_dirty);
 		INIT_LIST_HEAD(&s->s_io);
-		INIT_LIST_HEAD(&s->s_files);
+		s->s_files = alloc_percpu(struct list_head);
+		if (!s->s_files) {
+			security_sb_free(s);
+			kfree(s);
+			s = NULL;
+			goto out;
+		} else {
+			int i;
+
+			for_each_cpu(i)
+				INIT_LIST_HEAD(per_cpu_ptr(s->s_files, i));
+		}
 		INIT_LIST_HEAD(&s->s_instances);
 		INIT_HLIST_HEAD(&s->s_anon);
+		INIT_LIST_HEAD(&s->s_dentry_lru);
+		spin_lock_init(&s->s_dentry_lru_lock);
 		INIT_LIST_HEAD(&s->s_inodes);
 		init_rwsem(&s->s_umount);
 		sema_init(&s->s_lock, 1);
@@ -99,6 +112,7 @@ out:
  */
 static inline void destroy_super(struct super_block *s)
 {
+	free_percpu(s->s_files);
 	security_sb_free(s);
 	kfree(s);
 }
@@ -505,12 +519,12 @@ static void mark_files_ro(struct super_block *sb)
 {
 	struct file *f;
 
-	file_list_lock();
-	list_for_each_entry(f, &sb->s_files, f_list) {
+	sb_file_list_lock();
+	do_file_list_for_each_entry(sb, f) {
 		if (S_ISREG(f->f_dentry->d_inode->i_mode) && file_count(f))
 			f->f_mode &= ~FMODE_WRITE;
-	}
-	file_list_unlock();
+	} while_file_list_for_each_entry;
+	sb_file_list_unlock();
 }
 
 /**
@@ -563,8 +563,12 @@ __SYSCALL(__NR_add_key, sys_add_key)
 __SYSCALL(__NR_request_key, sys_request_key)
 #define __NR_keyctl		250
 __SYSCALL(__NR_keyctl, sys_keyctl)
+#define __NR_epoll_create1	251
+__SYSCALL(__NR_epoll_create1, sys_epoll_create1)
+#define __NR_splice		252
+__SYSCALL(__NR_splice, sys_splice)
 
-#define __NR_syscall_max __NR_keyctl
+#define __NR_syscall_max __NR_splice
 #ifndef __NO_STUBS
 
 /* user-visible error numbers are in the range -1 - -4095 */
@@ -4,6 +4,7 @@
 #include <linux/list.h>
 #include <linux/workqueue.h>
 #include <linux/aio_abi.h>
+#include <linux/uio.h>
 
 #include <asm/atomic.h>
 
@@ -69,7 +70,13 @@ struct kiocb {
 	size_t			ki_nbytes; 	/* copy of iocb->aio_nbytes */
 	char 			__user *ki_buf;	/* remaining iocb->aio_buf */
 	size_t			ki_left; 	/* remaining bytes */
-	wait_queue_t		ki_wait;
+	struct iovec		ki_inline_vec;	/* inline vector */
+	struct iovec		*ki_iovec;	/* vectored ops: copy of the
+						 * user iovec, advanced as
+						 * retries progress */
+	unsigned long		ki_nr_segs;
+	unsigned long		ki_cur_seg;	/* first unfinished segment */
+	struct wait_bit_queue	ki_wait;	/* keyed for page bit waits */
 	long			ki_retried; 	/* just for testing */
 	long			ki_kicked; 	/* just for testing */
 	long			ki_queued; 	/* just for testing */
@@ -90,7 +97,7 @@ struct kiocb {
 		(x)->ki_dtor = NULL;			\
 		(x)->ki_obj.tsk = tsk;			\
 		(x)->ki_user_data = 0;                  \
-		init_wait((&(x)->ki_wait));             \
+		init_wait((&(x)->ki_wait.wait));        \
 	} while (0)
 
 #define AIO_RING_MAGIC			0xa10a10a1
@@ -184,7 +191,7 @@ do {									\
 	}								\
 } while (0)
 
-#define io_wait_to_kiocb(wait) container_of(wait, struct kiocb, ki_wait)
+#define io_wait_to_kiocb(wait) container_of(wait, struct kiocb, ki_wait.wait)
 #define is_retried_kiocb(iocb) ((iocb)->ki_retried > 1)
 
 #include <linux/aio_abi.h>
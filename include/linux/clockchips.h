@@ -0,0 +1,81 @@
+/*
+ *  include/linux/clockchips.h
+ *
+ *  Per-CPU programmable clock event devices.
+ *
+ *  A clock event device is a piece of per-CPU timer hardware that can be
+ *  told to raise an interrupt after a given number of its own clock
+ *  cycles (the local APIC timer in one-shot mode, for example).  An
+ *  architecture registers one for each CPU; the high resolution timer
+ *  code then takes it over, programs it for the next expiring hrtimer
+ *  and emulates the periodic local tick the device used to provide.
+ */
+#ifndef _LINUX_CLOCKCHIPS_H
+#define _LINUX_CLOCKCHIPS_H
+
+#include <linux/ktime.h>
+
+#include <asm/div64.h>
+
+struct pt_regs;
+
+enum clock_event_mode {
+	CLOCK_EVT_MODE_PERIODIC,
+	CLOCK_EVT_MODE_ONESHOT,
+};
+
+/**
+ * struct clock_event_device - per-CPU programmable timer
+ * @name:		name of the device, for diagnostics
+ * @mode:		current operating mode
+ * @mult:		nanoseconds to device cycles multiplier
+ * @shift:		nanoseconds to device cycles divisor (power of two)
+ * @max_delta_ns:	maximum delta that can be programmed
+ * @min_delta_ns:	minimum delta that can be programmed
+ * @tick_ns:		period of the local tick, emulated in one-shot mode
+ * @set_mode:		switch the device between periodic and one-shot mode
+ * @set_next_event:	program the next event, in device cycles from now
+ * @tick:		the work done by the periodic local tick
+ * @event_handler:	set by the hrtimer code when it takes the device
+ *			over; the driver's interrupt handler calls it instead
+ *			of @tick from then on
+ */
+struct clock_event_device {
+	const char		*name;
+	enum clock_event_mode	mode;
+	unsigned long		mult;
+	int			shift;
+	unsigned long		max_delta_ns;
+	unsigned long		min_delta_ns;
+	unsigned long		tick_ns;
+	void			(*set_mode)(enum clock_event_mode mode,
+					    struct clock_event_device *dev);
+	void			(*set_next_event)(unsigned long cycles,
+						  struct clock_event_device *dev);
+	void			(*tick)(struct pt_regs *regs);
+	void			(*event_handler)(struct clock_event_device *dev,
+						 struct pt_regs *regs);
+};
+
+/*
+ * Convert a delta in device cycles to nanoseconds, for the
+ * min_delta_ns/max_delta_ns limits.
+ */
+static inline unsigned long
+clockevent_delta2ns(unsigned long cycles, struct clock_event_device *dev)
+{
+	u64 ns = (u64) cycles << dev->shift;
+
+	do_div(ns, dev->mult);
+	return (unsigned long) ns;
+}
+
+#ifdef CONFIG_HIGH_RES_TIMERS
+extern void clockevents_register_device(struct clock_event_device *dev);
+#else
+static inline void clockevents_register_device(struct clock_event_device *dev)
+{
+}
+#endif
+
+#endif
@@ -8,6 +8,7 @@
 #include <linux/spinlock.h>
 #include <linux/cache.h>
 #include <linux/rcupdate.h>
+#include <linux/seqlock.h>
 #include <asm/bug.h>
 
 struct nameidata;
@@ -84,6 +85,7 @@ struct dentry {
 	atomic_t d_count; /* dエントリの参照カウンタ */
 	unsigned int d_flags;		/* フラグ */
 	spinlock_t d_lock;		/* エントリ用のスピンロック */
+	seqcount_t d_seq;		/* d_inode、名前、親、ハッシュの変更を検出する(RCUパス検索用) */
 	struct inode *d_inode;		/* dエントリに対応するiノード */
 	/*
 	 * The next three fields are touched by __d_lookup.  Place them here
@@ -140,7 +142,7 @@ locking rules:
 d_revalidate:	no		no		no       yes
 d_hash		no		no		no       yes
 d_compare:	no		yes		yes      no
-d_delete:	no		yes		no       no
+d_delete:	no		no		yes      no
 d_release:	no		no		no       yes
 d_iput:		no		no		no       yes
  */
@@ -168,6 +170,25 @@ d_iput:		no		no		no       yes
 
 extern spinlock_t dcache_lock;
 
+/*
+ * Locking of the dcache:
+ *
+ * dentry->d_lock protects d_flags, d_seq, the hash chain membership and
+ * the dropping of d_count to zero.  It also serializes additions to the
+ * dentry's own d_subdirs list, done by d_alloc() without dcache_lock.
+ * The hash chains have their own bucket locks and the unused lists are
+ * per superblock, under sb->s_dentry_lru_lock; both nest inside d_lock
+ * and are private to fs/dcache.c.
+ *
+ * dcache_lock protects the d_alias lists, dget_locked() on unused
+ * dentries, and the removal of dentries from d_subdirs lists (which also
+ * takes the parent's d_lock).  Holding it is therefore enough to walk a
+ * d_subdirs list: entries can be added at its head under you, but none
+ * goes away.  Anybody else moving entries around in a d_subdirs list has
+ * to hold both dcache_lock and the parent's d_lock.  Two d_locks may only
+ * be nested with dcache_lock held.
+ */
+
 /**
  * d_drop - drop a dentry
  * @dentry: dentry to drop
@@ -185,19 +206,14 @@ extern spinlock_t dcache_lock;
  * timeouts or autofs deletes).
  */
 
-static inline void __d_drop(struct dentry *dentry)
-{
-	if (!(dentry->d_flags & DCACHE_UNHASHED)) {
-		dentry->d_flags |= DCACHE_UNHASHED;
-		hlist_del_rcu(&dentry->d_hash);
-	}
-}
+/* Called with dentry->d_lock held */
+extern void __d_drop(struct dentry *dentry);
 
 static inline void d_drop(struct dentry *dentry)
 {
-	spin_lock(&dcache_lock);
+	spin_lock(&dentry->d_lock);
  	__d_drop(dentry);
-	spin_unlock(&dcache_lock);
+	spin_unlock(&dentry->d_lock);
 }
 
 static inline int dname_external(struct dentry *dentry)
@@ -219,6 +235,10 @@ extern struct dentry * d_splice_alias(struct inode *, struct dentry *);
 extern void shrink_dcache_sb(struct super_block *);
 extern void shrink_dcache_parent(struct dentry *);
 extern void shrink_dcache_anon(struct hlist_head *);
+struct ctl_table;
+struct file;
+extern int proc_nr_dentry(struct ctl_table *, int, struct file *,
+			  void __user *, size_t *, loff_t *);
 extern int d_invalidate(struct dentry *);
 
 /* only used at mount-time */
@@ -276,6 +296,8 @@ extern void d_move(struct dentry *, struct dentry *);
 /* appendix may either be NULL or be used for transname suffixes */
 extern struct dentry * d_lookup(struct dentry *, struct qstr *);
 extern struct dentry * __d_lookup(struct dentry *, struct qstr *);
+extern struct dentry * __d_lookup_rcu(struct dentry *, struct qstr *, unsigned *);
+extern seqlock_t rename_lock;
 
 /* validate "insecure" dentry pointer */
 extern int d_validate(struct dentry *, struct dentry *);
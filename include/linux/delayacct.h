@@ -0,0 +1,67 @@
+#ifndef _LINUX_DELAYACCT_H
+#define _LINUX_DELAYACCT_H
+
+/*
+ * Per-task delay accounting: how long and how often a task waited for
+ * block I/O and for swap-in.  The time it waited on a runqueue is kept
+ * in tsk->sched_info by the scheduler.  Exported by kernel/taskstats.c.
+ */
+
+#include <linux/config.h>
+#include <linux/sched.h>
+#include <linux/string.h>
+
+/* task_delay_info.flags */
+#define DELAYACCT_PF_SWAPIN	0x00000001	/* I/O waits are for swap-in */
+
+#ifdef CONFIG_TASK_DELAY_ACCT
+extern void __delayacct_blkio_end(void);
+
+static inline void delayacct_init(struct task_struct *tsk)
+{
+	memset(&tsk->delays, 0, sizeof(tsk->delays));
+	spin_lock_init(&tsk->delays.lock);
+}
+
+static inline void delayacct_set_flag(int flag)
+{
+	current->delays.flags |= flag;
+}
+
+static inline void delayacct_clear_flag(int flag)
+{
+	current->delays.flags &= ~flag;
+}
+
+static inline void delayacct_blkio_start(void)
+{
+	current->delays.blkio_start = sched_clock();
+}
+
+static inline void delayacct_blkio_end(void)
+{
+	__delayacct_blkio_end();
+}
+#else
+static inline void delayacct_init(struct task_struct *tsk)
+{
+}
+
+static inline void delayacct_set_flag(int flag)
+{
+}
+
+static inline void delayacct_clear_flag(int flag)
+{
+}
+
+static inline void delayacct_blkio_start(void)
+{
+}
+
+static inline void delayacct_blkio_end(void)
+{
+}
+#endif
+
+#endif /* _LINUX_DELAYACCT_H */
@@ -22,6 +22,12 @@
 #define EPOLL_CTL_DEL 2
 #define EPOLL_CTL_MOD 3
 
+/* Flags for sys_epoll_create1() */
+#define EPOLL_SHARDED 1	/* Keep per-CPU ready lists */
+
+/* Wake up only one of the tasks waiting inside epoll_wait(2) */
+#define EPOLLEXCLUSIVE (1 << 28)
+
 /* Set the One Shot behaviour for the target file descriptor */
 #define EPOLLONESHOT (1 << 30)
 
@@ -43,6 +49,32 @@ struct epoll_event {
 	__u64 data;
 } EPOLL_PACKED;
 
+/* Magic value stored at the beginning of a shared ready ring */
+#define EPOLL_RING_MAGIC 0x45506f6c
+
+/*
+ * Header of the ready ring that is created by mmap()ing an eventpoll file
+ * descriptor with MAP_SHARED. Edge triggered items are pushed inside the
+ * ring directly from the wakeup callback, so that userspace can harvest
+ * them without entering the kernel. The kernel produces at "tail" and the
+ * consumer advances "head" ( both are slot indexes in [0, nr) ). The ring
+ * is empty when head == tail and full when (tail + 1) % nr == head. When
+ * the ring is full, events are queued to the ready list and delivered by
+ * sys_epoll_wait(), that also drains the ring when called.
+ * Since the wakeup callback cannot call f_op->poll(), the "events" field
+ * of a ring slot reports the interest set of the item, not the actual
+ * ready set.
+ */
+struct epoll_ring {
+	__u32 magic;		/* EPOLL_RING_MAGIC */
+	__u32 nr;		/* Number of event slots */
+	__u32 head;		/* Consumer index, written by userspace */
+	__u32 tail;		/* Producer index, written by the kernel */
+	__u32 header_length;	/* Size of struct epoll_ring */
+	__u32 overflow;		/* Events diverted to the ready list */
+	struct epoll_event events[0];
+};
+
 #ifdef __KERNEL__
 
 /* Forward declarations to avoid compiler errors */
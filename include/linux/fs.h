@@ -81,6 +81,7 @@ extern int dir_notify_enable;
 /* public flags for file_system_type */
 #define FS_REQUIRES_DEV 1 /* 物理ディスクデバイス上に存在する */
 #define FS_BINARY_MOUNTDATA 2 /* ファイルシステムがバイナリのマウントデータを使用する */
+#define FS_RCU_WALK	4	/* iノードのキャッシュがSLAB_DESTROY_BY_RCUであり、RCUパス検索が可能 */ /* inode cache is SLAB_DESTROY_BY_RCU, see link_path_walk() */
 #define FS_REVAL_DOT	16384	/* dエントリキャッシュの"."、".."について有効性の確認を行う(ネットワークファイルシステム用) */ /* Check the paths ".", ".." for staleness */
 #define FS_ODD_RENAME	32768	/* renameをmove操作に変更する */ /* Temporary stuff; will go away as soon
 				  * as nfs_rename() will be cleaned up
@@ -233,6 +234,12 @@ extern void __init inode_init_early(void);
 extern void __init mnt_init(unsigned long);
 extern void __init files_init(unsigned long);
 
+extern int get_nr_files(void);
+struct ctl_table;
+struct file;
+extern int proc_nr_files(struct ctl_table *, int, struct file *,
+			 void __user *, size_t *, loff_t *);
+
 struct buffer_head;
 typedef int (get_block_t)(struct inode *inode, sector_t iblock,
 			struct buffer_head *bh_result, int create);
@@ -575,6 +582,7 @@ struct file_ra_state {
 
 struct file {
 	struct list_head	f_list; // ファイルオブジェクトの汎用的なリスト用のポインタ
+	int			f_sb_list_cpu; // f_listがつながっているスーパーブロックのCPU別リストのCPU番号(それ以外のリストでは-1)
 	struct dentry		*f_dentry; // オープン時に利用したファイル名を保持するdエントリ
 	struct vfsmount         *f_vfsmnt; // そのファイルを扱うファイルシステムへのポインタ
 	struct file_operations	*f_op; // ファイル操作用のメソッドを保持する構造体へのポインタ
@@ -601,10 +609,32 @@ struct file {
 #endif /* #ifdef CONFIG_EPOLL */
 	struct address_space	*f_mapping; // ファイルのアドレス空間オブジェクトへのポインタ
 };
+/*
+ * files_lock protects the lists of files other than sb->s_files, such as
+ * tty->tty_files.  The open files of a superblock are kept on per-cpu
+ * lists with per-cpu locks, see fs/file_table.c; walk them with
+ * do_file_list_for_each_entry() between sb_file_list_lock() and
+ * sb_file_list_unlock().
+ */
 extern spinlock_t files_lock;
 #define file_list_lock() spin_lock(&files_lock);
 #define file_list_unlock() spin_unlock(&files_lock);
 
+extern void sb_file_list_lock(void);
+extern void sb_file_list_unlock(void);
+
+#define do_file_list_for_each_entry(__sb, __file)			\
+{									\
+	int __cpu;							\
+	for_each_cpu(__cpu) {						\
+		struct list_head *__list;				\
+		__list = per_cpu_ptr((__sb)->s_files, __cpu);		\
+		list_for_each_entry((__file), __list, f_list)
+
+#define while_file_list_for_each_entry					\
+	}								\
+}
+
 #define get_file(x)	atomic_inc(&(x)->f_count)
 #define file_count(x)	atomic_read(&(x)->f_count)
 
@@ -782,7 +812,10 @@ struct super_block {
 	struct list_head	s_dirty;	/* 変更されたiノードのリスト */
 	struct list_head	s_io;		/* ディスクへの書き込み待ちiノードのリスト */
 	struct hlist_head	s_anon;		/* ネットワークファイルシステム処理用の無名ディレクトリのリスト */
-	struct list_head	s_files; /* ファイルオブジェクトのリスト */
+	struct list_head	s_dentry_lru;	/* 未使用dエントリのリスト(LRU) */
+	int			s_nr_dentry_unused; /* s_dentry_lru上のdエントリ数 */
+	spinlock_t		s_dentry_lru_lock; /* 上記の2つのフィールドを保護するロック */
+	struct list_head	*s_files; /* ファイルオブジェクトのリスト(CPU別) */
 
 	struct block_device	*s_bdev; /* ブロック型デバイスディスクリプタへのポインタ */
 	struct list_head	s_instances; /* 同じファイルシステム種別のスーパーブロックオブジェクトのリスト用のポインタ */
@@ -1022,6 +1055,18 @@ struct file_operations {
 
 	/* flockシステムコールの振る舞いを変更する */
 	int (*flock) (struct file *, int, struct file_lock *);
+
+	/* 非同期にベクタ読み込みを行う(IOCB_CMD_PREADV) */
+	ssize_t (*aio_readv) (struct kiocb *, const struct iovec *, unsigned long, loff_t);
+
+	/* 非同期にベクタ書き込みを行う(IOCB_CMD_PWRITEV) */
+	ssize_t (*aio_writev) (struct kiocb *, const struct iovec *, unsigned long, loff_t);
+
+	/* ファイルのページをコピーせずにパイプへ繋ぐ(spliceシステムコール) */
+	ssize_t (*splice_read) (struct file *, loff_t *, struct inode *, size_t, unsigned int);
+
+	/* パイプのバッファをファイルへ書き出す(spliceシステムコール) */
+	ssize_t (*splice_write) (struct inode *, struct file *, loff_t *, size_t, unsigned int);
 };
 
 struct inode_operations {
@@ -1596,6 +1641,7 @@ static inline void insert_inode_hash(struct inode *inode) {
 extern struct file * get_empty_filp(void);
 extern void file_move(struct file *f, struct list_head *list);
 extern void file_kill(struct file *f);
+extern void file_sb_list_add(struct file *f, struct super_block *sb);
 struct bio;
 extern void submit_bio(int, struct bio *);
 extern int bdev_read_only(struct block_device *);
@@ -1611,8 +1657,10 @@ extern ssize_t generic_file_read(struct file *, char __user *, size_t, loff_t *)
 int generic_write_checks(struct file *file, loff_t *pos, size_t *count, int isblk);
 extern ssize_t generic_file_write(struct file *, const char __user *, size_t, loff_t *);
 extern ssize_t generic_file_aio_read(struct kiocb *, char __user *, size_t, loff_t);
+extern ssize_t generic_file_aio_readv(struct kiocb *, const struct iovec *, unsigned long, loff_t);
 extern ssize_t __generic_file_aio_read(struct kiocb *, const struct iovec *, unsigned long, loff_t *);
 extern ssize_t generic_file_aio_write(struct kiocb *, const char __user *, size_t, loff_t);
+extern ssize_t generic_file_aio_writev(struct kiocb *, const struct iovec *, unsigned long, loff_t);
 extern ssize_t generic_file_aio_write_nolock(struct kiocb *, const struct iovec *,
 		unsigned long, loff_t *);
 extern ssize_t generic_file_direct_write(struct kiocb *, const struct iovec *,
@@ -1624,6 +1672,12 @@ extern ssize_t do_sync_write(struct file *filp, const char __user *buf, size_t l
 ssize_t generic_file_write_nolock(struct file *file, const struct iovec *iov,
 				unsigned long nr_segs, loff_t *ppos);
 extern ssize_t generic_file_sendfile(struct file *, loff_t *, size_t, read_actor_t, void *);
+extern ssize_t generic_file_splice_read(struct file *, loff_t *,
+		struct inode *, size_t, unsigned int);
+extern ssize_t generic_file_splice_write(struct inode *, struct file *,
+		loff_t *, size_t, unsigned int);
+extern ssize_t generic_splice_sendpage(struct inode *, struct file *,
+		loff_t *, size_t, unsigned int);
 extern void do_generic_mapping_read(struct address_space *mapping,
 				    struct file_ra_state *, struct file *,
 				    loff_t *, read_descriptor_t *, read_actor_t);
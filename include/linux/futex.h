@@ -9,9 +9,83 @@
 #define FUTEX_FD (2)
 #define FUTEX_REQUEUE (3)
 #define FUTEX_CMP_REQUEUE (4)
+#define FUTEX_WAKE_OP (5)
+#define FUTEX_LOCK_PI (6)
+#define FUTEX_UNLOCK_PI (7)
+#define FUTEX_TRYLOCK_PI (8)
+
+/*
+ * Or'ed into the operation for futexes that are only ever used by the
+ * threads of one process.  They are hashed on (mm, address) without
+ * looking up the vma or taking mmap_sem.
+ */
+#define FUTEX_PRIVATE_FLAG (128)
+#define FUTEX_CMD_MASK ~FUTEX_PRIVATE_FLAG
+
+#define FUTEX_WAIT_PRIVATE	(FUTEX_WAIT | FUTEX_PRIVATE_FLAG)
+#define FUTEX_WAKE_PRIVATE	(FUTEX_WAKE | FUTEX_PRIVATE_FLAG)
+#define FUTEX_REQUEUE_PRIVATE	(FUTEX_REQUEUE | FUTEX_PRIVATE_FLAG)
+#define FUTEX_CMP_REQUEUE_PRIVATE (FUTEX_CMP_REQUEUE | FUTEX_PRIVATE_FLAG)
+#define FUTEX_WAKE_OP_PRIVATE	(FUTEX_WAKE_OP | FUTEX_PRIVATE_FLAG)
+#define FUTEX_LOCK_PI_PRIVATE	(FUTEX_LOCK_PI | FUTEX_PRIVATE_FLAG)
+#define FUTEX_UNLOCK_PI_PRIVATE	(FUTEX_UNLOCK_PI | FUTEX_PRIVATE_FLAG)
+#define FUTEX_TRYLOCK_PI_PRIVATE (FUTEX_TRYLOCK_PI | FUTEX_PRIVATE_FLAG)
+
+/*
+ * The word of a PI futex holds the TID of its owner, 0 when unlocked.
+ * User space locks it by changing 0 to its TID and unlocks it by
+ * changing its TID back to 0, and only calls FUTEX_LOCK_PI and
+ * FUTEX_UNLOCK_PI when that fails.  The kernel sets FUTEX_WAITERS while
+ * tasks are blocked on the futex, so that the owner's unlock fails and
+ * comes to the kernel, and FUTEX_OWNER_DIED when it hands the futex of
+ * an exited owner to a waiter.
+ */
+#define FUTEX_WAITERS		0x80000000
+#define FUTEX_OWNER_DIED	0x40000000
+#define FUTEX_TID_MASK		0x3fffffff
 
 long do_futex(unsigned long uaddr, int op, int val,
 		unsigned long timeout, unsigned long uaddr2, int val2,
 		int val3);
 
+struct task_struct;
+
+#ifdef CONFIG_FUTEX
+extern void exit_pi_state_list(struct task_struct *curr);
+#else
+static inline void exit_pi_state_list(struct task_struct *curr)
+{
+}
+#endif
+
+/*
+ * FUTEX_WAKE_OP will perform atomically
+ *   int oldval = *(int *)UADDR2;
+ *   *(int *)UADDR2 = oldval OP OPARG;
+ *   if (oldval CMP CMPARG)
+ *     wake UADDR2;
+ * after waking up to VAL waiters on UADDR.  The operation is
+ * encoded in VAL3 with FUTEX_OP().
+ */
+#define FUTEX_OP_SET		0	/* *(int *)UADDR2 = OPARG; */
+#define FUTEX_OP_ADD		1	/* *(int *)UADDR2 += OPARG; */
+#define FUTEX_OP_OR		2	/* *(int *)UADDR2 |= OPARG; */
+#define FUTEX_OP_ANDN		3	/* *(int *)UADDR2 &= ~OPARG; */
+#define FUTEX_OP_XOR		4	/* *(int *)UADDR2 ^= OPARG; */
+
+#define FUTEX_OP_OPARG_SHIFT	8	/* Use (1 << OPARG) instead of OPARG,
+					   OPARG must be 0..31.  */
+
+#define FUTEX_OP_CMP_EQ		0	/* if (oldval == CMPARG) wake */
+#define FUTEX_OP_CMP_NE		1	/* if (oldval != CMPARG) wake */
+#define FUTEX_OP_CMP_LT		2	/* if (oldval < CMPARG) wake */
+#define FUTEX_OP_CMP_LE		3	/* if (oldval <= CMPARG) wake */
+#define FUTEX_OP_CMP_GT		4	/* if (oldval > CMPARG) wake */
+#define FUTEX_OP_CMP_GE		5	/* if (oldval >= CMPARG) wake */
+
+/* FUTEX_OP_ADD etc. can be or'ed with FUTEX_OP_OPARG_SHIFT in op. */
+#define FUTEX_OP(op, oparg, cmp, cmparg) \
+  (((op & 0xf) << 28) | ((cmp & 0xf) << 24)		\
+   | ((oparg & 0xfff) << 12) | (cmparg & 0xfff))
+
 #endif
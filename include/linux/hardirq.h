@@ -95,10 +95,17 @@ static inline void account_system_vtime(struct task_struct *tsk)
 }
 #endif
 
+#if defined(CONFIG_HIGH_RES_TIMERS) && defined(CONFIG_NO_IDLE_HZ)
+extern void hrtimer_irq_enter(void);
+#else
+# define hrtimer_irq_enter()	do { } while (0)
+#endif
+
 #define irq_enter()					\
 	do {						\
 		account_system_vtime(current);		\
 		add_preempt_count(HARDIRQ_OFFSET);	\
+		hrtimer_irq_enter();			\
 	} while (0)
 
 extern void irq_exit(void);
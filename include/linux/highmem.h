@@ -46,7 +46,7 @@ static inline void clear_user_highpage(struct page *page, unsigned long vaddr)
 static inline struct page *
 alloc_zeroed_user_highpage(struct vm_area_struct *vma, unsigned long vaddr)
 {
-	struct page *page = alloc_page_vma(GFP_HIGHUSER, vma, vaddr);
+	struct page *page = alloc_page_vma(GFP_HIGHUSER_MOVABLE, vma, vaddr);
 
 	if (page)
 		clear_user_highpage(page, vaddr);
@@ -62,6 +62,21 @@ static inline void clear_highpage(struct page *page)
 	kunmap_atomic(kaddr, KM_USER0);
 }
 
+/*
+ * Same, but without pulling the page into the cache where the architecture
+ * can do that: for pages which are not going to be used right away.
+ */
+#ifndef __HAVE_ARCH_CLEAR_PAGE_NOCACHE
+#define clear_page_nocache(addr)	clear_page(addr)
+#endif
+
+static inline void clear_highpage_nocache(struct page *page)
+{
+	void *kaddr = kmap_atomic(page, KM_USER0);
+	clear_page_nocache(kaddr);
+	kunmap_atomic(kaddr, KM_USER0);
+}
+
 /*
  * Same but also flushes aliased cache contents to RAM.
  */
@@ -0,0 +1,228 @@
+/*
+ *  include/linux/hrtimer.h
+ *
+ *  hrtimers - High-resolution kernel timers
+ *
+ *  Timers with nanosecond resolution, kept in a per-CPU, per-clock
+ *  red-black tree ordered by expiry time.  They are independent of the
+ *  jiffies based timer wheel, which is left to the (usually cancelled
+ *  long before they expire) coarse timeouts.
+ *
+ *  See Documentation/hrtimers.txt for the details.
+ */
+#ifndef _LINUX_HRTIMER_H
+#define _LINUX_HRTIMER_H
+
+#include <linux/config.h>
+#include <linux/rbtree.h>
+#include <linux/ktime.h>
+#include <linux/init.h>
+#include <linux/list.h>
+#include <linux/spinlock.h>
+#include <linux/thread_info.h>
+
+/*
+ * Mode arguments of xxx_hrtimer functions:
+ */
+enum hrtimer_mode {
+	HRTIMER_ABS,	/* Time value is absolute */
+	HRTIMER_REL,	/* Time value is relative to now */
+};
+
+/*
+ * Return values for the callback function
+ */
+enum hrtimer_restart {
+	HRTIMER_NORESTART,	/* Timer is not restarted */
+	HRTIMER_RESTART,	/* Timer must be restarted */
+};
+
+/*
+ * Values for the state field of struct hrtimer.  A timer whose callback
+ * is running can be enqueued again at the same time, so they are bits.
+ */
+#define HRTIMER_STATE_INACTIVE	0x00
+#define HRTIMER_STATE_ENQUEUED	0x01
+#define HRTIMER_STATE_CALLBACK	0x02
+
+struct hrtimer_base;
+struct hrtimer_cpu_base;
+struct clock_event_device;
+struct task_struct;
+struct pt_regs;
+
+/**
+ * struct hrtimer - the basic hrtimer structure
+ * @node:	red black tree node for time ordered insertion
+ * @expires:	the absolute expiry time in the hrtimers internal
+ *		representation.  The time is related to the clock on
+ *		which the timer is based.
+ * @function:	timer expiry callback function; it is called with
+ *		interrupts disabled and returns HRTIMER_RESTART after
+ *		forwarding @expires to have the timer requeued
+ * @base:	pointer to the timer base (per cpu and per clock)
+ * @state:	state information (HRTIMER_STATE_*)
+ *
+ * The hrtimer structure must be initialized by hrtimer_init()
+ */
+struct hrtimer {
+	struct rb_node			node;
+	ktime_t				expires;
+	int				(*function)(struct hrtimer *);
+	struct hrtimer_base		*base;
+	unsigned long			state;
+};
+
+/**
+ * struct hrtimer_sleeper - simple sleeper structure
+ * @timer:	embedded timer structure
+ * @task:	task to wake up, cleared when the timer has expired
+ */
+struct hrtimer_sleeper {
+	struct hrtimer			timer;
+	struct task_struct		*task;
+};
+
+/**
+ * struct hrtimer_base - the timer base for a specific clock
+ * @cpu_base:	per cpu base this clock base belongs to
+ * @index:	clock type index for per_cpu support when moving a timer
+ *		to a base on another cpu.
+ * @active:	red black tree root node for the active timers
+ * @first:	pointer to the timer node which expires first
+ * @resolution:	the resolution of the clock, in nanoseconds
+ * @get_time:	function to retrieve the current time of the clock
+ * @offset:	offset of this clock to the monotonic base, used to
+ *		program the clock event device
+ */
+struct hrtimer_base {
+	struct hrtimer_cpu_base		*cpu_base;
+	clockid_t			index;
+	struct rb_root			active;
+	struct rb_node			*first;
+	ktime_t				resolution;
+	ktime_t				(*get_time)(void);
+	ktime_t				offset;
+};
+
+#define HRTIMER_MAX_CLOCK_BASES		2
+
+/**
+ * struct hrtimer_cpu_base - the per cpu clock bases
+ * @lock:		lock protecting the bases and the timers in them
+ * @clock_base:		array of clock bases for this cpu
+ * @expires_next:	absolute monotonic time of the next event the
+ *			clock event device is programmed for
+ * @hres_active:	the clock event device has been taken over
+ * @in_interrupt:	hrtimer_interrupt() is running and will program
+ *			the next event when it is done
+ * @dev:		the clock event device of this cpu, if any
+ * @tick_timer:		timer emulating the periodic local tick in high
+ *			resolution mode
+ * @regs:		register frame of the interrupted context, for the
+ *			emulated tick
+ * @tick_stopped:	the emulated tick is stopped while the cpu is idle
+ * @idle_tick:		time of the first tick skipped since then
+ */
+struct hrtimer_cpu_base {
+	spinlock_t			lock;
+	struct hrtimer_base		clock_base[HRTIMER_MAX_CLOCK_BASES];
+	ktime_t				expires_next;
+	int				hres_active;
+	int				in_interrupt;
+	struct clock_event_device	*dev;
+	struct hrtimer			tick_timer;
+	struct pt_regs			*regs;
+#ifdef CONFIG_NO_IDLE_HZ
+	int				tick_stopped;
+	ktime_t				idle_tick;
+#endif
+};
+
+/* Exported timer functions: */
+
+/* Initialize timers: */
+extern void hrtimer_init(struct hrtimer *timer, clockid_t which_clock,
+			 enum hrtimer_mode mode);
+
+/* Basic timer operations: */
+extern int hrtimer_start(struct hrtimer *timer, ktime_t tim,
+			 const enum hrtimer_mode mode);
+extern int hrtimer_cancel(struct hrtimer *timer);
+extern int hrtimer_try_to_cancel(struct hrtimer *timer);
+
+static inline int hrtimer_restart(struct hrtimer *timer)
+{
+	return hrtimer_start(timer, timer->expires, HRTIMER_ABS);
+}
+
+/* Query timers: */
+extern ktime_t hrtimer_get_remaining(const struct hrtimer *timer);
+extern int hrtimer_get_res(const clockid_t which_clock, struct timespec *tp);
+
+static inline int hrtimer_active(const struct hrtimer *timer)
+{
+	return timer->state != HRTIMER_STATE_INACTIVE;
+}
+
+static inline int hrtimer_is_queued(const struct hrtimer *timer)
+{
+	return timer->state & HRTIMER_STATE_ENQUEUED;
+}
+
+static inline int hrtimer_callback_running(const struct hrtimer *timer)
+{
+	return timer->state & HRTIMER_STATE_CALLBACK;
+}
+
+/*
+ * Current time of the clock the timer is queued on; meant for the
+ * callbacks, which want to forward the timer relative to "now".
+ */
+static inline ktime_t hrtimer_cb_get_time(const struct hrtimer *timer)
+{
+	return timer->base->get_time();
+}
+
+/* Forward a hrtimer so it expires after now: */
+extern unsigned long hrtimer_forward(struct hrtimer *timer, ktime_t now,
+				     ktime_t interval);
+
+/* Precise sleep: */
+extern long hrtimer_nanosleep(struct timespec *rqtp, struct timespec *rmtp,
+			      const enum hrtimer_mode mode,
+			      const clockid_t clockid);
+extern long hrtimer_nanosleep_restart(struct restart_block *restart);
+extern long hrtimer_resume_nanosleep(struct restart_block *restart,
+				     struct timespec *rmtp);
+
+extern void hrtimer_init_sleeper(struct hrtimer_sleeper *sl,
+				 struct task_struct *tsk);
+
+/* Soft interrupt function to run the hrtimer queues: */
+extern void hrtimer_run_queues(void);
+
+/* Interrupt handler of clock event devices in high resolution mode: */
+extern void hrtimer_interrupt(struct clock_event_device *dev,
+			      struct pt_regs *regs);
+
+/* Stop/restart the local tick of an idle cpu: */
+#if defined(CONFIG_HIGH_RES_TIMERS) && defined(CONFIG_NO_IDLE_HZ)
+extern void hrtimer_stop_sched_tick(void);
+extern void hrtimer_restart_sched_tick(void);
+#else
+static inline void hrtimer_stop_sched_tick(void)
+{
+}
+static inline void hrtimer_restart_sched_tick(void)
+{
+}
+#endif
+
+/* Bootup initialization: */
+extern void __init hrtimers_init(void);
+
+/* ITIMER_REAL expiry function: */
+extern int it_real_fn(struct hrtimer *timer);
+
+#endif
@@ -0,0 +1,103 @@
+/*
+ *  include/linux/ktime.h
+ *
+ *  ktime_t - nanosecond-resolution time format.
+ *
+ *  A ktime_t is a signed 64 bit count of nanoseconds.  It is the time
+ *  format of the high resolution timer code: both absolute expiry times
+ *  (relative to the clock the timer is queued on) and intervals are
+ *  stored in it, so that comparisons and additions on the hot paths are
+ *  plain 64 bit integer operations.
+ *
+ *  Conversions from and to timespec/timeval are provided; the division
+ *  needed for the latter is done out of line.
+ */
+#ifndef _LINUX_KTIME_H
+#define _LINUX_KTIME_H
+
+#include <linux/time.h>
+#include <linux/jiffies.h>
+
+typedef union {
+	s64	tv64;
+} ktime_t;
+
+#define KTIME_MAX			((s64)~((u64)1 << 63))
+#define KTIME_SEC_MAX			(KTIME_MAX / NSEC_PER_SEC)
+
+/**
+ * ktime_set - Set a ktime_t variable from a seconds/nanoseconds value
+ * @secs:	seconds to set
+ * @nsecs:	nanoseconds to set
+ *
+ * Values beyond the range of a ktime_t are clamped to KTIME_MAX.
+ */
+static inline ktime_t ktime_set(const long secs, const unsigned long nsecs)
+{
+	ktime_t kt;
+
+	if (unlikely(secs >= KTIME_SEC_MAX))
+		kt.tv64 = KTIME_MAX;
+	else
+		kt.tv64 = (s64)secs * NSEC_PER_SEC + (s64)nsecs;
+	return kt;
+}
+
+static inline ktime_t ns_to_ktime(s64 ns)
+{
+	ktime_t kt;
+
+	kt.tv64 = ns;
+	return kt;
+}
+
+static inline ktime_t ktime_add(const ktime_t lhs, const ktime_t rhs)
+{
+	return ns_to_ktime(lhs.tv64 + rhs.tv64);
+}
+
+static inline ktime_t ktime_sub(const ktime_t lhs, const ktime_t rhs)
+{
+	return ns_to_ktime(lhs.tv64 - rhs.tv64);
+}
+
+static inline ktime_t ktime_add_ns(const ktime_t kt, s64 nsec)
+{
+	return ns_to_ktime(kt.tv64 + nsec);
+}
+
+#define ktime_to_ns(kt)			((kt).tv64)
+
+static inline ktime_t timespec_to_ktime(const struct timespec ts)
+{
+	return ktime_set(ts.tv_sec, ts.tv_nsec);
+}
+
+static inline ktime_t timeval_to_ktime(const struct timeval tv)
+{
+	return ktime_set(tv.tv_sec, tv.tv_usec * NSEC_PER_USEC);
+}
+
+static inline struct timespec ktime_to_timespec(const ktime_t kt)
+{
+	return ns_to_timespec(kt.tv64);
+}
+
+static inline struct timeval ktime_to_timeval(const ktime_t kt)
+{
+	return ns_to_timeval(kt.tv64);
+}
+
+/*
+ * Resolution of the clock bases: a tick when the expiry of the timers is
+ * checked from the timer softirq, the granularity of the clock event
+ * device otherwise.
+ */
+#define KTIME_LOW_RES			(ns_to_ktime(TICK_NSEC))
+#define KTIME_HIGH_RES			(ns_to_ktime(1))
+
+extern ktime_t ktime_get(void);
+extern ktime_t ktime_get_real(void);
+extern void ktime_get_ts(struct timespec *ts);
+
+#endif
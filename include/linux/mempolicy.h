@@ -118,6 +118,9 @@ extern int mpol_first_node(struct vm_area_struct *vma, unsigned long addr);
 extern int mpol_node_valid(int nid, struct vm_area_struct *vma,
 			unsigned long addr);
 
+extern int migrate_mm_to_node(struct mm_struct *mm, int nid,
+			      unsigned long *addr, unsigned long nr_ptes);
+
 /*
  * Tree of shared policies for a shared memory region.
  * Maintain the policies in a pseudo mm that contains vmas. The vmas
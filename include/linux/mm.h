@@ -698,6 +698,72 @@ static inline pmd_t *pmd_alloc(struct mm_struct *mm, pud_t *pud, unsigned long a
 #endif
 #endif /* CONFIG_MMU */
 
+/*
+ * The ptes of a page table page are protected by the pte lock: a spinlock
+ * in the struct page of the page table page with USE_SPLIT_PTLOCKS, the
+ * mm->page_table_lock otherwise.  Page faults take only the pte lock; the
+ * paths which work under mm->page_table_lock (zap, rmap, swapoff...) take
+ * the pte lock inside it with pte_lock_nested() when they may race with
+ * a fault.
+ */
+#ifdef CONFIG_MMU
+#if USE_SPLIT_PTLOCKS
+/*
+ * A page table page is neither in the page cache nor anonymous: the lock
+ * overlays page->private and page->mapping, and mapping must be cleared
+ * again before the page is freed.
+ */
+#define __pte_lockptr(page)	((spinlock_t *)&((page)->private))
+#define pte_lock_init(page)	do {					\
+	BUILD_BUG_ON(sizeof(spinlock_t) >				\
+		     sizeof(unsigned long) + sizeof(struct address_space *)); \
+	spin_lock_init(__pte_lockptr(page));				\
+} while (0)
+#define pte_lock_deinit(page)	((page)->mapping = NULL)
+#define pte_lockptr(mm, pmd)	({(void)(mm); __pte_lockptr(pmd_page(*(pmd)));})
+#else
+#define pte_lock_init(page)	do {} while (0)
+#define pte_lock_deinit(page)	do {} while (0)
+#define pte_lockptr(mm, pmd)	({(void)(pmd); &(mm)->page_table_lock;})
+#endif
+
+#define pte_offset_map_lock(mm, pmd, address, ptlp)	\
+({							\
+	spinlock_t *__ptl = pte_lockptr(mm, pmd);	\
+	pte_t *__pte = pte_offset_map(pmd, address);	\
+	*(ptlp) = __ptl;				\
+	spin_lock(__ptl);				\
+	__pte;						\
+})
+
+#define pte_unmap_unlock(pte, ptl)	do {		\
+	spin_unlock(ptl);				\
+	pte_unmap(pte);					\
+} while (0)
+
+/*
+ * For the callers holding mm->page_table_lock: takes the pte lock as well
+ * if it is a different one.  Returns what pte_unlock_nested() releases.
+ */
+static inline spinlock_t *pte_lock_nested(struct mm_struct *mm, pmd_t *pmd)
+{
+#if USE_SPLIT_PTLOCKS
+	spinlock_t *ptl = pte_lockptr(mm, pmd);
+
+	spin_lock(ptl);
+	return ptl;
+#else
+	return NULL;
+#endif
+}
+
+static inline void pte_unlock_nested(spinlock_t *ptl)
+{
+	if (ptl)
+		spin_unlock(ptl);
+}
+#endif /* CONFIG_MMU */
+
 extern void free_area_init(unsigned long * zones_size);
 extern void free_area_init_node(int nid, pg_data_t *pgdat,
 	unsigned long * zones_size, unsigned long zone_start_pfn, 
@@ -20,8 +20,27 @@
 #define MAX_ORDER CONFIG_FORCE_MAX_ZONEORDER
 #endif
 
+/*
+ * The free lists are split by the mobility of the allocations: the pages
+ * the kernel cannot give back on demand (unmovable), the slab caches which
+ * shrink under memory pressure (reclaimable) and the user and page cache
+ * pages (movable).  Every pageblock, MAX_ORDER-1 pages, has one of these
+ * types and its free pages go to the lists of that type, so that the
+ * long-lived kernel allocations do not end up scattered all over the zone
+ * and reclaim can still empty whole blocks for high-order allocations.
+ * An allocation takes a block of another type only when there are no free
+ * pages of its own.
+ */
+#define MIGRATE_UNMOVABLE	0
+#define MIGRATE_RECLAIMABLE	1
+#define MIGRATE_MOVABLE		2
+#define MIGRATE_TYPES		3
+
+#define PAGEBLOCK_ORDER		(MAX_ORDER - 1)
+#define PAGEBLOCK_NR_PAGES	(1UL << PAGEBLOCK_ORDER)
+
 struct free_area {
-	struct list_head	free_list;
+	struct list_head	free_list[MIGRATE_TYPES];
 	unsigned long		nr_free;
 };
 
@@ -128,6 +147,14 @@ struct zone {
 	 */
 	spinlock_t		lock;
 	struct free_area	free_area[MAX_ORDER];
+	unsigned char		*pageblock_type;	/* MIGRATE_* per block */
+
+#ifdef CONFIG_PREZERO_PAGES
+	/* order-0 pages zeroed in advance by kzerod, for __GFP_ZERO */
+	spinlock_t		zeroed_lock;
+	struct list_head	zeroed_list;
+	unsigned long		nr_zeroed;
+#endif
 
 
 	ZONE_PADDING(_pad1_)
@@ -142,6 +169,15 @@ struct zone {
 	unsigned long		nr_inactive;
 	unsigned long		pages_scanned;	   /* since last reclaim */
 	int			all_unreclaimable; /* All pages pinned */
+#ifdef CONFIG_COMPACTION
+	/*
+	 * After compaction failed, the next 1 << compact_defer_shift
+	 * allocations that would compact the zone skip it instead;
+	 * compact_considered counts them.  As racy as prev_priority.
+	 */
+	unsigned int		compact_considered;
+	unsigned int		compact_defer_shift;
+#endif
 
 	/*
 	 * prev_priority holds the scanning priority for this zone.  It is
@@ -262,6 +298,9 @@ typedef struct pglist_data {
 	wait_queue_head_t kswapd_wait;
 	struct task_struct *kswapd;
 	int kswapd_max_order;
+#ifdef CONFIG_PREZERO_PAGES
+	wait_queue_head_t kzerod_wait;
+#endif
 } pg_data_t;
 
 #define node_present_pages(nid)	(NODE_DATA(nid)->node_present_pages)
@@ -367,6 +406,9 @@ int min_free_kbytes_sysctl_handler(struct ctl_table *, int, struct file *,
 extern int sysctl_lowmem_reserve_ratio[MAX_NR_ZONES-1];
 int lowmem_reserve_ratio_sysctl_handler(struct ctl_table *, int, struct file *,
 					void __user *, size_t *, loff_t *);
+extern int sysctl_compact_memory;
+int sysctl_compaction_handler(struct ctl_table *, int, struct file *,
+					void __user *, size_t *, loff_t *);
 
 #include <linux/topology.h>
 /* Returns the number of the current Node. */
@@ -131,6 +131,10 @@ struct page_state {
 	unsigned long allocstall;	/* direct reclaim calls */
 
 	unsigned long pgrotated;	/* pages rotated to tail of the LRU */
+	unsigned long pgmigrate_success;/* pages moved by compaction */
+	unsigned long pgmigrate_fail;	/* pages compaction failed to move */
+	unsigned long compact_stall;	/* compaction runs for allocations */
+	unsigned long compact_success;	/* ... which emptied a block */
 };
 
 extern void get_page_state(struct page_state *ret);
@@ -50,14 +50,68 @@ static inline void mapping_set_gfp_mask(struct address_space *m, int mask)
 #define page_cache_release(page)	put_page(page)
 void release_pages(struct page **pages, int nr, int cold);
 
+/*
+ * Where the architecture has cmpxchg, find_get_page() and find_get_pages()
+ * walk the radix tree under RCU instead of the tree_lock.  The page they
+ * find may be freed and reused under them, so they take their reference
+ * only if the count is not zero, and check that the slot still points to
+ * the page afterwards.  Whoever removes a page from the page cache while
+ * others may still look it up (vmscan) freezes its count at zero first,
+ * with page_freeze_refs(), so that no new reference appears meanwhile.
+ */
+#ifdef __HAVE_ARCH_CMPXCHG
+#define PAGECACHE_LOCKLESS	1
+
+static inline int page_cache_get_speculative(struct page *page)
+{
+	int c, old;
+
+	/* _count is biased by -1: a free or frozen page reads -1 */
+	c = atomic_read(&page->_count);
+	for (;;) {
+		if (unlikely(c == -1))
+			return 0;
+		old = cmpxchg(&page->_count.counter, c, c + 1);
+		if (likely(old == c))
+			return 1;
+		c = old;
+	}
+}
+
+static inline int page_freeze_refs(struct page *page, int count)
+{
+	return likely(cmpxchg(&page->_count.counter,
+				count - 1, -1) == count - 1);
+}
+
+static inline void page_unfreeze_refs(struct page *page, int count)
+{
+	BUG_ON(page_count(page) != 0);
+	smp_mb();
+	set_page_count(page, count);
+}
+#else
+#define PAGECACHE_LOCKLESS	0
+
+/* Lookups take the tree_lock, which the caller holds. */
+static inline int page_freeze_refs(struct page *page, int count)
+{
+	return page_count(page) == count;
+}
+
+static inline void page_unfreeze_refs(struct page *page, int count)
+{
+}
+#endif
+
 static inline struct page *page_cache_alloc(struct address_space *x)
 {
-	return alloc_pages(mapping_gfp_mask(x), 0);
+	return alloc_pages(mapping_gfp_mask(x) | __GFP_MOVABLE, 0);
 }
 
 static inline struct page *page_cache_alloc_cold(struct address_space *x)
 {
-	return alloc_pages(mapping_gfp_mask(x)|__GFP_COLD, 0);
+	return alloc_pages(mapping_gfp_mask(x)|__GFP_COLD|__GFP_MOVABLE, 0);
 }
 
 typedef int filler_t(void *, struct page *);
@@ -168,6 +222,21 @@ static inline void lock_page(struct page *page)
 	if (TestSetPageLocked(page))
 		__lock_page(page);
 }
+
+extern int FASTCALL(__lock_page_async(struct page *page, wait_queue_t *wait));
+
+/*
+ * Lock a page on behalf of an aio retry: if "wait" is an async wait queue
+ * entry (current->io_wait), instead of sleeping it queues "wait" on the
+ * page and returns -EIOCBRETRY. The iocb gets kicked when the page is
+ * unlocked. Otherwise it behaves like lock_page() and returns 0.
+ */
+static inline int lock_page_async(struct page *page, wait_queue_t *wait)
+{
+	if (TestSetPageLocked(page))
+		return __lock_page_async(page, wait);
+	return 0;
+}
 	
 /*
  * This is exported only for wait_on_page_locked/wait_on_page_writeback.
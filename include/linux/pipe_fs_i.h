@@ -3,7 +3,8 @@
 
 #define PIPEFS_MAGIC 0x50495045
 
-#define PIPE_BUFFERS (16)
+/* Ring size of a new pipe, in buffers; a power of two */
+#define PIPE_DEF_BUFFERS (16)
 
 struct pipe_buffer {
 	struct page *page;
@@ -20,8 +21,8 @@ struct pipe_buf_operations {
 
 struct pipe_inode_info {
 	wait_queue_head_t wait;
-	unsigned int nrbufs, curbuf;
-	struct pipe_buffer bufs[PIPE_BUFFERS];
+	unsigned int nrbufs, curbuf, buffers;
+	struct pipe_buffer *bufs;	/* ring of "buffers" entries */
 	struct page *tmp_page;
 	unsigned int start;
 	unsigned int readers;
@@ -56,4 +57,17 @@ void pipe_wait(struct inode * inode);
 struct inode* pipe_new(struct inode* inode);
 void free_pipe_info(struct inode* inode);
 
+/* F_SETPIPE_SZ and F_GETPIPE_SZ, and the unprivileged size limit */
+long pipe_fcntl(struct file *file, unsigned int cmd, unsigned long arg);
+extern int pipe_max_size, pipe_min_size;
+
+/*
+ * splice(2) flags
+ */
+#define SPLICE_F_NONBLOCK	(0x02)	/* don't block on the pipe splicing
+					 * (but we may still block on the fd
+					 * we splice from/to) */
+#define SPLICE_F_MORE		(0x04)	/* expect more data, see MSG_MORE */
+#define SPLICE_F_ALL		(SPLICE_F_NONBLOCK|SPLICE_F_MORE)
+
 #endif
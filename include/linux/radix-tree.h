@@ -21,6 +21,18 @@
 
 #include <linux/preempt.h>
 #include <linux/types.h>
+#include <linux/rcupdate.h>
+
+/*
+ * Updates of a radix tree (insert, delete, tag set and clear) must be
+ * serialized by the caller.  radix_tree_lookup(), radix_tree_lookup_slot()
+ * and radix_tree_gang_lookup{,_slot}() may run concurrently with them
+ * under rcu_read_lock(): items and nodes are published with
+ * rcu_assign_pointer() and nodes are freed after a grace period.  The
+ * item found that way may be deleted at any time; the caller has to pin
+ * it, then check that the slot still holds it.  Tagged lookups still
+ * need the lock.
+ */
 
 struct radix_tree_root {
 	unsigned int		height;
@@ -46,10 +58,14 @@ do {									\
 
 int radix_tree_insert(struct radix_tree_root *, unsigned long, void *);
 void *radix_tree_lookup(struct radix_tree_root *, unsigned long);
+void **radix_tree_lookup_slot(struct radix_tree_root *, unsigned long);
 void *radix_tree_delete(struct radix_tree_root *, unsigned long);
 unsigned int
 radix_tree_gang_lookup(struct radix_tree_root *root, void **results,
 			unsigned long first_index, unsigned int max_items);
+unsigned int
+radix_tree_gang_lookup_slot(struct radix_tree_root *root, void ***results,
+			unsigned long first_index, unsigned int max_items);
 int radix_tree_preload(int gfp_mask);
 void radix_tree_init(void);
 void *radix_tree_tag_set(struct radix_tree_root *root,
@@ -63,6 +79,11 @@ radix_tree_gang_lookup_tag(struct radix_tree_root *root, void **results,
 		unsigned long first_index, unsigned int max_items, int tag);
 int radix_tree_tagged(struct radix_tree_root *root, int tag);
 
+static inline void *radix_tree_deref_slot(void **pslot)
+{
+	return rcu_dereference(*pslot);
+}
+
 static inline void radix_tree_preload_end(void)
 {
 	preempt_enable();
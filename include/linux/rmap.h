@@ -90,7 +90,13 @@ static inline void page_dup_rmap(struct page *page)
  * Called from mm/vmscan.c to handle paging out
  */
 int page_referenced(struct page *, int is_locked, int ignore_token);
-int try_to_unmap(struct page *);
+int try_to_unmap(struct page *, int migration);
+
+/*
+ * Called from mm/migrate.c to move anonymous pages
+ */
+int page_wrprotect_anon(struct page *);
+void page_move_anon_ptes(struct page *, struct page *);
 
 /*
  * Used by swapoff to help locate where page is expected in vma.
@@ -104,7 +110,7 @@ unsigned long page_address_in_vma(struct page *, struct vm_area_struct *);
 #define anon_vma_link(vma)	do {} while (0)
 
 #define page_referenced(page,l,i) TestClearPageReferenced(page)
-#define try_to_unmap(page)	SWAP_FAIL
+#define try_to_unmap(page, m)	SWAP_FAIL
 
 #endif	/* CONFIG_MMU */
 
@@ -100,6 +100,7 @@ extern unsigned long nr_iowait(void);
 #include <linux/param.h>
 #include <linux/resource.h>
 #include <linux/timer.h>
+#include <linux/hrtimer.h>
 
 #include <asm/processor.h>
 
@@ -156,6 +157,31 @@ extern void init_idle(task_t *idle, int cpu);
 
 extern cpumask_t nohz_cpu_mask;
 
+/* tunables of the fair scheduling class, in nanoseconds: */
+extern unsigned int sysctl_sched_latency;
+extern unsigned int sysctl_sched_min_granularity;
+extern unsigned int sysctl_sched_wakeup_granularity;
+
+struct user_struct;
+#ifdef CONFIG_FAIR_USER_SCHED
+extern unsigned int sysctl_sched_bandwidth_period_us;
+extern int sched_create_user(struct user_struct *up);
+extern void sched_destroy_user(struct user_struct *up);
+extern void sched_switch_user(struct task_struct *p);
+extern struct file_operations proc_sched_users_operations;
+#else
+static inline int sched_create_user(struct user_struct *up)
+{
+	return 0;
+}
+static inline void sched_destroy_user(struct user_struct *up)
+{
+}
+static inline void sched_switch_user(struct task_struct *p)
+{
+}
+#endif
+
 extern void show_state(void);
 extern void show_regs(struct pt_regs *);
 
@@ -204,6 +230,29 @@ extern void arch_unmap_area(struct vm_area_struct *area);
 extern void arch_unmap_area_topdown(struct vm_area_struct *area);
 
 
+#define USE_SPLIT_PTLOCKS	(NR_CPUS >= CONFIG_SPLIT_PTLOCK_CPUS)
+
+#if USE_SPLIT_PTLOCKS
+/*
+ * Page faults hold the lock of the page table page they work on rather
+ * than mm->page_table_lock, so the counters they update are atomic.
+ */
+typedef atomic_t mm_counter_t;
+#define set_mm_counter(mm, member, value) atomic_set(&(mm)->_##member, value)
+#define get_mm_counter(mm, member) ((unsigned long)atomic_read(&(mm)->_##member))
+#define add_mm_counter(mm, member, value) atomic_add(value, &(mm)->_##member)
+#define inc_mm_counter(mm, member) atomic_inc(&(mm)->_##member)
+#define dec_mm_counter(mm, member) atomic_dec(&(mm)->_##member)
+#else
+/* protected by mm->page_table_lock */
+typedef unsigned long mm_counter_t;
+#define set_mm_counter(mm, member, value) (mm)->_##member = (value)
+#define get_mm_counter(mm, member) ((mm)->_##member)
+#define add_mm_counter(mm, member, value) (mm)->_##member += (value)
+#define inc_mm_counter(mm, member) (mm)->_##member++
+#define dec_mm_counter(mm, member) (mm)->_##member--
+#endif
+
 struct mm_struct {
 	struct vm_area_struct * mmap;		/* メモリリージョンオブジェクトリストのヘッド */
 	struct rb_root mm_rb; /* メモリリージョンオブジェクトの赤黒木のルート要素を指す */
@@ -225,7 +274,7 @@ struct mm_struct {
 	atomic_t mm_count;			/* この構造体の参照数 */
 	int map_count;				/* メモリリージョン数 */
 	struct rw_semaphore mmap_sem; // メモリリージョンの読み書き用セマフォ
-	spinlock_t page_table_lock;		/* メモリリージョン及びページテーブル用のスピンロック, mm->rss, mm->anon_rss */
+	spinlock_t page_table_lock;		/* メモリリージョン及びページテーブル用のスピンロック, rss (USE_SPLIT_PTLOCKS でなければ) */
 
 	struct list_head mmlist; // メモリディスクリプタのリスト(次の要素を指す)
 	/* List of maybe swapped mm's.  These are globally strung
@@ -263,7 +312,8 @@ struct mm_struct {
 	 * locked_vm: スワップアウトされないページ数
 	 * shared_vm: 共有ファイルメモリマッピング領域のページ数
 	 */
-	unsigned long rss, anon_rss, total_vm, locked_vm, shared_vm;
+	mm_counter_t _rss, _anon_rss;
+	unsigned long total_vm, locked_vm, shared_vm;
 
 	/**
 	 * exec_vm: 実行可能メモリまピング領域のページ数
@@ -303,6 +353,13 @@ struct mm_struct {
 
 	unsigned long hiwater_rss;	/* 当該プロセスがある時点で使用していたページフレームの最大数 */
 	unsigned long hiwater_vm;	/* 当該プロセスのメモリリージョンがある時点で使用していたページフレームの数 */
+
+#ifdef CONFIG_NUMA
+	/* automatic page migration, see task_numa_placement() */
+	struct work_struct numa_work;
+	unsigned long numa_scan_addr;
+	int numa_migrate_nid;
+#endif
 };
 
 struct sighand_struct {
@@ -427,6 +484,10 @@ struct user_struct {
 	/* Hash table maintenance information */
 	struct list_head uidhash_list;
 	uid_t uid;
+
+#ifdef CONFIG_FAIR_USER_SCHED
+	struct fair_group *fair_group;	/* CPU share, see kernel/sched_fair.c */
+#endif
 };
 
 extern struct user_struct *find_user(uid_t);
@@ -435,10 +496,27 @@ extern struct user_struct root_user;
 #define INIT_USER (&root_user)
 
 typedef struct prio_array prio_array_t;
+struct fair_rq;
+
+/*
+ * What the fair scheduling class (kernel/sched_fair.c) queues: a task or,
+ * with CONFIG_FAIR_USER_SCHED, the tasks of one user on one cpu.
+ */
+struct sched_entity {
+	struct rb_node run_node;
+	unsigned long weight;
+	unsigned long long vruntime, exec_start;
+	int on_rq;
+#ifdef CONFIG_FAIR_USER_SCHED
+	struct fair_rq *fair_rq;	/* queued on */
+	struct fair_rq *my_q;		/* the user's tasks, NULL for a task */
+	struct sched_entity *parent;	/* the user's entity, for a task */
+#endif
+};
 struct backing_dev_info;
 struct reclaim_state;
 
-#ifdef CONFIG_SCHEDSTATS
+#if defined(CONFIG_SCHEDSTATS) || defined(CONFIG_TASK_DELAY_ACCT)
 struct sched_info {
 	/* cumulative counters */
 	unsigned long	cpu_time,	/* time spent on the cpu */
@@ -449,10 +527,25 @@ struct sched_info {
 	unsigned long	last_arrival,	/* when we last ran on a cpu */
 			last_queued;	/* when we were last queued to run */
 };
+#endif
 
+#ifdef CONFIG_SCHEDSTATS
 extern struct file_operations proc_schedstat_operations;
 #endif
 
+#ifdef CONFIG_TASK_DELAY_ACCT
+struct task_delay_info {
+	spinlock_t	lock;		/* protects the totals and counts */
+	unsigned int	flags;		/* DELAYACCT_PF_*, see delayacct.h */
+
+	unsigned long long blkio_start;	/* sched_clock() of the last wait */
+	unsigned long long blkio_delay;	/* total ns waited for block I/O */
+	unsigned long long swapin_delay; /* and for swap-in */
+	unsigned long	blkio_count;
+	unsigned long	swapin_count;
+};
+#endif
+
 enum idle_type
 {
 	SCHED_IDLE,
@@ -572,6 +665,8 @@ int set_current_groups(struct group_info *group_info);
 struct audit_context;		/* See audit.c */
 struct mempolicy;
 
+struct futex_pi_state;
+
 struct task_struct {
 	volatile long state;	/* -1 unrunnable, 0 runnable, >0 stopped */
 	struct thread_info *thread_info;
@@ -581,9 +676,12 @@ struct task_struct {
 
 	int lock_depth;		/* Lock depth */
 
-	int prio, static_prio;
+	int prio, static_prio, normal_prio;
+	int pi_prio;		/* boost from PI futex waiters, MAX_PRIO if none */
 	struct list_head run_list;
 	prio_array_t *array;
+	int on_rq;		/* queued on a runqueue */
+	struct sched_entity se;
 
 	unsigned long sleep_avg;
 	unsigned long long timestamp, last_ran;
@@ -593,9 +691,12 @@ struct task_struct {
 	cpumask_t cpus_allowed;
 	unsigned int time_slice, first_time_slice;
 
-#ifdef CONFIG_SCHEDSTATS
+#if defined(CONFIG_SCHEDSTATS) || defined(CONFIG_TASK_DELAY_ACCT)
 	struct sched_info sched_info;
 #endif
+#ifdef CONFIG_TASK_DELAY_ACCT
+	struct task_delay_info delays;
+#endif
 
 	struct list_head tasks;
 	/*
@@ -640,10 +741,10 @@ struct task_struct {
 	int __user *clear_child_tid;		/* CLONE_CHILD_CLEARTID */
 
 	unsigned long rt_priority;
-	unsigned long it_real_value, it_real_incr;
+	ktime_t it_real_incr;
 	cputime_t it_virt_value, it_virt_incr;
 	cputime_t it_prof_value, it_prof_incr;
-	struct timer_list real_timer;
+	struct hrtimer real_timer;
 	cputime_t utime, stime;
 	unsigned long nvcsw, nivcsw; /* context switch counts */
 	struct timespec start_time;
@@ -731,6 +832,14 @@ struct task_struct {
 #ifdef CONFIG_NUMA
   	struct mempolicy *mempolicy;
 	short il_next;
+	int numa_preferred_nid;		/* node its memory is on, or -1 */
+	int numa_remote_periods;
+	unsigned long numa_placement_stamp;
+	unsigned int numa_faults[MAX_NUMNODES];	/* recent faults per node */
+#endif
+#ifdef CONFIG_FUTEX
+	struct list_head pi_state_list;	/* PI futexes owned, with waiters */
+	struct futex_pi_state *pi_blocked_on;
 #endif
 };
 
@@ -836,6 +945,7 @@ static inline void idle_task_exit(void) {}
 
 extern void sched_idle_next(void);
 extern void set_user_nice(task_t *p, long nice);
+extern void sched_pi_setprio(task_t *p, int prio);
 extern int task_prio(const task_t *p);
 extern int task_nice(const task_t *p);
 extern int task_curr(const task_t *p);
@@ -901,6 +1011,24 @@ extern void FASTCALL(wake_up_new_task(struct task_struct * tsk,
 extern void FASTCALL(sched_fork(task_t * p));
 extern void FASTCALL(sched_exit(task_t * p));
 
+#ifdef CONFIG_NUMA
+extern int sysctl_numa_migrate;
+extern void mm_init_numa(struct mm_struct *mm);
+
+/* the current task faulted on a page of node nid */
+static inline void task_numa_fault(int nid)
+{
+	current->numa_faults[nid]++;
+}
+#else
+static inline void mm_init_numa(struct mm_struct *mm)
+{
+}
+static inline void task_numa_fault(int nid)
+{
+}
+#endif
+
 extern int in_group_p(gid_t);
 extern int in_egroup_p(gid_t);
 
@@ -358,6 +358,18 @@ struct swap_info_struct;
  *	@mask contains the permission mask.
  *     @nd contains the nameidata (may be NULL).
  *	Return 0 if permission is granted.
+ * @inode_permission_rcu:
+ *	Check permission like @inode_permission, for a lookup done by the
+ *	RCU path walk.  @inode is not pinned and may be freed and reused
+ *	under the caller, who validates the result afterwards; the hook
+ *	must not sleep, must not rely on state hanging off @inode staying
+ *	allocated, and may always return -EAGAIN to send the walk down the
+ *	refcounted path, where @inode_permission is called instead.  Modules
+ *	that provide @inode_permission but not this hook get -EAGAIN.
+ *	@inode contains the inode structure to check.
+ *	@mask contains the permission mask.
+ *	@nd contains the nameidata.
+ *	Return 0 if permission is granted.
  * @inode_setattr:
  *	Check permission before setting file attributes.  Note that the kernel
  *	call to notify_change is performed from several locations, whenever
@@ -1109,6 +1121,7 @@ struct security_operations {
 	int (*inode_readlink) (struct dentry *dentry);
 	int (*inode_follow_link) (struct dentry *dentry, struct nameidata *nd);
 	int (*inode_permission) (struct inode *inode, int mask, struct nameidata *nd);
+	int (*inode_permission_rcu) (struct inode *inode, int mask, struct nameidata *nd);
 	int (*inode_setattr)	(struct dentry *dentry, struct iattr *attr);
 	int (*inode_getattr) (struct vfsmount *mnt, struct dentry *dentry);
         void (*inode_delete) (struct inode *inode);
@@ -1551,6 +1564,12 @@ static inline int security_inode_permission (struct inode *inode, int mask,
 	return security_ops->inode_permission (inode, mask, nd);
 }
 
+static inline int security_inode_permission_rcu (struct inode *inode, int mask,
+						 struct nameidata *nd)
+{
+	return security_ops->inode_permission_rcu (inode, mask, nd);
+}
+
 static inline int security_inode_setattr (struct dentry *dentry,
 					  struct iattr *attr)
 {
@@ -2204,6 +2223,12 @@ static inline int security_inode_permission (struct inode *inode, int mask,
 	return 0;
 }
 
+static inline int security_inode_permission_rcu (struct inode *inode, int mask,
+						 struct nameidata *nd)
+{
+	return 0;
+}
+
 static inline int security_inode_setattr (struct dentry *dentry,
 					  struct iattr *attr)
 {
@@ -135,6 +135,11 @@ enum
 	KERN_HZ_TIMER=65,	/* int: hz timer on or off */
 	KERN_UNKNOWN_NMI_PANIC=66, /* int: unknown nmi panic flag */
 	KERN_BOOTLOADER_TYPE=67, /* int: boot loader type */
+	KERN_SCHED_LATENCY=68,	/* int: fair scheduler latency target (ns) */
+	KERN_SCHED_MIN_GRANULARITY=69, /* int: fair scheduler minimal slice (ns) */
+	KERN_SCHED_WAKEUP_GRANULARITY=70, /* int: fair scheduler wakeup preemption (ns) */
+	KERN_SCHED_BANDWIDTH_PERIOD=71, /* int: fair scheduler quota period (us) */
+	KERN_NUMA_MIGRATE=72,	/* int: move the memory of tasks to their node */
 };
 
 
@@ -169,6 +174,7 @@ enum
 	VM_VFS_CACHE_PRESSURE=26, /* dcache/icache reclaim pressure */
 	VM_LEGACY_VA_LAYOUT=27, /* legacy/compatibility virtual address space layout */
 	VM_SWAP_TOKEN_TIMEOUT=28, /* default time for token time out */
+	VM_COMPACT_MEMORY=29,	/* int: compact all zones when written */
 };
 
 
@@ -670,6 +676,7 @@ enum
 	FS_XFS=17,	/* struct: control xfs parameters */
 	FS_AIO_NR=18,	/* current system-wide number of aio requests */
 	FS_AIO_MAX_NR=19,	/* system-wide maximum number of aio requests */
+	FS_PIPE_MAX_SIZE=20,	/* int: maximum unprivileged pipe ring size */
 };
 
 /* /proc/sys/fs/quota/ */
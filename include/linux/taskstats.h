@@ -0,0 +1,52 @@
+#ifndef _LINUX_TASKSTATS_H
+#define _LINUX_TASKSTATS_H
+
+#include <linux/types.h>
+
+/*
+ * Per-task statistics over NETLINK_TASKSTATS.
+ *
+ * Send a TASKSTATS_GET request with a struct taskstats_req for one task
+ * or one thread group; the answer is a TASKSTATS_NEW message carrying a
+ * struct taskstats.  With NLM_F_DUMP set the request gets one
+ * TASKSTATS_NEW message per task in the system, the taskstats_req is
+ * ignored.  All times are in nanoseconds.
+ */
+
+#define TASKSTATS_VERSION	1
+
+/* message types */
+#define TASKSTATS_GET		16
+#define TASKSTATS_NEW		17
+
+/* taskstats_req.type */
+#define TASKSTATS_TYPE_PID	1	/* a single task */
+#define TASKSTATS_TYPE_TGID	2	/* sum over a thread group */
+
+struct taskstats_req {
+	__u32	type;
+	__u32	pid;
+};
+
+struct taskstats {
+	__u32	version;
+	__u32	pid;
+	__u32	tgid;
+	__u32	nr_threads;		/* tasks summed up in here */
+
+	/* waiting on a runqueue, and how often the tasks got a cpu */
+	__u64	cpu_count;
+	__u64	cpu_delay_total;
+	/* time spent on a cpu */
+	__u64	cpu_run_total;
+
+	/* waiting for block I/O other than swap-in */
+	__u64	blkio_count;
+	__u64	blkio_delay_total;
+
+	/* waiting for pages to be read back from swap */
+	__u64	swapin_count;
+	__u64	swapin_delay_total;
+};
+
+#endif /* _LINUX_TASKSTATS_H */
@@ -19,10 +19,21 @@ struct timer_list {
 	unsigned long data;
 
 	struct tvec_t_base_s *base;
+	unsigned int flags;
 };
 
 #define TIMER_MAGIC	0x4b87ad6e
 
+/*
+ * Timer flags:
+ *
+ * TIMER_DEFERRABLE: a housekeeping timer which does not mind running
+ * late.  Its expiry is rounded up (by at most 1/64 of the timeout) so
+ * that such timers expire together, and it does not wake up an idle
+ * cpu whose tick is stopped: it runs at the next tick the cpu takes.
+ */
+#define TIMER_DEFERRABLE	0x1
+
 #define TIMER_INITIALIZER(_function, _expires, _data) {		\
 		.function = (_function),			\
 		.expires = (_expires),				\
@@ -32,6 +43,16 @@ struct timer_list {
 		.lock = SPIN_LOCK_UNLOCKED,			\
 	}
 
+#define TIMER_DEFERRED_INITIALIZER(_function, _expires, _data) {	\
+		.function = (_function),			\
+		.expires = (_expires),				\
+		.data = (_data),				\
+		.base = NULL,					\
+		.magic = TIMER_MAGIC,				\
+		.lock = SPIN_LOCK_UNLOCKED,			\
+		.flags = TIMER_DEFERRABLE,			\
+	}
+
 /***
  * init_timer - initialize a timer.
  * @timer: the timer to be initialized
@@ -43,9 +64,23 @@ static inline void init_timer(struct timer_list * timer)
 {
 	timer->base = NULL;
 	timer->magic = TIMER_MAGIC;
+	timer->flags = 0;
 	spin_lock_init(&timer->lock);
 }
 
+/***
+ * init_timer_deferrable - initialize a deferrable timer.
+ * @timer: the timer to be initialized
+ *
+ * Like init_timer(), for a timer which may expire late (see
+ * TIMER_DEFERRABLE).
+ */
+static inline void init_timer_deferrable(struct timer_list * timer)
+{
+	init_timer(timer);
+	timer->flags = TIMER_DEFERRABLE;
+}
+
 /***
  * timer_pending - is a timer pending?
  * @timer: the timer in question
@@ -97,6 +132,5 @@ static inline void add_timer(struct timer_list * timer)
 
 extern void init_timers(void);
 extern void run_local_timers(void);
-extern void it_real_fn(unsigned long);
 
 #endif
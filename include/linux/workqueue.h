@@ -50,6 +50,16 @@ struct work_struct {
 		init_timer(&(_work)->timer);			\
 	} while (0)
 
+/*
+ * initialize a work-struct for housekeeping work, whose delay may be
+ * stretched (see TIMER_DEFERRABLE):
+ */
+#define INIT_WORK_DEFERRABLE(_work, _func, _data)		\
+	do {							\
+		INIT_WORK((_work), (_func), (_data));		\
+		init_timer_deferrable(&(_work)->timer);		\
+	} while (0)
+
 extern struct workqueue_struct *__create_workqueue(const char *name,
 						    int singlethread);
 #define create_workqueue(name) __create_workqueue((name), 0)
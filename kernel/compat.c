@@ -18,6 +18,7 @@
 #include <linux/signal.h>
 #include <linux/sched.h>	/* for MAX_SCHEDULE_TIMEOUT */
 #include <linux/futex.h>	/* for FUTEX_WAIT */
+#include <linux/hrtimer.h>
 #include <linux/syscalls.h>
 #include <linux/unistd.h>
 #include <linux/security.h>
@@ -40,39 +41,26 @@ int put_compat_timespec(const struct timespec *ts, struct compat_timespec __user
 
 static long compat_nanosleep_restart(struct restart_block *restart)
 {
-	unsigned long expire = restart->arg0, now = jiffies;
 	struct compat_timespec __user *rmtp;
-
-	/* Did it expire while we handled signals? */
-	if (!time_after(expire, now))
-		return 0;
-
-	current->state = TASK_INTERRUPTIBLE;
-	expire = schedule_timeout(expire - now);
-	if (expire == 0)
-		return 0;
+	struct timespec rmt;
+	long ret;
 
 	rmtp = (struct compat_timespec __user *)restart->arg1;
-	if (rmtp) {
-		struct compat_timespec ct;
-		struct timespec t;
-
-		jiffies_to_timespec(expire, &t);
-		ct.tv_sec = t.tv_sec;
-		ct.tv_nsec = t.tv_nsec;
-		if (copy_to_user(rmtp, &ct, sizeof(ct)))
-			return -EFAULT;
-	}
+	ret = hrtimer_resume_nanosleep(restart, rmtp ? &rmt : NULL);
+	if (ret == -ERESTART_RESTARTBLOCK && rmtp &&
+	    put_compat_timespec(&rmt, rmtp))
+		return -EFAULT;
+
 	/* The 'restart' block is already filled in */
-	return -ERESTART_RESTARTBLOCK;
+	return ret;
 }
 
 asmlinkage long compat_sys_nanosleep(struct compat_timespec __user *rqtp,
 		struct compat_timespec __user *rmtp)
 {
-	struct timespec t;
+	struct timespec t, rmt;
 	struct restart_block *restart;
-	unsigned long expire;
+	long ret;
 
 	if (get_compat_timespec(&t, rqtp))
 		return -EFAULT;
@@ -80,22 +68,18 @@ asmlinkage long compat_sys_nanosleep(struct compat_timespec __user *rqtp,
 	if ((t.tv_nsec >= 1000000000L) || (t.tv_nsec < 0) || (t.tv_sec < 0))
 		return -EINVAL;
 
-	expire = timespec_to_jiffies(&t) + (t.tv_sec || t.tv_nsec);
-	current->state = TASK_INTERRUPTIBLE;
-	expire = schedule_timeout(expire);
-	if (expire == 0)
-		return 0;
+	ret = hrtimer_nanosleep(&t, rmtp ? &rmt : NULL, HRTIMER_REL,
+				CLOCK_MONOTONIC);
+	if (ret != -ERESTART_RESTARTBLOCK)
+		return ret;
+
+	if (rmtp && put_compat_timespec(&rmt, rmtp))
+		return -EFAULT;
 
-	if (rmtp) {
-		jiffies_to_timespec(expire, &t);
-		if (put_compat_timespec(&t, rmtp))
-			return -EFAULT;
-	}
 	restart = &current_thread_info()->restart_block;
 	restart->fn = compat_nanosleep_restart;
-	restart->arg0 = jiffies + expire;
 	restart->arg1 = (unsigned long) rmtp;
-	return -ERESTART_RESTARTBLOCK;
+	return ret;
 }
 
 static inline long get_compat_itimerval(struct itimerval *o,
@@ -247,14 +231,16 @@ asmlinkage long compat_sys_futex(u32 __user *uaddr, int op, int val,
 {
 	struct timespec t;
 	unsigned long timeout = MAX_SCHEDULE_TIMEOUT;
+	int cmd = op & FUTEX_CMD_MASK;
 	int val2 = 0;
 
-	if ((op == FUTEX_WAIT) && utime) {
+	if ((cmd == FUTEX_WAIT || cmd == FUTEX_LOCK_PI) && utime) {
 		if (get_compat_timespec(&t, utime))
 			return -EFAULT;
 		timeout = timespec_to_jiffies(&t) + 1;
 	}
-	if (op >= FUTEX_REQUEUE)
+	if (cmd == FUTEX_REQUEUE || cmd == FUTEX_CMP_REQUEUE ||
+	    cmd == FUTEX_WAKE_OP)
 		val2 = (int) (unsigned long) utime;
 
 	return do_futex((unsigned long)uaddr, op, val, timeout,
@@ -0,0 +1,31 @@
+/*
+ *  kernel/delayacct.c
+ *
+ *  Per-task delay accounting: io_schedule() and io_schedule_timeout()
+ *  time every wait of the current task for I/O and add it to its block
+ *  I/O or, while it is faulting in a page from swap, its swap-in delay.
+ *  Read out through kernel/taskstats.c.
+ */
+
+#include <linux/sched.h>
+#include <linux/delayacct.h>
+
+void __delayacct_blkio_end(void)
+{
+	struct task_delay_info *delays = &current->delays;
+	unsigned long long delta = sched_clock() - delays->blkio_start;
+
+	/* sched_clock() is per cpu, and we may have woken up on another one */
+	if ((long long)delta < 0)
+		delta = 0;
+
+	spin_lock(&delays->lock);
+	if (delays->flags & DELAYACCT_PF_SWAPIN) {
+		delays->swapin_delay += delta;
+		delays->swapin_count++;
+	} else {
+		delays->blkio_delay += delta;
+		delays->blkio_count++;
+	}
+	spin_unlock(&delays->lock);
+}
@@ -8,6 +8,9 @@
  *  Removed page pinning, fix privately mapped COW pages and other cleanups
  *  (C) Copyright 2003, 2004 Jamie Lokier
  *
+ *  PI futexes boost the owner to the priority of its best waiter,
+ *  see futex_lock_pi() and futex_unlock_pi().
+ *
  *  Thanks to Ben LaHaise for yelling "hashed waitqueues" loudly
  *  enough at me, Linus for the original (flawed) idea, Matthew
  *  Kirkwood for proof-of-concept implementation.
@@ -39,8 +42,8 @@
 #include <linux/mount.h>
 #include <linux/pagemap.h>
 #include <linux/syscalls.h>
-
-#define FUTEX_HASHBITS 8
+#include <linux/bootmem.h>
+#include <asm/futex.h>
 
 /*
  * Futexes are matched on equal values of this key.
@@ -48,8 +51,13 @@
  * Don't rearrange members without looking at hash_futex().
  *
  * offset is aligned to a multiple of sizeof(u32) (== 4) by definition.
- * We set bit 0 to indicate if it's an inode-based key.
+ * We set bit 0 to indicate if it's an inode-based key, and bit 1 if
+ * it's an mm-based key which holds a reference to the mm.  Keys of
+ * FUTEX_PRIVATE_FLAG futexes have neither bit set and hold no reference.
  */
+#define FUT_OFF_INODE    1
+#define FUT_OFF_MMSHARED 2
+
 union futex_key {
 	struct {
 		unsigned long pgoff;
@@ -68,6 +76,31 @@ union futex_key {
 	} both;
 };
 
+/*
+ * Priority inheritance state of a PI futex.  It exists while tasks are
+ * blocked on the futex, and is found through their futex_q's in the
+ * hash bucket.  While it has an owner it sits on the owner's
+ * pi_state_list, so the owner can run at the priority of the best
+ * waiter of all the futexes it holds.
+ *
+ * The lists and the owner are protected by futex_pi_lock, which nests
+ * inside the hash bucket lock and outside the runqueue locks.  PI slow
+ * paths only run when a futex is contended.
+ */
+struct futex_pi_state {
+	struct list_head list;		/* on owner->pi_state_list */
+	struct list_head waiters;	/* futex_q's blocked on the futex */
+	struct task_struct *owner;	/* NULL once the owner exited */
+};
+
+static DEFINE_SPINLOCK(futex_pi_lock);
+
+/* Limit on the length of a chain of boosted owners */
+#define FUTEX_PI_MAX_DEPTH	16
+
+/* Set if the architecture can do futex_atomic_cmpxchg_inatomic() */
+static int futex_cmpxchg_enabled;
+
 /*
  * We use this hashed waitqueue instead of a normal wait_queue_t, so
  * we can wake only the relevant ones (hashed queues may be shared).
@@ -90,6 +123,11 @@ struct futex_q {
 	/* For fd, sigio sent using these. */
 	int fd;
 	struct file *filp;
+
+	/* For PI futexes: the waiting task and what it is waiting for. */
+	struct task_struct *task;
+	struct futex_pi_state *pi_state;
+	struct list_head pi_list;
 };
 
 /*
@@ -99,9 +137,11 @@ struct futex_hash_bucket {
        spinlock_t              lock;
        unsigned int	    nqueued;
        struct list_head       chain;
-};
+} ____cacheline_aligned_in_smp;
 
-static struct futex_hash_bucket futex_queues[1<<FUTEX_HASHBITS];
+/* Sized at boot by the number of cpus, see init() */
+static struct futex_hash_bucket *futex_queues;
+static unsigned int futex_hash_mask;
 
 /* Futex-fs vfsmount entry: */
 static struct vfsmount *futex_mnt;
@@ -114,7 +154,7 @@ static struct futex_hash_bucket *hash_futex(union futex_key *key)
 	u32 hash = jhash2((u32*)&key->both.word,
 			  (sizeof(key->both.word)+sizeof(key->both.ptr))/4,
 			  key->both.offset);
-	return &futex_queues[hash & ((1 << FUTEX_HASHBITS)-1)];
+	return &futex_queues[hash & futex_hash_mask];
 }
 
 /*
@@ -127,6 +167,22 @@ static inline int match_futex(union futex_key *key1, union futex_key *key2)
 		&& key1->both.offset == key2->both.offset);
 }
 
+/*
+ * fshared is NULL for FUTEX_PRIVATE_FLAG futexes, and points to
+ * current->mm->mmap_sem otherwise.  Private futexes never need it.
+ */
+static inline void futex_lock_mm(struct rw_semaphore *fshared)
+{
+	if (fshared)
+		down_read(fshared);
+}
+
+static inline void futex_unlock_mm(struct rw_semaphore *fshared)
+{
+	if (fshared)
+		up_read(fshared);
+}
+
 /*
  * Get parameters which are the keys for a futex.
  *
@@ -134,12 +190,16 @@ static inline int match_futex(union futex_key *key1, union futex_key *key2)
  * offset_within_page).  For private mappings, it's (uaddr, current->mm).
  * We can usually work out the index without swapping in the page.
  *
+ * For process-private futexes (fshared == NULL) it's (uaddr, current->mm)
+ * without looking at the vma at all.
+ *
  * Returns: 0, or negative error code.
  * The key words are stored in *key on success.
  *
- * Should be called with &current->mm->mmap_sem but NOT any spinlocks.
+ * Should be called with fshared held but NOT any spinlocks.
  */
-static int get_futex_key(unsigned long uaddr, union futex_key *key)
+static int get_futex_key(unsigned long uaddr, struct rw_semaphore *fshared,
+			 union futex_key *key)
 {
 	struct mm_struct *mm = current->mm;
 	struct vm_area_struct *vma;
@@ -152,6 +212,20 @@ static int get_futex_key(unsigned long uaddr, union futex_key *key)
 	key->both.offset = uaddr % PAGE_SIZE;
 	if (unlikely((key->both.offset % sizeof(u32)) != 0))
 		return -EINVAL;
+
+	/*
+	 * Private futexes can only be seen by the threads of this mm, which
+	 * keep the mm alive: no vma lookup, no reference.  An invalid address
+	 * is caught when the futex word is read.
+	 */
+	if (!fshared) {
+		if (unlikely(!access_ok(VERIFY_WRITE, (void __user *)uaddr,
+					sizeof(u32))))
+			return -EFAULT;
+		key->private.mm = mm;
+		key->private.uaddr = uaddr - key->both.offset;
+		return 0;
+	}
 	uaddr -= key->both.offset;
 
 	/*
@@ -178,6 +252,7 @@ static int get_futex_key(unsigned long uaddr, union futex_key *key)
 	 * mappings of _writable_ handles.
 	 */
 	if (likely(!(vma->vm_flags & VM_MAYSHARE))) {
+		key->both.offset |= FUT_OFF_MMSHARED;
 		key->private.mm = mm;
 		key->private.uaddr = uaddr;
 		return 0;
@@ -187,7 +262,7 @@ static int get_futex_key(unsigned long uaddr, union futex_key *key)
 	 * Linear file mappings are also simple.
 	 */
 	key->shared.inode = vma->vm_file->f_dentry->d_inode;
-	key->both.offset++; /* Bit 0 of offset indicates inode-based key. */
+	key->both.offset |= FUT_OFF_INODE;
 	if (likely(!(vma->vm_flags & VM_NONLINEAR))) {
 		key->shared.pgoff = (((uaddr - vma->vm_start) >> PAGE_SHIFT)
 				     + vma->vm_pgoff);
@@ -236,11 +311,15 @@ static int get_futex_key(unsigned long uaddr, union futex_key *key)
  */
 static inline void get_key_refs(union futex_key *key)
 {
-	if (key->both.ptr != 0) {
-		if (key->both.offset & 1)
-			atomic_inc(&key->shared.inode->i_count);
-		else
-			atomic_inc(&key->private.mm->mm_count);
+	if (key->both.ptr == 0)
+		return;
+	switch (key->both.offset & (FUT_OFF_INODE|FUT_OFF_MMSHARED)) {
+	case FUT_OFF_INODE:
+		atomic_inc(&key->shared.inode->i_count);
+		break;
+	case FUT_OFF_MMSHARED:
+		atomic_inc(&key->private.mm->mm_count);
+		break;
 	}
 }
 
@@ -250,11 +329,15 @@ static inline void get_key_refs(union futex_key *key)
  */
 static void drop_key_refs(union futex_key *key)
 {
-	if (key->both.ptr != 0) {
-		if (key->both.offset & 1)
-			iput(key->shared.inode);
-		else
-			mmdrop(key->private.mm);
+	if (key->both.ptr == 0)
+		return;
+	switch (key->both.offset & (FUT_OFF_INODE|FUT_OFF_MMSHARED)) {
+	case FUT_OFF_INODE:
+		iput(key->shared.inode);
+		break;
+	case FUT_OFF_MMSHARED:
+		mmdrop(key->private.mm);
+		break;
 	}
 }
 
@@ -270,6 +353,19 @@ static inline int get_futex_value_locked(int *dest, int __user *from)
 	return ret ? -EFAULT : 0;
 }
 
+static inline int cmpxchg_futex_value_locked(int __user *uaddr, int uval,
+					     int newval)
+{
+	int curval;
+
+	inc_preempt_count();
+	curval = futex_atomic_cmpxchg_inatomic(uaddr, uval, newval);
+	dec_preempt_count();
+	preempt_check_resched();
+
+	return curval;
+}
+
 /*
  * The hash bucket lock must be held when this is called.
  * Afterwards, the futex_q must not be accessed.
@@ -295,7 +391,8 @@ static void wake_futex(struct futex_q *q)
  * Wake up all waiters hashed on the physical page that is mapped
  * to this virtual address:
  */
-static int futex_wake(unsigned long uaddr, int nr_wake)
+static int futex_wake(unsigned long uaddr, struct rw_semaphore *fshared,
+		      int nr_wake)
 {
 	union futex_key key;
 	struct futex_hash_bucket *bh;
@@ -303,9 +400,9 @@ static int futex_wake(unsigned long uaddr, int nr_wake)
 	struct futex_q *this, *next;
 	int ret;
 
-	down_read(&current->mm->mmap_sem);
+	futex_lock_mm(fshared);
 
-	ret = get_futex_key(uaddr, &key);
+	ret = get_futex_key(uaddr, fshared, &key);
 	if (unlikely(ret != 0))
 		goto out;
 
@@ -315,6 +412,10 @@ static int futex_wake(unsigned long uaddr, int nr_wake)
 
 	list_for_each_entry_safe(this, next, head, list) {
 		if (match_futex (&this->key, &key)) {
+			if (this->pi_state) {
+				ret = -EINVAL;
+				break;
+			}
 			wake_futex(this);
 			if (++ret >= nr_wake)
 				break;
@@ -323,7 +424,170 @@ static int futex_wake(unsigned long uaddr, int nr_wake)
 
 	spin_unlock(&bh->lock);
 out:
-	up_read(&current->mm->mmap_sem);
+	futex_unlock_mm(fshared);
+	return ret;
+}
+
+/*
+ * The user word of a FUTEX_WAKE_OP could not be modified atomically
+ * because it is not mapped writable.  Fault it in for writing, which
+ * get_user() alone cannot do.  Private futexes don't hold mmap_sem yet.
+ */
+static int futex_handle_fault(unsigned long address,
+			      struct rw_semaphore *fshared, int attempt)
+{
+	struct vm_area_struct * vma;
+	struct mm_struct *mm = current->mm;
+	int ret = -EFAULT;
+
+	if (attempt > 2)
+		return ret;
+
+	if (!fshared)
+		down_read(&mm->mmap_sem);
+
+	vma = find_vma(mm, address);
+	if (vma && address >= vma->vm_start && (vma->vm_flags & VM_WRITE)) {
+		switch (handle_mm_fault(mm, vma, address, 1)) {
+		case VM_FAULT_MINOR:
+			ret = 0;
+			current->min_flt++;
+			break;
+		case VM_FAULT_MAJOR:
+			ret = 0;
+			current->maj_flt++;
+			break;
+		}
+	}
+
+	if (!fshared)
+		up_read(&mm->mmap_sem);
+	return ret;
+}
+
+/*
+ * Wake up waiters on uaddr1, atomically modify *uaddr2 as encoded in op,
+ * and depending on its old value also wake up waiters on uaddr2.
+ * Both hash buckets are held for the whole operation, so a waiter can't
+ * slip in between the modification and the wakeups.
+ */
+static int futex_wake_op(unsigned long uaddr1, struct rw_semaphore *fshared,
+			 unsigned long uaddr2, int nr_wake, int nr_wake2,
+			 int op)
+{
+	union futex_key key1, key2;
+	struct futex_hash_bucket *bh1, *bh2;
+	struct list_head *head;
+	struct futex_q *this, *next;
+	int ret, op_ret, attempt = 0;
+
+ retryfull:
+	futex_lock_mm(fshared);
+
+	ret = get_futex_key(uaddr1, fshared, &key1);
+	if (unlikely(ret != 0))
+		goto out;
+	ret = get_futex_key(uaddr2, fshared, &key2);
+	if (unlikely(ret != 0))
+		goto out;
+
+	bh1 = hash_futex(&key1);
+	bh2 = hash_futex(&key2);
+
+ retry:
+	if (bh1 < bh2)
+		spin_lock(&bh1->lock);
+	spin_lock(&bh2->lock);
+	if (bh1 > bh2)
+		spin_lock(&bh1->lock);
+
+	op_ret = futex_atomic_op_inuser(op, (int __user *)uaddr2);
+	if (unlikely(op_ret < 0)) {
+		int dummy;
+
+		spin_unlock(&bh1->lock);
+		if (bh1 != bh2)
+			spin_unlock(&bh2->lock);
+
+#ifndef CONFIG_MMU
+		/*
+		 * we don't get EFAULT from MMU faults if we don't have an MMU,
+		 * but we might get them from range checking
+		 */
+		ret = op_ret;
+		goto out;
+#endif
+
+		if (unlikely(op_ret != -EFAULT)) {
+			ret = op_ret;
+			goto out;
+		}
+
+		/*
+		 * futex_atomic_op_inuser needs to both read and write
+		 * *(int __user *)uaddr2, but we can't modify it
+		 * non-atomically.  Therefore, if get_user below is not
+		 * enough, we need to handle the fault ourselves, while
+		 * still holding the mmap_sem.
+		 */
+		if (attempt++) {
+			ret = futex_handle_fault(uaddr2, fshared, attempt);
+			if (ret)
+				goto out;
+			goto retry;
+		}
+
+		/*
+		 * If we would have faulted, release mmap_sem,
+		 * fault it in and start all over again.
+		 */
+		futex_unlock_mm(fshared);
+
+		ret = get_user(dummy, (int __user *)uaddr2);
+		if (ret)
+			return ret;
+
+		goto retryfull;
+	}
+
+	head = &bh1->chain;
+
+	list_for_each_entry_safe(this, next, head, list) {
+		if (match_futex (&this->key, &key1)) {
+			if (this->pi_state) {
+				ret = -EINVAL;
+				goto out_unlock;
+			}
+			wake_futex(this);
+			if (++ret >= nr_wake)
+				break;
+		}
+	}
+
+	if (op_ret > 0) {
+		head = &bh2->chain;
+
+		op_ret = 0;
+		list_for_each_entry_safe(this, next, head, list) {
+			if (match_futex (&this->key, &key2)) {
+				if (this->pi_state) {
+					ret = -EINVAL;
+					goto out_unlock;
+				}
+				wake_futex(this);
+				if (++op_ret >= nr_wake2)
+					break;
+			}
+		}
+		ret += op_ret;
+	}
+
+out_unlock:
+	spin_unlock(&bh1->lock);
+	if (bh1 != bh2)
+		spin_unlock(&bh2->lock);
+out:
+	futex_unlock_mm(fshared);
 	return ret;
 }
 
@@ -331,8 +595,9 @@ out:
  * Requeue all waiters hashed on one physical page to another
  * physical page.
  */
-static int futex_requeue(unsigned long uaddr1, unsigned long uaddr2,
-			 int nr_wake, int nr_requeue, int *valp)
+static int futex_requeue(unsigned long uaddr1, struct rw_semaphore *fshared,
+			 unsigned long uaddr2, int nr_wake, int nr_requeue,
+			 int *valp)
 {
 	union futex_key key1, key2;
 	struct futex_hash_bucket *bh1, *bh2;
@@ -342,12 +607,12 @@ static int futex_requeue(unsigned long uaddr1, unsigned long uaddr2,
 	unsigned int nqueued;
 
  retry:
-	down_read(&current->mm->mmap_sem);
+	futex_lock_mm(fshared);
 
-	ret = get_futex_key(uaddr1, &key1);
+	ret = get_futex_key(uaddr1, fshared, &key1);
 	if (unlikely(ret != 0))
 		goto out;
-	ret = get_futex_key(uaddr2, &key2);
+	ret = get_futex_key(uaddr2, fshared, &key2);
 	if (unlikely(ret != 0))
 		goto out;
 
@@ -374,7 +639,7 @@ static int futex_requeue(unsigned long uaddr1, unsigned long uaddr2,
 			/* If we would have faulted, release mmap_sem, fault
 			 * it in and start all over again.
 			 */
-			up_read(&current->mm->mmap_sem);
+			futex_unlock_mm(fshared);
 
 			ret = get_user(curval, (int __user *)uaddr1);
 
@@ -404,6 +669,10 @@ static int futex_requeue(unsigned long uaddr1, unsigned long uaddr2,
 	list_for_each_entry_safe(this, next, head1, list) {
 		if (!match_futex (&this->key, &key1))
 			continue;
+		if (this->pi_state) {
+			ret = -EINVAL;
+			break;
+		}
 		if (++ret <= nr_wake) {
 			wake_futex(this);
 		} else {
@@ -431,7 +700,7 @@ out_unlock:
 		drop_key_refs(&key1);
 
 out:
-	up_read(&current->mm->mmap_sem);
+	futex_unlock_mm(fshared);
 	return ret;
 }
 
@@ -440,6 +709,18 @@ out:
  * exactly once.  They are called with the hashed spinlock held.
  */
 
+/* The key must be already stored in q->key, and bh->lock held. */
+static void __queue_me(struct futex_q *q, struct futex_hash_bucket *bh)
+{
+	init_waitqueue_head(&q->waiters);
+
+	get_key_refs(&q->key);
+	q->lock_ptr = &bh->lock;
+
+	bh->nqueued++;
+	list_add_tail(&q->list, &bh->chain);
+}
+
 /* The key must be already stored in q->key. */
 static void queue_me(struct futex_q *q, int fd, struct file *filp)
 {
@@ -447,16 +728,12 @@ static void queue_me(struct futex_q *q, int fd, struct file *filp)
 
 	q->fd = fd;
 	q->filp = filp;
+	q->task = current;
+	q->pi_state = NULL;
 
-	init_waitqueue_head(&q->waiters);
-
-	get_key_refs(&q->key);
 	bh = hash_futex(&q->key);
-	q->lock_ptr = &bh->lock;
-
 	spin_lock(&bh->lock);
-	bh->nqueued++;
-	list_add_tail(&q->list, &bh->chain);
+	__queue_me(q, bh);
 	spin_unlock(&bh->lock);
 }
 
@@ -498,16 +775,17 @@ static int unqueue_me(struct futex_q *q)
 	return ret;
 }
 
-static int futex_wait(unsigned long uaddr, int val, unsigned long time)
+static int futex_wait(unsigned long uaddr, struct rw_semaphore *fshared,
+		      int val, unsigned long time)
 {
 	DECLARE_WAITQUEUE(wait, current);
 	int ret, curval;
 	struct futex_q q;
 
  retry:
-	down_read(&current->mm->mmap_sem);
+	futex_lock_mm(fshared);
 
-	ret = get_futex_key(uaddr, &q.key);
+	ret = get_futex_key(uaddr, fshared, &q.key);
 	if (unlikely(ret != 0))
 		goto out_release_sem;
 
@@ -530,8 +808,9 @@ static int futex_wait(unsigned long uaddr, int val, unsigned long time)
 	 * a wakeup when *uaddr != val on entry to the syscall.  This is
 	 * rare, but normal.
 	 *
-	 * We hold the mmap semaphore, so the mapping cannot have changed
-	 * since we looked it up in get_futex_key.
+	 * For shared futexes we hold the mmap semaphore, so the mapping
+	 * cannot have changed since we looked it up in get_futex_key.
+	 * Private futexes don't depend on the mapping.
 	 */
 
 	ret = get_futex_value_locked(&curval, (int __user *)uaddr);
@@ -540,7 +819,7 @@ static int futex_wait(unsigned long uaddr, int val, unsigned long time)
 		/* If we would have faulted, release mmap_sem, fault it in and
 		 * start all over again.
 		 */
-		up_read(&current->mm->mmap_sem);
+		futex_unlock_mm(fshared);
 
 		if (!unqueue_me(&q)) /* There's a chance we got woken already */
 			return 0;
@@ -560,7 +839,7 @@ static int futex_wait(unsigned long uaddr, int val, unsigned long time)
 	 * Now the futex is queued and we have checked the data, we
 	 * don't want to hold mmap_sem while we sleep.
 	 */	
-	up_read(&current->mm->mmap_sem);
+	futex_unlock_mm(fshared);
 
 	/*
 	 * There might have been scheduling since the queue_me(), as we
@@ -601,10 +880,420 @@ static int futex_wait(unsigned long uaddr, int val, unsigned long time)
 	if (!unqueue_me(&q))
 		ret = 0;
  out_release_sem:
-	up_read(&current->mm->mmap_sem);
+	futex_unlock_mm(fshared);
+	return ret;
+}
+
+/*
+ * Find the PI state of the futex with this key, if any task is blocked
+ * on it.  Called with bh->lock held.
+ */
+static struct futex_pi_state *lookup_pi_state(struct futex_hash_bucket *bh,
+					      union futex_key *key)
+{
+	struct futex_q *this;
+
+	list_for_each_entry(this, &bh->chain, list) {
+		if (this->pi_state && match_futex(&this->key, key))
+			return this->pi_state;
+	}
+	return NULL;
+}
+
+/*
+ * Recompute the priority boost of a PI futex owner from the waiters of
+ * all the futexes it holds, and pass the change on to the owner of the
+ * futex it is blocked on in turn.  Called with futex_pi_lock held.
+ */
+static void futex_pi_adjust_prio(struct task_struct *task)
+{
+	struct futex_pi_state *pi_state;
+	struct futex_q *this;
+	int depth, prio;
+
+	for (depth = 0; task && depth < FUTEX_PI_MAX_DEPTH; depth++) {
+		prio = MAX_PRIO;
+		list_for_each_entry(pi_state, &task->pi_state_list, list) {
+			list_for_each_entry(this, &pi_state->waiters, pi_list) {
+				if (this->task != task && this->task->prio < prio)
+					prio = this->task->prio;
+			}
+		}
+		if (prio == task->pi_prio)
+			break;
+		sched_pi_setprio(task, prio);
+
+		pi_state = task->pi_blocked_on;
+		task = pi_state ? pi_state->owner : NULL;
+	}
+}
+
+/*
+ * Make task the owner of the PI state.  Called with futex_pi_lock held.
+ */
+static void pi_state_set_owner(struct futex_pi_state *pi_state,
+			       struct task_struct *task)
+{
+	struct task_struct *old = pi_state->owner;
+
+	list_del_init(&pi_state->list);
+	list_add(&pi_state->list, &task->pi_state_list);
+	pi_state->owner = task;
+	if (old)
+		futex_pi_adjust_prio(old);
+	futex_pi_adjust_prio(task);
+}
+
+/*
+ * Take a PI waiter off the hash chain and the PI state, and free the
+ * state if it was the last waiter.  Returns 1 if the futex had been
+ * handed over to us.
+ */
+static int unqueue_me_pi(struct futex_q *q)
+{
+	struct futex_pi_state *pi_state = q->pi_state;
+	struct task_struct *owner;
+	int ret;
+
+	/* PI waiters are never requeued, so lock_ptr is stable */
+	spin_lock(q->lock_ptr);
+	list_del(&q->list);
+
+	spin_lock(&futex_pi_lock);
+	list_del(&q->pi_list);
+	current->pi_blocked_on = NULL;
+	owner = pi_state->owner;
+	ret = (owner == current);
+	if (list_empty(&pi_state->waiters)) {
+		list_del(&pi_state->list);
+		kfree(pi_state);
+	}
+	if (owner)
+		futex_pi_adjust_prio(owner);
+	spin_unlock(&futex_pi_lock);
+
+	spin_unlock(q->lock_ptr);
+
+	drop_key_refs(&q->key);
 	return ret;
 }
 
+/*
+ * Find the task whose TID is in a PI futex word and take a reference to
+ * it.  Only tasks of the same user may be boosted through a futex, as
+ * for signals.  Returns NULL if there is no such task.
+ */
+static struct task_struct *futex_find_get_task(pid_t pid)
+{
+	struct task_struct *p;
+
+	read_lock(&tasklist_lock);
+	p = find_task_by_pid(pid);
+	if (p) {
+		if (current->euid != p->euid && current->euid != p->uid)
+			p = ERR_PTR(-EPERM);
+		else
+			get_task_struct(p);
+	}
+	read_unlock(&tasklist_lock);
+	return p;
+}
+
+/*
+ * Lock a PI futex whose user space fast path failed.  If the owner is
+ * alive, set FUTEX_WAITERS, block, and boost the owner until it hands
+ * the futex over to us in futex_unlock_pi().  If the owner exited, take
+ * the futex over and tell user space with FUTEX_OWNER_DIED.
+ */
+static int futex_lock_pi(unsigned long uaddr, struct rw_semaphore *fshared,
+			 unsigned long time, int trylock)
+{
+	struct futex_pi_state *pi_state, *new_state = NULL;
+	struct task_struct *owner;
+	struct futex_hash_bucket *bh;
+	struct futex_q q;
+	int uval, newval, curval, pid, ret, attempt = 0;
+
+	q.task = current;
+	q.fd = -1;
+	q.filp = NULL;
+
+ retry:
+	/* The state can't be allocated with the bucket lock held */
+	if (!trylock && !new_state) {
+		new_state = kmalloc(sizeof(*new_state), GFP_KERNEL);
+		if (!new_state)
+			return -ENOMEM;
+	}
+	owner = NULL;
+	futex_lock_mm(fshared);
+
+	ret = get_futex_key(uaddr, fshared, &q.key);
+	if (unlikely(ret != 0))
+		goto out_release_sem;
+
+	bh = hash_futex(&q.key);
+	spin_lock(&bh->lock);
+
+ retry_locked:
+	if (owner) {
+		put_task_struct(owner);
+		owner = NULL;
+	}
+	ret = get_futex_value_locked(&uval, (int __user *)uaddr);
+	if (unlikely(ret))
+		goto uaddr_faulted;
+
+	pid = uval & FUTEX_TID_MASK;
+	if (unlikely(pid == current->pid)) {
+		ret = -EDEADLK;
+		goto out_unlock;
+	}
+
+	pi_state = lookup_pi_state(bh, &q.key);
+	if (pid) {
+		if (pi_state) {
+			/* exit_pi_state_list() clears the owner */
+			spin_lock(&futex_pi_lock);
+			owner = pi_state->owner;
+			if (owner)
+				get_task_struct(owner);
+			spin_unlock(&futex_pi_lock);
+		} else {
+			owner = futex_find_get_task(pid);
+			if (IS_ERR(owner)) {
+				ret = PTR_ERR(owner);
+				owner = NULL;
+				goto out_unlock;
+			}
+		}
+		if (owner && (owner->flags & PF_EXITING)) {
+			put_task_struct(owner);
+			owner = NULL;
+		}
+	}
+
+	/*
+	 * The futex is free, or its owner is gone: take it.
+	 */
+	if (!owner) {
+		newval = current->pid | (uval & FUTEX_WAITERS);
+		if (pid)
+			newval |= FUTEX_OWNER_DIED;
+		curval = cmpxchg_futex_value_locked((int __user *)uaddr,
+						    uval, newval);
+		if (unlikely(curval == -EFAULT))
+			goto uaddr_faulted;
+		if (curval != uval)
+			goto retry_locked;
+		if (pi_state) {
+			spin_lock(&futex_pi_lock);
+			pi_state_set_owner(pi_state, current);
+			spin_unlock(&futex_pi_lock);
+		}
+		ret = 0;
+		goto out_unlock;
+	}
+
+	if (trylock) {
+		ret = -EWOULDBLOCK;
+		goto out_unlock;
+	}
+
+	/*
+	 * Make the owner's unlock come to the kernel.
+	 */
+	if (!(uval & FUTEX_WAITERS)) {
+		curval = cmpxchg_futex_value_locked((int __user *)uaddr,
+						    uval, uval | FUTEX_WAITERS);
+		if (unlikely(curval == -EFAULT))
+			goto uaddr_faulted;
+		if (curval != uval)
+			goto retry_locked;
+	}
+
+	spin_lock(&futex_pi_lock);
+	if (!pi_state) {
+		/*
+		 * do_exit() sets PF_EXITING before it takes futex_pi_lock
+		 * in exit_pi_state_list(), so either it finds this state
+		 * on the owner's list or we see PF_EXITING here.
+		 */
+		if (unlikely(owner->flags & PF_EXITING)) {
+			spin_unlock(&futex_pi_lock);
+			goto retry_locked;
+		}
+		pi_state = new_state;
+		new_state = NULL;
+		INIT_LIST_HEAD(&pi_state->waiters);
+		list_add(&pi_state->list, &owner->pi_state_list);
+		pi_state->owner = owner;
+	}
+	q.pi_state = pi_state;
+	__queue_me(&q, bh);
+	list_add_tail(&q.pi_list, &pi_state->waiters);
+	current->pi_blocked_on = pi_state;
+	futex_pi_adjust_prio(owner);
+	spin_unlock(&futex_pi_lock);
+
+	spin_unlock(&bh->lock);
+	futex_unlock_mm(fshared);
+	put_task_struct(owner);
+
+	/*
+	 * futex_unlock_pi() makes us the owner before waking us up, and
+	 * exit_pi_state_list() clears the owner of a dead one.
+	 */
+	for (;;) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		owner = pi_state->owner;
+		if (owner == current || !owner)
+			break;
+		if (!time || signal_pending(current))
+			break;
+		time = schedule_timeout(time);
+	}
+	__set_current_state(TASK_RUNNING);
+
+	if (unqueue_me_pi(&q))
+		ret = 0;
+	else if (!owner)
+		goto retry;
+	else if (!time)
+		ret = -ETIMEDOUT;
+	else
+		ret = -EINTR;
+	goto out_free;
+
+ uaddr_faulted:
+	/*
+	 * The futex word has to be written, get_user() alone may not
+	 * be enough: fault it in for writing while still holding the
+	 * mmap_sem, like futex_wake_op().
+	 */
+	spin_unlock(&bh->lock);
+	if (owner) {
+		put_task_struct(owner);
+		owner = NULL;
+	}
+	if (attempt++) {
+		ret = futex_handle_fault(uaddr, fshared, attempt);
+		if (ret)
+			goto out_release_sem;
+		spin_lock(&bh->lock);
+		goto retry_locked;
+	}
+	futex_unlock_mm(fshared);
+
+	ret = get_user(uval, (int __user *)uaddr);
+	if (!ret)
+		goto retry;
+	goto out_free;
+
+ out_unlock:
+	spin_unlock(&bh->lock);
+	if (owner)
+		put_task_struct(owner);
+ out_release_sem:
+	futex_unlock_mm(fshared);
+ out_free:
+	kfree(new_state);
+	return ret;
+}
+
+/*
+ * Unlock a PI futex whose user space fast path failed because
+ * FUTEX_WAITERS is set.  The futex goes straight to the highest
+ * priority waiter, FIFO among equals, and our boost is dropped.
+ */
+static int futex_unlock_pi(unsigned long uaddr, struct rw_semaphore *fshared)
+{
+	struct futex_pi_state *pi_state;
+	struct futex_hash_bucket *bh;
+	struct futex_q *this, *top;
+	union futex_key key;
+	int uval, newval, curval, ret, attempt = 0;
+
+ retry:
+	if (get_user(uval, (int __user *)uaddr))
+		return -EFAULT;
+	if ((uval & FUTEX_TID_MASK) != current->pid)
+		return -EPERM;
+
+	futex_lock_mm(fshared);
+
+	ret = get_futex_key(uaddr, fshared, &key);
+	if (unlikely(ret != 0))
+		goto out;
+
+	bh = hash_futex(&key);
+	spin_lock(&bh->lock);
+
+ retry_locked:
+	top = NULL;
+	newval = 0;
+	pi_state = lookup_pi_state(bh, &key);
+	if (pi_state) {
+		list_for_each_entry(this, &pi_state->waiters, pi_list) {
+			if (!top || this->task->prio < top->task->prio)
+				top = this;
+		}
+		newval = top->task->pid | FUTEX_WAITERS;
+	}
+
+	curval = cmpxchg_futex_value_locked((int __user *)uaddr, uval, newval);
+	if (unlikely(curval == -EFAULT)) {
+		spin_unlock(&bh->lock);
+		if (attempt++) {
+			ret = futex_handle_fault(uaddr, fshared, attempt);
+			if (ret)
+				goto out;
+			spin_lock(&bh->lock);
+			goto retry_locked;
+		}
+		futex_unlock_mm(fshared);
+		goto retry;
+	}
+	if (curval != uval) {
+		/* Only the kernel modifies a locked word, but be safe */
+		spin_unlock(&bh->lock);
+		futex_unlock_mm(fshared);
+		goto retry;
+	}
+
+	if (top) {
+		spin_lock(&futex_pi_lock);
+		top->task->pi_blocked_on = NULL;
+		pi_state_set_owner(pi_state, top->task);
+		spin_unlock(&futex_pi_lock);
+		wake_up_process(top->task);
+	}
+	spin_unlock(&bh->lock);
+out:
+	futex_unlock_mm(fshared);
+	return ret;
+}
+
+/*
+ * Called from do_exit() after PF_EXITING is set.  The futexes held by
+ * the exiting task lose their owner, and their waiters are woken up to
+ * take them over.
+ */
+void exit_pi_state_list(struct task_struct *curr)
+{
+	struct futex_pi_state *pi_state, *next;
+	struct futex_q *this;
+
+	spin_lock(&futex_pi_lock);
+	list_for_each_entry_safe(pi_state, next, &curr->pi_state_list, list) {
+		list_del_init(&pi_state->list);
+		pi_state->owner = NULL;
+		list_for_each_entry(this, &pi_state->waiters, pi_list)
+			wake_up_process(this->task);
+	}
+	spin_unlock(&futex_pi_lock);
+}
+
 static int futex_close(struct inode *inode, struct file *filp)
 {
 	struct futex_q *q = filp->private_data;
@@ -686,8 +1375,12 @@ static int futex_fd(unsigned long uaddr, int signal)
 		goto out;
 	}
 
+	/*
+	 * The fd can outlive the mm and be passed to other processes, so
+	 * FUTEX_FD always uses a shared key, which pins the mm or inode.
+	 */
 	down_read(&current->mm->mmap_sem);
-	err = get_futex_key(uaddr, &q->key);
+	err = get_futex_key(uaddr, &current->mm->mmap_sem, &q->key);
 
 	if (unlikely(err != 0)) {
 		up_read(&current->mm->mmap_sem);
@@ -715,24 +1408,44 @@ out:
 long do_futex(unsigned long uaddr, int op, int val, unsigned long timeout,
 		unsigned long uaddr2, int val2, int val3)
 {
+	struct rw_semaphore *fshared = NULL;
+	int cmd = op & FUTEX_CMD_MASK;
 	int ret;
 
-	switch (op) {
+	if (!(op & FUTEX_PRIVATE_FLAG))
+		fshared = &current->mm->mmap_sem;
+
+	switch (cmd) {
 	case FUTEX_WAIT:
-		ret = futex_wait(uaddr, val, timeout);
+		ret = futex_wait(uaddr, fshared, val, timeout);
 		break;
 	case FUTEX_WAKE:
-		ret = futex_wake(uaddr, val);
+		ret = futex_wake(uaddr, fshared, val);
 		break;
 	case FUTEX_FD:
 		/* non-zero val means F_SETOWN(getpid()) & F_SETSIG(val) */
 		ret = futex_fd(uaddr, val);
 		break;
 	case FUTEX_REQUEUE:
-		ret = futex_requeue(uaddr, uaddr2, val, val2, NULL);
+		ret = futex_requeue(uaddr, fshared, uaddr2, val, val2, NULL);
 		break;
 	case FUTEX_CMP_REQUEUE:
-		ret = futex_requeue(uaddr, uaddr2, val, val2, &val3);
+		ret = futex_requeue(uaddr, fshared, uaddr2, val, val2, &val3);
+		break;
+	case FUTEX_WAKE_OP:
+		ret = futex_wake_op(uaddr, fshared, uaddr2, val, val2, val3);
+		break;
+	case FUTEX_LOCK_PI:
+	case FUTEX_TRYLOCK_PI:
+		ret = -ENOSYS;
+		if (futex_cmpxchg_enabled)
+			ret = futex_lock_pi(uaddr, fshared, timeout,
+					    cmd == FUTEX_TRYLOCK_PI);
+		break;
+	case FUTEX_UNLOCK_PI:
+		ret = -ENOSYS;
+		if (futex_cmpxchg_enabled)
+			ret = futex_unlock_pi(uaddr, fshared);
 		break;
 	default:
 		ret = -ENOSYS;
@@ -747,17 +1460,20 @@ asmlinkage long sys_futex(u32 __user *uaddr, int op, int val,
 {
 	struct timespec t;
 	unsigned long timeout = MAX_SCHEDULE_TIMEOUT;
+	int cmd = op & FUTEX_CMD_MASK;
 	int val2 = 0;
 
-	if ((op == FUTEX_WAIT) && utime) {
+	if ((cmd == FUTEX_WAIT || cmd == FUTEX_LOCK_PI) && utime) {
 		if (copy_from_user(&t, utime, sizeof(t)) != 0)
 			return -EFAULT;
 		timeout = timespec_to_jiffies(&t) + 1;
 	}
 	/*
-	 * requeue parameter in 'utime' if op == FUTEX_REQUEUE.
+	 * requeue parameter in 'utime' if op == FUTEX_REQUEUE, and the
+	 * number of waiters to wake on uaddr2 if op == FUTEX_WAKE_OP.
 	 */
-	if (op >= FUTEX_REQUEUE)
+	if (cmd == FUTEX_REQUEUE || cmd == FUTEX_CMP_REQUEUE ||
+	    cmd == FUTEX_WAKE_OP)
 		val2 = (int) (unsigned long) utime;
 
 	return do_futex((unsigned long)uaddr, op, val, timeout,
@@ -784,10 +1500,26 @@ static int __init init(void)
 	register_filesystem(&futex_fs_type);
 	futex_mnt = kern_mount(&futex_fs_type);
 
-	for (i = 0; i < ARRAY_SIZE(futex_queues); i++) {
+	/*
+	 * Contended futexes of unrelated processes should rarely share a
+	 * bucket: allow for at least 256 buckets per possible cpu.
+	 */
+	futex_queues = alloc_large_system_hash("Futex",
+					sizeof(struct futex_hash_bucket),
+					256 * num_possible_cpus(),
+					0, 0, NULL, &futex_hash_mask, 0);
+
+	for (i = 0; i <= futex_hash_mask; i++) {
 		INIT_LIST_HEAD(&futex_queues[i].chain);
 		spin_lock_init(&futex_queues[i].lock);
 	}
+
+	/*
+	 * PI futexes need futex_atomic_cmpxchg_inatomic(), which faults
+	 * on a NULL pointer where it is implemented.
+	 */
+	if (cmpxchg_futex_value_locked(NULL, 0, 0) == -EFAULT)
+		futex_cmpxchg_enabled = 1;
 	return 0;
 }
 __initcall(init);
@@ -0,0 +1,1353 @@
+/*
+ *  linux/kernel/hrtimer.c
+ *
+ *  High-resolution kernel timers
+ *
+ *  In contrast to the jiffies based timer wheel in kernel/timer.c,
+ *  hrtimers keep their expiry time in nanoseconds and are not rounded
+ *  to the tick.  They are used for:
+ *
+ *   - nanosleep and clock_nanosleep
+ *   - ITIMER_REAL interval timers
+ *   - POSIX timers on CLOCK_REALTIME and CLOCK_MONOTONIC
+ *   - the local tick, on CPUs running in high resolution mode
+ *
+ *  Every CPU has a timer base per clock, each holding its timers in a
+ *  red-black tree sorted by expiry, with the first node cached.
+ *
+ *  Until a CPU has a clock event device (and in kernels built without
+ *  CONFIG_HIGH_RES_TIMERS), the expired timers are run from the timer
+ *  softirq, once per tick.  Once a device has been registered the CPU
+ *  switches to high resolution mode: the device is set to one-shot mode
+ *  and programmed for the first expiring timer, the timers run from its
+ *  interrupt, and the periodic local tick is emulated by a timer of its
+ *  own.
+ */
+
+#include <linux/cpu.h>
+#include <linux/module.h>
+#include <linux/percpu.h>
+#include <linux/hrtimer.h>
+#include <linux/clockchips.h>
+#include <linux/notifier.h>
+#include <linux/syscalls.h>
+#include <linux/interrupt.h>
+#include <linux/workqueue.h>
+#include <linux/sched.h>
+#include <linux/kernel_stat.h>
+#include <linux/rcupdate.h>
+
+#include <asm/uaccess.h>
+
+/**
+ * ktime_get - get the monotonic time in ktime_t format
+ *
+ * returns the time in ktime_t format
+ */
+ktime_t ktime_get(void)
+{
+	struct timespec now;
+
+	ktime_get_ts(&now);
+
+	return timespec_to_ktime(now);
+}
+
+EXPORT_SYMBOL_GPL(ktime_get);
+
+/**
+ * ktime_get_real - get the real (wall-) time in ktime_t format
+ *
+ * returns the time in ktime_t format
+ */
+ktime_t ktime_get_real(void)
+{
+	struct timespec now;
+
+	getnstimeofday(&now);
+
+	return timespec_to_ktime(now);
+}
+
+EXPORT_SYMBOL_GPL(ktime_get_real);
+
+/**
+ * ktime_get_ts - get the monotonic clock in timespec format
+ * @ts:		pointer to timespec variable
+ *
+ * The function calculates the monotonic clock from the realtime
+ * clock and the wall_to_monotonic offset and stores the result
+ * in normalized timespec format in the variable pointed to by @ts.
+ */
+void ktime_get_ts(struct timespec *ts)
+{
+	struct timespec tomono;
+	unsigned long seq;
+
+	do {
+		seq = read_seqbegin(&xtime_lock);
+		getnstimeofday(ts);
+		tomono = wall_to_monotonic;
+
+	} while (read_seqretry(&xtime_lock, seq));
+
+	set_normalized_timespec(ts, ts->tv_sec + tomono.tv_sec,
+				ts->tv_nsec + tomono.tv_nsec);
+}
+
+EXPORT_SYMBOL_GPL(ktime_get_ts);
+
+/*
+ * Read the monotonic time and the offset of CLOCK_REALTIME to it in one
+ * go, so that both belong to the same instant.
+ */
+static ktime_t ktime_get_and_offset(ktime_t *offs_real)
+{
+	struct timespec now, tomono;
+	unsigned long seq;
+
+	do {
+		seq = read_seqbegin(&xtime_lock);
+		getnstimeofday(&now);
+		tomono = wall_to_monotonic;
+
+	} while (read_seqretry(&xtime_lock, seq));
+
+	offs_real->tv64 = -ktime_to_ns(timespec_to_ktime(tomono));
+
+	return ktime_add(timespec_to_ktime(now), timespec_to_ktime(tomono));
+}
+
+/*
+ * The timer bases:
+ *
+ * Timers on CLOCK_REALTIME expire relative to the wall clock and follow
+ * it when it is set; timers on CLOCK_MONOTONIC, and relative timers on
+ * either clock, are not affected by clock setting.
+ */
+static DEFINE_PER_CPU(struct hrtimer_cpu_base, hrtimer_bases) =
+{
+	.clock_base =
+	{
+		{
+			.index = CLOCK_REALTIME,
+			.get_time = &ktime_get_real,
+		},
+		{
+			.index = CLOCK_MONOTONIC,
+			.get_time = &ktime_get,
+		},
+	}
+};
+
+/*
+ * Functions and macros which are different for UP/SMP systems are kept
+ * in a single place
+ */
+#ifdef CONFIG_SMP
+
+/*
+ * We are using hashed locking: holding per_cpu(hrtimer_bases).lock
+ * means that all timers which are tied to this CPU's bases via
+ * timer->base are locked, and the bases themselves are locked too.
+ *
+ * So the expiry code and migrate_hrtimers() can safely modify all the
+ * timers which could be found in the trees.
+ *
+ * When the timer's base is locked, and the timer removed from the tree,
+ * it is possible to set timer->base = NULL and drop the lock: the timer
+ * remains locked.
+ */
+static struct hrtimer_base *lock_hrtimer_base(const struct hrtimer *timer,
+					      unsigned long *flags)
+{
+	struct hrtimer_base *base;
+
+	for (;;) {
+		base = timer->base;
+		if (likely(base != NULL)) {
+			spin_lock_irqsave(&base->cpu_base->lock, *flags);
+			if (likely(base == timer->base))
+				return base;
+			/* The timer has migrated to another CPU: */
+			spin_unlock_irqrestore(&base->cpu_base->lock, *flags);
+		}
+		cpu_relax();
+	}
+}
+
+/*
+ * Switch the timer base to the current CPU when possible.
+ */
+static inline struct hrtimer_base *
+switch_hrtimer_base(struct hrtimer *timer, struct hrtimer_base *base)
+{
+	struct hrtimer_base *new_base;
+
+	new_base = &__get_cpu_var(hrtimer_bases).clock_base[base->index];
+
+	if (base != new_base) {
+		/*
+		 * We are trying to schedule the timer on the local CPU.
+		 * However we can't change timer's base while its callback
+		 * is running, so we keep it on the same CPU: the expiry
+		 * code there looks at the bases again when the callback
+		 * has completed.  There is no conflict as we hold the lock
+		 * until the timer is enqueued.
+		 */
+		if (unlikely(hrtimer_callback_running(timer)))
+			return base;
+
+		/* See the comment in lock_hrtimer_base() */
+		timer->base = NULL;
+		spin_unlock(&base->cpu_base->lock);
+		spin_lock(&new_base->cpu_base->lock);
+		timer->base = new_base;
+	}
+	return new_base;
+}
+
+#else /* CONFIG_SMP */
+
+static inline struct hrtimer_base *
+lock_hrtimer_base(const struct hrtimer *timer, unsigned long *flags)
+{
+	struct hrtimer_base *base = timer->base;
+
+	spin_lock_irqsave(&base->cpu_base->lock, *flags);
+
+	return base;
+}
+
+#define switch_hrtimer_base(t, b)	(b)
+
+#endif	/* !CONFIG_SMP */
+
+static inline void
+unlock_hrtimer_base(const struct hrtimer *timer, unsigned long *flags)
+{
+	spin_unlock_irqrestore(&timer->base->cpu_base->lock, *flags);
+}
+
+/*
+ * Functions for the union type storage format of ktime_t which are
+ * too large for inlining:
+ */
+#if BITS_PER_LONG < 64
+/*
+ * Divide a ktime value by a nanosecond value
+ */
+static unsigned long ktime_divns(const ktime_t kt, s64 div)
+{
+	u64 dclc;
+	int sft = 0;
+
+	dclc = ktime_to_ns(kt);
+	/* Make sure the divisor is less than 2^32: */
+	while (div >> 32) {
+		sft++;
+		div >>= 1;
+	}
+	dclc >>= sft;
+	do_div(dclc, (unsigned long) div);
+
+	return (unsigned long) dclc;
+}
+#else
+# define ktime_divns(kt, div)		(unsigned long)((kt).tv64 / (div))
+#endif
+
+/* High resolution timer related functions */
+#ifdef CONFIG_HIGH_RES_TIMERS
+
+/*
+ * High resolution timer enabled ?
+ */
+static int hrtimer_hres_enabled = 1;
+
+/*
+ * Enable / Disable high resolution mode
+ */
+static int __init setup_hrtimer_hres(char *str)
+{
+	if (!strcmp(str, "off"))
+		hrtimer_hres_enabled = 0;
+	else if (!strcmp(str, "on"))
+		hrtimer_hres_enabled = 1;
+	else
+		return 0;
+	return 1;
+}
+
+__setup("highres=", setup_hrtimer_hres);
+
+/*
+ * Absolute monotonic expiry time of the first timer of this CPU, or
+ * KTIME_MAX when no timer is queued.  Called with the cpu_base lock held.
+ */
+static ktime_t hrtimer_next_event(struct hrtimer_cpu_base *cpu_base)
+{
+	struct hrtimer_base *base = cpu_base->clock_base;
+	ktime_t expires, expires_next;
+	int i;
+
+	expires_next.tv64 = KTIME_MAX;
+
+	for (i = 0; i < HRTIMER_MAX_CLOCK_BASES; i++, base++) {
+		struct hrtimer *timer;
+
+		if (!base->first)
+			continue;
+		timer = rb_entry(base->first, struct hrtimer, node);
+		expires = ktime_sub(timer->expires, base->offset);
+		if (expires.tv64 < expires_next.tv64)
+			expires_next = expires;
+	}
+	return expires_next;
+}
+
+static inline int hrtimer_hres_active(struct hrtimer_cpu_base *cpu_base)
+{
+	return cpu_base->hres_active;
+}
+
+/*
+ * Program the clock event device for the absolute monotonic time
+ * @expires.  An event which is already due is programmed min_delta_ns
+ * ahead, so that the interrupt comes right away.
+ */
+static void hrtimer_program_event(struct hrtimer_cpu_base *cpu_base,
+				  ktime_t expires)
+{
+	struct clock_event_device *dev = cpu_base->dev;
+	s64 delta;
+
+	cpu_base->expires_next = expires;
+	if (expires.tv64 == KTIME_MAX)
+		return;
+
+	delta = ktime_to_ns(ktime_sub(expires, ktime_get()));
+	if (delta > (s64) dev->max_delta_ns)
+		delta = dev->max_delta_ns;
+	if (delta < (s64) dev->min_delta_ns)
+		delta = dev->min_delta_ns;
+
+	dev->set_next_event(((u64) delta * dev->mult) >> dev->shift, dev);
+}
+
+/*
+ * @timer has become the first timer of @base: reprogram the clock event
+ * device if it expires before the event the device is programmed for.
+ * Called with the cpu_base lock held.
+ *
+ * Only the local device can be programmed.  A timer is only enqueued on
+ * another CPU while its callback runs there, and hrtimer_interrupt()
+ * looks at all the bases again before it returns, as it does for the
+ * timers enqueued by the callbacks themselves.
+ */
+static void hrtimer_reprogram(struct hrtimer *timer, struct hrtimer_base *base)
+{
+	struct hrtimer_cpu_base *cpu_base = base->cpu_base;
+	ktime_t expires;
+
+	if (!cpu_base->hres_active || cpu_base->in_interrupt ||
+	    cpu_base != &__get_cpu_var(hrtimer_bases))
+		return;
+
+	expires = ktime_sub(timer->expires, base->offset);
+	if (expires.tv64 < cpu_base->expires_next.tv64)
+		hrtimer_program_event(cpu_base, expires);
+}
+
+/*
+ * Reread the offset of CLOCK_REALTIME and reprogram the clock event
+ * device for the first timer.  Called on every CPU when the clock was
+ * set.
+ */
+static void retrigger_next_event(void *arg)
+{
+	struct hrtimer_cpu_base *cpu_base = &__get_cpu_var(hrtimer_bases);
+	unsigned long flags;
+
+	if (!hrtimer_hres_active(cpu_base))
+		return;
+
+	spin_lock_irqsave(&cpu_base->lock, flags);
+	ktime_get_and_offset(&cpu_base->clock_base[CLOCK_REALTIME].offset);
+	hrtimer_program_event(cpu_base, hrtimer_next_event(cpu_base));
+	spin_unlock_irqrestore(&cpu_base->lock, flags);
+}
+
+static void clock_was_set_work_fn(void *unused)
+{
+	clock_was_set();
+}
+
+static DECLARE_WORK(clock_was_set_work, clock_was_set_work_fn, NULL);
+
+/*
+ * Clock realtime was set
+ *
+ * The offset of the realtime clock vs. the monotonic clock changed, so
+ * the CLOCK_REALTIME timers expire at another monotonic time: every CPU
+ * in high resolution mode has to reprogram its clock event device.
+ *
+ * clock_was_set() is also called from the timer interrupt, with
+ * xtime_lock held, when a leap second is inserted: the CPUs are kicked
+ * from keventd then.
+ */
+void clock_was_set(void)
+{
+	if (unlikely(in_interrupt() || irqs_disabled())) {
+		schedule_work(&clock_was_set_work);
+		return;
+	}
+	on_each_cpu(retrigger_next_event, NULL, 0, 1);
+}
+
+#ifdef CONFIG_NO_IDLE_HZ
+
+/*
+ * 0: idle cpus stop their local tick, 1: they keep it running.
+ * Can be changed through /proc/sys/kernel/hz_timer.
+ */
+int sysctl_hz_timer;
+
+/*
+ * Account the ticks skipped between cpu_base->idle_tick and @now (both
+ * included) as idle time, and move idle_tick to the first tick after
+ * @now.  Called on the local cpu with interrupts disabled.
+ */
+static void hrtimer_account_idle_ticks(struct hrtimer_cpu_base *cpu_base,
+				       ktime_t now)
+{
+	unsigned long ticks;
+
+	if (now.tv64 < cpu_base->idle_tick.tv64)
+		return;
+
+	ticks = ktime_divns(ktime_sub(now, cpu_base->idle_tick), TICK_NSEC) + 1;
+	cpu_base->idle_tick = ktime_add_ns(cpu_base->idle_tick,
+					   (u64) ticks * TICK_NSEC);
+	account_steal_time(current, jiffies_to_cputime(ticks));
+}
+
+#endif
+
+/*
+ * The periodic local tick, emulated on top of the one-shot device.
+ */
+static int hrtimer_sched_tick(struct hrtimer *timer)
+{
+	struct hrtimer_cpu_base *cpu_base =
+		container_of(timer, struct hrtimer_cpu_base, tick_timer);
+	struct clock_event_device *dev = cpu_base->dev;
+
+#ifdef CONFIG_NO_IDLE_HZ
+	/*
+	 * The idle cpu slept until its next timer: account the ticks it
+	 * skipped before this one and keep ticking, until
+	 * hrtimer_stop_sched_tick() is called again on the way out of
+	 * the interrupt.
+	 */
+	if (cpu_base->tick_stopped) {
+		ktime_t prev = ktime_sub(hrtimer_cb_get_time(timer),
+					 ns_to_ktime(TICK_NSEC));
+
+		hrtimer_account_idle_ticks(cpu_base, prev);
+		cpu_base->tick_stopped = 0;
+		cpu_clear(smp_processor_id(), nohz_cpu_mask);
+	}
+#endif
+
+	dev->tick(cpu_base->regs);
+
+	hrtimer_forward(timer, hrtimer_cb_get_time(timer),
+			ns_to_ktime(dev->tick_ns));
+
+	return HRTIMER_RESTART;
+}
+
+static void enqueue_hrtimer(struct hrtimer *timer, struct hrtimer_base *base);
+
+/*
+ * Switch to high resolution mode, once this CPU has a clock event
+ * device.  Called from the timer softirq.
+ */
+static int hrtimer_switch_to_hres(struct hrtimer_cpu_base *cpu_base)
+{
+	struct clock_event_device *dev = cpu_base->dev;
+	struct hrtimer *tick = &cpu_base->tick_timer;
+	unsigned long flags;
+	ktime_t now;
+	int i;
+
+	if (!hrtimer_hres_enabled || !dev)
+		return 0;
+
+	local_irq_save(flags);
+	spin_lock(&cpu_base->lock);
+
+	dev->set_mode(CLOCK_EVT_MODE_ONESHOT, dev);
+	dev->mode = CLOCK_EVT_MODE_ONESHOT;
+	dev->event_handler = hrtimer_interrupt;
+
+	cpu_base->hres_active = 1;
+	for (i = 0; i < HRTIMER_MAX_CLOCK_BASES; i++)
+		cpu_base->clock_base[i].resolution = KTIME_HIGH_RES;
+
+	hrtimer_init(tick, CLOCK_MONOTONIC, HRTIMER_ABS);
+	tick->function = hrtimer_sched_tick;
+	now = ktime_get_and_offset(&cpu_base->clock_base[CLOCK_REALTIME].offset);
+	tick->expires = ktime_add_ns(now, dev->tick_ns);
+
+	cpu_base->in_interrupt = 1;
+	enqueue_hrtimer(tick, tick->base);
+	cpu_base->in_interrupt = 0;
+
+	hrtimer_program_event(cpu_base, hrtimer_next_event(cpu_base));
+
+	spin_unlock(&cpu_base->lock);
+	local_irq_restore(flags);
+
+	printk(KERN_INFO "hrtimer: %s switched to high resolution mode "
+	       "on CPU %d\n", dev->name, smp_processor_id());
+	return 1;
+}
+
+/**
+ * clockevents_register_device - register the clock event device of a CPU
+ * @dev:	device to register
+ *
+ * Must be called on the CPU the device belongs to, with interrupts
+ * disabled.  The device keeps running its periodic tick until the CPU
+ * switches to high resolution mode from the next timer softirq.
+ */
+void clockevents_register_device(struct clock_event_device *dev)
+{
+	struct hrtimer_cpu_base *cpu_base = &__get_cpu_var(hrtimer_bases);
+
+	dev->mode = CLOCK_EVT_MODE_PERIODIC;
+	dev->event_handler = NULL;
+	if (!dev->tick_ns)
+		dev->tick_ns = TICK_NSEC;
+	cpu_base->dev = dev;
+}
+
+#else
+
+static inline int hrtimer_hres_active(struct hrtimer_cpu_base *cpu_base)
+{
+	return 0;
+}
+
+static inline int hrtimer_switch_to_hres(struct hrtimer_cpu_base *cpu_base)
+{
+	return 0;
+}
+
+static inline void
+hrtimer_reprogram(struct hrtimer *timer, struct hrtimer_base *base)
+{
+}
+
+/*
+ * In low resolution mode the CLOCK_REALTIME timers are compared against
+ * the wall clock on every tick: nothing to do.
+ */
+void clock_was_set(void)
+{
+}
+
+#endif /* CONFIG_HIGH_RES_TIMERS */
+
+/**
+ * hrtimer_forward - forward the timer expiry
+ * @timer:	hrtimer to forward
+ * @now:	forward past this time
+ * @interval:	the interval to forward
+ *
+ * Forward the timer expiry so it will expire in the future.
+ * Returns the number of overruns.
+ */
+unsigned long
+hrtimer_forward(struct hrtimer *timer, ktime_t now, ktime_t interval)
+{
+	unsigned long orun = 1;
+	ktime_t delta;
+
+	delta = ktime_sub(now, timer->expires);
+
+	if (delta.tv64 < 0)
+		return 0;
+
+	if (interval.tv64 < timer->base->resolution.tv64)
+		interval.tv64 = timer->base->resolution.tv64;
+
+	if (unlikely(delta.tv64 >= interval.tv64)) {
+		s64 incr = ktime_to_ns(interval);
+
+		orun = ktime_divns(delta, incr);
+		timer->expires = ktime_add_ns(timer->expires, incr * orun);
+		if (timer->expires.tv64 > now.tv64)
+			return orun;
+		/*
+		 * This (and the ktime_add() below) is the
+		 * correction for exact:
+		 */
+		orun++;
+	}
+	timer->expires = ktime_add(timer->expires, interval);
+
+	return orun;
+}
+
+EXPORT_SYMBOL_GPL(hrtimer_forward);
+
+/*
+ * enqueue_hrtimer - internal function to (re)start a timer
+ *
+ * The timer is inserted in expiry order. Insertion into the
+ * red black tree is O(log(n)). Must hold the base lock.
+ */
+static void enqueue_hrtimer(struct hrtimer *timer, struct hrtimer_base *base)
+{
+	struct rb_node **link = &base->active.rb_node;
+	struct rb_node *parent = NULL;
+	struct hrtimer *entry;
+	int leftmost = 1;
+
+	/*
+	 * Find the right place in the rbtree:
+	 */
+	while (*link) {
+		parent = *link;
+		entry = rb_entry(parent, struct hrtimer, node);
+		/*
+		 * We dont care about collisions. Nodes with
+		 * the same expiry time stay together.
+		 */
+		if (timer->expires.tv64 < entry->expires.tv64)
+			link = &(*link)->rb_left;
+		else {
+			link = &(*link)->rb_right;
+			leftmost = 0;
+		}
+	}
+
+	/*
+	 * Insert the timer to the rbtree and check whether it
+	 * replaces the first pending timer
+	 */
+	if (leftmost)
+		base->first = &timer->node;
+
+	rb_link_node(&timer->node, parent, link);
+	rb_insert_color(&timer->node, &base->active);
+	timer->state |= HRTIMER_STATE_ENQUEUED;
+
+	if (leftmost)
+		hrtimer_reprogram(timer, base);
+}
+
+/*
+ * __remove_hrtimer - internal function to remove a timer
+ *
+ * Caller must hold the base lock.  The clock event device is not
+ * reprogrammed when the first timer goes away: the interrupt it raises
+ * finds nothing to do and programs the next event.
+ */
+static void __remove_hrtimer(struct hrtimer *timer, struct hrtimer_base *base,
+			     unsigned long newstate)
+{
+	/*
+	 * Remove the timer from the rbtree and replace the
+	 * first entry pointer if necessary.
+	 */
+	if (base->first == &timer->node)
+		base->first = rb_next(&timer->node);
+	rb_erase(&timer->node, &base->active);
+	timer->state = newstate;
+}
+
+/*
+ * remove hrtimer, called with base lock held
+ */
+static inline int
+remove_hrtimer(struct hrtimer *timer, struct hrtimer_base *base)
+{
+	if (hrtimer_is_queued(timer)) {
+		/* A timer restarted while its callback runs stays marked */
+		__remove_hrtimer(timer, base,
+				 timer->state & HRTIMER_STATE_CALLBACK);
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * hrtimer_start - (re)start an relative timer on the current CPU
+ * @timer:	the timer to be added
+ * @tim:	expiry time
+ * @mode:	expiry mode: absolute (HRTIMER_ABS) or relative (HRTIMER_REL)
+ *
+ * Returns:
+ *  0 on success
+ *  1 when the timer was active
+ */
+int
+hrtimer_start(struct hrtimer *timer, ktime_t tim, const enum hrtimer_mode mode)
+{
+	struct hrtimer_base *base, *new_base;
+	unsigned long flags;
+	int ret;
+
+	base = lock_hrtimer_base(timer, &flags);
+
+	/* Remove an active timer from the queue: */
+	ret = remove_hrtimer(timer, base);
+
+	/* Switch the timer base, if necessary: */
+	new_base = switch_hrtimer_base(timer, base);
+
+	if (mode == HRTIMER_REL)
+		tim = ktime_add(tim, new_base->get_time());
+	timer->expires = tim;
+
+	enqueue_hrtimer(timer, new_base);
+
+	unlock_hrtimer_base(timer, &flags);
+
+	return ret;
+}
+
+EXPORT_SYMBOL_GPL(hrtimer_start);
+
+/**
+ * hrtimer_try_to_cancel - try to deactivate a timer
+ * @timer:	hrtimer to stop
+ *
+ * Returns:
+ *  0 when the timer was not active
+ *  1 when the timer was active
+ * -1 when the timer is currently excuting the callback function and
+ *    cannot be stopped
+ */
+int hrtimer_try_to_cancel(struct hrtimer *timer)
+{
+	struct hrtimer_base *base;
+	unsigned long flags;
+	int ret = -1;
+
+	base = lock_hrtimer_base(timer, &flags);
+
+	if (!hrtimer_callback_running(timer))
+		ret = remove_hrtimer(timer, base);
+
+	unlock_hrtimer_base(timer, &flags);
+
+	return ret;
+
+}
+
+EXPORT_SYMBOL_GPL(hrtimer_try_to_cancel);
+
+/**
+ * hrtimer_cancel - cancel a timer and wait for the handler to finish.
+ * @timer:	the timer to be cancelled
+ *
+ * Must not be called from the timer's own callback, nor with a lock the
+ * callback takes.
+ *
+ * Returns:
+ *  0 when the timer was not active
+ *  1 when the timer was active
+ */
+int hrtimer_cancel(struct hrtimer *timer)
+{
+	for (;;) {
+		int ret = hrtimer_try_to_cancel(timer);
+
+		if (ret >= 0)
+			return ret;
+		cpu_relax();
+	}
+}
+
+EXPORT_SYMBOL_GPL(hrtimer_cancel);
+
+/**
+ * hrtimer_get_remaining - get remaining time for the timer
+ * @timer:	the timer to read
+ */
+ktime_t hrtimer_get_remaining(const struct hrtimer *timer)
+{
+	struct hrtimer_base *base;
+	unsigned long flags;
+	ktime_t rem;
+
+	base = lock_hrtimer_base(timer, &flags);
+	rem = ktime_sub(timer->expires, base->get_time());
+	unlock_hrtimer_base(timer, &flags);
+
+	return rem;
+}
+
+EXPORT_SYMBOL_GPL(hrtimer_get_remaining);
+
+/**
+ * hrtimer_init - initialize a timer to the given clock
+ * @timer:	the timer to be initialized
+ * @clock_id:	the clock to be used
+ * @mode:	timer mode abs/rel
+ *
+ * A relative timer on CLOCK_REALTIME is queued on CLOCK_MONOTONIC, as
+ * setting the clock must not change when it expires.
+ */
+void hrtimer_init(struct hrtimer *timer, clockid_t clock_id,
+		  enum hrtimer_mode mode)
+{
+	struct hrtimer_cpu_base *cpu_base;
+
+	memset(timer, 0, sizeof(struct hrtimer));
+
+	cpu_base = &per_cpu(hrtimer_bases, _smp_processor_id());
+
+	if (clock_id == CLOCK_REALTIME && mode != HRTIMER_ABS)
+		clock_id = CLOCK_MONOTONIC;
+
+	timer->base = &cpu_base->clock_base[clock_id];
+}
+
+EXPORT_SYMBOL_GPL(hrtimer_init);
+
+/**
+ * hrtimer_get_res - get the timer resolution for a clock
+ * @which_clock: which clock to query
+ * @tp:		 pointer to timespec variable to store the resolution
+ *
+ * Store the resolution of the clock selected by which_clock in the
+ * variable pointed to by tp.
+ */
+int hrtimer_get_res(const clockid_t which_clock, struct timespec *tp)
+{
+	struct hrtimer_cpu_base *cpu_base;
+
+	cpu_base = &per_cpu(hrtimer_bases, _smp_processor_id());
+	*tp = ktime_to_timespec(cpu_base->clock_base[which_clock].resolution);
+
+	return 0;
+}
+
+EXPORT_SYMBOL_GPL(hrtimer_get_res);
+
+/*
+ * Run the callback of an expired timer.  Called with the cpu_base lock
+ * held and interrupts disabled; the lock is dropped around the callback.
+ */
+static void run_hrtimer(struct hrtimer *timer, struct hrtimer_base *base)
+{
+	struct hrtimer_cpu_base *cpu_base = base->cpu_base;
+	int (*fn)(struct hrtimer *);
+	int restart;
+
+	__remove_hrtimer(timer, base, HRTIMER_STATE_CALLBACK);
+	fn = timer->function;
+
+	spin_unlock(&cpu_base->lock);
+	restart = fn(timer);
+	spin_lock(&cpu_base->lock);
+
+	/*
+	 * Note: We clear the CALLBACK bit after enqueue_hrtimer to avoid
+	 * reprogramming of the event hardware. This happens at the end of
+	 * this function anyway.
+	 */
+	if (restart != HRTIMER_NORESTART) {
+		BUG_ON(hrtimer_is_queued(timer));
+		enqueue_hrtimer(timer, base);
+	}
+	timer->state &= ~HRTIMER_STATE_CALLBACK;
+}
+
+/*
+ * Run the expired timers of all the bases of a CPU, @now being the
+ * monotonic time.  Called with the cpu_base lock held.
+ */
+static void run_hrtimer_queues(struct hrtimer_cpu_base *cpu_base, ktime_t now)
+{
+	struct hrtimer_base *base = cpu_base->clock_base;
+	int i;
+
+	for (i = 0; i < HRTIMER_MAX_CLOCK_BASES; i++, base++) {
+		ktime_t basenow = ktime_add(now, base->offset);
+		struct rb_node *node;
+
+		while ((node = base->first)) {
+			struct hrtimer *timer;
+
+			timer = rb_entry(node, struct hrtimer, node);
+			if (basenow.tv64 < timer->expires.tv64)
+				break;
+
+			run_hrtimer(timer, base);
+		}
+	}
+}
+
+#ifdef CONFIG_HIGH_RES_TIMERS
+
+/*
+ * High resolution timer interrupt
+ * Called with interrupts disabled
+ */
+void hrtimer_interrupt(struct clock_event_device *dev, struct pt_regs *regs)
+{
+	struct hrtimer_cpu_base *cpu_base = &__get_cpu_var(hrtimer_bases);
+	ktime_t now, expires_next;
+
+	cpu_base->regs = regs;
+
+	spin_lock(&cpu_base->lock);
+	cpu_base->in_interrupt = 1;
+
+	/*
+	 * Run the expired timers, and run them again if the next one
+	 * expired while the callbacks were running.
+	 */
+	do {
+		now = ktime_get_and_offset(
+			&cpu_base->clock_base[CLOCK_REALTIME].offset);
+		run_hrtimer_queues(cpu_base, now);
+		expires_next = hrtimer_next_event(cpu_base);
+	} while (expires_next.tv64 <= ktime_get().tv64);
+
+	cpu_base->in_interrupt = 0;
+	hrtimer_program_event(cpu_base, expires_next);
+
+	spin_unlock(&cpu_base->lock);
+
+	cpu_base->regs = NULL;
+}
+
+#ifdef CONFIG_NO_IDLE_HZ
+
+/*
+ * Move the emulated tick of this cpu to @expires and reprogram the
+ * clock event device.  Called with interrupts disabled.
+ */
+static void hrtimer_move_sched_tick(struct hrtimer_cpu_base *cpu_base,
+				    ktime_t expires)
+{
+	struct hrtimer *tick = &cpu_base->tick_timer;
+
+	spin_lock(&cpu_base->lock);
+	if (hrtimer_is_queued(tick))
+		__remove_hrtimer(tick, tick->base, HRTIMER_STATE_INACTIVE);
+	tick->expires = expires;
+
+	cpu_base->in_interrupt = 1;
+	enqueue_hrtimer(tick, tick->base);
+	cpu_base->in_interrupt = 0;
+
+	hrtimer_program_event(cpu_base, hrtimer_next_event(cpu_base));
+	spin_unlock(&cpu_base->lock);
+}
+
+/**
+ * hrtimer_irq_enter - an interrupt hit this cpu
+ *
+ * Called from irq_enter().  A cpu in nohz_cpu_mask is ignored by new RCU
+ * grace periods, but the interrupt handler and the softirqs run on the
+ * way out may enter RCU read side sections, so the cpu leaves the mask
+ * first.  hrtimer_stop_sched_tick() puts it back when the cpu returns
+ * to idle.
+ */
+void hrtimer_irq_enter(void)
+{
+	int cpu = smp_processor_id();
+
+	if (cpu_isset(cpu, nohz_cpu_mask)) {
+		cpu_clear(cpu, nohz_cpu_mask);
+		smp_mb();
+	}
+}
+
+/**
+ * hrtimer_stop_sched_tick - stop the local tick of an idle cpu
+ *
+ * Called from the idle loop, and from irq_exit() when an interrupt hit
+ * the idle cpu, since its handler may have queued a timer.  The tick is
+ * moved to the expiry of the first timer wheel timer of this cpu; the
+ * hrtimers program the clock event device themselves.
+ *
+ * While its tick is stopped and it is not handling an interrupt, the
+ * cpu is in nohz_cpu_mask, so that RCU grace periods do not wait for
+ * it.  It keeps ticking when RCU still needs it, or when softirqs are
+ * pending.
+ */
+void hrtimer_stop_sched_tick(void)
+{
+	struct hrtimer_cpu_base *cpu_base = &__get_cpu_var(hrtimer_bases);
+	int cpu = smp_processor_id();
+	unsigned long flags, delta;
+	ktime_t now;
+
+	if (!cpu_base->hres_active || sysctl_hz_timer)
+		return;
+
+	local_irq_save(flags);
+
+	cpu_set(cpu, nohz_cpu_mask);
+	smp_mb();
+	if (rcu_pending(cpu) || local_softirq_pending())
+		goto restart;
+
+	delta = next_timer_interrupt() - jiffies;
+	if ((long) delta <= 1)
+		goto restart;
+	/* No timer for ages: the device wakes us up now and then anyway */
+	if (delta > 3600 * HZ)
+		delta = 3600 * HZ;
+
+	if (!cpu_base->tick_stopped) {
+		cpu_base->idle_tick = cpu_base->tick_timer.expires;
+		cpu_base->tick_stopped = 1;
+	}
+
+	now = ktime_get();
+	hrtimer_move_sched_tick(cpu_base,
+				ktime_add_ns(now, (u64) delta * TICK_NSEC));
+	local_irq_restore(flags);
+	return;
+
+restart:
+	local_irq_restore(flags);
+	hrtimer_restart_sched_tick();
+}
+
+/**
+ * hrtimer_restart_sched_tick - restart the local tick
+ *
+ * Called from the idle loop before it schedules, and when the tick
+ * cannot be stopped (any more).  The skipped ticks are accounted as
+ * idle time, the tick restarts in its old phase and RCU learns about
+ * the quiescent state this cpu was in.
+ */
+void hrtimer_restart_sched_tick(void)
+{
+	struct hrtimer_cpu_base *cpu_base = &__get_cpu_var(hrtimer_bases);
+	int cpu = smp_processor_id();
+	unsigned long flags;
+
+	local_irq_save(flags);
+	cpu_clear(cpu, nohz_cpu_mask);
+
+	if (cpu_base->tick_stopped) {
+		cpu_base->tick_stopped = 0;
+		hrtimer_account_idle_ticks(cpu_base, ktime_get());
+		hrtimer_move_sched_tick(cpu_base, cpu_base->idle_tick);
+		rcu_check_callbacks(cpu, 0);
+	}
+	local_irq_restore(flags);
+}
+
+#endif /* CONFIG_NO_IDLE_HZ */
+
+#endif
+
+/*
+ * Called from the timer softirq every jiffy: run the expired timers of
+ * a CPU in low resolution mode, or switch it to high resolution mode.
+ */
+void hrtimer_run_queues(void)
+{
+	struct hrtimer_cpu_base *cpu_base = &__get_cpu_var(hrtimer_bases);
+	ktime_t now;
+
+	if (hrtimer_hres_active(cpu_base))
+		return;
+
+	if (hrtimer_switch_to_hres(cpu_base))
+		return;
+
+	if (!cpu_base->clock_base[CLOCK_REALTIME].first &&
+	    !cpu_base->clock_base[CLOCK_MONOTONIC].first)
+		return;
+
+	spin_lock_irq(&cpu_base->lock);
+	now = ktime_get_and_offset(&cpu_base->clock_base[CLOCK_REALTIME].offset);
+	run_hrtimer_queues(cpu_base, now);
+	spin_unlock_irq(&cpu_base->lock);
+}
+
+/*
+ * Sleep related functions:
+ */
+static int hrtimer_wakeup(struct hrtimer *timer)
+{
+	struct hrtimer_sleeper *t =
+		container_of(timer, struct hrtimer_sleeper, timer);
+	struct task_struct *task = t->task;
+
+	t->task = NULL;
+	if (task)
+		wake_up_process(task);
+
+	return HRTIMER_NORESTART;
+}
+
+void hrtimer_init_sleeper(struct hrtimer_sleeper *sl, struct task_struct *task)
+{
+	sl->timer.function = hrtimer_wakeup;
+	sl->task = task;
+}
+
+static int __sched do_hrtimer_nanosleep(struct hrtimer_sleeper *t,
+					enum hrtimer_mode mode)
+{
+	hrtimer_init_sleeper(t, current);
+
+	do {
+		set_current_state(TASK_INTERRUPTIBLE);
+		hrtimer_start(&t->timer, t->timer.expires, mode);
+
+		if (likely(t->task))
+			schedule();
+
+		hrtimer_cancel(&t->timer);
+		mode = HRTIMER_ABS;
+
+	} while (t->task && !signal_pending(current));
+
+	__set_current_state(TASK_RUNNING);
+
+	return t->task == NULL;
+}
+
+static int update_rmtp(struct hrtimer *timer, struct timespec *rmtp)
+{
+	ktime_t rem;
+
+	rem = hrtimer_get_remaining(timer);
+	if (rem.tv64 <= 0)
+		return 0;
+	*rmtp = ktime_to_timespec(rem);
+
+	return 1;
+}
+
+/*
+ * Resume a nanosleep interrupted by a signal, storing the remaining
+ * time in the kernel timespec @rmtp (when non-NULL) if it is
+ * interrupted again.  The restart block was filled in by
+ * hrtimer_nanosleep(): arg0 is the clock, arg2/arg3 the low and high
+ * halves of the absolute expiry time; arg1 belongs to the caller.
+ */
+long __sched
+hrtimer_resume_nanosleep(struct restart_block *restart, struct timespec *rmtp)
+{
+	struct hrtimer_sleeper t;
+
+	hrtimer_init(&t.timer, restart->arg0, HRTIMER_ABS);
+	t.timer.expires.tv64 = ((u64)restart->arg3 << 32) |
+		(u64) (restart->arg2 & 0xffffffffUL);
+
+	if (do_hrtimer_nanosleep(&t, HRTIMER_ABS))
+		return 0;
+
+	if (rmtp && !update_rmtp(&t.timer, rmtp))
+		return 0;
+
+	/* The other values in restart are already filled in */
+	return -ERESTART_RESTARTBLOCK;
+}
+
+/*
+ * Restart function of nanosleep and clock_nanosleep; arg1 holds the
+ * user space timespec for the remaining time.
+ */
+long __sched hrtimer_nanosleep_restart(struct restart_block *restart)
+{
+	struct timespec __user *rmtp;
+	struct timespec rmt;
+	long ret;
+
+	rmtp = (struct timespec __user *) restart->arg1;
+	ret = hrtimer_resume_nanosleep(restart, rmtp ? &rmt : NULL);
+	if (ret == -ERESTART_RESTARTBLOCK && rmtp &&
+	    copy_to_user(rmtp, &rmt, sizeof(rmt)))
+		return -EFAULT;
+
+	return ret;
+}
+
+/**
+ * hrtimer_nanosleep - sleep on a clock
+ * @rqtp:	requested time, relative or absolute depending on @mode
+ * @rmtp:	remaining time, when interrupted (kernel pointer, may be NULL)
+ * @mode:	HRTIMER_ABS or HRTIMER_REL
+ * @clockid:	CLOCK_REALTIME or CLOCK_MONOTONIC
+ *
+ * An interrupted relative sleep is restarted through the restart block
+ * with hrtimer_nanosleep_restart(); the caller stores the user space
+ * address for the remaining time in restart_block.arg1.
+ */
+long hrtimer_nanosleep(struct timespec *rqtp, struct timespec *rmtp,
+		       const enum hrtimer_mode mode, const clockid_t clockid)
+{
+	struct restart_block *restart;
+	struct hrtimer_sleeper t;
+
+	hrtimer_init(&t.timer, clockid, mode);
+	t.timer.expires = timespec_to_ktime(*rqtp);
+	if (do_hrtimer_nanosleep(&t, mode))
+		return 0;
+
+	/* Absolute timers do not update the rmtp value and restart: */
+	if (mode == HRTIMER_ABS)
+		return -ERESTARTNOHAND;
+
+	if (rmtp && !update_rmtp(&t.timer, rmtp))
+		return 0;
+
+	restart = &current_thread_info()->restart_block;
+	restart->fn = hrtimer_nanosleep_restart;
+	restart->arg0 = (unsigned long) t.timer.base->index;
+	restart->arg1 = 0;
+	restart->arg2 = t.timer.expires.tv64 & 0xFFFFFFFF;
+	restart->arg3 = t.timer.expires.tv64 >> 32;
+
+	return -ERESTART_RESTARTBLOCK;
+}
+
+asmlinkage long
+sys_nanosleep(struct timespec __user *rqtp, struct timespec __user *rmtp)
+{
+	struct timespec tu, rmt;
+	long ret;
+
+	if (copy_from_user(&tu, rqtp, sizeof(tu)))
+		return -EFAULT;
+
+	if ((tu.tv_nsec >= NSEC_PER_SEC) || (tu.tv_nsec < 0) || (tu.tv_sec < 0))
+		return -EINVAL;
+
+	ret = hrtimer_nanosleep(&tu, rmtp ? &rmt : NULL, HRTIMER_REL,
+				CLOCK_MONOTONIC);
+
+	if (ret == -ERESTART_RESTARTBLOCK) {
+		current_thread_info()->restart_block.arg1 = (unsigned long) rmtp;
+		if (rmtp && copy_to_user(rmtp, &rmt, sizeof(rmt)))
+			return -EFAULT;
+	}
+
+	return ret;
+}
+
+/*
+ * Functions related to boot-time initialization:
+ */
+static void __devinit init_hrtimers_cpu(int cpu)
+{
+	struct hrtimer_cpu_base *cpu_base = &per_cpu(hrtimer_bases, cpu);
+	int i;
+
+	spin_lock_init(&cpu_base->lock);
+
+	for (i = 0; i < HRTIMER_MAX_CLOCK_BASES; i++) {
+		cpu_base->clock_base[i].cpu_base = cpu_base;
+		cpu_base->clock_base[i].resolution = KTIME_LOW_RES;
+	}
+
+	cpu_base->expires_next.tv64 = KTIME_MAX;
+}
+
+#ifdef CONFIG_HOTPLUG_CPU
+
+static void migrate_hrtimer_list(struct hrtimer_base *old_base,
+				struct hrtimer_base *new_base)
+{
+	struct hrtimer *timer;
+	struct rb_node *node;
+
+	while ((node = rb_first(&old_base->active))) {
+		timer = rb_entry(node, struct hrtimer, node);
+		BUG_ON(hrtimer_callback_running(timer));
+		__remove_hrtimer(timer, old_base, HRTIMER_STATE_INACTIVE);
+		timer->base = new_base;
+		enqueue_hrtimer(timer, new_base);
+	}
+}
+
+static void migrate_hrtimers(int cpu)
+{
+	struct hrtimer_cpu_base *old_base, *new_base;
+	int i;
+
+	BUG_ON(cpu_online(cpu));
+	old_base = &per_cpu(hrtimer_bases, cpu);
+	new_base = &get_cpu_var(hrtimer_bases);
+
+	local_irq_disable();
+
+	spin_lock(&new_base->lock);
+	spin_lock(&old_base->lock);
+
+	/* The emulated tick of the dead CPU is not carried over */
+	if (old_base->hres_active) {
+		struct hrtimer *tick = &old_base->tick_timer;
+
+		if (hrtimer_is_queued(tick))
+			__remove_hrtimer(tick, tick->base,
+					 HRTIMER_STATE_INACTIVE);
+		old_base->hres_active = 0;
+	}
+	old_base->dev = NULL;
+
+	for (i = 0; i < HRTIMER_MAX_CLOCK_BASES; i++)
+		migrate_hrtimer_list(&old_base->clock_base[i],
+				     &new_base->clock_base[i]);
+
+	spin_unlock(&old_base->lock);
+	spin_unlock(&new_base->lock);
+
+	local_irq_enable();
+	put_cpu_var(hrtimer_bases);
+}
+#endif /* CONFIG_HOTPLUG_CPU */
+
+static int __devinit hrtimer_cpu_notify(struct notifier_block *self,
+					unsigned long action, void *hcpu)
+{
+	long cpu = (long)hcpu;
+
+	switch (action) {
+
+	case CPU_UP_PREPARE:
+		init_hrtimers_cpu(cpu);
+		break;
+
+#ifdef CONFIG_HOTPLUG_CPU
+	case CPU_DEAD:
+		migrate_hrtimers(cpu);
+		break;
+#endif
+
+	default:
+		break;
+	}
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block __devinitdata hrtimers_nb = {
+	.notifier_call = hrtimer_cpu_notify,
+};
+
+void __init hrtimers_init(void)
+{
+	hrtimer_cpu_notify(&hrtimers_nb, (unsigned long)CPU_UP_PREPARE,
+			  (void *)(long)smp_processor_id());
+	register_cpu_notifier(&hrtimers_nb);
+}
@@ -11,28 +11,33 @@
 #include <linux/interrupt.h>
 #include <linux/syscalls.h>
 #include <linux/time.h>
+#include <linux/hrtimer.h>
 
 #include <asm/uaccess.h>
 
-int do_getitimer(int which, struct itimerval *value)
+/*
+ * Time left on an ITIMER_REAL timer.  Racy, but better than returning 0
+ * while the timer is still pending.
+ */
+static struct timeval itimer_get_remtime(struct hrtimer *timer)
 {
-	register unsigned long val;
+	ktime_t rem = hrtimer_get_remaining(timer);
+
+	if (hrtimer_active(timer)) {
+		if (rem.tv64 <= 0)
+			rem.tv64 = NSEC_PER_USEC;
+	} else
+		rem.tv64 = 0;
+
+	return ktime_to_timeval(rem);
+}
 
+int do_getitimer(int which, struct itimerval *value)
+{
 	switch (which) {
 	case ITIMER_REAL:
-		val = 0;
-		/* 
-		 * FIXME! This needs to be atomic, in case the kernel timer happens!
-		 */
-		if (timer_pending(&current->real_timer)) {
-			val = current->real_timer.expires - jiffies;
-
-			/* look out for negative/zero itimer.. */
-			if ((long) val <= 0)
-				val = 1;
-		}
-		jiffies_to_timeval(val, &value->it_value);
-		jiffies_to_timeval(current->it_real_incr, &value->it_interval);
+		value->it_value = itimer_get_remtime(&current->real_timer);
+		value->it_interval = ktime_to_timeval(current->it_real_incr);
 		break;
 	case ITIMER_VIRTUAL:
 		cputime_to_timeval(current->it_virt_value, &value->it_value);
@@ -63,24 +68,27 @@ asmlinkage long sys_getitimer(int which, struct itimerval __user *value)
 	return error;
 }
 
-void it_real_fn(unsigned long __data)
+/*
+ * The timer is automagically restarted, when interval != 0
+ */
+int it_real_fn(struct hrtimer *timer)
 {
-	struct task_struct * p = (struct task_struct *) __data;
-	unsigned long interval;
+	struct task_struct *p =
+		container_of(timer, struct task_struct, real_timer);
 
 	send_group_sig_info(SIGALRM, SEND_SIG_PRIV, p);
-	interval = p->it_real_incr;
-	if (interval) {
-		if (interval > (unsigned long) LONG_MAX)
-			interval = LONG_MAX;
-		p->real_timer.expires = jiffies + interval;
-		add_timer(&p->real_timer);
-	}
+
+	if (!p->it_real_incr.tv64)
+		return HRTIMER_NORESTART;
+
+	hrtimer_forward(timer, hrtimer_cb_get_time(timer), p->it_real_incr);
+	return HRTIMER_RESTART;
 }
 
 int do_setitimer(int which, struct itimerval *value, struct itimerval *ovalue)
 {
-	unsigned long expire;
+	struct hrtimer *timer;
+	ktime_t expires;
 	cputime_t cputime;
 	int k;
 
@@ -88,17 +96,13 @@ int do_setitimer(int which, struct itimerval *value, struct itimerval *ovalue)
 		return k;
 	switch (which) {
 		case ITIMER_REAL:
-			del_timer_sync(&current->real_timer);
-			expire = timeval_to_jiffies(&value->it_value);
-			current->it_real_value = expire;
+			timer = &current->real_timer;
+			hrtimer_cancel(timer);
 			current->it_real_incr =
-				timeval_to_jiffies(&value->it_interval);
-			if (!expire)
-				break;
-			if (expire > (unsigned long) LONG_MAX)
-				expire = LONG_MAX;
-			current->real_timer.expires = jiffies + expire;
-			add_timer(&current->real_timer);
+				timeval_to_ktime(value->it_interval);
+			expires = timeval_to_ktime(value->it_value);
+			if (expires.tv64 != 0)
+				hrtimer_start(timer, expires, HRTIMER_REL);
 			break;
 		case ITIMER_VIRTUAL:
 			cputime = timeval_to_cputime(&value->it_value);
@@ -16,6 +16,8 @@
  *		by Davide Libenzi, preemptible kernel bits by Robert Love.
  *  2003-09-03	Interactivity tuning by Con Kolivas.
  *  2004-04-02	Scheduler domains code by Nick Piggin
+ *  2005-06-20	Pluggable scheduling classes and the fair class, see
+ *		kernel/sched_fair.c
  */
 
 #include <linux/mm.h>
@@ -45,6 +47,9 @@
 #include <linux/seq_file.h>
 #include <linux/syscalls.h>
 #include <linux/times.h>
+#include <linux/nodemask.h>
+#include <linux/mempolicy.h>
+#include <linux/delayacct.h>
 #include <asm/tlb.h>
 
 #include <asm/unistd.h>
@@ -149,9 +154,6 @@
 	(JIFFIES_TO_NS(MAX_SLEEP_AVG * \
 		(MAX_BONUS / 2 + DELTA((p)) + 1) / MAX_BONUS - 1))
 
-#define TASK_PREEMPTS_CURR(p, rq) \
-	((p)->prio < (rq)->curr->prio)
-
 /*
  * task_timeslice() scales user-nice values [ -20 ... 0 ... 19 ]
  * to time slice values: [800ms ... 100ms ... 5ms]
@@ -188,6 +190,27 @@ struct prio_array {
 	struct list_head queue[MAX_PRIO];
 };
 
+/*
+ * A timeline of the fair scheduling class: the runqueue's own and, with
+ * CONFIG_FAIR_USER_SCHED, one per user and cpu.  See kernel/sched_fair.c.
+ */
+struct fair_rq {
+	struct rb_root timeline;
+	struct rb_node *leftmost;
+	unsigned long nr_running, load;
+	unsigned long long min_vruntime;
+	/* tasks on throttled timelines, on the runqueue's own: */
+	unsigned long nr_throttled;
+#ifdef CONFIG_FAIR_USER_SCHED
+	struct fair_group *group;	/* NULL for the runqueue's own */
+	struct sched_entity *se;	/* the group's entity on the runqueue */
+	long long runtime_remaining;	/* of the group's bandwidth quota */
+	int throttled;
+	/* throttled timelines, on the runqueue's own: */
+	struct list_head throttled_list;
+#endif
+};
+
 /*
  * This is the main, per-CPU runqueue data structure.
  *
@@ -224,6 +247,8 @@ struct runqueue {
 	int best_expired_prio;
 	atomic_t nr_iowait;
 
+	struct fair_rq fair;
+
 #ifdef CONFIG_SMP
 	struct sched_domain *sd;
 
@@ -288,6 +313,57 @@ static DEFINE_PER_CPU(struct runqueue, runqueues);
 #define task_rq(p)		cpu_rq(task_cpu(p))
 #define cpu_curr(cpu)		(cpu_rq(cpu)->curr)
 
+/*
+ * A scheduling class decides in which order the tasks of a runqueue run
+ * and for how long.  The prio_array based O(1) class is the default; the
+ * fair class of kernel/sched_fair.c is selected with "cpusched=fair" on
+ * the kernel command line.  Both keep the RT tasks on the prio arrays.
+ *
+ * The methods are called with the runqueue locked, except task_fork(),
+ * task_exit() and task_tick(), which do their own locking.  task_wakeup(),
+ * task_exit(), task_migrate() and rq_offline() may be NULL.
+ */
+struct sched_class {
+	const char *name;
+
+	/* put @p on @rq, or take it off (also to requeue it): */
+	void (*enqueue_task)(task_t *p, runqueue_t *rq);
+	void (*dequeue_task)(task_t *p, runqueue_t *rq);
+	/* @p wakes up at @now (@rq's clock), it is enqueued next: */
+	void (*task_wakeup)(task_t *p, runqueue_t *rq, unsigned long long now);
+	/* enqueue a new task, to run before its parent if @child_first: */
+	void (*task_new)(task_t *p, runqueue_t *rq, int child_first);
+	void (*task_fork)(task_t *p);
+	void (*task_exit)(task_t *p);
+	/* @p, not queued, moves from task_cpu(@p) to @cpu: */
+	void (*task_migrate)(task_t *p, int cpu);
+
+	task_t *(*pick_next_task)(runqueue_t *rq, unsigned long long now);
+	void (*put_prev_task)(task_t *prev, runqueue_t *rq,
+			      unsigned long long now);
+	void (*task_tick)(task_t *p, runqueue_t *rq);
+	void (*yield_task)(task_t *p, runqueue_t *rq);
+	/* should @p, just queued on @rq, preempt the running task? */
+	int (*preempts_curr)(task_t *p, runqueue_t *rq);
+	/* priority bonus of a SCHED_NORMAL task, see normal_prio(): */
+	int (*prio_bonus)(task_t *p);
+#ifdef CONFIG_SMP
+	int (*move_tasks)(runqueue_t *this_rq, int this_cpu,
+			  runqueue_t *busiest, unsigned long max_nr_move,
+			  struct sched_domain *sd, enum idle_type idle);
+#endif
+#ifdef CONFIG_HOTPLUG_CPU
+	/* the cpu of @rq is dead, make all its tasks pickable: */
+	void (*rq_offline)(runqueue_t *rq);
+#endif
+};
+
+static struct sched_class o1_sched_class, fair_sched_class;
+static struct sched_class *sched_class = &o1_sched_class;
+
+#define TASK_PREEMPTS_CURR(p, rq) \
+	(sched_class->preempts_curr((p), (rq)))
+
 /*
  * Default context-switch locking:
  */
@@ -454,7 +530,7 @@ static int cpu_and_siblings_are_idle(int cpu)
 #define cpu_and_siblings_are_idle(A) idle_cpu(A)
 #endif
 
-#ifdef CONFIG_SCHEDSTATS
+#if defined(CONFIG_SCHEDSTATS) || defined(CONFIG_TASK_DELAY_ACCT)
 /*
  * Called when a process is dequeued from the active array and given
  * the cpu.  We should note that with the exception of interactive
@@ -483,7 +559,9 @@ static inline void sched_info_dequeued(task_t *t)
 static inline void sched_info_arrive(task_t *t)
 {
 	unsigned long now = jiffies, diff = 0;
+#ifdef CONFIG_SCHEDSTATS
 	struct runqueue *rq = task_rq(t);
+#endif
 
 	if (t->sched_info.last_queued)
 		diff = now - t->sched_info.last_queued;
@@ -492,11 +570,13 @@ static inline void sched_info_arrive(task_t *t)
 	t->sched_info.last_arrival = now;
 	t->sched_info.pcnt++;
 
+#ifdef CONFIG_SCHEDSTATS
 	if (!rq)
 		return;
 
 	rq->rq_sched_info.run_delay += diff;
 	rq->rq_sched_info.pcnt++;
+#endif
 }
 
 /*
@@ -526,13 +606,14 @@ static inline void sched_info_queued(task_t *t)
  */
 static inline void sched_info_depart(task_t *t)
 {
-	struct runqueue *rq = task_rq(t);
 	unsigned long diff = jiffies - t->sched_info.last_arrival;
 
 	t->sched_info.cpu_time += diff;
 
-	if (rq)
-		rq->rq_sched_info.cpu_time += diff;
+#ifdef CONFIG_SCHEDSTATS
+	if (task_rq(t))
+		task_rq(t)->rq_sched_info.cpu_time += diff;
+#endif
 }
 
 /*
@@ -558,7 +639,7 @@ static inline void sched_info_switch(task_t *prev, task_t *next)
 #else
 #define sched_info_queued(t)		do { } while (0)
 #define sched_info_switch(t, next)	do { } while (0)
-#endif /* CONFIG_SCHEDSTATS */
+#endif /* CONFIG_SCHEDSTATS || CONFIG_TASK_DELAY_ACCT */
 
 /*
  * Adding/removing a task to/from a priority array:
@@ -611,14 +692,14 @@ static inline void enqueue_task_head(struct task_struct *p, prio_array_t *array)
  *
  * Both properties are important to certain workloads.
  */
-static int effective_prio(task_t *p)
+static int normal_prio(task_t *p)
 {
 	int bonus, prio;
 
-	if (rt_task(p))
-		return p->prio;
+	if (p->policy != SCHED_NORMAL)
+		return MAX_USER_RT_PRIO-1 - p->rt_priority;
 
-	bonus = CURRENT_BONUS(p) - MAX_BONUS / 2;
+	bonus = sched_class->prio_bonus(p);
 
 	prio = p->static_prio - bonus;
 	if (prio < MAX_RT_PRIO)
@@ -628,12 +709,36 @@ static int effective_prio(task_t *p)
 	return prio;
 }
 
+/*
+ * A task holding a PI futex runs at least at the priority of the
+ * highest priority task waiting for it (p->pi_prio).
+ */
+static int effective_prio(task_t *p)
+{
+	p->normal_prio = normal_prio(p);
+	if (unlikely(p->pi_prio < p->normal_prio))
+		return p->pi_prio;
+	return p->normal_prio;
+}
+
 /*
  * __activate_task - move a task to the runqueue.
  */
 static inline void __activate_task(task_t *p, runqueue_t *rq)
 {
-	enqueue_task(p, rq->active);
+	sched_class->enqueue_task(p, rq);
+	p->on_rq = 1;
+	rq->nr_running++;
+}
+
+/*
+ * __activate_new_task - move a newly forked task to the runqueue.
+ */
+static inline void __activate_new_task(task_t *p, runqueue_t *rq,
+				       int child_first)
+{
+	sched_class->task_new(p, rq, child_first);
+	p->on_rq = 1;
 	rq->nr_running++;
 }
 
@@ -643,6 +748,7 @@ static inline void __activate_task(task_t *p, runqueue_t *rq)
 static inline void __activate_idle_task(task_t *p, runqueue_t *rq)
 {
 	enqueue_task_head(p, rq->active);
+	p->on_rq = 1;
 	rq->nr_running++;
 }
 
@@ -708,25 +814,10 @@ static void recalc_task_prio(task_t *p, unsigned long long now)
 }
 
 /*
- * activate_task - move a task to the runqueue and do priority recalculation
- *
- * Update all the scheduling statistics stuff. (sleep average
- * calculation, priority modifiers, etc.)
+ * The O(1) class: do the priority recalculation of a waking task.
  */
-static void activate_task(task_t *p, runqueue_t *rq, int local)
+static void o1_task_wakeup(task_t *p, runqueue_t *rq, unsigned long long now)
 {
-	unsigned long long now;
-
-	now = sched_clock();
-#ifdef CONFIG_SMP
-	if (!local) {
-		/* Compensate for drifting sched_clock */
-		runqueue_t *this_rq = this_rq();
-		now = (now - this_rq->timestamp_last_tick)
-			+ rq->timestamp_last_tick;
-	}
-#endif
-
 	recalc_task_prio(p, now);
 
 	/*
@@ -751,6 +842,30 @@ static void activate_task(task_t *p, runqueue_t *rq, int local)
 			p->activated = 1;
 		}
 	}
+}
+
+/*
+ * activate_task - move a task to the runqueue and do priority recalculation
+ *
+ * Update all the scheduling statistics stuff. (sleep average
+ * calculation, priority modifiers, etc.)
+ */
+static void activate_task(task_t *p, runqueue_t *rq, int local)
+{
+	unsigned long long now;
+
+	now = sched_clock();
+#ifdef CONFIG_SMP
+	if (!local) {
+		/* Compensate for drifting sched_clock */
+		runqueue_t *this_rq = this_rq();
+		now = (now - this_rq->timestamp_last_tick)
+			+ rq->timestamp_last_tick;
+	}
+#endif
+
+	if (sched_class->task_wakeup)
+		sched_class->task_wakeup(p, rq, now);
 	p->timestamp = now;
 
 	__activate_task(p, rq);
@@ -762,8 +877,43 @@ static void activate_task(task_t *p, runqueue_t *rq, int local)
 static void deactivate_task(struct task_struct *p, runqueue_t *rq)
 {
 	rq->nr_running--;
-	dequeue_task(p, p->array);
+	sched_class->dequeue_task(p, rq);
 	p->array = NULL;
+	p->on_rq = 0;
+}
+
+/*
+ * The O(1) class keeps a requeued task on the array it was on.
+ */
+static void o1_enqueue_task(task_t *p, runqueue_t *rq)
+{
+	enqueue_task(p, p->array ? p->array : rq->active);
+}
+
+static void o1_dequeue_task(task_t *p, runqueue_t *rq)
+{
+	dequeue_task(p, p->array);
+}
+
+static int o1_prio_bonus(task_t *p)
+{
+	return CURRENT_BONUS(p) - MAX_BONUS / 2;
+}
+
+static int o1_preempts_curr(task_t *p, runqueue_t *rq)
+{
+	return p->prio < rq->curr->prio;
+}
+
+/*
+ * Let the scheduling class know that @p, which is not queued, moves
+ * to the runqueue of @cpu.
+ */
+static inline void move_task_cpu(task_t *p, int cpu)
+{
+	if (sched_class->task_migrate)
+		sched_class->task_migrate(p, cpu);
+	set_task_cpu(p, cpu);
 }
 
 /*
@@ -836,8 +986,8 @@ static int migrate_task(task_t *p, int dest_cpu, migration_req_t *req)
 	 * If the task is not on a runqueue (and not running), then
 	 * it is sufficient to simply update the task's cpu field.
 	 */
-	if (!p->array && !task_running(rq, p)) {
-		set_task_cpu(p, dest_cpu);
+	if (!p->on_rq && !task_running(rq, p)) {
+		move_task_cpu(p, dest_cpu);
 		return 0;
 	}
 
@@ -867,7 +1017,7 @@ void wait_task_inactive(task_t * p)
 repeat:
 	rq = task_rq_lock(p, &flags);
 	/* Must be off runqueue entirely, not preempted. */
-	if (unlikely(p->array || task_running(rq, p))) {
+	if (unlikely(p->on_rq || task_running(rq, p))) {
 		/* If it's preempted, we yield.  It could be a while. */
 		preempted = !task_running(rq, p);
 		task_rq_unlock(rq, &flags);
@@ -903,6 +1053,16 @@ void kick_process(task_t *p)
 	preempt_enable();
 }
 
+/*
+ * The tasks of a runqueue that the load balancer can move: the ones on
+ * throttled timelines of the fair class cannot run before the next
+ * bandwidth period, wherever they are.
+ */
+static inline unsigned long balance_nr_running(runqueue_t *rq)
+{
+	return rq->nr_running - rq->fair.nr_throttled;
+}
+
 /*
  * Return a low guess at the load of a migration-source cpu.
  *
@@ -912,7 +1072,7 @@ void kick_process(task_t *p)
 static inline unsigned long source_load(int cpu)
 {
 	runqueue_t *rq = cpu_rq(cpu);
-	unsigned long load_now = rq->nr_running * SCHED_LOAD_SCALE;
+	unsigned long load_now = balance_nr_running(rq) * SCHED_LOAD_SCALE;
 
 	return min(rq->cpu_load, load_now);
 }
@@ -923,13 +1083,144 @@ static inline unsigned long source_load(int cpu)
 static inline unsigned long target_load(int cpu)
 {
 	runqueue_t *rq = cpu_rq(cpu);
-	unsigned long load_now = rq->nr_running * SCHED_LOAD_SCALE;
+	unsigned long load_now = balance_nr_running(rq) * SCHED_LOAD_SCALE;
 
 	return max(rq->cpu_load, load_now);
 }
 
 #endif
 
+#ifdef CONFIG_NUMA
+/*
+ * NUMA placement.  Every task counts the page faults it takes on the pages
+ * of each node (task_numa_fault()).  Once per NUMA_PLACEMENT_PERIOD the node
+ * that got most of the recent faults becomes the preferred node of the
+ * task: that is where its memory is.  Wakeups and the load balancer keep a
+ * task on its preferred node, and the balancer does not hold it back as
+ * cache hot when moving it would bring it back there.
+ *
+ * With /proc/sys/kernel/numa_migrate set the memory follows the task when
+ * the task keeps running on another node anyway: keventd moves the private
+ * anonymous pages of a single threaded process to the node it runs on,
+ * NUMA_MIGRATE_PTES page table entries every NUMA_MIGRATE_DELAY.
+ */
+#define NUMA_PLACEMENT_PERIOD		HZ
+#define NUMA_PLACEMENT_MIN_FAULTS	64
+#define NUMA_MIGRATE_PERIODS		2
+#define NUMA_MIGRATE_PTES		16384
+#define NUMA_MIGRATE_DELAY		(HZ / 10)
+
+int sysctl_numa_migrate;
+
+/*
+ * Would moving p to this_cpu take it away from its memory?
+ */
+static inline int task_numa_stays(task_t *p, int this_cpu)
+{
+	int nid = p->numa_preferred_nid;
+
+	return nid >= 0 && nid == cpu_to_node(task_cpu(p)) &&
+		nid != cpu_to_node(this_cpu);
+}
+
+/*
+ * Would moving p to this_cpu bring it back to its memory?
+ */
+static inline int task_numa_returns(task_t *p, int this_cpu)
+{
+	int nid = p->numa_preferred_nid;
+
+	return nid >= 0 && nid != cpu_to_node(task_cpu(p)) &&
+		nid == cpu_to_node(this_cpu);
+}
+
+static void numa_migrate_work(void *data)
+{
+	struct mm_struct *mm = data;
+
+	if (migrate_mm_to_node(mm, mm->numa_migrate_nid, &mm->numa_scan_addr,
+			       NUMA_MIGRATE_PTES) &&
+	    atomic_read(&mm->mm_users) > 1 &&
+	    schedule_delayed_work(&mm->numa_work, NUMA_MIGRATE_DELAY))
+		return;
+	mmput(mm);
+}
+
+void mm_init_numa(struct mm_struct *mm)
+{
+	INIT_WORK(&mm->numa_work, numa_migrate_work, mm);
+}
+
+/*
+ * Called from the tick for the running task.
+ */
+static void task_numa_placement(task_t *p, int cpu)
+{
+	struct mm_struct *mm = p->mm;
+	unsigned long faults, total = 0, max = 0;
+	int nid, max_nid = -1;
+
+	if (!mm || num_online_nodes() == 1 ||
+	    time_before(jiffies, p->numa_placement_stamp +
+				 NUMA_PLACEMENT_PERIOD))
+		return;
+	p->numa_placement_stamp = jiffies;
+
+	for_each_online_node(nid) {
+		faults = p->numa_faults[nid];
+		total += faults;
+		if (faults > max) {
+			max = faults;
+			max_nid = nid;
+		}
+		p->numa_faults[nid] = faults / 2;
+	}
+	/*
+	 * A task which does not fault keeps its preference: its memory is
+	 * still where it was.
+	 */
+	if (total >= NUMA_PLACEMENT_MIN_FAULTS)
+		p->numa_preferred_nid = 2 * max > total ? max_nid : -1;
+
+	nid = cpu_to_node(cpu);
+	if (p->numa_preferred_nid < 0 || p->numa_preferred_nid == nid) {
+		p->numa_remote_periods = 0;
+		return;
+	}
+	if (!sysctl_numa_migrate ||
+	    ++p->numa_remote_periods < NUMA_MIGRATE_PERIODS)
+		return;
+	p->numa_remote_periods = 0;
+	if (p->mempolicy || atomic_read(&mm->mm_users) != 1)
+		return;
+
+	/* the task has moved for good, its memory follows it */
+	p->numa_faults[nid] += p->numa_faults[p->numa_preferred_nid];
+	p->numa_faults[p->numa_preferred_nid] = 0;
+	p->numa_preferred_nid = nid;
+
+	atomic_inc(&mm->mm_users);
+	mm->numa_migrate_nid = nid;
+	mm->numa_scan_addr = 0;
+	if (!schedule_work(&mm->numa_work))
+		atomic_dec(&mm->mm_users);
+}
+#else
+static inline int task_numa_stays(task_t *p, int this_cpu)
+{
+	return 0;
+}
+
+static inline int task_numa_returns(task_t *p, int this_cpu)
+{
+	return 0;
+}
+
+static inline void task_numa_placement(task_t *p, int cpu)
+{
+}
+#endif
+
 /*
  * wake_idle() will wake a task on an idle cpu if task->cpu is
  * not idle and an idle cpu is available.  The span of cpus to
@@ -1000,7 +1291,7 @@ static int try_to_wake_up(task_t * p, unsigned int state, int sync)
 	if (!(old_state & state))
 		goto out;
 
-	if (p->array)
+	if (p->on_rq)
 		goto out_running;
 
 	cpu = task_cpu(p);
@@ -1029,6 +1320,10 @@ static int try_to_wake_up(task_t * p, unsigned int state, int sync)
 	if (load < SCHED_LOAD_SCALE/2 && this_load > SCHED_LOAD_SCALE/2)
 		goto out_set_cpu;
 
+	/* Nor away from the node its memory is on */
+	if (task_numa_stays(p, this_cpu))
+		goto out_set_cpu;
+
 	new_cpu = this_cpu; /* Wake to this CPU if we can */
 
 	/*
@@ -1072,14 +1367,14 @@ out_set_cpu:
 	new_cpu = wake_idle(new_cpu, p);
 	if (new_cpu != cpu) {
 		schedstat_inc(rq, ttwu_moved);
-		set_task_cpu(p, new_cpu);
+		move_task_cpu(p, new_cpu);
 		task_rq_unlock(rq, &flags);
 		/* might preempt at this point */
 		rq = task_rq_lock(p, &flags);
 		old_state = p->state;
 		if (!(old_state & state))
 			goto out;
-		if (p->array)
+		if (p->on_rq)
 			goto out_running;
 
 		this_cpu = smp_processor_id();
@@ -1153,10 +1448,19 @@ void fastcall sched_fork(task_t *p)
 	p->state = TASK_RUNNING;
 	INIT_LIST_HEAD(&p->run_list);
 	p->array = NULL;
+	p->on_rq = 0;
+	/* PI boosts are not inherited */
+	p->pi_prio = MAX_PRIO;
+	p->prio = current->normal_prio;
 	spin_lock_init(&p->switch_lock);
-#ifdef CONFIG_SCHEDSTATS
+#if defined(CONFIG_SCHEDSTATS) || defined(CONFIG_TASK_DELAY_ACCT)
 	memset(&p->sched_info, 0, sizeof(p->sched_info));
 #endif
+#ifdef CONFIG_NUMA
+	/* the child starts out with the memory of the parent */
+	p->numa_remote_periods = 0;
+	p->numa_placement_stamp = jiffies;
+#endif
 #ifdef CONFIG_PREEMPT
 	/*
 	 * During context-switch we hold precisely one spinlock, which
@@ -1166,11 +1470,17 @@ void fastcall sched_fork(task_t *p)
 	 */
 	p->thread_info->preempt_count = 1;
 #endif
-	/*
-	 * Share the timeslice between parent and child, thus the
-	 * total amount of pending timeslices in the system doesn't change,
-	 * resulting in more scheduling fairness.
-	 */
+	p->timestamp = sched_clock();
+	sched_class->task_fork(p);
+}
+
+/*
+ * The O(1) class: share the timeslice between parent and child, thus
+ * the total amount of pending timeslices in the system doesn't change,
+ * resulting in more scheduling fairness.
+ */
+static void o1_task_fork(task_t *p)
+{
 	local_irq_disable();
 	p->time_slice = (current->time_slice + 1) >> 1;
 	/*
@@ -1179,7 +1489,6 @@ void fastcall sched_fork(task_t *p)
 	 */
 	p->first_time_slice = 1;
 	current->time_slice >>= 1;
-	p->timestamp = sched_clock();
 	if (unlikely(!current->time_slice)) {
 		/*
 		 * This case is rare, it happens when the parent has only
@@ -1227,25 +1536,12 @@ void fastcall wake_up_new_task(task_t * p, unsigned long clone_flags)
 	p->prio = effective_prio(p);
 
 	if (likely(cpu == this_cpu)) {
-		if (!(clone_flags & CLONE_VM)) {
-			/*
-			 * The VM isn't cloned, so we're in a good position to
-			 * do child-runs-first in anticipation of an exec. This
-			 * usually avoids a lot of COW overhead.
-			 */
-			if (unlikely(!current->array))
-				__activate_task(p, rq);
-			else {
-				p->prio = current->prio;
-				list_add_tail(&p->run_list, &current->run_list);
-				p->array = current->array;
-				p->array->nr_active++;
-				rq->nr_running++;
-			}
-			set_need_resched();
-		} else
-			/* Run child last */
-			__activate_task(p, rq);
+		/*
+		 * If the VM isn't cloned, we're in a good position to
+		 * do child-runs-first in anticipation of an exec. This
+		 * usually avoids a lot of COW overhead.
+		 */
+		__activate_new_task(p, rq, !(clone_flags & CLONE_VM));
 		/*
 		 * We skip the following code due to cpu == this_cpu
 	 	 *
@@ -1262,7 +1558,7 @@ void fastcall wake_up_new_task(task_t * p, unsigned long clone_flags)
 		 */
 		p->timestamp = (p->timestamp - this_rq->timestamp_last_tick)
 					+ rq->timestamp_last_tick;
-		__activate_task(p, rq);
+		__activate_new_task(p, rq, 0);
 		if (TASK_PREEMPTS_CURR(p, rq))
 			resched_task(rq->curr);
 
@@ -1279,6 +1575,29 @@ void fastcall wake_up_new_task(task_t * p, unsigned long clone_flags)
 	task_rq_unlock(this_rq, &flags);
 }
 
+/*
+ * The O(1) class: enqueue a new task, right behind its parent when it
+ * is to run first.
+ */
+static void o1_task_new(task_t *p, runqueue_t *rq, int child_first)
+{
+	if (child_first && current->array) {
+		p->prio = current->prio;
+		list_add_tail(&p->run_list, &current->run_list);
+		p->array = current->array;
+		p->array->nr_active++;
+	} else
+		enqueue_task(p, rq->active);
+	if (child_first)
+		set_need_resched();
+}
+
+void fastcall sched_exit(task_t * p)
+{
+	if (sched_class->task_exit)
+		sched_class->task_exit(p);
+}
+
 /*
  * Potentially available exiting-child timeslices are
  * retrieved here - this way the parent does not get
@@ -1288,7 +1607,7 @@ void fastcall wake_up_new_task(task_t * p, unsigned long clone_flags)
  * artificially, because any timeslice recovered here
  * was given away by the parent in the first place.)
  */
-void fastcall sched_exit(task_t * p)
+static void o1_task_exit(task_t *p)
 {
 	unsigned long flags;
 	runqueue_t *rq;
@@ -1631,7 +1950,7 @@ void pull_task(runqueue_t *src_rq, prio_array_t *src_array, task_t *p,
 {
 	dequeue_task(p, src_array);
 	src_rq->nr_running--;
-	set_task_cpu(p, this_cpu);
+	move_task_cpu(p, this_cpu);
 	this_rq->nr_running++;
 	enqueue_task(p, this_array);
 	p->timestamp = (p->timestamp - src_rq->timestamp_last_tick)
@@ -1662,6 +1981,16 @@ int can_migrate_task(task_t *p, runqueue_t *rq, int this_cpu,
 	if (!cpu_isset(this_cpu, p->cpus_allowed))
 		return 0;
 
+	/*
+	 * Keep a task on the node its memory is on until balancing keeps
+	 * failing, and move it back there even when it is cache hot.
+	 */
+	if (task_numa_stays(p, this_cpu) &&
+			sd->nr_balance_failed <= sd->cache_nice_tries)
+		return 0;
+	if (task_numa_returns(p, this_cpu))
+		return 1;
+
 	/*
 	 * Aggressive migration if:
 	 * 1) the [whole] cpu is idle, or
@@ -1684,9 +2013,20 @@ int can_migrate_task(task_t *p, runqueue_t *rq, int this_cpu,
  *
  * Called with both runqueues locked.
  */
-static int move_tasks(runqueue_t *this_rq, int this_cpu, runqueue_t *busiest,
-		      unsigned long max_nr_move, struct sched_domain *sd,
-		      enum idle_type idle)
+static inline int move_tasks(runqueue_t *this_rq, int this_cpu,
+			     runqueue_t *busiest, unsigned long max_nr_move,
+			     struct sched_domain *sd, enum idle_type idle)
+{
+	return sched_class->move_tasks(this_rq, this_cpu, busiest,
+				       max_nr_move, sd, idle);
+}
+
+/*
+ * move_array_tasks - move_tasks() for the tasks on the prio arrays.
+ */
+static int move_array_tasks(runqueue_t *this_rq, int this_cpu,
+			    runqueue_t *busiest, unsigned long max_nr_move,
+			    struct sched_domain *sd, enum idle_type idle)
 {
 	prio_array_t *array, *dst_array;
 	struct list_head *head, *curr;
@@ -1964,7 +2304,7 @@ static int load_balance(int this_cpu, runqueue_t *this_rq,
 	schedstat_add(sd, lb_imbalance[idle], imbalance);
 
 	nr_moved = 0;
-	if (busiest->nr_running > 1) {
+	if (balance_nr_running(busiest) > 1) {
 		/*
 		 * Attempt to move tasks. If find_busiest_group has found
 		 * an imbalance but busiest->nr_running <= 1, the group is
@@ -2118,7 +2458,7 @@ static void active_load_balance(runqueue_t *busiest_rq, int busiest_cpu)
 		cpu_group = sd->groups;
 		do {
 			for_each_cpu_mask(cpu, cpu_group->cpumask) {
-				if (busiest_rq->nr_running <= 1)
+				if (balance_nr_running(busiest_rq) <= 1)
 					/* no more tasks left to move */
 					return;
 				if (cpu_isset(cpu, visited_cpus))
@@ -2172,7 +2512,7 @@ static void rebalance_tick(int this_cpu, runqueue_t *this_rq,
 
 	/* Update our load */
 	old_load = this_rq->cpu_load;
-	this_load = this_rq->nr_running * SCHED_LOAD_SCALE;
+	this_load = balance_nr_running(this_rq) * SCHED_LOAD_SCALE;
 	/*
 	 * Round up the averaging division if load is increasing. This
 	 * prevents us from getting stuck on 9 if the load is 10, for
@@ -2402,6 +2742,22 @@ void account_steal_time(struct task_struct *p, cputime_t steal)
 		cpustat->steal = cputime64_add(cpustat->steal, tmp);
 }
 
+/*
+ * RR tasks need a special form of timeslice management.
+ * FIFO tasks have no timeslices.
+ */
+static void task_tick_rt(task_t *p, runqueue_t *rq)
+{
+	if ((p->policy == SCHED_RR) && !--p->time_slice) {
+		p->time_slice = task_timeslice(p);
+		p->first_time_slice = 0;
+		set_tsk_need_resched(p);
+
+		/* put it at the end of the queue: */
+		requeue_task(p, rq->active);
+	}
+}
+
 /*
  * This function gets called by the timer code, with HZ frequency.
  * We call it with interrupts disabled.
@@ -2424,10 +2780,18 @@ void scheduler_tick(void)
 		return;
 	}
 
+	sched_class->task_tick(p, rq);
+	task_numa_placement(p, cpu);
+out:
+	rebalance_tick(cpu, rq, NOT_IDLE);
+}
+
+static void o1_task_tick(task_t *p, runqueue_t *rq)
+{
 	/* Task might have expired already, but not scheduled off yet */
 	if (p->array != rq->active) {
 		set_tsk_need_resched(p);
-		goto out;
+		return;
 	}
 	spin_lock(&rq->lock);
 	/*
@@ -2438,18 +2802,7 @@ void scheduler_tick(void)
 	 * to use up their timeslices at their highest priority levels.
 	 */
 	if (rt_task(p)) {
-		/*
-		 * RR tasks need a special form of timeslice management.
-		 * FIFO tasks have no timeslices.
-		 */
-		if ((p->policy == SCHED_RR) && !--p->time_slice) {
-			p->time_slice = task_timeslice(p);
-			p->first_time_slice = 0;
-			set_tsk_need_resched(p);
-
-			/* put it at the end of the queue: */
-			requeue_task(p, rq->active);
-		}
+		task_tick_rt(p, rq);
 		goto out_unlock;
 	}
 	if (!--p->time_slice) {
@@ -2495,8 +2848,6 @@ void scheduler_tick(void)
 	}
 out_unlock:
 	spin_unlock(&rq->lock);
-out:
-	rebalance_tick(cpu, rq, NOT_IDLE);
 }
 
 #ifdef CONFIG_SCHED_SMT
@@ -2555,6 +2906,9 @@ static inline int dependent_sleeper(int this_cpu, runqueue_t *this_rq)
 
 	if (!(sd->flags & SD_SHARE_CPUPOWER))
 		return 0;
+	/* The sibling heuristics compare timeslices, which only O(1) has */
+	if (sched_class != &o1_sched_class)
+		return 0;
 
 	/*
 	 * The same locking rules and details apply as for
@@ -2664,11 +3018,8 @@ asmlinkage void __sched schedule(void)
 	long *switch_count;
 	task_t *prev, *next;
 	runqueue_t *rq;
-	prio_array_t *array;
-	struct list_head *queue;
 	unsigned long long now;
-	unsigned long run_time;
-	int cpu, idx;
+	int cpu;
 
 	/*
 	 * Test if we are atomic.  Since do_exit() needs to call into
@@ -2703,16 +3054,6 @@ need_resched_nonpreemptible:
 
 	schedstat_inc(rq, sched_cnt);
 	now = sched_clock();
-	if (likely(now - prev->timestamp < NS_MAX_SLEEP_AVG))
-		run_time = now - prev->timestamp;
-	else
-		run_time = NS_MAX_SLEEP_AVG;
-
-	/*
-	 * Tasks charged proportionately less run_time at high sleep_avg to
-	 * delay them losing their interactive status
-	 */
-	run_time /= (CURRENT_BONUS(prev) ? : 1);
 
 	spin_lock_irq(&rq->lock);
 
@@ -2731,6 +3072,7 @@ need_resched_nonpreemptible:
 			deactivate_task(prev, rq);
 		}
 	}
+	sched_class->put_prev_task(prev, rq, now);
 
 	cpu = smp_processor_id();
 	if (unlikely(!rq->nr_running)) {
@@ -2762,6 +3104,48 @@ go_idle:
 			goto go_idle;
 	}
 
+	next = sched_class->pick_next_task(rq, now);
+switch_tasks:
+	if (next == rq->idle)
+		schedstat_inc(rq, sched_goidle);
+	prefetch(next);
+	clear_tsk_need_resched(prev);
+	rcu_qsctr_inc(task_cpu(prev));
+
+	prev->timestamp = prev->last_ran = now;
+
+	sched_info_switch(prev, next);
+	if (likely(prev != next)) {
+		next->timestamp = now;
+		rq->nr_switches++;
+		rq->curr = next;
+		++*switch_count;
+
+		prepare_arch_switch(rq, next);
+		prev = context_switch(rq, prev, next);
+		barrier();
+
+		finish_task_switch(prev);
+	} else
+		spin_unlock_irq(&rq->lock);
+
+	prev = current;
+	if (unlikely(reacquire_kernel_lock(prev) < 0))
+		goto need_resched_nonpreemptible;
+	preempt_enable_no_resched();
+	if (unlikely(test_thread_flag(TIF_NEED_RESCHED)))
+		goto need_resched;
+}
+
+EXPORT_SYMBOL(schedule);
+
+static task_t *o1_pick_next_task(runqueue_t *rq, unsigned long long now)
+{
+	prio_array_t *array;
+	struct list_head *queue;
+	task_t *next;
+	int idx;
+
 	array = rq->active;
 	if (unlikely(!array->nr_active)) {
 		/*
@@ -2792,43 +3176,30 @@ go_idle:
 		enqueue_task(next, array);
 	}
 	next->activated = 0;
-switch_tasks:
-	if (next == rq->idle)
-		schedstat_inc(rq, sched_goidle);
-	prefetch(next);
-	clear_tsk_need_resched(prev);
-	rcu_qsctr_inc(task_cpu(prev));
-
-	prev->sleep_avg -= run_time;
-	if ((long)prev->sleep_avg <= 0)
-		prev->sleep_avg = 0;
-	prev->timestamp = prev->last_ran = now;
+	return next;
+}
 
-	sched_info_switch(prev, next);
-	if (likely(prev != next)) {
-		next->timestamp = now;
-		rq->nr_switches++;
-		rq->curr = next;
-		++*switch_count;
+static void o1_put_prev_task(task_t *prev, runqueue_t *rq,
+			     unsigned long long now)
+{
+	unsigned long run_time;
 
-		prepare_arch_switch(rq, next);
-		prev = context_switch(rq, prev, next);
-		barrier();
+	if (likely(now - prev->timestamp < NS_MAX_SLEEP_AVG))
+		run_time = now - prev->timestamp;
+	else
+		run_time = NS_MAX_SLEEP_AVG;
 
-		finish_task_switch(prev);
-	} else
-		spin_unlock_irq(&rq->lock);
+	/*
+	 * Tasks charged proportionately less run_time at high sleep_avg to
+	 * delay them losing their interactive status
+	 */
+	run_time /= (CURRENT_BONUS(prev) ? : 1);
 
-	prev = current;
-	if (unlikely(reacquire_kernel_lock(prev) < 0))
-		goto need_resched_nonpreemptible;
-	preempt_enable_no_resched();
-	if (unlikely(test_thread_flag(TIF_NEED_RESCHED)))
-		goto need_resched;
+	prev->sleep_avg -= run_time;
+	if ((long)prev->sleep_avg <= 0)
+		prev->sleep_avg = 0;
 }
 
-EXPORT_SYMBOL(schedule);
-
 #ifdef CONFIG_PREEMPT
 /*
  * this is is the entry point to schedule() from in-kernel preemption
@@ -3227,9 +3598,8 @@ EXPORT_SYMBOL(sleep_on_timeout);
 void set_user_nice(task_t *p, long nice)
 {
 	unsigned long flags;
-	prio_array_t *array;
 	runqueue_t *rq;
-	int old_prio, new_prio, delta;
+	int old_prio, delta, queued;
 
 	if (TASK_NICE(p) == nice || nice < -20 || nice > 19)
 		return;
@@ -3244,22 +3614,21 @@ void set_user_nice(task_t *p, long nice)
 	 * it wont have any effect on scheduling until the task is
 	 * not SCHED_NORMAL:
 	 */
-	if (rt_task(p)) {
+	if (p->policy != SCHED_NORMAL) {
 		p->static_prio = NICE_TO_PRIO(nice);
 		goto out_unlock;
 	}
-	array = p->array;
-	if (array)
-		dequeue_task(p, array);
+	queued = p->on_rq;
+	if (queued)
+		sched_class->dequeue_task(p, rq);
 
 	old_prio = p->prio;
-	new_prio = NICE_TO_PRIO(nice);
-	delta = new_prio - old_prio;
 	p->static_prio = NICE_TO_PRIO(nice);
-	p->prio += delta;
+	p->prio = effective_prio(p);
+	delta = p->prio - old_prio;
 
-	if (array) {
-		enqueue_task(p, array);
+	if (queued) {
+		sched_class->enqueue_task(p, rq);
 		/*
 		 * If the task increased its priority or is running and
 		 * lowered its priority, then reschedule its CPU:
@@ -3273,6 +3642,47 @@ out_unlock:
 
 EXPORT_SYMBOL(set_user_nice);
 
+/*
+ * sched_pi_setprio - set the priority boost of a PI futex owner
+ * @p: the task owning the futex.
+ * @prio: the priority of its highest priority waiter, MAX_PRIO for none.
+ *
+ * The task runs at the better of its normal priority and @prio until
+ * the boost is changed again.  A boosted task that had expired its
+ * timeslice is moved back to the active array, so that it can release
+ * the futex before the waiters it is blocking time out.
+ */
+void sched_pi_setprio(task_t *p, int prio)
+{
+	unsigned long flags;
+	runqueue_t *rq;
+	int oldprio, queued;
+
+	rq = task_rq_lock(p, &flags);
+	p->pi_prio = prio;
+	oldprio = p->prio;
+	queued = p->on_rq;
+	if (queued)
+		sched_class->dequeue_task(p, rq);
+	p->prio = effective_prio(p);
+	if (queued) {
+		if (p->prio < oldprio && p->array)
+			p->array = rq->active;
+		sched_class->enqueue_task(p, rq);
+		/*
+		 * Reschedule if we are currently running on this runqueue and
+		 * our priority decreased, or if we are not currently running on
+		 * this runqueue and our priority is higher than the current's
+		 */
+		if (task_running(rq, p)) {
+			if (p->prio > oldprio)
+				resched_task(rq->curr);
+		} else if (TASK_PREEMPTS_CURR(p, rq))
+			resched_task(rq->curr);
+	}
+	task_rq_unlock(rq, &flags);
+}
+
 #ifdef __ARCH_WANT_SYS_NICE
 
 /*
@@ -3380,13 +3790,14 @@ static inline task_t *find_process_by_pid(pid_t pid)
 /* Actually do priority change: must hold rq lock. */
 static void __setscheduler(struct task_struct *p, int policy, int prio)
 {
-	BUG_ON(p->array);
+	BUG_ON(p->on_rq);
 	p->policy = policy;
 	p->rt_priority = prio;
 	if (policy != SCHED_NORMAL)
-		p->prio = MAX_USER_RT_PRIO-1 - p->rt_priority;
+		p->normal_prio = MAX_USER_RT_PRIO-1 - p->rt_priority;
 	else
-		p->prio = p->static_prio;
+		p->normal_prio = p->static_prio;
+	p->prio = min(p->normal_prio, p->pi_prio);
 }
 
 /**
@@ -3399,8 +3810,7 @@ static void __setscheduler(struct task_struct *p, int policy, int prio)
 int sched_setscheduler(struct task_struct *p, int policy, struct sched_param *param)
 {
 	int retval;
-	int oldprio, oldpolicy = -1;
-	prio_array_t *array;
+	int oldprio, oldpolicy = -1, queued;
 	unsigned long flags;
 	runqueue_t *rq;
 
@@ -3442,12 +3852,12 @@ recheck:
 		task_rq_unlock(rq, &flags);
 		goto recheck;
 	}
-	array = p->array;
-	if (array)
+	queued = p->on_rq;
+	if (queued)
 		deactivate_task(p, rq);
 	oldprio = p->prio;
 	__setscheduler(p, policy, param->sched_priority);
-	if (array) {
+	if (queued) {
 		__activate_task(p, rq);
 		/*
 		 * Reschedule if we are currently running on this runqueue and
@@ -3705,31 +4115,22 @@ asmlinkage long sys_sched_getaffinity(pid_t pid, unsigned int len,
 	return sizeof(cpumask_t);
 }
 
-/**
- * sys_sched_yield - yield the current processor to other threads.
+/*
+ * The O(1) class implements yielding by moving the task into the
+ * expired queue.
  *
- * this function yields the current CPU by moving the calling thread
- * to the expired array. If there are no other threads running on this
- * CPU then this function will return.
+ * (special rule: RT tasks will just roundrobin in the active
+ *  array.)
  */
-asmlinkage long sys_sched_yield(void)
+static void o1_yield_task(task_t *p, runqueue_t *rq)
 {
-	runqueue_t *rq = this_rq_lock();
-	prio_array_t *array = current->array;
+	prio_array_t *array = p->array;
 	prio_array_t *target = rq->expired;
 
-	schedstat_inc(rq, yld_cnt);
-	/*
-	 * We implement yielding by moving the task into the expired
-	 * queue.
-	 *
-	 * (special rule: RT tasks will just roundrobin in the active
-	 *  array.)
-	 */
-	if (rt_task(current))
+	if (rt_task(p))
 		target = rq->active;
 
-	if (current->array->nr_active == 1) {
+	if (array->nr_active == 1) {
 		schedstat_inc(rq, yld_act_empty);
 		if (!rq->expired->nr_active)
 			schedstat_inc(rq, yld_both_empty);
@@ -3737,13 +4138,28 @@ asmlinkage long sys_sched_yield(void)
 		schedstat_inc(rq, yld_exp_empty);
 
 	if (array != target) {
-		dequeue_task(current, array);
-		enqueue_task(current, target);
+		dequeue_task(p, array);
+		enqueue_task(p, target);
 	} else
 		/*
 		 * requeue_task is cheaper so perform that if possible.
 		 */
-		requeue_task(current, array);
+		requeue_task(p, array);
+}
+
+/**
+ * sys_sched_yield - yield the current processor to other threads.
+ *
+ * this function yields the current CPU by moving the calling thread
+ * behind the other runnable threads of its runqueue. If there are no
+ * other threads running on this CPU then this function will return.
+ */
+asmlinkage long sys_sched_yield(void)
+{
+	runqueue_t *rq = this_rq_lock();
+
+	schedstat_inc(rq, yld_cnt);
+	sched_class->yield_task(current, rq);
 
 	/*
 	 * Since we are going to call schedule() anyway, there's
@@ -3849,9 +4265,11 @@ void __sched io_schedule(void)
 {
 	struct runqueue *rq = &per_cpu(runqueues, _smp_processor_id());
 
+	delayacct_blkio_start();
 	atomic_inc(&rq->nr_iowait);
 	schedule();
 	atomic_dec(&rq->nr_iowait);
+	delayacct_blkio_end();
 }
 
 EXPORT_SYMBOL(io_schedule);
@@ -3861,9 +4279,11 @@ long __sched io_schedule_timeout(long timeout)
 	struct runqueue *rq = &per_cpu(runqueues, _smp_processor_id());
 	long ret;
 
+	delayacct_blkio_start();
 	atomic_inc(&rq->nr_iowait);
 	ret = schedule_timeout(timeout);
 	atomic_dec(&rq->nr_iowait);
+	delayacct_blkio_end();
 	return ret;
 }
 
@@ -4056,7 +4476,8 @@ void __devinit init_idle(task_t *idle, int cpu)
 
 	idle->sleep_avg = 0;
 	idle->array = NULL;
-	idle->prio = MAX_PRIO;
+	idle->on_rq = 0;
+	idle->prio = idle->normal_prio = MAX_PRIO;
 	idle->state = TASK_RUNNING;
 	set_task_cpu(idle, cpu);
 
@@ -4153,6 +4574,7 @@ EXPORT_SYMBOL_GPL(set_cpus_allowed);
 static void __migrate_task(struct task_struct *p, int src_cpu, int dest_cpu)
 {
 	runqueue_t *rq_dest, *rq_src;
+	int queued;
 
 	if (unlikely(cpu_is_offline(dest_cpu)))
 		return;
@@ -4168,8 +4590,11 @@ static void __migrate_task(struct task_struct *p, int src_cpu, int dest_cpu)
 	if (!cpu_isset(dest_cpu, p->cpus_allowed))
 		goto out;
 
-	set_task_cpu(p, dest_cpu);
-	if (p->array) {
+	queued = p->on_rq;
+	if (queued)
+		deactivate_task(p, rq_src);
+	move_task_cpu(p, dest_cpu);
+	if (queued) {
 		/*
 		 * Sync timestamp with rq_dest's before activating.
 		 * The same thing could be achieved by doing this step
@@ -4178,7 +4603,6 @@ static void __migrate_task(struct task_struct *p, int src_cpu, int dest_cpu)
 		 */
 		p->timestamp = p->timestamp - rq_src->timestamp_last_tick
 				+ rq_dest->timestamp_last_tick;
-		deactivate_task(p, rq_src);
 		activate_task(p, rq_dest, 0);
 		if (TASK_PREEMPTS_CURR(p, rq_dest))
 			resched_task(rq_dest->curr);
@@ -4399,18 +4823,13 @@ static void migrate_dead(unsigned int dead_cpu, task_t *tsk)
 /* release_task() removes task from tasklist, so we won't find dead tasks. */
 static void migrate_dead_tasks(unsigned int dead_cpu)
 {
-	unsigned arr, i;
 	struct runqueue *rq = cpu_rq(dead_cpu);
 
-	for (arr = 0; arr < 2; arr++) {
-		for (i = 0; i < MAX_PRIO; i++) {
-			struct list_head *list = &rq->arrays[arr].queue[i];
-			while (!list_empty(list))
-				migrate_dead(dead_cpu,
-					     list_entry(list->next, task_t,
-							run_list));
-		}
-	}
+	if (sched_class->rq_offline)
+		sched_class->rq_offline(rq);
+	while (rq->nr_running)
+		migrate_dead(dead_cpu,
+			     sched_class->pick_next_task(rq, sched_clock()));
 }
 #endif /* CONFIG_HOTPLUG_CPU */
 
@@ -4949,6 +5368,48 @@ int in_sched_functions(unsigned long addr)
 		&& addr < (unsigned long)__sched_text_end);
 }
 
+#include "sched_fair.c"
+
+static struct sched_class o1_sched_class = {
+	.name			= "O(1)",
+	.enqueue_task		= o1_enqueue_task,
+	.dequeue_task		= o1_dequeue_task,
+	.task_wakeup		= o1_task_wakeup,
+	.task_new		= o1_task_new,
+	.task_fork		= o1_task_fork,
+	.task_exit		= o1_task_exit,
+	.pick_next_task		= o1_pick_next_task,
+	.put_prev_task		= o1_put_prev_task,
+	.task_tick		= o1_task_tick,
+	.yield_task		= o1_yield_task,
+	.preempts_curr		= o1_preempts_curr,
+	.prio_bonus		= o1_prio_bonus,
+#ifdef CONFIG_SMP
+	.move_tasks		= move_array_tasks,
+#endif
+};
+
+/*
+ * "cpusched=fair" selects the fair scheduling class at boot, "cpusched=o1"
+ * the default one.  The class cannot be changed once tasks are queued.
+ */
+static int __init cpusched_setup(char *str)
+{
+	if (!strcmp(str, "fair"))
+		sched_class = &fair_sched_class;
+	else if (!strcmp(str, "o1"))
+		sched_class = &o1_sched_class;
+	else {
+		printk(KERN_WARNING "cpusched: unknown scheduler %s\n", str);
+		return 1;
+	}
+	printk(KERN_INFO "cpusched: using the %s scheduler\n",
+	       sched_class->name);
+	return 1;
+}
+
+__setup("cpusched=", cpusched_setup);
+
 void __init sched_init(void)
 {
 	runqueue_t *rq;
@@ -4962,6 +5423,7 @@ void __init sched_init(void)
 		rq->active = rq->arrays;
 		rq->expired = rq->arrays + 1;
 		rq->best_expired_prio = MAX_PRIO;
+		init_fair_rq(&rq->fair);
 
 #ifdef CONFIG_SMP
 		rq->sd = &sched_domain_dummy;
@@ -4983,6 +5445,11 @@ void __init sched_init(void)
 			__set_bit(MAX_PRIO, array->bitmap);
 		}
 	}
+	init_fair_user_sched();
+#ifdef CONFIG_NUMA
+	/* inherited by every task, up to its first page faults */
+	current->numa_preferred_nid = -1;
+#endif
 
 	/*
 	 * The boot idle thread does lazy MMU switching as well:
@@ -5025,9 +5492,9 @@ EXPORT_SYMBOL(__might_sleep);
 void normalize_rt_tasks(void)
 {
 	struct task_struct *p;
-	prio_array_t *array;
 	unsigned long flags;
 	runqueue_t *rq;
+	int queued;
 
 	read_lock_irq(&tasklist_lock);
 	for_each_process (p) {
@@ -5036,11 +5503,11 @@ void normalize_rt_tasks(void)
 
 		rq = task_rq_lock(p, &flags);
 
-		array = p->array;
-		if (array)
+		queued = p->on_rq;
+		if (queued)
 			deactivate_task(p, task_rq(p));
 		__setscheduler(p, SCHED_NORMAL, 0);
-		if (array) {
+		if (queued) {
 			__activate_task(p, task_rq(p));
 			resched_task(rq->curr);
 		}
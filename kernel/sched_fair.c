@@ -0,0 +1,1125 @@
+/*
+ *  kernel/sched_fair.c
+ *
+ *  The fair scheduling class, selected with "cpusched=fair".
+ *
+ *  Every SCHED_NORMAL task accumulates virtual runtime: the nanoseconds it
+ *  ran, scaled by the weight of its nice level (prio_to_weight[], nice 0
+ *  counts 1:1, every nice level is about 10% of CPU time).  The runnable
+ *  tasks of a runqueue are kept in a red-black tree ordered by virtual
+ *  runtime and the leftmost one, which had the least CPU time, runs next.
+ *  There is no interactivity estimator and no expired array: a task that
+ *  slept comes back with the smallest virtual runtime of the runqueue minus
+ *  half a latency period, and so gets to run soon but cannot starve the
+ *  others.
+ *
+ *  Within a latency period (sysctl_sched_latency) every runnable task runs
+ *  once, for a slice proportional to its weight.  With more tasks than fit
+ *  in the period with sysctl_sched_min_granularity each, the period is
+ *  stretched instead.
+ *
+ *  With CONFIG_FAIR_USER_SCHED the runqueue's timeline holds one entity per
+ *  user instead, weighted by the user's shares, and every user has a
+ *  timeline of its tasks on every cpu: the CPU time is shared fairly among
+ *  the users first, then among the tasks of each user.  A user can also be
+ *  capped to a quota of CPU time per bandwidth period; its timelines are
+ *  taken off the runqueues when the quota is used up, until the next period.
+ *
+ *  RT tasks, and tasks boosted to an RT priority by a PI futex, stay on
+ *  the prio arrays of the runqueue and always run before the fair tasks.
+ *
+ *  This file is #included from kernel/sched.c.
+ *
+ *  2005-06-20	Initial version
+ *  2005-07-11	Fair share between users, bandwidth caps
+ */
+
+/*
+ * Nice levels are multiplicative, with a gentle 10% change for every
+ * nice level changed.  I.e. when a CPU-bound task goes from nice 0 to
+ * nice 1, it will get ~10% less CPU time than another CPU-bound task
+ * that remained on nice 0.
+ */
+static const unsigned int prio_to_weight[40] = {
+ /* -20 */     88761,     71755,     56483,     46273,     36291,
+ /* -15 */     29154,     23254,     18705,     14949,     11916,
+ /* -10 */      9548,      7620,      6100,      4904,      3906,
+ /*  -5 */      3121,      2501,      1991,      1586,      1277,
+ /*   0 */      1024,       820,       655,       526,       423,
+ /*   5 */       335,       272,       215,       172,       137,
+ /*  10 */       110,        87,        70,        56,        45,
+ /*  15 */        36,        29,        23,        18,        15,
+};
+
+#define NICE_0_LOAD		1024
+
+/*
+ * Targeted preemption latency for CPU-bound tasks: every runnable task
+ * runs once within this period.  (default: 20ms)
+ */
+unsigned int sysctl_sched_latency = 20000000;
+
+/*
+ * Minimal preemption granularity for CPU-bound tasks.  (default: 4ms)
+ */
+unsigned int sysctl_sched_min_granularity = 4000000;
+
+/*
+ * A waking task preempts the running one only if its virtual runtime is
+ * this much smaller, to keep wakeup storms from thrashing the cache.
+ * (default: 5ms)
+ */
+unsigned int sysctl_sched_wakeup_granularity = 5000000;
+
+static inline unsigned long task_weight(task_t *p)
+{
+	return prio_to_weight[TASK_USER_PRIO(p)];
+}
+
+/*
+ * Tasks on the prio arrays: RT tasks and PI-boosted ones.
+ */
+static inline int fair_array_task(task_t *p)
+{
+	return p->array || rt_task(p);
+}
+
+static inline task_t *task_of(struct sched_entity *se)
+{
+	return container_of(se, task_t, se);
+}
+
+static inline struct sched_entity *timeline_entry(struct rb_node *node)
+{
+	return rb_entry(node, struct sched_entity, run_node);
+}
+
+static void init_fair_rq(struct fair_rq *fair_rq)
+{
+	fair_rq->timeline = RB_ROOT;
+	fair_rq->leftmost = NULL;
+	fair_rq->nr_running = 0;
+	fair_rq->load = 0;
+	fair_rq->min_vruntime = 0;
+	fair_rq->nr_throttled = 0;
+#ifdef CONFIG_FAIR_USER_SCHED
+	INIT_LIST_HEAD(&fair_rq->throttled_list);
+#endif
+}
+
+#ifdef CONFIG_FAIR_USER_SCHED
+
+/* walk up from a task to its user's entity on the runqueue: */
+#define for_each_sched_entity(se) \
+		for (; se; se = (se)->parent)
+
+static inline struct fair_rq *fair_rq_of(struct sched_entity *se)
+{
+	return se->fair_rq;
+}
+
+static inline struct fair_rq *group_fair_rq(struct sched_entity *se)
+{
+	return se->my_q;
+}
+
+static inline int fair_rq_throttled(struct fair_rq *fair_rq)
+{
+	return fair_rq->throttled;
+}
+
+#else
+
+#define for_each_sched_entity(se) \
+		for (; se; se = NULL)
+
+static inline struct fair_rq *fair_rq_of(struct sched_entity *se)
+{
+	return &task_rq(task_of(se))->fair;
+}
+
+static inline struct fair_rq *group_fair_rq(struct sched_entity *se)
+{
+	return NULL;
+}
+
+static inline int fair_rq_throttled(struct fair_rq *fair_rq)
+{
+	return 0;
+}
+
+static inline struct fair_rq *cpu_fair_rq(task_t *p, int cpu)
+{
+	return &cpu_rq(cpu)->fair;
+}
+
+static inline void set_task_fair_rq(task_t *p, int cpu)
+{
+}
+
+static inline void
+account_fair_rq_runtime(runqueue_t *rq, struct fair_rq *fair_rq,
+			unsigned long long delta)
+{
+}
+
+static inline void check_fair_rq_runtime(runqueue_t *rq, task_t *prev)
+{
+}
+
+static inline void init_fair_user_sched(void)
+{
+}
+
+#endif /* CONFIG_FAIR_USER_SCHED */
+
+static void __enqueue_timeline(struct fair_rq *fair_rq,
+			       struct sched_entity *se)
+{
+	struct rb_node **link = &fair_rq->timeline.rb_node;
+	struct rb_node *parent = NULL;
+	int leftmost = 1;
+
+	while (*link) {
+		parent = *link;
+		/*
+		 * Entities with the same virtual runtime go to the right,
+		 * behind the ones already queued:
+		 */
+		if ((long long)(se->vruntime -
+				timeline_entry(parent)->vruntime) < 0)
+			link = &parent->rb_left;
+		else {
+			link = &parent->rb_right;
+			leftmost = 0;
+		}
+	}
+	if (leftmost)
+		fair_rq->leftmost = &se->run_node;
+
+	rb_link_node(&se->run_node, parent, link);
+	rb_insert_color(&se->run_node, &fair_rq->timeline);
+}
+
+static void __dequeue_timeline(struct fair_rq *fair_rq,
+			       struct sched_entity *se)
+{
+	if (fair_rq->leftmost == &se->run_node)
+		fair_rq->leftmost = rb_next(&se->run_node);
+	rb_erase(&se->run_node, &fair_rq->timeline);
+}
+
+/*
+ * The smallest virtual runtime of a timeline only ever goes forward,
+ * it is the reference point of waking and migrating entities.
+ */
+static inline void update_min_vruntime(struct fair_rq *fair_rq)
+{
+	struct sched_entity *first;
+
+	if (!fair_rq->leftmost)
+		return;
+	first = timeline_entry(fair_rq->leftmost);
+	if ((long long)(first->vruntime - fair_rq->min_vruntime) > 0)
+		fair_rq->min_vruntime = first->vruntime;
+}
+
+/*
+ * A sleeper gets credit for at most half a latency period, so that it
+ * runs soon after waking up without starving the entities that kept
+ * running.  This also catches up the ones coming back from the prio
+ * arrays or from being throttled.
+ */
+static void enqueue_entity(struct fair_rq *fair_rq, struct sched_entity *se)
+{
+	unsigned long long min_vruntime;
+
+	min_vruntime = fair_rq->min_vruntime - sysctl_sched_latency / 2;
+	if ((long long)(se->vruntime - min_vruntime) < 0)
+		se->vruntime = min_vruntime;
+
+	__enqueue_timeline(fair_rq, se);
+	fair_rq->nr_running++;
+	fair_rq->load += se->weight;
+	se->on_rq = 1;
+}
+
+static void dequeue_entity(struct fair_rq *fair_rq, struct sched_entity *se)
+{
+	__dequeue_timeline(fair_rq, se);
+	fair_rq->nr_running--;
+	fair_rq->load -= se->weight;
+	se->on_rq = 0;
+}
+
+#ifdef CONFIG_FAIR_USER_SCHED
+
+/*
+ * The CPU share of a user: its entity and timeline on every cpu, its
+ * weight and its bandwidth quota.
+ */
+struct fair_group_cpu {
+	struct fair_rq fair_rq;
+	struct sched_entity se;
+};
+
+struct fair_group {
+	struct user_struct *user;
+	struct fair_group_cpu *cpu[NR_CPUS];
+	unsigned long shares;
+	spinlock_t lock;		/* protects runtime */
+	unsigned long long quota;	/* per period, RUNTIME_INF if none */
+	unsigned long long runtime;	/* left in this period */
+	unsigned long nr_throttled;	/* protected by lock too */
+	struct list_head list;		/* on fair_groups */
+};
+
+#define RUNTIME_INF		(~0ULL)
+
+/*
+ * A cpu takes runtime from the quota of a user in slices of 5ms, so that
+ * the group lock is not taken on every tick.
+ */
+#define FAIR_BANDWIDTH_SLICE	5000000LL
+
+#define MIN_SHARES		2
+#define MAX_SHARES		(1UL << 18)
+
+/* the bandwidth quotas are refilled every period (default: 100ms) */
+unsigned int sysctl_sched_bandwidth_period_us = 100000;
+
+/*
+ * All users, and the number of them which have a quota.  Lock order:
+ * fair_groups_lock, rq->lock, fair_group->lock.
+ */
+static LIST_HEAD(fair_groups);
+static DEFINE_SPINLOCK(fair_groups_lock);
+static int nr_capped_groups;
+
+static void fair_bandwidth_timer_fn(unsigned long data);
+static struct timer_list fair_bandwidth_timer =
+		TIMER_INITIALIZER(fair_bandwidth_timer_fn, 0, 0);
+
+static struct fair_group root_fair_group;
+static DEFINE_PER_CPU(struct fair_group_cpu, root_fair_group_cpu);
+
+static inline struct fair_rq *cpu_fair_rq(task_t *p, int cpu)
+{
+	return &p->user->fair_group->cpu[cpu]->fair_rq;
+}
+
+/*
+ * Point the entity of a task to the timeline of its user on @cpu.
+ */
+static inline void set_task_fair_rq(task_t *p, int cpu)
+{
+	struct fair_group_cpu *fgc = p->user->fair_group->cpu[cpu];
+
+	p->se.fair_rq = &fgc->fair_rq;
+	p->se.parent = &fgc->se;
+}
+
+static void init_fair_group(struct fair_group *fg, struct user_struct *up)
+{
+	fg->user = up;
+	fg->shares = NICE_0_LOAD;
+	spin_lock_init(&fg->lock);
+	fg->quota = fg->runtime = RUNTIME_INF;
+	fg->nr_throttled = 0;
+}
+
+static void init_fair_group_cpu(struct fair_group *fg,
+				struct fair_group_cpu *fgc, int cpu)
+{
+	init_fair_rq(&fgc->fair_rq);
+	fgc->fair_rq.group = fg;
+	fgc->fair_rq.se = &fgc->se;
+	fgc->fair_rq.runtime_remaining = 0;
+	fgc->fair_rq.throttled = 0;
+
+	memset(&fgc->se, 0, sizeof(fgc->se));
+	fgc->se.weight = fg->shares;
+	fgc->se.fair_rq = &cpu_rq(cpu)->fair;
+	fgc->se.my_q = &fgc->fair_rq;
+	fg->cpu[cpu] = fgc;
+}
+
+/*
+ * root_user exists before the slab allocator does.
+ */
+static void __init init_fair_user_sched(void)
+{
+	struct fair_group *fg = &root_fair_group;
+	int cpu;
+
+	init_fair_group(fg, &root_user);
+	for (cpu = 0; cpu < NR_CPUS; cpu++)
+		init_fair_group_cpu(fg, &per_cpu(root_fair_group_cpu, cpu),
+				    cpu);
+	list_add(&fg->list, &fair_groups);
+	root_user.fair_group = fg;
+}
+
+int sched_create_user(struct user_struct *up)
+{
+	struct fair_group *fg;
+	int cpu;
+
+	up->fair_group = NULL;
+	if (sched_class != &fair_sched_class)
+		return 0;
+
+	fg = kmalloc(sizeof(*fg), GFP_KERNEL);
+	if (!fg)
+		return -ENOMEM;
+	memset(fg, 0, sizeof(*fg));
+	init_fair_group(fg, up);
+
+	for_each_cpu(cpu) {
+		struct fair_group_cpu *fgc;
+
+		fgc = kmalloc(sizeof(*fgc), GFP_KERNEL);
+		if (!fgc)
+			goto out_free;
+		init_fair_group_cpu(fg, fgc, cpu);
+	}
+
+	spin_lock_irq(&fair_groups_lock);
+	list_add_tail(&fg->list, &fair_groups);
+	spin_unlock_irq(&fair_groups_lock);
+
+	up->fair_group = fg;
+	return 0;
+
+out_free:
+	for_each_cpu(cpu)
+		kfree(fg->cpu[cpu]);
+	kfree(fg);
+	return -ENOMEM;
+}
+
+/*
+ * The user has no tasks left, but its timelines may still be throttled.
+ */
+void sched_destroy_user(struct user_struct *up)
+{
+	struct fair_group *fg = up->fair_group;
+	unsigned long flags;
+	runqueue_t *rq;
+	int cpu;
+
+	if (!fg)
+		return;
+
+	spin_lock_irqsave(&fair_groups_lock, flags);
+	list_del(&fg->list);
+	if (fg->quota != RUNTIME_INF)
+		nr_capped_groups--;
+	spin_unlock_irqrestore(&fair_groups_lock, flags);
+
+	for_each_cpu(cpu) {
+		struct fair_rq *fair_rq = &fg->cpu[cpu]->fair_rq;
+
+		rq = cpu_rq(cpu);
+		spin_lock_irqsave(&rq->lock, flags);
+		if (fair_rq->throttled)
+			list_del(&fair_rq->throttled_list);
+		spin_unlock_irqrestore(&rq->lock, flags);
+		kfree(fg->cpu[cpu]);
+	}
+	kfree(fg);
+}
+
+/*
+ * Take runtime from the quota of the user, enough to cover what the
+ * timeline overran plus a slice.  Returns whether it has runtime left.
+ */
+static int assign_fair_rq_runtime(struct fair_rq *fair_rq)
+{
+	struct fair_group *fg = fair_rq->group;
+	unsigned long long amount;
+
+	amount = FAIR_BANDWIDTH_SLICE - fair_rq->runtime_remaining;
+	spin_lock(&fg->lock);
+	if (fg->quota != RUNTIME_INF) {
+		if (amount > fg->runtime)
+			amount = fg->runtime;
+		fg->runtime -= amount;
+	}
+	spin_unlock(&fg->lock);
+	fair_rq->runtime_remaining += amount;
+
+	return fair_rq->runtime_remaining > 0;
+}
+
+static void account_fair_rq_runtime(runqueue_t *rq, struct fair_rq *fair_rq,
+				    unsigned long long delta)
+{
+	if (fair_rq->group->quota == RUNTIME_INF)
+		return;
+
+	fair_rq->runtime_remaining -= delta;
+	if (fair_rq->runtime_remaining > 0)
+		return;
+	if (!assign_fair_rq_runtime(fair_rq))
+		set_tsk_need_resched(rq->curr);
+}
+
+/*
+ * Take the user's entity off the runqueue; its tasks stay queued on the
+ * user's timeline.
+ */
+static void throttle_fair_rq(runqueue_t *rq, struct fair_rq *fair_rq)
+{
+	struct sched_entity *se = fair_rq->se;
+
+	for_each_sched_entity(se) {
+		if (!se->on_rq)
+			break;
+		dequeue_entity(fair_rq_of(se), se);
+		if (fair_rq_of(se)->nr_running)
+			break;
+	}
+	fair_rq->throttled = 1;
+	list_add(&fair_rq->throttled_list, &rq->fair.throttled_list);
+	rq->fair.nr_throttled += fair_rq->nr_running;
+
+	spin_lock(&fair_rq->group->lock);
+	fair_rq->group->nr_throttled++;
+	spin_unlock(&fair_rq->group->lock);
+}
+
+static void unthrottle_fair_rq(runqueue_t *rq, struct fair_rq *fair_rq)
+{
+	struct sched_entity *se = fair_rq->se;
+
+	fair_rq->throttled = 0;
+	list_del(&fair_rq->throttled_list);
+	rq->fair.nr_throttled -= fair_rq->nr_running;
+	if (!fair_rq->nr_running)
+		return;
+
+	for_each_sched_entity(se) {
+		if (se->on_rq)
+			break;
+		enqueue_entity(fair_rq_of(se), se);
+	}
+	if (rq->curr == rq->idle)
+		resched_task(rq->curr);
+}
+
+/*
+ * The previous task used up the quota of its user: throttle the user's
+ * timeline before the next task is picked.
+ */
+static void check_fair_rq_runtime(runqueue_t *rq, task_t *prev)
+{
+	struct fair_rq *fair_rq;
+
+	if (prev == rq->idle || fair_array_task(prev))
+		return;
+	fair_rq = fair_rq_of(&prev->se);
+	if (fair_rq->group->quota != RUNTIME_INF &&
+	    fair_rq->runtime_remaining <= 0 && !fair_rq->throttled)
+		throttle_fair_rq(rq, fair_rq);
+}
+
+/*
+ * Refill the quotas at the end of every bandwidth period and let the
+ * throttled timelines run again.
+ */
+static void fair_bandwidth_timer_fn(unsigned long data)
+{
+	struct fair_rq *fair_rq, *n;
+	struct fair_group *fg;
+	int cpu, capped;
+
+	spin_lock_irq(&fair_groups_lock);
+	list_for_each_entry(fg, &fair_groups, list) {
+		if (fg->quota == RUNTIME_INF)
+			continue;
+		spin_lock(&fg->lock);
+		fg->runtime = fg->quota;
+		spin_unlock(&fg->lock);
+	}
+	capped = nr_capped_groups;
+	spin_unlock_irq(&fair_groups_lock);
+
+	for_each_online_cpu(cpu) {
+		runqueue_t *rq = cpu_rq(cpu);
+
+		spin_lock_irq(&rq->lock);
+		list_for_each_entry_safe(fair_rq, n, &rq->fair.throttled_list,
+					 throttled_list)
+			if (assign_fair_rq_runtime(fair_rq))
+				unthrottle_fair_rq(rq, fair_rq);
+		spin_unlock_irq(&rq->lock);
+	}
+
+	if (capped)
+		mod_timer(&fair_bandwidth_timer, jiffies +
+			  usecs_to_jiffies(sysctl_sched_bandwidth_period_us));
+}
+
+/*
+ * Set the shares and the quota (RUNTIME_INF for none) of a user.
+ */
+static void set_fair_group(struct fair_group *fg, unsigned long shares,
+			   unsigned long long quota)
+{
+	unsigned long flags;
+	int cpu;
+
+	spin_lock_irq(&fair_groups_lock);
+	if (fg->quota == RUNTIME_INF && quota != RUNTIME_INF)
+		nr_capped_groups++;
+	else if (fg->quota != RUNTIME_INF && quota == RUNTIME_INF)
+		nr_capped_groups--;
+	spin_lock(&fg->lock);
+	fg->shares = shares;
+	fg->quota = fg->runtime = quota;
+	spin_unlock(&fg->lock);
+	spin_unlock_irq(&fair_groups_lock);
+
+	for_each_cpu(cpu) {
+		struct fair_rq *fair_rq = &fg->cpu[cpu]->fair_rq;
+		struct sched_entity *se = fair_rq->se;
+		runqueue_t *rq = cpu_rq(cpu);
+
+		spin_lock_irqsave(&rq->lock, flags);
+		if (se->on_rq) {
+			fair_rq_of(se)->load -= se->weight;
+			fair_rq_of(se)->load += shares;
+		}
+		se->weight = shares;
+		fair_rq->runtime_remaining = 0;
+		if (fair_rq->throttled && quota == RUNTIME_INF)
+			unthrottle_fair_rq(rq, fair_rq);
+		spin_unlock_irqrestore(&rq->lock, flags);
+	}
+
+	if (quota != RUNTIME_INF && !timer_pending(&fair_bandwidth_timer))
+		mod_timer(&fair_bandwidth_timer, jiffies +
+			  usecs_to_jiffies(sysctl_sched_bandwidth_period_us));
+}
+
+/*
+ * A task changed its user: move it to the timeline of the new one.
+ */
+void sched_switch_user(task_t *p)
+{
+	struct sched_entity *se = &p->se;
+	unsigned long flags;
+	runqueue_t *rq;
+	int queued;
+
+	if (sched_class != &fair_sched_class)
+		return;
+
+	rq = task_rq_lock(p, &flags);
+	queued = p->on_rq && !p->array;
+	if (queued)
+		sched_class->dequeue_task(p, rq);
+	se->vruntime -= fair_rq_of(se)->min_vruntime;
+	set_task_fair_rq(p, task_cpu(p));
+	se->vruntime += fair_rq_of(se)->min_vruntime;
+	if (queued)
+		sched_class->enqueue_task(p, rq);
+	task_rq_unlock(rq, &flags);
+}
+
+#ifdef CONFIG_HOTPLUG_CPU
+/*
+ * The tasks of a dead cpu are migrated whatever the quota of their user.
+ */
+static void fair_rq_offline(runqueue_t *rq)
+{
+	struct fair_rq *fair_rq, *n;
+
+	list_for_each_entry_safe(fair_rq, n, &rq->fair.throttled_list,
+				 throttled_list)
+		unthrottle_fair_rq(rq, fair_rq);
+}
+#endif
+
+/*
+ * /proc/sched_users lists the users with their shares, quota per period
+ * (-1 if none) and how often they were throttled.  "uid shares [quota]"
+ * written to it sets them; the quota is in microseconds.
+ */
+static int show_sched_users(struct seq_file *seq, void *v)
+{
+	struct fair_group *fg;
+
+	seq_printf(seq, "period %u\n", sysctl_sched_bandwidth_period_us);
+	if (sched_class != &fair_sched_class)
+		return 0;
+
+	spin_lock_irq(&fair_groups_lock);
+	list_for_each_entry(fg, &fair_groups, list) {
+		unsigned long long quota = fg->quota;
+
+		if (quota == RUNTIME_INF)
+			seq_printf(seq, "%u %lu -1 %lu\n", fg->user->uid,
+				   fg->shares, fg->nr_throttled);
+		else {
+			do_div(quota, 1000);
+			seq_printf(seq, "%u %lu %llu %lu\n", fg->user->uid,
+				   fg->shares, quota, fg->nr_throttled);
+		}
+	}
+	spin_unlock_irq(&fair_groups_lock);
+	return 0;
+}
+
+static int sched_users_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, show_sched_users, NULL);
+}
+
+static ssize_t write_sched_users(struct file *file, const char __user *buf,
+				 size_t count, loff_t *ppos)
+{
+	unsigned long long quota = RUNTIME_INF;
+	struct user_struct *up;
+	unsigned long shares;
+	long quota_us = -1;
+	char kbuf[64];
+	uid_t uid;
+
+	if (!capable(CAP_SYS_NICE))
+		return -EPERM;
+	if (sched_class != &fair_sched_class)
+		return -EINVAL;
+	if (!count || count >= sizeof(kbuf))
+		return -EINVAL;
+	if (copy_from_user(kbuf, buf, count))
+		return -EFAULT;
+	kbuf[count] = '\0';
+
+	if (sscanf(kbuf, "%u %lu %ld", &uid, &shares, &quota_us) < 2)
+		return -EINVAL;
+	if (shares < MIN_SHARES || shares > MAX_SHARES || quota_us < -1)
+		return -EINVAL;
+	if (quota_us >= 0)
+		quota = (unsigned long long) quota_us * 1000;
+
+	up = find_user(uid);
+	if (!up)
+		return -ESRCH;
+	set_fair_group(up->fair_group, shares, quota);
+	free_uid(up);
+	return count;
+}
+
+struct file_operations proc_sched_users_operations = {
+	.open		= sched_users_open,
+	.read		= seq_read,
+	.write		= write_sched_users,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+#endif /* CONFIG_FAIR_USER_SCHED */
+
+/*
+ * delta /= weight, in units of a nice 0 task:
+ */
+static inline unsigned long long
+calc_delta_fair(unsigned long long delta, unsigned long weight)
+{
+	if (weight != NICE_0_LOAD) {
+		delta *= NICE_0_LOAD;
+		do_div(delta, weight);
+	}
+	return delta;
+}
+
+/*
+ * Charge the running task, and its user, for the time since it was last
+ * charged.  The running entities stay in their timelines; they are moved
+ * only when they got past the entity after them.
+ */
+static void update_curr(runqueue_t *rq, unsigned long long now)
+{
+	task_t *curr = rq->curr;
+	struct sched_entity *se = &curr->se;
+	unsigned long long delta;
+	struct fair_rq *fair_rq;
+	struct rb_node *next;
+
+	if (curr == rq->idle || fair_array_task(curr))
+		return;
+
+	/* sched_clock() of another cpu may lag behind ours: */
+	delta = now - se->exec_start;
+	if ((long long) delta <= 0)
+		return;
+	se->exec_start = now;
+	account_fair_rq_runtime(rq, fair_rq_of(se), delta);
+
+	for_each_sched_entity(se) {
+		fair_rq = fair_rq_of(se);
+		se->vruntime += calc_delta_fair(delta, se->weight);
+		if (!se->on_rq)
+			continue;
+		next = rb_next(&se->run_node);
+		if (next && (long long)(se->vruntime -
+					timeline_entry(next)->vruntime) >= 0) {
+			__dequeue_timeline(fair_rq, se);
+			__enqueue_timeline(fair_rq, se);
+		}
+		update_min_vruntime(fair_rq);
+	}
+}
+
+static unsigned long long sched_period(unsigned long nr_running)
+{
+	unsigned long nr_latency = sysctl_sched_latency /
+				   sysctl_sched_min_granularity;
+
+	if (nr_running > nr_latency)
+		return (unsigned long long) nr_running *
+			sysctl_sched_min_granularity;
+	return sysctl_sched_latency;
+}
+
+/*
+ * The share of the period of a task: its weight relative to the other
+ * tasks of its user, times the weight of the user relative to the other
+ * users.  A task which is not queued yet is counted in.
+ */
+static unsigned long long sched_slice(runqueue_t *rq, struct sched_entity *se)
+{
+	unsigned long long slice = sched_period(rq->nr_running + !se->on_rq);
+	unsigned long load;
+
+	for_each_sched_entity(se) {
+		load = fair_rq_of(se)->load;
+		if (!se->on_rq)
+			load += se->weight;
+		slice *= se->weight;
+		do_div(slice, load);
+	}
+	return slice;
+}
+
+static void fair_enqueue_task(task_t *p, runqueue_t *rq)
+{
+	struct sched_entity *se = &p->se;
+
+	if (rt_task(p)) {
+		enqueue_task(p, rq->active);
+		return;
+	}
+
+	sched_info_queued(p);
+	se->weight = task_weight(p);
+	if (!se->on_rq && fair_rq_throttled(fair_rq_of(se)))
+		rq->fair.nr_throttled++;
+
+	for_each_sched_entity(se) {
+		if (se->on_rq)
+			break;
+		if (group_fair_rq(se) && fair_rq_throttled(group_fair_rq(se)))
+			break;
+		enqueue_entity(fair_rq_of(se), se);
+	}
+}
+
+static void fair_dequeue_task(task_t *p, runqueue_t *rq)
+{
+	struct sched_entity *se = &p->se;
+	struct fair_rq *fair_rq;
+
+	if (p->array) {
+		dequeue_task(p, p->array);
+		p->array = NULL;
+		return;
+	}
+	if (p == rq->curr)
+		update_curr(rq, sched_clock());
+	if (se->on_rq && fair_rq_throttled(fair_rq_of(se)))
+		rq->fair.nr_throttled--;
+
+	for_each_sched_entity(se) {
+		if (!se->on_rq)
+			break;
+		fair_rq = fair_rq_of(se);
+		dequeue_entity(fair_rq, se);
+		/* the user's entity stays while it has other tasks: */
+		if (fair_rq->nr_running)
+			break;
+	}
+}
+
+/*
+ * A new task starts one slice behind its timeline, so that a fork loop
+ * does not get more than its share.  If the child is to run first, it
+ * swaps places with its parent.
+ */
+static void fair_task_new(task_t *p, runqueue_t *rq, int child_first)
+{
+	struct sched_entity *se = &p->se, *pse = &current->se;
+	struct fair_rq *fair_rq;
+	unsigned long long tmp;
+
+	set_task_fair_rq(p, task_cpu(p));
+	if (rt_task(p)) {
+		enqueue_task(p, rq->active);
+		if (child_first)
+			set_need_resched();
+		return;
+	}
+
+	fair_rq = fair_rq_of(se);
+	update_curr(rq, sched_clock());
+	se->weight = task_weight(p);
+	se->vruntime = fair_rq->min_vruntime +
+		       calc_delta_fair(sched_slice(rq, se), se->weight);
+
+	if (child_first && pse->on_rq && !fair_array_task(current) &&
+	    fair_rq_of(pse) == fair_rq &&
+	    (long long)(pse->vruntime - se->vruntime) < 0) {
+		tmp = pse->vruntime;
+		pse->vruntime = se->vruntime;
+		se->vruntime = tmp;
+		__dequeue_timeline(fair_rq, pse);
+		__enqueue_timeline(fair_rq, pse);
+	}
+	fair_enqueue_task(p, rq);
+
+	if (child_first)
+		set_need_resched();
+}
+
+/*
+ * The child inherits the virtual runtime of the parent, there are no
+ * timeslices to share.
+ */
+static void fair_task_fork(task_t *p)
+{
+	p->se.on_rq = 0;
+	p->time_slice = task_timeslice(p);
+	p->first_time_slice = 0;
+}
+
+/*
+ * Virtual runtimes are relative to the timeline they are queued on.
+ */
+static void fair_task_migrate(task_t *p, int cpu)
+{
+	struct sched_entity *se = &p->se;
+
+	se->vruntime = se->vruntime - fair_rq_of(se)->min_vruntime +
+		       cpu_fair_rq(p, cpu)->min_vruntime;
+	set_task_fair_rq(p, cpu);
+}
+
+/*
+ * RT tasks first, then the leftmost task of the leftmost user.  If all the
+ * users with runnable tasks are throttled, the cpu goes idle.
+ */
+static task_t *fair_pick_next_task(runqueue_t *rq, unsigned long long now)
+{
+	prio_array_t *array = rq->active;
+	struct fair_rq *fair_rq = &rq->fair;
+	struct sched_entity *se;
+	task_t *next;
+
+	if (array->nr_active) {
+		int idx = sched_find_first_bit(array->bitmap);
+
+		next = list_entry(array->queue[idx].next, task_t, run_list);
+		next->se.exec_start = now;
+		return next;
+	}
+
+	do {
+		if (!fair_rq->leftmost)
+			return rq->idle;
+		se = timeline_entry(fair_rq->leftmost);
+		fair_rq = group_fair_rq(se);
+	} while (fair_rq);
+
+	se->exec_start = now;
+	return task_of(se);
+}
+
+static void fair_put_prev_task(task_t *prev, runqueue_t *rq,
+			       unsigned long long now)
+{
+	update_curr(rq, now);
+	check_fair_rq_runtime(rq, prev);
+}
+
+static void fair_task_tick(task_t *p, runqueue_t *rq)
+{
+	unsigned long long now = sched_clock();
+
+	spin_lock(&rq->lock);
+	if (fair_array_task(p)) {
+		task_tick_rt(p, rq);
+		goto out_unlock;
+	}
+	update_curr(rq, now);
+	if (rq->nr_running > 1 && now - p->timestamp >= sched_slice(rq, &p->se))
+		set_tsk_need_resched(p);
+out_unlock:
+	spin_unlock(&rq->lock);
+}
+
+/*
+ * Yielding moves a fair task behind all the others of its timeline, RT
+ * tasks roundrobin on their array.
+ */
+static void fair_yield_task(task_t *p, runqueue_t *rq)
+{
+	struct sched_entity *se = &p->se;
+	struct fair_rq *fair_rq = fair_rq_of(se);
+	struct rb_node *last;
+
+	if (p->array) {
+		requeue_task(p, p->array);
+		return;
+	}
+	update_curr(rq, sched_clock());
+	last = rb_last(&fair_rq->timeline);
+	if (last == &se->run_node)
+		return;
+	__dequeue_timeline(fair_rq, se);
+	se->vruntime = timeline_entry(last)->vruntime;
+	__enqueue_timeline(fair_rq, se);
+	update_min_vruntime(fair_rq);
+}
+
+/*
+ * Tasks of different users are compared by their users' entities.
+ */
+static int fair_preempts_curr(task_t *p, runqueue_t *rq)
+{
+	struct sched_entity *se = &p->se, *cse;
+	task_t *curr = rq->curr;
+
+	if (curr == rq->idle || fair_array_task(p) || fair_array_task(curr))
+		return p->prio < curr->prio;
+
+	cse = &curr->se;
+#ifdef CONFIG_FAIR_USER_SCHED
+	while (fair_rq_of(se) != fair_rq_of(cse)) {
+		se = se->parent;
+		cse = cse->parent;
+	}
+#endif
+	return (long long)(cse->vruntime - se->vruntime) >
+		(long long) sysctl_sched_wakeup_granularity;
+}
+
+static int fair_prio_bonus(task_t *p)
+{
+	return 0;
+}
+
+#ifdef CONFIG_SMP
+/*
+ * pull_fair_task - move a fair task from a remote runqueue to the local
+ * runqueue.  Both runqueues must be locked.
+ */
+static void pull_fair_task(runqueue_t *src_rq, task_t *p,
+			   runqueue_t *this_rq, int this_cpu)
+{
+	fair_dequeue_task(p, src_rq);
+	src_rq->nr_running--;
+	move_task_cpu(p, this_cpu);
+	this_rq->nr_running++;
+	fair_enqueue_task(p, this_rq);
+	p->timestamp = (p->timestamp - src_rq->timestamp_last_tick)
+				+ this_rq->timestamp_last_tick;
+	if (TASK_PREEMPTS_CURR(p, this_rq))
+		resched_task(this_rq->curr);
+}
+
+/*
+ * Move the tasks of a timeline, and of the users queued on it, starting
+ * with the largest virtual runtime: they are the ones which run last.
+ * Tasks whose user is throttled on this_cpu stay where they are.
+ */
+static int move_fair_rq_tasks(runqueue_t *this_rq, int this_cpu,
+			      runqueue_t *busiest, struct fair_rq *fair_rq,
+			      unsigned long max_nr_move,
+			      struct sched_domain *sd, enum idle_type idle)
+{
+	struct rb_node *node, *prev;
+	struct sched_entity *se;
+	int pulled = 0;
+	task_t *p;
+
+	for (node = rb_last(&fair_rq->timeline); node; node = prev) {
+		prev = rb_prev(node);
+		se = timeline_entry(node);
+		if (group_fair_rq(se)) {
+			pulled += move_fair_rq_tasks(this_rq, this_cpu, busiest,
+						     group_fair_rq(se),
+						     max_nr_move - pulled,
+						     sd, idle);
+		} else {
+			p = task_of(se);
+			if (!can_migrate_task(p, busiest, this_cpu, sd, idle) ||
+			    fair_rq_throttled(cpu_fair_rq(p, this_cpu)))
+				continue;
+
+			schedstat_inc(this_rq, pt_gained[idle]);
+			schedstat_inc(busiest, pt_lost[idle]);
+
+			pull_fair_task(busiest, p, this_rq, this_cpu);
+			pulled++;
+		}
+		if (pulled >= max_nr_move)
+			break;
+	}
+	return pulled;
+}
+
+/*
+ * move_tasks() of the fair class: RT tasks are moved only when there
+ * were not enough fair ones.
+ */
+static int fair_move_tasks(runqueue_t *this_rq, int this_cpu,
+			   runqueue_t *busiest, unsigned long max_nr_move,
+			   struct sched_domain *sd, enum idle_type idle)
+{
+	int pulled = 0;
+
+	if (max_nr_move <= 0 || balance_nr_running(busiest) <= 1)
+		goto out;
+
+	pulled = move_fair_rq_tasks(this_rq, this_cpu, busiest, &busiest->fair,
+				    max_nr_move, sd, idle);
+	if (pulled < max_nr_move)
+		pulled += move_array_tasks(this_rq, this_cpu, busiest,
+					   max_nr_move - pulled, sd, idle);
+out:
+	return pulled;
+}
+#endif
+
+static struct sched_class fair_sched_class = {
+	.name			= "fair",
+	.enqueue_task		= fair_enqueue_task,
+	.dequeue_task		= fair_dequeue_task,
+	.task_new		= fair_task_new,
+	.task_fork		= fair_task_fork,
+	.task_migrate		= fair_task_migrate,
+	.pick_next_task		= fair_pick_next_task,
+	.put_prev_task		= fair_put_prev_task,
+	.task_tick		= fair_task_tick,
+	.yield_task		= fair_yield_task,
+	.preempts_curr		= fair_preempts_curr,
+	.prio_bonus		= fair_prio_bonus,
+#ifdef CONFIG_SMP
+	.move_tasks		= fair_move_tasks,
+#endif
+#if defined(CONFIG_HOTPLUG_CPU) && defined(CONFIG_FAIR_USER_SCHED)
+	.rq_offline		= fair_rq_offline,
+#endif
+};
@@ -167,6 +167,14 @@ void irq_exit(void)
 	sub_preempt_count(IRQ_EXIT_OFFSET);
 	if (!in_interrupt() && local_softirq_pending())
 		invoke_softirq();
+#ifdef CONFIG_NO_IDLE_HZ
+	/*
+	 * Back to idle: the handler may have queued a timer, and the cpu
+	 * goes back into nohz_cpu_mask now that the softirqs are done.
+	 */
+	if (!in_interrupt() && idle_cpu(smp_processor_id()) && !need_resched())
+		hrtimer_stop_sched_tick();
+#endif
 	preempt_enable_no_resched();
 }
 
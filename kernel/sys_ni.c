@@ -41,6 +41,7 @@ cond_syscall(sys_socketcall)
 cond_syscall(sys_futex)
 cond_syscall(compat_sys_futex)
 cond_syscall(sys_epoll_create)
+cond_syscall(sys_epoll_create1)
 cond_syscall(sys_epoll_ctl)
 cond_syscall(sys_epoll_wait)
 cond_syscall(sys_semget)
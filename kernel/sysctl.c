@@ -41,6 +41,7 @@
 #include <linux/limits.h>
 #include <linux/dcache.h>
 #include <linux/syscalls.h>
+#include <linux/pipe_fs_i.h>
 
 #include <asm/uaccess.h>
 #include <asm/processor.h>
@@ -76,6 +77,14 @@ extern int proc_unknown_nmi_panic(ctl_table *, int, struct file *,
 static int maxolduid = 65535;
 static int minolduid;
 
+/* limits of the fair scheduler tunables, in nanoseconds */
+static int min_sched_granularity_ns = 100000;		/* 100 usecs */
+static int max_sched_granularity_ns = 1000000000;	/* 1 second */
+#ifdef CONFIG_FAIR_USER_SCHED
+static int min_sched_bandwidth_period_us = 1000;	/* 1 msec */
+static int max_sched_bandwidth_period_us = 1000000;	/* 1 second */
+#endif
+
 static int ngroups_max = NGROUPS_MAX;
 
 #ifdef CONFIG_KMOD
@@ -548,6 +557,15 @@ static ctl_table kern_table[] = {
 		.mode		= 0644,
 		.proc_handler	= &proc_dointvec,
 	},
+#endif
+	{
+		.ctl_name	= KERN_S390_USER_DEBUG_LOGGING,
+		.procname	= "userprocess_debug",
+		.data		= &sysctl_userprocess_debug,
+		.maxlen		= sizeof(int),
+		.mode		= 0644,
+		.proc_handler	= &proc_dointvec,
+	},
 #endif
 #ifdef CONFIG_NO_IDLE_HZ
 	{
@@ -558,15 +576,6 @@ static ctl_table kern_table[] = {
 		.mode           = 0644,
 		.proc_handler   = &proc_dointvec,
 	},
-#endif
-	{
-		.ctl_name	= KERN_S390_USER_DEBUG_LOGGING,
-		.procname	= "userprocess_debug",
-		.data		= &sysctl_userprocess_debug,
-		.maxlen		= sizeof(int),
-		.mode		= 0644,
-		.proc_handler	= &proc_dointvec,
-	},
 #endif
 	{
 		.ctl_name	= KERN_PIDMAX,
@@ -631,6 +640,62 @@ static ctl_table kern_table[] = {
 		.mode		= 0444,
 		.proc_handler	= &proc_dointvec,
 	},
+#endif
+	{
+		.ctl_name	= KERN_SCHED_LATENCY,
+		.procname	= "sched_latency_ns",
+		.data		= &sysctl_sched_latency,
+		.maxlen		= sizeof(unsigned int),
+		.mode		= 0644,
+		.proc_handler	= &proc_dointvec_minmax,
+		.strategy	= &sysctl_intvec,
+		.extra1		= &min_sched_granularity_ns,
+		.extra2		= &max_sched_granularity_ns,
+	},
+	{
+		.ctl_name	= KERN_SCHED_MIN_GRANULARITY,
+		.procname	= "sched_min_granularity_ns",
+		.data		= &sysctl_sched_min_granularity,
+		.maxlen		= sizeof(unsigned int),
+		.mode		= 0644,
+		.proc_handler	= &proc_dointvec_minmax,
+		.strategy	= &sysctl_intvec,
+		.extra1		= &min_sched_granularity_ns,
+		.extra2		= &max_sched_granularity_ns,
+	},
+	{
+		.ctl_name	= KERN_SCHED_WAKEUP_GRANULARITY,
+		.procname	= "sched_wakeup_granularity_ns",
+		.data		= &sysctl_sched_wakeup_granularity,
+		.maxlen		= sizeof(unsigned int),
+		.mode		= 0644,
+		.proc_handler	= &proc_dointvec_minmax,
+		.strategy	= &sysctl_intvec,
+		.extra1		= &min_sched_granularity_ns,
+		.extra2		= &max_sched_granularity_ns,
+	},
+#ifdef CONFIG_FAIR_USER_SCHED
+	{
+		.ctl_name	= KERN_SCHED_BANDWIDTH_PERIOD,
+		.procname	= "sched_bandwidth_period_us",
+		.data		= &sysctl_sched_bandwidth_period_us,
+		.maxlen		= sizeof(unsigned int),
+		.mode		= 0644,
+		.proc_handler	= &proc_dointvec_minmax,
+		.strategy	= &sysctl_intvec,
+		.extra1		= &min_sched_bandwidth_period_us,
+		.extra2		= &max_sched_bandwidth_period_us,
+	},
+#endif
+#ifdef CONFIG_NUMA
+	{
+		.ctl_name	= KERN_NUMA_MIGRATE,
+		.procname	= "numa_migrate",
+		.data		= &sysctl_numa_migrate,
+		.maxlen		= sizeof(int),
+		.mode		= 0644,
+		.proc_handler	= &proc_dointvec,
+	},
 #endif
 	{ .ctl_name = 0 }
 };
@@ -824,6 +889,16 @@ static ctl_table vm_table[] = {
 		.proc_handler	= &proc_dointvec_jiffies,
 		.strategy	= &sysctl_jiffies,
 	},
+#endif
+#ifdef CONFIG_COMPACTION
+	{
+		.ctl_name	= VM_COMPACT_MEMORY,
+		.procname	= "compact_memory",
+		.data		= &sysctl_compact_memory,
+		.maxlen		= sizeof(sysctl_compact_memory),
+		.mode		= 0200,
+		.proc_handler	= &sysctl_compaction_handler,
+	},
 #endif
 	{ .ctl_name = 0 }
 };
@@ -855,7 +930,7 @@ static ctl_table fs_table[] = {
 		.data		= &files_stat,
 		.maxlen		= 3*sizeof(int),
 		.mode		= 0444,
-		.proc_handler	= &proc_dointvec,
+		.proc_handler	= &proc_nr_files,
 	},
 	{
 		.ctl_name	= FS_MAXFILE,
@@ -871,7 +946,7 @@ static ctl_table fs_table[] = {
 		.data		= &dentry_stat,
 		.maxlen		= 6*sizeof(int),
 		.mode		= 0444,
-		.proc_handler	= &proc_dointvec,
+		.proc_handler	= &proc_nr_dentry,
 	},
 	{
 		.ctl_name	= FS_OVERFLOWUID,
@@ -939,6 +1014,16 @@ static ctl_table fs_table[] = {
 		.proc_handler	= &proc_dointvec,
 	},
 #endif
+	{
+		.ctl_name	= FS_PIPE_MAX_SIZE,
+		.procname	= "pipe-max-size",
+		.data		= &pipe_max_size,
+		.maxlen		= sizeof(int),
+		.mode		= 0644,
+		.proc_handler	= &proc_dointvec_minmax,
+		.strategy	= &sysctl_intvec,
+		.extra1		= &pipe_min_size,
+	},
 	{ .ctl_name = 0 }
 };
 
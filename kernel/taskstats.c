@@ -0,0 +1,191 @@
+/*
+ *  kernel/taskstats.c
+ *
+ *  Per-task statistics over netlink (NETLINK_TASKSTATS): how often and how
+ *  long tasks waited for a cpu, for block I/O and for swap-in.  A request
+ *  returns the totals of one task or one thread group, a dump those of
+ *  every task in the system, so that monitoring agents do not have to read
+ *  thousands of /proc files.  The protocol is in include/linux/taskstats.h.
+ */
+
+#include <linux/config.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/sched.h>
+#include <linux/jiffies.h>
+#include <linux/skbuff.h>
+#include <linux/netlink.h>
+#include <linux/taskstats.h>
+#include <linux/delayacct.h>
+#include <net/sock.h>
+
+static struct sock *taskstats_sock;
+
+/*
+ * Add the counters of tsk to stats.  Called with tasklist_lock held.
+ */
+static void taskstats_add(struct taskstats *stats, struct task_struct *tsk)
+{
+	struct task_delay_info *delays = &tsk->delays;
+
+	stats->nr_threads++;
+
+	/* the scheduler keeps these in jiffies */
+	stats->cpu_count += tsk->sched_info.pcnt;
+	stats->cpu_delay_total += (u64)tsk->sched_info.run_delay * TICK_NSEC;
+	stats->cpu_run_total += (u64)tsk->sched_info.cpu_time * TICK_NSEC;
+
+	spin_lock(&delays->lock);
+	stats->blkio_count += delays->blkio_count;
+	stats->blkio_delay_total += delays->blkio_delay;
+	stats->swapin_count += delays->swapin_count;
+	stats->swapin_delay_total += delays->swapin_delay;
+	spin_unlock(&delays->lock);
+}
+
+static int taskstats_fill(struct sk_buff *skb, struct task_struct *tsk,
+			  int type, u32 pid, u32 seq, u16 nlmsg_flags)
+{
+	unsigned char *b = skb->tail;
+	struct taskstats *stats;
+	struct nlmsghdr *nlh;
+	struct task_struct *t = tsk;
+
+	nlh = NLMSG_PUT(skb, pid, seq, TASKSTATS_NEW, sizeof(*stats));
+	nlh->nlmsg_flags = nlmsg_flags;
+	stats = NLMSG_DATA(nlh);
+	memset(stats, 0, sizeof(*stats));
+
+	stats->version = TASKSTATS_VERSION;
+	stats->tgid = tsk->tgid;
+	if (type == TASKSTATS_TYPE_TGID) {
+		stats->pid = tsk->tgid;
+		do {
+			taskstats_add(stats, t);
+		} while_each_thread(tsk, t);
+	} else {
+		stats->pid = tsk->pid;
+		taskstats_add(stats, tsk);
+	}
+	return skb->len;
+
+nlmsg_failure:
+	skb_trim(skb, b - skb->data);
+	return -1;
+}
+
+static int taskstats_get(struct sk_buff *in_skb, struct nlmsghdr *nlh)
+{
+	struct taskstats_req *req = NLMSG_DATA(nlh);
+	struct task_struct *tsk;
+	struct sk_buff *rep;
+	int err;
+
+	if (req->type != TASKSTATS_TYPE_PID && req->type != TASKSTATS_TYPE_TGID)
+		return -EINVAL;
+
+	rep = alloc_skb(NLMSG_SPACE(sizeof(struct taskstats)), GFP_KERNEL);
+	if (!rep)
+		return -ENOMEM;
+
+	err = -ESRCH;
+	read_lock(&tasklist_lock);
+	tsk = find_task_by_pid(req->pid);
+	if (tsk && taskstats_fill(rep, tsk, req->type, NETLINK_CB(in_skb).pid,
+				  nlh->nlmsg_seq, 0) > 0)
+		err = 0;
+	read_unlock(&tasklist_lock);
+	if (err) {
+		kfree_skb(rep);
+		return err;
+	}
+
+	err = netlink_unicast(taskstats_sock, rep, NETLINK_CB(in_skb).pid,
+			      MSG_DONTWAIT);
+	return err > 0 ? 0 : err;
+}
+
+/*
+ * Every call fills one skb; cb->args[0] counts the tasks already sent.
+ * Tasks forking or exiting between two calls may be sent twice or not at
+ * all, as with the other netlink dumps.
+ */
+static int taskstats_dump(struct sk_buff *skb, struct netlink_callback *cb)
+{
+	struct task_struct *g, *t;
+	long num = 0, s_num = cb->args[0];
+
+	read_lock(&tasklist_lock);
+	do_each_thread(g, t) {
+		if (num < s_num) {
+			num++;
+			continue;
+		}
+		if (taskstats_fill(skb, t, TASKSTATS_TYPE_PID,
+				   NETLINK_CB(cb->skb).pid,
+				   cb->nlh->nlmsg_seq, NLM_F_MULTI) <= 0)
+			goto out;
+		num++;
+	} while_each_thread(g, t);
+out:
+	read_unlock(&tasklist_lock);
+	cb->args[0] = num;
+	return skb->len;
+}
+
+static int taskstats_dump_done(struct netlink_callback *cb)
+{
+	return 0;
+}
+
+static int taskstats_rcv_msg(struct sk_buff *skb, struct nlmsghdr *nlh)
+{
+	if (!(nlh->nlmsg_flags & NLM_F_REQUEST))
+		return 0;
+
+	if (nlh->nlmsg_type != TASKSTATS_GET)
+		return -EINVAL;
+
+	if (nlh->nlmsg_flags & NLM_F_DUMP)
+		return netlink_dump_start(taskstats_sock, skb, nlh,
+					  taskstats_dump, taskstats_dump_done);
+
+	if (nlh->nlmsg_len < NLMSG_LENGTH(sizeof(struct taskstats_req)))
+		return -EINVAL;
+	return taskstats_get(skb, nlh);
+}
+
+static void taskstats_rcv_skb(struct sk_buff *skb)
+{
+	struct nlmsghdr *nlh;
+	int err;
+
+	if (skb->len >= NLMSG_SPACE(0)) {
+		nlh = (struct nlmsghdr *)skb->data;
+		if (nlh->nlmsg_len < sizeof(*nlh) || skb->len < nlh->nlmsg_len)
+			return;
+		err = taskstats_rcv_msg(skb, nlh);
+		if (err || nlh->nlmsg_flags & NLM_F_ACK)
+			netlink_ack(skb, nlh, err);
+	}
+}
+
+static void taskstats_rcv(struct sock *sk, int len)
+{
+	struct sk_buff *skb;
+
+	while ((skb = skb_dequeue(&sk->sk_receive_queue)) != NULL) {
+		taskstats_rcv_skb(skb);
+		kfree_skb(skb);
+	}
+}
+
+static int __init taskstats_init(void)
+{
+	taskstats_sock = netlink_kernel_create(NETLINK_TASKSTATS, taskstats_rcv);
+	if (!taskstats_sock)
+		printk(KERN_ERR "taskstats: cannot create netlink socket\n");
+	return 0;
+}
+
+__initcall(taskstats_init);
@@ -37,6 +37,7 @@
 
 #include <asm/uaccess.h>
 #include <asm/unistd.h>
+#include <asm/div64.h>
 
 /* 
  * The timezone where the local system is located.  Used as a default by some
@@ -476,6 +477,47 @@ struct timespec timespec_trunc(struct timespec t, unsigned gran)
 }
 EXPORT_SYMBOL(timespec_trunc);
 
+/**
+ * ns_to_timespec - Convert nanoseconds to timespec
+ * @nsec:	the nanoseconds value to be converted
+ *
+ * Returns the timespec representation of the nsec parameter.
+ */
+struct timespec ns_to_timespec(const s64 nsec)
+{
+	struct timespec ts;
+	u64 val;
+	long rem;
+
+	val = nsec < 0 ? -nsec : nsec;
+	rem = do_div(val, NSEC_PER_SEC);
+	if (nsec < 0)
+		set_normalized_timespec(&ts, -(time_t)val, -rem);
+	else {
+		ts.tv_sec = val;
+		ts.tv_nsec = rem;
+	}
+	return ts;
+}
+EXPORT_SYMBOL(ns_to_timespec);
+
+/**
+ * ns_to_timeval - Convert nanoseconds to timeval
+ * @nsec:	the nanoseconds value to be converted
+ *
+ * Returns the timeval representation of the nsec parameter.
+ */
+struct timeval ns_to_timeval(const s64 nsec)
+{
+	struct timespec ts = ns_to_timespec(nsec);
+	struct timeval tv;
+
+	tv.tv_sec = ts.tv_sec;
+	tv.tv_usec = ts.tv_nsec / NSEC_PER_USEC;
+	return tv;
+}
+EXPORT_SYMBOL(ns_to_timeval);
+
 #ifdef CONFIG_TIME_INTERPOLATION
 void getnstimeofday (struct timespec *tv)
 {
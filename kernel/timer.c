@@ -32,6 +32,7 @@
 #include <linux/jiffies.h>
 #include <linux/cpu.h>
 #include <linux/syscalls.h>
+#include <linux/hrtimer.h>
 
 #include <asm/uaccess.h>
 #include <asm/unistd.h>
@@ -111,6 +112,36 @@ static inline void check_timer(struct timer_list *timer)
 		check_timer_failed(timer);
 }
 
+/*
+ * Round the expiry of a deferrable timer up to a multiple of the
+ * largest power of two not above 1/64 of its timeout (and a second),
+ * so that the housekeeping timers armed at about the same time expire
+ * in the same tick instead of waking the cpu up one after the other.
+ * The rounding is skewed by a few jiffies per cpu, to keep per-cpu
+ * housekeeping (cache_reap() for one) from running in lockstep on all
+ * cpus.
+ */
+#define TIMER_SLACK_SHIFT	6
+
+static inline unsigned long timer_round_expires(struct timer_list *timer,
+						unsigned long expires, int cpu)
+{
+	unsigned long mask, skew = cpu * 3;
+	long slack;
+
+	if (!(timer->flags & TIMER_DEFERRABLE))
+		return expires;
+
+	slack = (long) (expires - jiffies) >> TIMER_SLACK_SHIFT;
+	if (slack <= 1)
+		return expires;
+	if (slack > HZ)
+		slack = HZ;
+
+	mask = (1UL << (fls(slack) - 1)) - 1;
+	return ((expires + skew + mask) & ~mask) - skew;
+}
+
 
 static void internal_add_timer(tvec_base_t *base, struct timer_list *timer)
 {
@@ -165,6 +196,7 @@ int __mod_timer(struct timer_list *timer, unsigned long expires)
 	check_timer(timer);
 
 	spin_lock_irqsave(&timer->lock, flags);
+	expires = timer_round_expires(timer, expires, smp_processor_id());
 	new_base = &__get_cpu_var(tvec_bases);
 repeat:
 	old_base = timer->base;
@@ -234,6 +266,7 @@ void add_timer_on(struct timer_list *timer, int cpu)
   	BUG_ON(timer_pending(timer) || !timer->function);
 
 	check_timer(timer);
+	timer->expires = timer_round_expires(timer, timer->expires, cpu);
 
 	spin_lock_irqsave(&base->lock, flags);
 	internal_add_timer(base, timer);
@@ -272,7 +305,9 @@ int mod_timer(struct timer_list *timer, unsigned long expires)
 	 * networking code - if the timer is re-modified
 	 * to be the same thing then just return:
 	 */
-	if (timer->expires == expires && timer_pending(timer))
+	if (timer->expires == timer_round_expires(timer, expires,
+						  _smp_processor_id()) &&
+	    timer_pending(timer))
 		return 1;
 
 	return __mod_timer(timer, expires);
@@ -484,7 +519,9 @@ repeat:
 #ifdef CONFIG_NO_IDLE_HZ
 /*
  * Find out when the next timer event is due to happen. This
- * is used on S/390 to stop all activity when a cpus is idle.
+ * is used on S/390 to stop all activity when a cpus is idle, and
+ * by the hrtimer code to stop the local tick of an idle cpu.
+ * Deferrable timers are ignored: they run at the next tick anyway.
  * This functions needs to be called disabled.
  */
 unsigned long next_timer_interrupt(void)
@@ -505,6 +542,8 @@ unsigned long next_timer_interrupt(void)
 	j = base->timer_jiffies & TVR_MASK;
 	do {
 		list_for_each_entry(nte, base->tv1.vec + j, entry) {
+			if (nte->flags & TIMER_DEFERRABLE)
+				continue;
 			expires = nte->expires;
 			if (j < (base->timer_jiffies & TVR_MASK))
 				list = base->tv2.vec + (INDEX(0));
@@ -521,16 +560,21 @@ unsigned long next_timer_interrupt(void)
 	for (i = 0; i < 4; i++) {
 		j = INDEX(i);
 		do {
-			if (list_empty(varray[i]->vec + j)) {
-				j = (j + 1) & TVN_MASK;
-				continue;
-			}
-			list_for_each_entry(nte, varray[i]->vec + j, entry)
+			int pending = 0;
+
+			list_for_each_entry(nte, varray[i]->vec + j, entry) {
+				if (nte->flags & TIMER_DEFERRABLE)
+					continue;
+				pending = 1;
 				if (time_before(nte->expires, expires))
 					expires = nte->expires;
-			if (j < (INDEX(i)) && i < 3)
-				list = varray[i + 1]->vec + (INDEX(i + 1));
-			goto found;
+			}
+			if (pending) {
+				if (j < (INDEX(i)) && i < 3)
+					list = varray[i + 1]->vec + (INDEX(i + 1));
+				goto found;
+			}
+			j = (j + 1) & TVN_MASK;
 		} while (j != (INDEX(i)));
 	}
 found:
@@ -541,6 +585,8 @@ found:
 		 * where we found the timer element.
 		 */
 		list_for_each_entry(nte, list, entry) {
+			if (nte->flags & TIMER_DEFERRABLE)
+				continue;
 			if (time_before(nte->expires, expires))
 				expires = nte->expires;
 		}
@@ -883,6 +929,7 @@ static void run_timer_softirq(struct softirq_action *h)
 {
 	tvec_base_t *base = &__get_cpu_var(tvec_bases);
 
+	hrtimer_run_queues();
 	if (time_after_eq(jiffies, base->timer_jiffies))
 		__run_timers(base);
 }
@@ -1130,64 +1177,6 @@ asmlinkage long sys_gettid(void)
 	return current->pid;
 }
 
-static long __sched nanosleep_restart(struct restart_block *restart)
-{
-	unsigned long expire = restart->arg0, now = jiffies;
-	struct timespec __user *rmtp = (struct timespec __user *) restart->arg1;
-	long ret;
-
-	/* Did it expire while we handled signals? */
-	if (!time_after(expire, now))
-		return 0;
-
-	current->state = TASK_INTERRUPTIBLE;
-	expire = schedule_timeout(expire - now);
-
-	ret = 0;
-	if (expire) {
-		struct timespec t;
-		jiffies_to_timespec(expire, &t);
-
-		ret = -ERESTART_RESTARTBLOCK;
-		if (rmtp && copy_to_user(rmtp, &t, sizeof(t)))
-			ret = -EFAULT;
-		/* The 'restart' block is already filled in */
-	}
-	return ret;
-}
-
-asmlinkage long sys_nanosleep(struct timespec __user *rqtp, struct timespec __user *rmtp)
-{
-	struct timespec t;
-	unsigned long expire;
-	long ret;
-
-	if (copy_from_user(&t, rqtp, sizeof(t)))
-		return -EFAULT;
-
-	if ((t.tv_nsec >= 1000000000L) || (t.tv_nsec < 0) || (t.tv_sec < 0))
-		return -EINVAL;
-
-	expire = timespec_to_jiffies(&t) + (t.tv_sec || t.tv_nsec);
-	current->state = TASK_INTERRUPTIBLE;
-	expire = schedule_timeout(expire);
-
-	ret = 0;
-	if (expire) {
-		struct restart_block *restart;
-		jiffies_to_timespec(expire, &t);
-		if (rmtp && copy_to_user(rmtp, &t, sizeof(t)))
-			return -EFAULT;
-
-		restart = &current_thread_info()->restart_block;
-		restart->fn = nanosleep_restart;
-		restart->arg0 = jiffies + expire;
-		restart->arg1 = (unsigned long) rmtp;
-		ret = -ERESTART_RESTARTBLOCK;
-	}
-	return ret;
-}
-
 /*
  * sys_sysinfo - fill in sysinfo struct
  */ 
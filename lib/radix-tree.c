@@ -29,6 +29,7 @@
 #include <linux/gfp.h>
 #include <linux/string.h>
 #include <linux/bitops.h>
+#include <linux/rcupdate.h>
 
 
 #ifdef __KERNEL__
@@ -45,7 +46,9 @@
 	((RADIX_TREE_MAP_SIZE + BITS_PER_LONG - 1) / BITS_PER_LONG)
 
 struct radix_tree_node {
+	unsigned int	height;		/* Height from the bottom */
 	unsigned int	count;
+	struct rcu_head	rcu_head;
 	void		*slots[RADIX_TREE_MAP_SIZE];
 	unsigned long	tags[RADIX_TREE_TAGS][RADIX_TREE_TAG_LONGS];
 };
@@ -97,10 +100,22 @@ radix_tree_node_alloc(struct radix_tree_root *root)
 	return ret;
 }
 
+static void radix_tree_node_rcu_free(struct rcu_head *head)
+{
+	struct radix_tree_node *node =
+			container_of(head, struct radix_tree_node, rcu_head);
+
+	kmem_cache_free(radix_tree_node_cachep, node);
+}
+
+/*
+ * Lockless lookups may still be walking the node: it goes back to the slab
+ * after a grace period.  It is empty, so they find nothing in it.
+ */
 static inline void
 radix_tree_node_free(struct radix_tree_node *node)
 {
-	kmem_cache_free(radix_tree_node_cachep, node);
+	call_rcu(&node->rcu_head, radix_tree_node_rcu_free);
 }
 
 /*
@@ -208,8 +223,9 @@ static int radix_tree_extend(struct radix_tree_root *root, unsigned long index)
 				tag_set(node, tag, 0);
 		}
 
+		node->height = root->height + 1;
 		node->count = 1;
-		root->rnode = node;
+		rcu_assign_pointer(root->rnode, node);
 		root->height++;
 	} while (height > root->height);
 out:
@@ -250,7 +266,8 @@ int radix_tree_insert(struct radix_tree_root *root,
 			/* Have to add a child node.  */
 			if (!(tmp = radix_tree_node_alloc(root)))
 				return -ENOMEM;
-			*slot = tmp;
+			tmp->height = height;
+			rcu_assign_pointer(*slot, tmp);
 			if (node)
 				node->count++;
 		}
@@ -271,42 +288,70 @@ int radix_tree_insert(struct radix_tree_root *root,
 		BUG_ON(tag_get(node, 1, offset));
 	}
 
-	*slot = item;
+	rcu_assign_pointer(*slot, item);
 	return 0;
 }
 EXPORT_SYMBOL(radix_tree_insert);
 
 /**
- *	radix_tree_lookup    -    perform lookup operation on a radix tree
+ *	radix_tree_lookup_slot    -    lookup a slot in a radix tree
  *	@root:		radix tree root
  *	@index:		index key
  *
- *	Lookup the item at the position @index in the radix tree @root.
+ *	Returns the slot of the item at the position @index in the radix tree
+ *	@root, or NULL.  Under rcu_read_lock() the slot may be emptied or
+ *	reused at any time: read it with radix_tree_deref_slot() and check it
+ *	again after pinning the item.
  */
-void *radix_tree_lookup(struct radix_tree_root *root, unsigned long index)
+void **radix_tree_lookup_slot(struct radix_tree_root *root, unsigned long index)
 {
 	unsigned int height, shift;
-	struct radix_tree_node **slot;
+	struct radix_tree_node *node, **slot;
 
-	height = root->height;
+	/*
+	 * Take the height from the top node, not from the root: a
+	 * concurrent radix_tree_extend() may have pushed a new one.
+	 */
+	node = rcu_dereference(root->rnode);
+	if (node == NULL)
+		return NULL;
+
+	height = node->height;
 	if (index > radix_tree_maxindex(height))
 		return NULL;
 
 	shift = (height-1) * RADIX_TREE_MAP_SHIFT;
-	slot = &root->rnode;
-
-	while (height > 0) {
-		if (*slot == NULL)
-			return NULL;
 
+	for ( ; ; ) {
 		slot = (struct radix_tree_node **)
-			((*slot)->slots +
-				((index >> shift) & RADIX_TREE_MAP_MASK));
+			(node->slots + ((index >> shift) & RADIX_TREE_MAP_MASK));
+		if (--height == 0)
+			break;
+		node = rcu_dereference(*slot);
+		if (node == NULL)
+			return NULL;
 		shift -= RADIX_TREE_MAP_SHIFT;
-		height--;
 	}
 
-	return *slot;
+	return (void **)slot;
+}
+EXPORT_SYMBOL(radix_tree_lookup_slot);
+
+/**
+ *	radix_tree_lookup    -    perform lookup operation on a radix tree
+ *	@root:		radix tree root
+ *	@index:		index key
+ *
+ *	Lookup the item at the position @index in the radix tree @root.  May
+ *	be called under rcu_read_lock() instead of the lock serializing the
+ *	updates of the tree, see radix_tree_lookup_slot().
+ */
+void *radix_tree_lookup(struct radix_tree_root *root, unsigned long index)
+{
+	void **slot;
+
+	slot = radix_tree_lookup_slot(root, index);
+	return slot != NULL ? radix_tree_deref_slot(slot) : NULL;
 }
 EXPORT_SYMBOL(radix_tree_lookup);
 
@@ -468,16 +513,14 @@ EXPORT_SYMBOL(radix_tree_tag_get);
 #endif
 
 static unsigned int
-__lookup(struct radix_tree_root *root, void **results, unsigned long index,
+__lookup(struct radix_tree_node *slot, void ***results, unsigned long index,
 	unsigned int max_items, unsigned long *next_index)
 {
 	unsigned int nr_found = 0;
 	unsigned int shift;
-	unsigned int height = root->height;
-	struct radix_tree_node *slot;
+	unsigned int height = slot->height;
 
 	shift = (height-1) * RADIX_TREE_MAP_SHIFT;
-	slot = root->rnode;
 
 	while (height > 0) {
 		unsigned long i = (index >> shift) & RADIX_TREE_MAP_MASK;
@@ -499,14 +542,16 @@ __lookup(struct radix_tree_root *root, void **results, unsigned long index,
 			for ( ; j < RADIX_TREE_MAP_SIZE; j++) {
 				index++;
 				if (slot->slots[j]) {
-					results[nr_found++] = slot->slots[j];
+					results[nr_found++] = &slot->slots[j];
 					if (nr_found == max_items)
 						goto out;
 				}
 			}
 		}
 		shift -= RADIX_TREE_MAP_SHIFT;
-		slot = slot->slots[i];
+		slot = rcu_dereference(slot->slots[i]);
+		if (slot == NULL)
+			goto out;	/* deleted under a lockless lookup */
 	}
 out:
 	*next_index = index;
@@ -514,33 +559,37 @@ out:
 }
 
 /**
- *	radix_tree_gang_lookup - perform multiple lookup on a radix tree
+ *	radix_tree_gang_lookup_slot - perform multiple slot lookup on a radix tree
  *	@root:		radix tree root
  *	@results:	where the results of the lookup are placed
  *	@first_index:	start the lookup from this key
  *	@max_items:	place up to this many items at *results
  *
- *	Performs an index-ascending scan of the tree for present items.  Places
- *	them at *@results and returns the number of items which were placed at
- *	*@results.
- *
- *	The implementation is naive.
+ *	Like radix_tree_gang_lookup(), but places the slots of the items at
+ *	*@results.  Under rcu_read_lock() the same rules as for
+ *	radix_tree_lookup_slot() apply to every slot.
  */
 unsigned int
-radix_tree_gang_lookup(struct radix_tree_root *root, void **results,
+radix_tree_gang_lookup_slot(struct radix_tree_root *root, void ***results,
 			unsigned long first_index, unsigned int max_items)
 {
-	const unsigned long max_index = radix_tree_maxindex(root->height);
+	unsigned long max_index;
+	struct radix_tree_node *node;
 	unsigned long cur_index = first_index;
 	unsigned int ret = 0;
 
+	node = rcu_dereference(root->rnode);
+	if (node == NULL)
+		return 0;
+	max_index = radix_tree_maxindex(node->height);
+
 	while (ret < max_items) {
 		unsigned int nr_found;
 		unsigned long next_index;	/* Index of next search */
 
 		if (cur_index > max_index)
 			break;
-		nr_found = __lookup(root, results + ret, cur_index,
+		nr_found = __lookup(node, results + ret, cur_index,
 					max_items - ret, &next_index);
 		ret += nr_found;
 		if (next_index == 0)
@@ -549,6 +598,37 @@ radix_tree_gang_lookup(struct radix_tree_root *root, void **results,
 	}
 	return ret;
 }
+EXPORT_SYMBOL(radix_tree_gang_lookup_slot);
+
+/**
+ *	radix_tree_gang_lookup - perform multiple lookup on a radix tree
+ *	@root:		radix tree root
+ *	@results:	where the results of the lookup are placed
+ *	@first_index:	start the lookup from this key
+ *	@max_items:	place up to this many items at *results
+ *
+ *	Performs an index-ascending scan of the tree for present items.  Places
+ *	them at *@results and returns the number of items which were placed at
+ *	*@results.  May be called under rcu_read_lock(); an item deleted
+ *	meanwhile may or may not be returned.
+ *
+ *	The implementation is naive.
+ */
+unsigned int
+radix_tree_gang_lookup(struct radix_tree_root *root, void **results,
+			unsigned long first_index, unsigned int max_items)
+{
+	unsigned int i, j, ret;
+
+	ret = radix_tree_gang_lookup_slot(root, (void ***)results,
+					  first_index, max_items);
+	for (i = j = 0; i < ret; i++) {
+		results[j] = radix_tree_deref_slot((void **)results[i]);
+		if (results[j])
+			j++;
+	}
+	return j;
+}
 EXPORT_SYMBOL(radix_tree_gang_lookup);
 
 /*
@@ -717,6 +797,10 @@ void *radix_tree_delete(struct radix_tree_root *root, unsigned long index)
 		pathp--;
 	} while (pathp[0].node && nr_cleared_tags);
 
+	/*
+	 * The emptied nodes are freed through RCU, see
+	 * radix_tree_node_free().
+	 */
 	pathp = orig_pathp;
 	*pathp[0].slot = NULL;
 	while (pathp[0].node && --pathp[0].node->count == 0) {
@@ -0,0 +1,298 @@
+/*
+ *  linux/mm/compaction.c
+ *
+ *  Reclaim frees the pages the LRU picks, wherever they are, so once
+ *  memory has been full of page cache and anonymous memory the free pages
+ *  are scattered over the zones, and an allocation of a few contiguous
+ *  pages can fail with plenty of memory free.  Compaction empties aligned
+ *  blocks of pages by moving the pages in use in them elsewhere.
+ */
+
+#include <linux/mm.h>
+#include <linux/swap.h>
+#include <linux/pagemap.h>
+#include <linux/mm_inline.h>
+#include <linux/sysctl.h>
+#include <linux/smp.h>
+
+#include "internal.h"
+
+/*
+ * Count the pages in use in the block of 2^order pages at pfn, -1 if one
+ * of them cannot be moved.  Only done to pick a block, so without locks.
+ */
+static int block_used_pages(unsigned long pfn, int order)
+{
+	unsigned long end = pfn + (1UL << order);
+	struct page *page;
+	int used = 0;
+
+	while (pfn < end) {
+		page = pfn_to_page(pfn);
+		if (PageReserved(page) || PageCompound(page))
+			return -1;
+		if (PagePrivate(page) && !page_count(page)) {
+			/* Free, page->private is the order of the buddy */
+			if (page->private >= MAX_ORDER)
+				return -1;
+			pfn += 1UL << page->private;
+			continue;
+		}
+		if (!PageLRU(page) || PageWriteback(page))
+			return -1;
+		used++;
+		pfn++;
+	}
+	return used;
+}
+
+/*
+ * Take the pages of the block off the LRU, with a reference each.
+ */
+static void isolate_block(struct zone *zone, unsigned long pfn, int order,
+			  struct list_head *pages)
+{
+	unsigned long end = pfn + (1UL << order);
+	struct page *page;
+
+	spin_lock_irq(&zone->lru_lock);
+	for (; pfn < end; pfn++) {
+		page = pfn_to_page(pfn);
+		if (!TestClearPageLRU(page))
+			continue;
+		if (get_page_testone(page)) {
+			/* It is being freed elsewhere */
+			__put_page(page);
+			SetPageLRU(page);
+			continue;
+		}
+		if (PageActive(page))
+			del_page_from_active_list(zone, page);
+		else
+			del_page_from_inactive_list(zone, page);
+		list_add_tail(&page->lru, pages);
+	}
+	spin_unlock_irq(&zone->lru_lock);
+}
+
+/*
+ * Give back a page taken by isolate_block(): free it if it was moved,
+ * or freed meanwhile, put it back on the LRU otherwise.
+ */
+static void putback_page(struct page *page)
+{
+	struct zone *zone = page_zone(page);
+
+	if (page_count(page) == 1) {
+		ClearPageActive(page);
+		page_cache_release(page);
+		return;
+	}
+
+	spin_lock_irq(&zone->lru_lock);
+	if (TestSetPageLRU(page))
+		BUG();
+	if (PageActive(page))
+		add_page_to_active_list(zone, page);
+	else
+		add_page_to_inactive_list(zone, page);
+	spin_unlock_irq(&zone->lru_lock);
+	page_cache_release(page);
+}
+
+/*
+ * Allocate a page to move page to, outside of the block [start, end).
+ * The free pages of the block the allocator hands out meanwhile are kept
+ * on the held list until the block is done.  The block is off the LRU
+ * and the caller may be in the allocator already, so this neither
+ * sleeps nor reclaims: the zone is above its high watermark anyway.
+ */
+static struct page *alloc_migrate_target(struct page *page,
+		unsigned long start, unsigned long end, struct list_head *held)
+{
+	unsigned int gfp_mask = GFP_HIGHUSER;
+	struct page *newpage;
+	unsigned long pfn;
+
+	if (!PageAnon(page) && !PageSwapCache(page) && page->mapping)
+		gfp_mask = mapping_gfp_mask(page->mapping);
+	gfp_mask &= ~(__GFP_WAIT | __GFP_IO | __GFP_FS);
+	gfp_mask |= __GFP_MOVABLE | __GFP_NORETRY | __GFP_NOWARN;
+
+	for ( ; ; ) {
+		newpage = alloc_pages_node(page_to_nid(page), gfp_mask, 0);
+		if (!newpage)
+			return NULL;
+		pfn = page_to_pfn(newpage);
+		if (pfn < start || pfn >= end)
+			return newpage;
+		list_add(&newpage->lru, held);
+	}
+}
+
+/*
+ * Move all the pages in use out of the block of 2^order pages at start.
+ * Gives up at the first page which cannot be moved.
+ */
+static int compact_block(struct zone *zone, unsigned long start, int order)
+{
+	unsigned long end = start + (1UL << order);
+	LIST_HEAD(pages);
+	LIST_HEAD(held);
+	struct page *page, *newpage;
+	int failed = 0;
+	int rc;
+
+	isolate_block(zone, start, order, &pages);
+
+	while (!list_empty(&pages)) {
+		page = list_entry(pages.next, struct page, lru);
+		list_del(&page->lru);
+
+		rc = -EAGAIN;
+		if (page_count(page) == 1)
+			rc = 0;
+		else if (!failed) {
+			/* Allocate before taking the page lock */
+			newpage = alloc_migrate_target(page, start, end, &held);
+			if (newpage && !TestSetPageLocked(page)) {
+				rc = migrate_page(page, newpage);
+				if (rc)
+					inc_page_state(pgmigrate_fail);
+				else
+					inc_page_state(pgmigrate_success);
+				unlock_page(page);
+			}
+			if (newpage)
+				page_cache_release(newpage);
+		}
+		if (rc)
+			failed++;
+		putback_page(page);
+	}
+
+	while (!list_empty(&held)) {
+		page = list_entry(held.next, struct page, lru);
+		list_del(&page->lru);
+		__free_page(page);
+	}
+	return failed ? -EAGAIN : 0;
+}
+
+static void drain_cpu_pages(void *dummy)
+{
+	drain_local_pages();
+}
+
+/*
+ * Empty up to nr_blocks blocks of 2^order pages of the zone, picking the
+ * ones with at most half of their pages in use: moving more would cost
+ * more free pages than it gains.  The zone must stay above its high
+ * watermark meanwhile.  Returns the number of blocks found free
+ * afterwards.
+ */
+static unsigned long compact_zone(struct zone *zone, int order,
+				  unsigned long nr_blocks)
+{
+	unsigned long nr_pages = 1UL << order;
+	unsigned long pfn, end, done = 0;
+	int used;
+
+	/* The pages parked in the per-cpu lists would look in use */
+	drain_zeroed_pages(zone);
+	on_each_cpu(drain_cpu_pages, NULL, 0, 1);
+
+	pfn = ALIGN(zone->zone_start_pfn, nr_pages);
+	end = zone->zone_start_pfn + zone->spanned_pages;
+	for ( ; pfn + nr_pages <= end && done < nr_blocks; pfn += nr_pages) {
+		if (zone->free_pages < zone->pages_high + nr_pages)
+			break;
+		used = block_used_pages(pfn, order);
+		if (used < 0 || used > nr_pages / 2)
+			continue;
+		if (used && compact_block(zone, pfn, order))
+			continue;
+		/*
+		 * A page may have been skipped by isolate_block(), or freed
+		 * to this cpu's per-cpu list: count the block only if all of
+		 * it is back in the buddy allocator.
+		 */
+		drain_local_pages();
+		if (!block_used_pages(pfn, order))
+			done++;
+		cond_resched();
+	}
+
+	/* Where the moved pages were freed to */
+	on_each_cpu(drain_cpu_pages, NULL, 0, 1);
+	return done;
+}
+
+/*
+ * Every failure doubles the number of allocations which skip the zone
+ * before it is compacted again, up to 1 << COMPACT_MAX_DEFER_SHIFT.
+ */
+#define COMPACT_MAX_DEFER_SHIFT	6
+
+static void defer_compaction(struct zone *zone)
+{
+	zone->compact_considered = 0;
+	if (zone->compact_defer_shift < COMPACT_MAX_DEFER_SHIFT)
+		zone->compact_defer_shift++;
+}
+
+static int compaction_deferred(struct zone *zone)
+{
+	if (++zone->compact_considered > 1U << zone->compact_defer_shift) {
+		zone->compact_considered = 0;
+		return 0;
+	}
+	return 1;
+}
+
+/*
+ * Called by __alloc_pages() when an allocation of 2^order pages fails:
+ * returns 1 if a block of that order was emptied in one of the zones.
+ * Zones where compaction failed recently are left alone.
+ */
+int try_to_compact_pages(struct zone **zones, int order)
+{
+	struct zone *zone;
+	int i, stalled = 0;
+
+	for (i = 0; (zone = zones[i]) != NULL; i++) {
+		if (zone->free_pages < zone->pages_high + (1UL << order))
+			continue;
+		if (zone->compact_defer_shift && compaction_deferred(zone))
+			continue;
+		if (!stalled++)
+			inc_page_state(compact_stall);
+		if (compact_zone(zone, order, 1)) {
+			zone->compact_defer_shift = 0;
+			inc_page_state(compact_success);
+			return 1;
+		}
+		defer_compaction(zone);
+	}
+	return 0;
+}
+
+int sysctl_compact_memory;
+
+/*
+ * Writing anything to /proc/sys/vm/compact_memory empties all the blocks
+ * of the largest order which can be emptied.
+ */
+int sysctl_compaction_handler(ctl_table *table, int write,
+		struct file *file, void __user *buffer, size_t *length,
+		loff_t *ppos)
+{
+	struct zone *zone;
+
+	proc_dointvec(table, write, file, buffer, length, ppos);
+	if (write)
+		for_each_zone(zone)
+			if (zone->present_pages)
+				compact_zone(zone, MAX_ORDER - 1, ~0UL);
+	return 0;
+}
@@ -131,12 +131,13 @@ void remove_from_page_cache(struct page *page)
 	spin_unlock_irq(&mapping->tree_lock);
 }
 
-static int sync_page(void *word)
+/*
+ * Kick the I/O that will unlock the page (or end its writeback) without
+ * waiting for it.
+ */
+static void unplug_page_io(struct page *page)
 {
 	struct address_space *mapping;
-	struct page *page;
-
-	page = container_of((page_flags_t *)word, struct page, flags);
 
 	/*
 	 * FIXME, fercrissake.  What is this barrier here for?
@@ -145,6 +146,15 @@ static int sync_page(void *word)
 	mapping = page_mapping(page);
 	if (mapping && mapping->a_ops && mapping->a_ops->sync_page)
 		mapping->a_ops->sync_page(page);
+}
+
+static int sync_page(void *word)
+{
+	struct page *page;
+
+	page = container_of((page_flags_t *)word, struct page, flags);
+
+	unplug_page_io(page);
 	io_schedule();
 	return 0;
 }
@@ -338,8 +348,9 @@ int filemap_write_and_wait(struct address_space *mapping)
 
 /*
  * This function is used to add newly allocated pagecache pages:
- * the page is new, so we can just run SetPageLocked() against it.
- * The other page state flags were set by rmqueue().
+ * the page is new, so we can just lock it.  The other page state flags
+ * were set by rmqueue().  move_from_swap_cache() passes a page it has
+ * locked already; that lock is left alone if the page cannot be added.
  *
  * This function does not add the page to the LRU.  The caller must do that.
  */
@@ -347,20 +358,32 @@ int add_to_page_cache(struct page *page, struct address_space *mapping,
 		pgoff_t offset, int gfp_mask)
 {
 	int error = radix_tree_preload(gfp_mask & ~__GFP_HIGHMEM);
+	int locked;
 
 	if (error == 0) {
+		/*
+		 * Lockless lookups may find the page as soon as it is in the
+		 * tree: it must be pinned, locked and know its place first.
+		 */
+		page_cache_get(page);
+		locked = TestSetPageLocked(page);
+		page->mapping = mapping;
+		page->index = offset;
+
 		spin_lock_irq(&mapping->tree_lock);
 		error = radix_tree_insert(&mapping->page_tree, offset, page);
 		if (!error) {
-			page_cache_get(page);
-			SetPageLocked(page);
-			page->mapping = mapping;
-			page->index = offset;
 			mapping->nrpages++;
 			pagecache_acct(1);
 		}
 		spin_unlock_irq(&mapping->tree_lock);
 		radix_tree_preload_end();
+		if (unlikely(error)) {
+			page->mapping = NULL;
+			if (!locked)
+				ClearPageLocked(page);
+			__put_page(page);
+		}
 	}
 	return error;
 }
@@ -464,10 +487,67 @@ void fastcall __lock_page(struct page *page)
 }
 EXPORT_SYMBOL(__lock_page);
 
+/*
+ * Slow path of lock_page_async(). The async wait queue entry is keyed like
+ * a wait_bit_queue, so that aio_wake_function() can filter out wakeups for
+ * other pages hashing to the same wait queue. The entry is queued before
+ * testing the bit, so an unlock racing with us cannot be missed.
+ */
+int fastcall __lock_page_async(struct page *page, wait_queue_t *wait)
+{
+	wait_queue_head_t *wqh = page_waitqueue(page);
+	struct wait_bit_queue *q;
+
+	if (is_sync_wait(wait)) {
+		__lock_page(page);
+		return 0;
+	}
+
+	q = container_of(wait, struct wait_bit_queue, wait);
+	q->key.flags = &page->flags;
+	q->key.bit_nr = PG_locked;
+
+	prepare_to_wait(wqh, wait, TASK_UNINTERRUPTIBLE);
+	if (TestSetPageLocked(page)) {
+		unplug_page_io(page);
+		return -EIOCBRETRY;
+	}
+	finish_wait(wqh, wait);
+	return 0;
+}
+EXPORT_SYMBOL(__lock_page_async);
+
 /*
  * a rather lightweight function, finding and getting a reference to a
  * hashed page atomically.
  */
+#if PAGECACHE_LOCKLESS
+struct page * find_get_page(struct address_space *mapping, unsigned long offset)
+{
+	void **pagep;
+	struct page *page;
+
+	rcu_read_lock();
+repeat:
+	page = NULL;
+	pagep = radix_tree_lookup_slot(&mapping->page_tree, offset);
+	if (pagep) {
+		page = radix_tree_deref_slot(pagep);
+		if (unlikely(!page))
+			goto out;
+		if (!page_cache_get_speculative(page))
+			goto repeat;
+		/* Has the page been freed and reused under us? */
+		if (unlikely(page != radix_tree_deref_slot(pagep))) {
+			page_cache_release(page);
+			goto repeat;
+		}
+	}
+out:
+	rcu_read_unlock();
+	return page;
+}
+#else
 struct page * find_get_page(struct address_space *mapping, unsigned long offset)
 {
 	struct page *page;
@@ -479,6 +559,7 @@ struct page * find_get_page(struct address_space *mapping, unsigned long offset)
 	spin_unlock_irq(&mapping->tree_lock);
 	return page;
 }
+#endif
 
 EXPORT_SYMBOL(find_get_page);
 
@@ -515,25 +596,18 @@ struct page *find_lock_page(struct address_space *mapping,
 {
 	struct page *page;
 
-	spin_lock_irq(&mapping->tree_lock);
 repeat:
-	page = radix_tree_lookup(&mapping->page_tree, offset);
+	page = find_get_page(mapping, offset);
 	if (page) {
-		page_cache_get(page);
-		if (TestSetPageLocked(page)) {
-			spin_unlock_irq(&mapping->tree_lock);
-			lock_page(page);
-			spin_lock_irq(&mapping->tree_lock);
-
-			/* Has the page been truncated while we slept? */
-			if (page->mapping != mapping || page->index != offset) {
-				unlock_page(page);
-				page_cache_release(page);
-				goto repeat;
-			}
+		lock_page(page);
+		/* Has the page been truncated while we slept? */
+		if (unlikely(page->mapping != mapping ||
+			     page->index != offset)) {
+			unlock_page(page);
+			page_cache_release(page);
+			goto repeat;
 		}
 	}
-	spin_unlock_irq(&mapping->tree_lock);
 	return page;
 }
 
@@ -601,6 +675,38 @@ EXPORT_SYMBOL(find_or_create_page);
  *
  * find_get_pages() returns the number of pages which were found.
  */
+#if PAGECACHE_LOCKLESS
+unsigned find_get_pages(struct address_space *mapping, pgoff_t start,
+			    unsigned int nr_pages, struct page **pages)
+{
+	unsigned int i;
+	unsigned int ret;
+	unsigned int nr_found;
+
+	rcu_read_lock();
+	/* The slots go to @pages first, each is replaced by its page */
+	nr_found = radix_tree_gang_lookup_slot(&mapping->page_tree,
+				(void ***)pages, start, nr_pages);
+	ret = 0;
+	for (i = 0; i < nr_found; i++) {
+		void **pagep = (void **)pages[i];
+		struct page *page;
+repeat:
+		page = radix_tree_deref_slot(pagep);
+		if (unlikely(!page))
+			continue;
+		if (!page_cache_get_speculative(page))
+			goto repeat;
+		if (unlikely(page != radix_tree_deref_slot(pagep))) {
+			page_cache_release(page);
+			goto repeat;
+		}
+		pages[ret++] = page;
+	}
+	rcu_read_unlock();
+	return ret;
+}
+#else
 unsigned find_get_pages(struct address_space *mapping, pgoff_t start,
 			    unsigned int nr_pages, struct page **pages)
 {
@@ -615,6 +721,7 @@ unsigned find_get_pages(struct address_space *mapping, pgoff_t start,
 	spin_unlock_irq(&mapping->tree_lock);
 	return ret;
 }
+#endif
 
 /*
  * Like find_get_pages, except we only return pages which are tagged with
@@ -782,7 +889,8 @@ page_ok:
 
 page_not_up_to_date:
 		/* Get exclusive access to the page ... */
-		lock_page(page);
+		if (lock_page_async(page, current->io_wait))
+			goto retry_later;
 
 		/* Did it get unhashed before we got the lock? */
 		if (!page->mapping) {
@@ -805,7 +913,12 @@ readpage:
 			goto readpage_error;
 
 		if (!PageUptodate(page)) {
-			lock_page(page);
+			/*
+			 * The read has been submitted: an aio retry will find
+			 * the page uptodate once it gets unlocked.
+			 */
+			if (lock_page_async(page, current->io_wait))
+				goto retry_later;
 			if (!PageUptodate(page)) {
 				if (page->mapping == NULL) {
 					/*
@@ -855,6 +968,15 @@ readpage_error:
 		page_cache_release(page);
 		goto out;
 
+retry_later:
+		/*
+		 * We are running on behalf of an aio retry and the page is
+		 * locked: the iocb will be kicked when it gets unlocked.
+		 */
+		desc->error = -EIOCBRETRY;
+		page_cache_release(page);
+		goto out;
+
 no_cached_page:
 		/*
 		 * Ok, it wasn't cached, so we need to create a new
@@ -1004,6 +1126,9 @@ __generic_file_aio_read(struct kiocb *iocb, const struct iovec *iov,
 				retval = desc.error;
 				break;
 			}
+			/* aio will retry the rest of the read */
+			if (desc.error == -EIOCBRETRY)
+				break;
 		}
 	}
 out:
@@ -1012,13 +1137,22 @@ out:
 
 EXPORT_SYMBOL(__generic_file_aio_read);
 
+ssize_t
+generic_file_aio_readv(struct kiocb *iocb, const struct iovec *iov,
+			unsigned long nr_segs, loff_t pos)
+{
+	BUG_ON(iocb->ki_pos != pos);
+	return __generic_file_aio_read(iocb, iov, nr_segs, &iocb->ki_pos);
+}
+
+EXPORT_SYMBOL(generic_file_aio_readv);
+
 ssize_t
 generic_file_aio_read(struct kiocb *iocb, char __user *buf, size_t count, loff_t pos)
 {
 	struct iovec local_iov = { .iov_base = buf, .iov_len = count };
 
-	BUG_ON(iocb->ki_pos != pos);
-	return __generic_file_aio_read(iocb, &local_iov, 1, &iocb->ki_pos);
+	return generic_file_aio_readv(iocb, &local_iov, 1, pos);
 }
 
 EXPORT_SYMBOL(generic_file_aio_read);
@@ -2170,20 +2304,18 @@ generic_file_write_nolock(struct file *file, const struct iovec *iov,
 }
 EXPORT_SYMBOL(generic_file_write_nolock);
 
-ssize_t generic_file_aio_write(struct kiocb *iocb, const char __user *buf,
-			       size_t count, loff_t pos)
+ssize_t generic_file_aio_writev(struct kiocb *iocb, const struct iovec *iov,
+				unsigned long nr_segs, loff_t pos)
 {
 	struct file *file = iocb->ki_filp;
 	struct address_space *mapping = file->f_mapping;
 	struct inode *inode = mapping->host;
 	ssize_t ret;
-	struct iovec local_iov = { .iov_base = (void __user *)buf,
-					.iov_len = count };
 
 	BUG_ON(iocb->ki_pos != pos);
 
 	down(&inode->i_sem);
-	ret = __generic_file_aio_write_nolock(iocb, &local_iov, 1,
+	ret = __generic_file_aio_write_nolock(iocb, iov, nr_segs,
 						&iocb->ki_pos);
 	up(&inode->i_sem);
 
@@ -2196,6 +2328,16 @@ ssize_t generic_file_aio_write(struct kiocb *iocb, const char __user *buf,
 	}
 	return ret;
 }
+EXPORT_SYMBOL(generic_file_aio_writev);
+
+ssize_t generic_file_aio_write(struct kiocb *iocb, const char __user *buf,
+			       size_t count, loff_t pos)
+{
+	struct iovec local_iov = { .iov_base = (void __user *)buf,
+					.iov_len = count };
+
+	return generic_file_aio_writev(iocb, &local_iov, 1, pos);
+}
 EXPORT_SYMBOL(generic_file_aio_write);
 
 ssize_t generic_file_write(struct file *file, const char __user *buf,
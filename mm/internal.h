@@ -11,3 +11,21 @@
 
 /* page_alloc.c */
 extern void set_page_refs(struct page *page, int order);
+extern void drain_local_pages(void);
+#ifdef CONFIG_PREZERO_PAGES
+extern void drain_zeroed_pages(struct zone *zone);
+#else
+static inline void drain_zeroed_pages(struct zone *zone)
+{
+}
+#endif
+
+/* compaction.c */
+#ifdef CONFIG_COMPACTION
+extern int try_to_compact_pages(struct zone **zones, int order);
+#else
+static inline int try_to_compact_pages(struct zone **zones, int order)
+{
+	return 0;
+}
+#endif
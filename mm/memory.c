@@ -49,6 +49,7 @@
 #include <linux/acct.h>
 #include <linux/module.h>
 #include <linux/init.h>
+#include <linux/delayacct.h>
 
 #include <asm/pgalloc.h>
 #include <asm/uaccess.h>
@@ -104,6 +105,7 @@ static inline void clear_pmd_range(struct mmu_gather *tlb, pmd_t *pmd, unsigned
 		pmd_clear(pmd);
 		dec_page_state(nr_page_table_pages);
 		tlb->mm->nr_ptes--;
+		pte_lock_deinit(page);
 		pte_free_tlb(tlb, page);
 	}
 }
@@ -211,8 +213,15 @@ pte_t fastcall * pte_alloc_map(struct mm_struct *mm, pmd_t *pmd, unsigned long a
 			pte_free(new);
 			goto out;
 		}
+		pte_lock_init(new);
 		mm->nr_ptes++;
 		inc_page_state(nr_page_table_pages);
+		/*
+		 * Page faults walk the page tables without the
+		 * page_table_lock: the cleared ptes and the pte lock
+		 * have to be visible before the pmd is.
+		 */
+		smp_wmb();
 		pmd_populate(mm, pmd, new);
 	}
 out:
@@ -313,9 +322,9 @@ copy_one_pte(struct mm_struct *dst_mm,  struct mm_struct *src_mm,
 		pte = pte_mkclean(pte);
 	pte = pte_mkold(pte);
 	get_page(page);
-	dst_mm->rss++;
+	inc_mm_counter(dst_mm, rss);
 	if (PageAnon(page))
-		dst_mm->anon_rss++;
+		inc_mm_counter(dst_mm, anon_rss);
 	set_pte(dst_pte, pte);
 	page_dup_rmap(page);
 }
@@ -457,6 +466,7 @@ static void zap_pte_range(struct mmu_gather *tlb,
 {
 	unsigned long offset;
 	pte_t *ptep;
+	spinlock_t *ptl;
 
 	if (pmd_none(*pmd))
 		return;
@@ -465,6 +475,7 @@ static void zap_pte_range(struct mmu_gather *tlb,
 		pmd_clear(pmd);
 		return;
 	}
+	ptl = pte_lock_nested(tlb->mm, pmd);
 	ptep = pte_offset_map(pmd, address);
 	offset = address & ~PMD_MASK;
 	if (offset + size > PMD_SIZE)
@@ -513,7 +524,7 @@ static void zap_pte_range(struct mmu_gather *tlb,
 			if (pte_dirty(pte))
 				set_page_dirty(page);
 			if (PageAnon(page))
-				tlb->mm->anon_rss--;
+				dec_mm_counter(tlb->mm, anon_rss);
 			else if (pte_young(pte))
 				mark_page_accessed(page);
 			tlb->freed++;
@@ -532,6 +543,7 @@ static void zap_pte_range(struct mmu_gather *tlb,
 		pte_clear(ptep);
 	}
 	pte_unmap(ptep-1);
+	pte_unlock_nested(ptl);
 }
 
 static void zap_pmd_range(struct mmu_gather *tlb,
@@ -741,21 +753,24 @@ void zap_page_range(struct vm_area_struct *vma, unsigned long address,
 
 /*
  * Do a quick page-table lookup for a single page.
- * mm->page_table_lock must be held.
+ * mm->page_table_lock must be held.  With get, a reference to the page
+ * is taken while a page fault cannot replace it yet.
  */
 static struct page *
-__follow_page(struct mm_struct *mm, unsigned long address, int read, int write)
+__follow_page(struct mm_struct *mm, unsigned long address, int read, int write,
+	      int get)
 {
 	pgd_t *pgd;
 	pud_t *pud;
 	pmd_t *pmd;
 	pte_t *ptep, pte;
+	spinlock_t *ptl;
 	unsigned long pfn;
 	struct page *page;
 
 	page = follow_huge_addr(mm, address, write);
 	if (! IS_ERR(page))
-		return page;
+		goto huge;
 
 	pgd = pgd_offset(mm, address);
 	if (pgd_none(*pgd) || unlikely(pgd_bad(*pgd)))
@@ -768,44 +783,56 @@ __follow_page(struct mm_struct *mm, unsigned long address, int read, int write)
 	pmd = pmd_offset(pud, address);
 	if (pmd_none(*pmd) || unlikely(pmd_bad(*pmd)))
 		goto out;
-	if (pmd_huge(*pmd))
-		return follow_huge_pmd(mm, address, pmd, write);
+	if (pmd_huge(*pmd)) {
+		page = follow_huge_pmd(mm, address, pmd, write);
+		goto huge;
+	}
 
 	ptep = pte_offset_map(pmd, address);
 	if (!ptep)
 		goto out;
 
+	ptl = pte_lock_nested(mm, pmd);
 	pte = *ptep;
 	pte_unmap(ptep);
 	if (pte_present(pte)) {
 		if (write && !pte_write(pte))
-			goto out;
+			goto unlock;
 		if (read && !pte_read(pte))
-			goto out;
+			goto unlock;
 		pfn = pte_pfn(pte);
 		if (pfn_valid(pfn)) {
 			page = pfn_to_page(pfn);
+			if (get && !PageReserved(page))
+				page_cache_get(page);
+			pte_unlock_nested(ptl);
 			if (write && !pte_dirty(pte) && !PageDirty(page))
 				set_page_dirty(page);
 			mark_page_accessed(page);
 			return page;
 		}
 	}
-
+unlock:
+	pte_unlock_nested(ptl);
 out:
 	return NULL;
+
+huge:
+	if (get && page)
+		page_cache_get(page);
+	return page;
 }
 
 struct page *
 follow_page(struct mm_struct *mm, unsigned long address, int write)
 {
-	return __follow_page(mm, address, /*read*/0, write);
+	return __follow_page(mm, address, /*read*/0, write, /*get*/0);
 }
 
 int
 check_user_page_readable(struct mm_struct *mm, unsigned long address)
 {
-	return __follow_page(mm, address, /*read*/1, /*write*/0) != NULL;
+	return __follow_page(mm, address, /*read*/1, /*write*/0, /*get*/0) != NULL;
 }
 
 EXPORT_SYMBOL(check_user_page_readable);
@@ -922,7 +949,8 @@ int get_user_pages(struct task_struct *tsk, struct mm_struct *mm,
 			int lookup_write = write;
 
 			cond_resched_lock(&mm->page_table_lock);
-			while (!(map = follow_page(mm, start, lookup_write))) {
+			while (!(map = __follow_page(mm, start, /*read*/0,
+						     lookup_write, pages != NULL))) {
 				/*
 				 * Shortcut for anonymous pages. We don't want
 				 * to force the creation of pages tables for
@@ -961,6 +989,7 @@ int get_user_pages(struct task_struct *tsk, struct mm_struct *mm,
 				spin_lock(&mm->page_table_lock);
 			}
 			if (pages) {
+				/* __follow_page() took the reference */
 				pages[i] = get_page_map(map);
 				if (!pages[i]) {
 					spin_unlock(&mm->page_table_lock);
@@ -970,8 +999,6 @@ int get_user_pages(struct task_struct *tsk, struct mm_struct *mm,
 					goto out;
 				}
 				flush_dcache_page(pages[i]);
-				if (!PageReserved(pages[i]))
-					page_cache_get(pages[i]);
 			}
 			if (vmas)
 				vmas[i] = vma;
@@ -1017,9 +1044,12 @@ static inline int zeromap_pmd_range(struct mm_struct *mm, pmd_t * pmd,
 		end = PUD_SIZE;
 	do {
 		pte_t * pte = pte_alloc_map(mm, pmd, base + address);
+		spinlock_t *ptl;
 		if (!pte)
 			return -ENOMEM;
+		ptl = pte_lock_nested(mm, pmd);
 		zeromap_pte_range(pte, base + address, end - address, prot);
+		pte_unlock_nested(ptl);
 		pte_unmap(pte);
 		address = (address + PMD_SIZE) & PMD_MASK;
 		pmd++;
@@ -1240,7 +1270,7 @@ static inline pte_t maybe_mkwrite(pte_t pte, struct vm_area_struct *vma)
 }
 
 /*
- * We hold the mm semaphore for reading and vma->vm_mm->page_table_lock
+ * We hold the mm semaphore for reading and the pte lock
  */
 static inline void break_cow(struct vm_area_struct * vma, struct page * new_page, unsigned long address, 
 		pte_t *page_table)
@@ -1271,8 +1301,8 @@ static inline void break_cow(struct vm_area_struct * vma, struct page * new_page
  * change only once the write actually happens. This avoids a few races,
  * and potentially makes it more efficient.
  *
- * We hold the mm semaphore and the page_table_lock on entry and exit
- * with the page_table_lock released.
+ * We hold the mm semaphore and the pte lock on entry and exit
+ * with the pte lock released.
  */
 static int do_wp_page(struct mm_struct *mm, struct vm_area_struct * vma,
 	unsigned long address, pte_t *page_table, pmd_t *pmd, pte_t pte)
@@ -1280,6 +1310,7 @@ static int do_wp_page(struct mm_struct *mm, struct vm_area_struct * vma,
 	struct page *old_page, *new_page;
 	unsigned long pfn = pte_pfn(pte);
 	pte_t entry;
+	spinlock_t *ptl = pte_lockptr(mm, pmd);
 
 	if (unlikely(!pfn_valid(pfn))) {
 		/*
@@ -1290,7 +1321,7 @@ static int do_wp_page(struct mm_struct *mm, struct vm_area_struct * vma,
 		pte_unmap(page_table);
 		printk(KERN_ERR "do_wp_page: bogus page at address %08lx\n",
 				address);
-		spin_unlock(&mm->page_table_lock);
+		spin_unlock(ptl);
 		return VM_FAULT_OOM;
 	}
 	old_page = pfn_to_page(pfn);
@@ -1299,13 +1330,14 @@ static int do_wp_page(struct mm_struct *mm, struct vm_area_struct * vma,
 		int reuse = can_share_swap_page(old_page);
 		unlock_page(old_page);
 		if (reuse) {
+			task_numa_fault(page_to_nid(old_page));
 			flush_cache_page(vma, address);
 			entry = maybe_mkwrite(pte_mkyoung(pte_mkdirty(pte)),
 					      vma);
 			ptep_set_access_flags(vma, address, page_table, entry, 1);
 			update_mmu_cache(vma, address, entry);
 			pte_unmap(page_table);
-			spin_unlock(&mm->page_table_lock);
+			spin_unlock(ptl);
 			return VM_FAULT_MINOR;
 		}
 	}
@@ -1316,7 +1348,7 @@ static int do_wp_page(struct mm_struct *mm, struct vm_area_struct * vma,
 	 */
 	if (!PageReserved(old_page))
 		page_cache_get(old_page);
-	spin_unlock(&mm->page_table_lock);
+	spin_unlock(ptl);
 
 	if (unlikely(anon_vma_prepare(vma)))
 		goto no_new_page;
@@ -1325,7 +1357,7 @@ static int do_wp_page(struct mm_struct *mm, struct vm_area_struct * vma,
 		if (!new_page)
 			goto no_new_page;
 	} else {
-		new_page = alloc_page_vma(GFP_HIGHUSER, vma, address);
+		new_page = alloc_page_vma(GFP_HIGHUSER_MOVABLE, vma, address);
 		if (!new_page)
 			goto no_new_page;
 		copy_user_highpage(new_page, old_page, address);
@@ -1333,13 +1365,13 @@ static int do_wp_page(struct mm_struct *mm, struct vm_area_struct * vma,
 	/*
 	 * Re-check the pte - we dropped the lock
 	 */
-	spin_lock(&mm->page_table_lock);
+	spin_lock(ptl);
 	page_table = pte_offset_map(pmd, address);
 	if (likely(pte_same(*page_table, pte))) {
 		if (PageAnon(old_page))
-			mm->anon_rss--;
+			dec_mm_counter(mm, anon_rss);
 		if (PageReserved(old_page)) {
-			++mm->rss;
+			inc_mm_counter(mm, rss);
 			acct_update_integrals();
 			update_mem_hiwater();
 		} else
@@ -1347,6 +1379,7 @@ static int do_wp_page(struct mm_struct *mm, struct vm_area_struct * vma,
 		break_cow(vma, new_page, address, page_table);
 		lru_cache_add_active(new_page);
 		page_add_anon_rmap(new_page, vma, address);
+		task_numa_fault(page_to_nid(new_page));
 
 		/* Free the old page.. */
 		new_page = old_page;
@@ -1354,7 +1387,7 @@ static int do_wp_page(struct mm_struct *mm, struct vm_area_struct * vma,
 	pte_unmap(page_table);
 	page_cache_release(new_page);
 	page_cache_release(old_page);
-	spin_unlock(&mm->page_table_lock);
+	spin_unlock(ptl);
 	return VM_FAULT_MINOR;
 
 no_new_page:
@@ -1682,8 +1715,8 @@ void swapin_readahead(swp_entry_t entry, unsigned long addr,struct vm_area_struc
 }
 
 /*
- * We hold the mm semaphore and the page_table_lock on entry and
- * should release the pagetable lock on exit..
+ * We hold the mm semaphore and the pte lock on entry and
+ * should release it on exit..
  */
 static int do_swap_page(struct mm_struct * mm,
 	struct vm_area_struct * vma, unsigned long address,
@@ -1693,26 +1726,29 @@ static int do_swap_page(struct mm_struct * mm,
 	swp_entry_t entry = pte_to_swp_entry(orig_pte);
 	pte_t pte;
 	int ret = VM_FAULT_MINOR;
+	spinlock_t *ptl = pte_lockptr(mm, pmd);
 
 	pte_unmap(page_table);
-	spin_unlock(&mm->page_table_lock);
+	spin_unlock(ptl);
+	delayacct_set_flag(DELAYACCT_PF_SWAPIN);
 	page = lookup_swap_cache(entry);
 	if (!page) {
  		swapin_readahead(entry, address, vma);
  		page = read_swap_cache_async(entry, vma, address);
 		if (!page) {
+			delayacct_clear_flag(DELAYACCT_PF_SWAPIN);
 			/*
 			 * Back out if somebody else faulted in this pte while
 			 * we released the page table lock.
 			 */
-			spin_lock(&mm->page_table_lock);
+			spin_lock(ptl);
 			page_table = pte_offset_map(pmd, address);
 			if (likely(pte_same(*page_table, orig_pte)))
 				ret = VM_FAULT_OOM;
 			else
 				ret = VM_FAULT_MINOR;
 			pte_unmap(page_table);
-			spin_unlock(&mm->page_table_lock);
+			spin_unlock(ptl);
 			goto out;
 		}
 
@@ -1724,16 +1760,17 @@ static int do_swap_page(struct mm_struct * mm,
 
 	mark_page_accessed(page);
 	lock_page(page);
+	delayacct_clear_flag(DELAYACCT_PF_SWAPIN);
 
 	/*
 	 * Back out if somebody else faulted in this pte while we
 	 * released the page table lock.
 	 */
-	spin_lock(&mm->page_table_lock);
+	spin_lock(ptl);
 	page_table = pte_offset_map(pmd, address);
 	if (unlikely(!pte_same(*page_table, orig_pte))) {
 		pte_unmap(page_table);
-		spin_unlock(&mm->page_table_lock);
+		spin_unlock(ptl);
 		unlock_page(page);
 		page_cache_release(page);
 		ret = VM_FAULT_MINOR;
@@ -1746,7 +1783,7 @@ static int do_swap_page(struct mm_struct * mm,
 	if (vm_swap_full())
 		remove_exclusive_swap_page(page);
 
-	mm->rss++;
+	inc_mm_counter(mm, rss);
 	acct_update_integrals();
 	update_mem_hiwater();
 
@@ -1760,6 +1797,7 @@ static int do_swap_page(struct mm_struct * mm,
 	flush_icache_page(vma, page);
 	set_pte(page_table, pte);
 	page_add_anon_rmap(page, vma, address);
+	task_numa_fault(page_to_nid(page));
 
 	if (write_access) {
 		if (do_wp_page(mm, vma, address,
@@ -1771,14 +1809,14 @@ static int do_swap_page(struct mm_struct * mm,
 	/* No need to invalidate - it was non-present before */
 	update_mmu_cache(vma, address, pte);
 	pte_unmap(page_table);
-	spin_unlock(&mm->page_table_lock);
+	spin_unlock(ptl);
 out:
 	return ret;
 }
 
 /*
- * We are called with the MM semaphore and page_table_lock
- * spinlock held to protect against concurrent faults in
+ * We are called with the MM semaphore and the pte lock
+ * held to protect against concurrent faults in
  * multithreaded programs. 
  */
 static int
@@ -1788,6 +1826,7 @@ do_anonymous_page(struct mm_struct *mm, struct vm_area_struct *vma,
 {
 	pte_t entry;
 	struct page * page = ZERO_PAGE(addr);
+	spinlock_t *ptl = pte_lockptr(mm, pmd);
 
 	/* Read-only mapping of ZERO_PAGE. */
 	entry = pte_wrprotect(mk_pte(ZERO_PAGE(addr), vma->vm_page_prot));
@@ -1796,7 +1835,7 @@ do_anonymous_page(struct mm_struct *mm, struct vm_area_struct *vma,
 	if (write_access) {
 		/* Allocate our own private page. */
 		pte_unmap(page_table);
-		spin_unlock(&mm->page_table_lock);
+		spin_unlock(ptl);
 
 		if (unlikely(anon_vma_prepare(vma)))
 			goto no_mem;
@@ -1804,16 +1843,16 @@ do_anonymous_page(struct mm_struct *mm, struct vm_area_struct *vma,
 		if (!page)
 			goto no_mem;
 
-		spin_lock(&mm->page_table_lock);
+		spin_lock(ptl);
 		page_table = pte_offset_map(pmd, addr);
 
 		if (!pte_none(*page_table)) {
 			pte_unmap(page_table);
 			page_cache_release(page);
-			spin_unlock(&mm->page_table_lock);
+			spin_unlock(ptl);
 			goto out;
 		}
-		mm->rss++;
+		inc_mm_counter(mm, rss);
 		acct_update_integrals();
 		update_mem_hiwater();
 		entry = maybe_mkwrite(pte_mkdirty(mk_pte(page,
@@ -1822,6 +1861,7 @@ do_anonymous_page(struct mm_struct *mm, struct vm_area_struct *vma,
 		lru_cache_add_active(page);
 		SetPageReferenced(page);
 		page_add_anon_rmap(page, vma, addr);
+		task_numa_fault(page_to_nid(page));
 	}
 
 	set_pte(page_table, entry);
@@ -1829,7 +1869,7 @@ do_anonymous_page(struct mm_struct *mm, struct vm_area_struct *vma,
 
 	/* No need to invalidate - it was non-present before */
 	update_mmu_cache(vma, addr, entry);
-	spin_unlock(&mm->page_table_lock);
+	spin_unlock(ptl);
 out:
 	return VM_FAULT_MINOR;
 no_mem:
@@ -1845,8 +1885,8 @@ no_mem:
  * As this is called only for pages that do not currently exist, we
  * do not need to flush old virtual caches or the TLB.
  *
- * This is called with the MM semaphore held and the page table
- * spinlock held. Exit with the spinlock released.
+ * This is called with the MM semaphore held and the pte lock
+ * held. Exit with the lock released.
  */
 static int
 do_no_page(struct mm_struct *mm, struct vm_area_struct *vma,
@@ -1858,12 +1898,13 @@ do_no_page(struct mm_struct *mm, struct vm_area_struct *vma,
 	unsigned int sequence = 0;
 	int ret = VM_FAULT_MINOR;
 	int anon = 0;
+	spinlock_t *ptl = pte_lockptr(mm, pmd);
 
 	if (!vma->vm_ops || !vma->vm_ops->nopage)
 		return do_anonymous_page(mm, vma, page_table,
 					pmd, write_access, address);
 	pte_unmap(page_table);
-	spin_unlock(&mm->page_table_lock);
+	spin_unlock(ptl);
 
 	if (vma->vm_file) {
 		mapping = vma->vm_file->f_mapping;
@@ -1895,7 +1936,7 @@ retry:
 
 		if (unlikely(anon_vma_prepare(vma)))
 			goto oom;
-		page = alloc_page_vma(GFP_HIGHUSER, vma, address);
+		page = alloc_page_vma(GFP_HIGHUSER_MOVABLE, vma, address);
 		if (!page)
 			goto oom;
 		copy_user_highpage(page, new_page, address);
@@ -1904,7 +1945,7 @@ retry:
 		anon = 1;
 	}
 
-	spin_lock(&mm->page_table_lock);
+	spin_lock(ptl);
 	/*
 	 * For a file-backed vma, someone could have truncated or otherwise
 	 * invalidated this page.  If unmap_mapping_range got called,
@@ -1912,7 +1953,7 @@ retry:
 	 */
 	if (mapping && unlikely(sequence != mapping->truncate_count)) {
 		sequence = mapping->truncate_count;
-		spin_unlock(&mm->page_table_lock);
+		spin_unlock(ptl);
 		page_cache_release(new_page);
 		goto retry;
 	}
@@ -1931,7 +1972,7 @@ retry:
 	/* Only go through if we didn't race with anybody else... */
 	if (pte_none(*page_table)) {
 		if (!PageReserved(new_page))
-			++mm->rss;
+			inc_mm_counter(mm, rss);
 		acct_update_integrals();
 		update_mem_hiwater();
 
@@ -1945,18 +1986,19 @@ retry:
 			page_add_anon_rmap(new_page, vma, address);
 		} else
 			page_add_file_rmap(new_page);
+		task_numa_fault(page_to_nid(new_page));
 		pte_unmap(page_table);
 	} else {
 		/* One of our sibling threads was faster, back out. */
 		pte_unmap(page_table);
 		page_cache_release(new_page);
-		spin_unlock(&mm->page_table_lock);
+		spin_unlock(ptl);
 		goto out;
 	}
 
 	/* no need to invalidate: a not-present page shouldn't be cached */
 	update_mmu_cache(vma, address, entry);
-	spin_unlock(&mm->page_table_lock);
+	spin_unlock(ptl);
 out:
 	return ret;
 oom:
@@ -1975,6 +2017,7 @@ static int do_file_page(struct mm_struct * mm, struct vm_area_struct * vma,
 {
 	unsigned long pgoff;
 	int err;
+	spinlock_t *ptl = pte_lockptr(mm, pmd);
 
 	BUG_ON(!vma->vm_ops || !vma->vm_ops->nopage);
 	/*
@@ -1990,7 +2033,7 @@ static int do_file_page(struct mm_struct * mm, struct vm_area_struct * vma,
 	pgoff = pte_to_pgoff(*pte);
 
 	pte_unmap(pte);
-	spin_unlock(&mm->page_table_lock);
+	spin_unlock(ptl);
 
 	err = vma->vm_ops->populate(vma, address & PAGE_MASK, PAGE_SIZE, vma->vm_page_prot, pgoff, 0);
 	if (err == -ENOMEM)
@@ -2009,7 +2052,7 @@ static int do_file_page(struct mm_struct * mm, struct vm_area_struct * vma,
  * with external mmu caches can use to update those (ie the Sparc or
  * PowerPC hashed page tables that act as extended TLBs).
  *
- * Note the "page_table_lock". It is to protect against kswapd removing
+ * Note the pte lock. It is to protect against kswapd removing
  * pages from under us. Note that kswapd only ever _removes_ pages, never
  * adds them. As such, once we have noticed that the page is not present,
  * we can drop the lock early.
@@ -2018,7 +2061,7 @@ static int do_file_page(struct mm_struct * mm, struct vm_area_struct * vma,
  * so we don't need to worry about a page being suddenly been added into
  * our VM.
  *
- * We enter with the pagetable spinlock held, we are supposed to
+ * We enter with the pte lock held, we are supposed to
  * release it when done.
  */
 static inline int handle_pte_fault(struct mm_struct *mm,
@@ -2026,6 +2069,7 @@ static inline int handle_pte_fault(struct mm_struct *mm,
 	int write_access, pte_t *pte, pmd_t *pmd)
 {
 	pte_t entry;
+	spinlock_t *ptl = pte_lockptr(mm, pmd);
 
 	entry = *pte;
 	if (!pte_present(entry)) {
@@ -2051,7 +2095,7 @@ static inline int handle_pte_fault(struct mm_struct *mm,
 	ptep_set_access_flags(vma, address, pte, entry, write_access);
 	update_mmu_cache(vma, address, entry);
 	pte_unmap(pte);
-	spin_unlock(&mm->page_table_lock);
+	spin_unlock(ptl);
 	return VM_FAULT_MINOR;
 }
 
@@ -2074,10 +2118,25 @@ int handle_mm_fault(struct mm_struct *mm, struct vm_area_struct * vma,
 		return VM_FAULT_SIGBUS;	/* mapping truncation does this. */
 
 	/*
-	 * We need the page table lock to synchronize with kswapd
-	 * and the SMP-safe atomic PTE updates.
+	 * Page tables are only freed with the mm semaphore held for
+	 * writing, so the upper levels can be walked without a lock;
+	 * the page_table_lock is needed only to allocate a missing one.
+	 * The pte lock then synchronizes with kswapd and the SMP-safe
+	 * atomic PTE updates.
 	 */
 	pgd = pgd_offset(mm, address);
+	if (unlikely(pgd_none(*pgd)))
+		goto alloc;
+	pud = pud_offset(pgd, address);
+	if (unlikely(pud_none(*pud)))
+		goto alloc;
+	pmd = pmd_offset(pud, address);
+	if (unlikely(!pmd_present(*pmd)))
+		goto alloc;
+	pte = pte_offset_map(pmd, address);
+	goto found;
+
+ alloc:
 	spin_lock(&mm->page_table_lock);
 
 	pud = pud_alloc(mm, pgd, address);
@@ -2091,7 +2150,10 @@ int handle_mm_fault(struct mm_struct *mm, struct vm_area_struct * vma,
 	pte = pte_alloc_map(mm, pmd, address);
 	if (!pte)
 		goto oom;
-	
+	spin_unlock(&mm->page_table_lock);
+
+ found:
+	spin_lock(pte_lockptr(mm, pmd));
 	return handle_pte_fault(mm, vma, address, write_access, pte, pmd);
 
  oom:
@@ -2127,6 +2189,7 @@ pud_t fastcall *__pud_alloc(struct mm_struct *mm, pgd_t *pgd, unsigned long addr
 		pud_free(new);
 		goto out;
 	}
+	smp_wmb();	/* see pte_alloc_map() */
 	pgd_populate(mm, pgd, new);
  out:
 	return pud_offset(pgd, address);
@@ -2159,6 +2222,7 @@ pmd_t fastcall *__pmd_alloc(struct mm_struct *mm, pud_t *pud, unsigned long addr
 		pmd_free(new);
 		goto out;
 	}
+	smp_wmb();	/* see pte_alloc_map() */
 	pud_populate(mm, pud, new);
  out:
 	return pmd_offset(pud, address);
@@ -2182,6 +2246,7 @@ pmd_t fastcall *__pmd_alloc(struct mm_struct *mm, pud_t *pud, unsigned long addr
 		pmd_free(new);
 		goto out;
 	}
+	smp_wmb();	/* see pte_alloc_map() */
 	pgd_populate(mm, pud, new);
 out:
 	return pmd_offset(pud, address);
@@ -2258,8 +2323,8 @@ void update_mem_hiwater(void)
 	struct task_struct *tsk = current;
 
 	if (tsk->mm) {
-		if (tsk->mm->hiwater_rss < tsk->mm->rss)
-			tsk->mm->hiwater_rss = tsk->mm->rss;
+		if (tsk->mm->hiwater_rss < get_mm_counter(tsk->mm, rss))
+			tsk->mm->hiwater_rss = get_mm_counter(tsk->mm, rss);
 		if (tsk->mm->hiwater_vm < tsk->mm->total_vm)
 			tsk->mm->hiwater_vm = tsk->mm->total_vm;
 	}
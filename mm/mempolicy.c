@@ -75,6 +75,9 @@
 #include <linux/init.h>
 #include <linux/compat.h>
 #include <linux/mempolicy.h>
+#include <linux/rmap.h>
+#include <linux/swap.h>
+#include <linux/pagemap.h>
 #include <asm/tlbflush.h>
 #include <asm/uaccess.h>
 
@@ -899,6 +902,155 @@ int mpol_node_valid(int nid, struct vm_area_struct *vma, unsigned long addr)
 	}
 }
 
+/*
+ * Replace the anonymous page mapped by *ptep with a copy in new.  Only
+ * pages mapped once and not in the swap cache are moved: nothing but this
+ * pte knows about them.  Called with the pte lock held; returns 1
+ * if new was used.
+ */
+static int migrate_anon_pte(struct vm_area_struct *vma, unsigned long addr,
+			    pte_t *ptep, struct page *new)
+{
+	struct page *page;
+	unsigned long pfn;
+	pte_t pte = *ptep, entry;
+
+	if (!pte_present(pte))
+		return 0;
+	pfn = pte_pfn(pte);
+	if (!pfn_valid(pfn))
+		return 0;
+	page = pfn_to_page(pfn);
+	if (PageReserved(page) || !PageAnon(page) || PageSwapCache(page) ||
+	    page_to_nid(page) == page_to_nid(new))
+		return 0;
+	/* the page lock keeps vmscan away, the counts anybody else */
+	if (TestSetPageLocked(page))
+		return 0;
+	if (page_mapcount(page) != 1 || page_count(page) != 1) {
+		unlock_page(page);
+		return 0;
+	}
+
+	flush_cache_page(vma, addr);
+	pte = ptep_clear_flush(vma, addr, ptep);
+	copy_user_highpage(new, page, addr);
+
+	entry = mk_pte(new, vma->vm_page_prot);
+	if (pte_write(pte))
+		entry = pte_mkwrite(entry);
+	if (pte_dirty(pte))
+		entry = pte_mkdirty(entry);
+	if (pte_young(pte))
+		entry = pte_mkyoung(entry);
+	lru_cache_add_active(new);
+	dec_mm_counter(vma->vm_mm, anon_rss);
+	page_add_anon_rmap(new, vma, addr);
+	set_pte(ptep, entry);
+	update_mmu_cache(vma, addr, entry);
+
+	page_remove_rmap(page);
+	unlock_page(page);
+	page_cache_release(page);
+	return 1;
+}
+
+/**
+ * migrate_mm_to_node - move the private anonymous memory of an mm to a node
+ * @mm: the address space, the caller holds a reference on it
+ * @nid: the node to move the pages to
+ * @addr: where to start the scan, updated to where it stopped
+ * @nr_ptes: how many page table entries to look at
+ *
+ * Used by the scheduler when a task has been moved to another node for
+ * good (see task_numa_placement()).  Vmas with a memory policy are left
+ * alone.  Returns 1 if the scan stopped on @nr_ptes and should be
+ * continued from *@addr, 0 when it reached the end of the address space
+ * or @nid ran out of memory.
+ */
+int migrate_mm_to_node(struct mm_struct *mm, int nid,
+		       unsigned long *addr, unsigned long nr_ptes)
+{
+	struct vm_area_struct *vma;
+	struct page *new = NULL;
+	unsigned long start = *addr;
+	int more = 1;
+
+	down_read(&mm->mmap_sem);
+	for (vma = find_vma(mm, start); vma; vma = vma->vm_next) {
+		if (start < vma->vm_start)
+			start = vma->vm_start;
+		if (!vma->anon_vma || vma->vm_policy ||
+		    (vma->vm_flags & (VM_SHARED | VM_IO | VM_RESERVED)) ||
+		    is_vm_hugetlb_page(vma))
+			continue;
+
+		while (start < vma->vm_end) {
+			pgd_t *pgd;
+			pud_t *pud;
+			pmd_t *pmd;
+			pte_t *pte;
+			spinlock_t *ptl;
+
+			if (!nr_ptes--)
+				goto out;
+			if (!new) {
+				new = alloc_pages_node(nid, GFP_HIGHUSER_MOVABLE |
+						__GFP_NORETRY | __GFP_NOWARN, 0);
+				if (!new || page_to_nid(new) != nid) {
+					more = 0;
+					goto out;
+				}
+			}
+
+			spin_lock(&mm->page_table_lock);
+			pgd = pgd_offset(mm, start);
+			if (pgd_none(*pgd) || pgd_bad(*pgd)) {
+				spin_unlock(&mm->page_table_lock);
+				start = (start + PGDIR_SIZE) & PGDIR_MASK;
+				if (!start)
+					break;
+				continue;
+			}
+			pud = pud_offset(pgd, start);
+			if (pud_none(*pud) || pud_bad(*pud)) {
+				spin_unlock(&mm->page_table_lock);
+				start = (start + PUD_SIZE) & PUD_MASK;
+				if (!start)
+					break;
+				continue;
+			}
+			pmd = pmd_offset(pud, start);
+			if (pmd_none(*pmd) || pmd_bad(*pmd)) {
+				spin_unlock(&mm->page_table_lock);
+				start = (start + PMD_SIZE) & PMD_MASK;
+				if (!start)
+					break;
+				continue;
+			}
+			ptl = pte_lock_nested(mm, pmd);
+			pte = pte_offset_map(pmd, start);
+			if (migrate_anon_pte(vma, start, pte, new))
+				new = NULL;
+			pte_unmap(pte);
+			pte_unlock_nested(ptl);
+			spin_unlock(&mm->page_table_lock);
+			start += PAGE_SIZE;
+			cond_resched();
+		}
+		if (!start)
+			break;
+	}
+	more = 0;
+	start = 0;
+out:
+	up_read(&mm->mmap_sem);
+	if (new)
+		__free_page(new);
+	*addr = start;
+	return more;
+}
+
 /*
  * Shared memory backing store policy support.
  *
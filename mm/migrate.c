@@ -0,0 +1,133 @@
+/*
+ *  linux/mm/migrate.c
+ *
+ *  Moving a page to another place in memory: the new page gets the
+ *  contents of the old one, its slot in the page cache or swap cache and
+ *  its ptes, and the old one is left to the caller to free.
+ */
+
+#include <linux/mm.h>
+#include <linux/swap.h>
+#include <linux/pagemap.h>
+#include <linux/highmem.h>
+#include <linux/buffer_head.h>	/* for try_to_release_page() */
+#include <linux/rmap.h>
+
+static void migrate_page_copy(struct page *newpage, struct page *page)
+{
+	copy_highpage(newpage, page);
+
+	if (PageError(page))
+		SetPageError(newpage);
+	if (PageReferenced(page))
+		SetPageReferenced(newpage);
+	if (PageUptodate(page))
+		SetPageUptodate(newpage);
+	if (PageChecked(page))
+		SetPageChecked(newpage);
+	if (PageMappedToDisk(page))
+		SetPageMappedToDisk(newpage);
+}
+
+/*
+ * Put newpage in the page cache or swap cache slot of page.  The count of
+ * page is frozen meanwhile, so that the lockless lookups cannot pin it:
+ * the page cache and the caller must hold the only references.
+ */
+static int migrate_page_mapping(struct address_space *mapping,
+				struct page *page, struct page *newpage)
+{
+	pgoff_t index = PageSwapCache(page) ? page->private : page->index;
+	void **pslot;
+
+	spin_lock_irq(&mapping->tree_lock);
+	pslot = radix_tree_lookup_slot(&mapping->page_tree, index);
+	if (!pslot || radix_tree_deref_slot(pslot) != page ||
+	    !page_freeze_refs(page, 2)) {
+		spin_unlock_irq(&mapping->tree_lock);
+		return -EAGAIN;
+	}
+
+	get_page(newpage);	/* The pagecache ref */
+	newpage->index = page->index;
+	newpage->mapping = page->mapping;
+	/* The radix tree tags stay with the slot */
+	if (PageDirty(page)) {
+		ClearPageDirty(page);
+		SetPageDirty(newpage);
+	}
+#ifdef CONFIG_SWAP
+	if (PageSwapCache(page)) {
+		SetPageSwapCache(newpage);
+		newpage->private = page->private;
+		ClearPageSwapCache(page);
+		page->private = 0;
+	} else
+#endif
+		page->mapping = NULL;
+	rcu_assign_pointer(*pslot, newpage);
+
+	page_unfreeze_refs(page, 2);
+	spin_unlock_irq(&mapping->tree_lock);
+	__put_page(page);	/* The pagecache ref */
+	return 0;
+}
+
+/**
+ * migrate_page - move a page to another page
+ * @page: the page, locked and taken off the LRU by the caller
+ * @newpage: a newly allocated page
+ *
+ * Page cache and swap cache pages are unmapped first, and the faults find
+ * @newpage in their place.  The ptes of other anonymous pages are pointed
+ * at @newpage directly, through the anon_vma.  @newpage is put on the LRU
+ * if it took over anything at all.
+ *
+ * Returns 0 when nobody but the caller holds @page anymore, -EBUSY when
+ * it cannot be moved for now (writeback, dirty buffers, mlock) and
+ * -EAGAIN when somebody else uses it.
+ */
+int migrate_page(struct page *page, struct page *newpage)
+{
+	struct address_space *mapping;
+	int rc = -EAGAIN;
+
+	BUG_ON(!PageLocked(page));
+	BUG_ON(PageLRU(page));
+
+	if (PageWriteback(page))
+		return -EBUSY;
+	if (PagePrivate(page) &&
+	    (PageDirty(page) || !try_to_release_page(page, 0)))
+		return -EBUSY;
+
+	SetPageLocked(newpage);
+
+	if (PageAnon(page) && !PageSwapCache(page)) {
+		if (page_wrprotect_anon(page) != SWAP_SUCCESS) {
+			rc = -EBUSY;
+			goto out;
+		}
+		/* The ptes and the caller */
+		if (page_count(page) != page_mapcount(page) + 1)
+			goto out;
+		migrate_page_copy(newpage, page);
+		page_move_anon_ptes(page, newpage);
+		if (!page_mapped(page))
+			rc = 0;
+	} else if ((mapping = page_mapping(page)) != NULL) {
+		if (page_mapped(page) && try_to_unmap(page, 1) != SWAP_SUCCESS)
+			goto out;
+		migrate_page_copy(newpage, page);
+		rc = migrate_page_mapping(mapping, page, newpage);
+	}
+out:
+	if (page_count(newpage) > 1) {
+		if (PageActive(page))
+			lru_cache_add_active(newpage);
+		else
+			lru_cache_add(newpage);
+	}
+	unlock_page(newpage);
+	return rc;
+}
@@ -18,8 +18,8 @@
 #include <asm/tlbflush.h>
 
 /*
- * Called with mm->page_table_lock held to protect against other
- * threads/the swapper from ripping pte's out from under us.
+ * Called with mm->page_table_lock and the pte lock held to protect
+ * against other threads/the swapper from ripping pte's out from under us.
  */
 static int filemap_sync_pte(pte_t *ptep, struct vm_area_struct *vma,
 	unsigned long address, unsigned int flags)
@@ -43,6 +43,7 @@ static int filemap_sync_pte_range(pmd_t * pmd,
 	struct vm_area_struct *vma, unsigned int flags)
 {
 	pte_t *pte;
+	spinlock_t *ptl;
 	int error;
 
 	if (pmd_none(*pmd))
@@ -52,6 +53,7 @@ static int filemap_sync_pte_range(pmd_t * pmd,
 		pmd_clear(pmd);
 		return 0;
 	}
+	ptl = pte_lock_nested(vma->vm_mm, pmd);
 	pte = pte_offset_map(pmd, address);
 	if ((address & PMD_MASK) != (end & PMD_MASK))
 		end = (address & PMD_MASK) + PMD_SIZE;
@@ -63,6 +65,7 @@ static int filemap_sync_pte_range(pmd_t * pmd,
 	} while (address && (address < end));
 
 	pte_unmap(pte - 1);
+	pte_unlock_nested(ptl);
 
 	return error;
 }
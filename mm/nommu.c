@@ -964,8 +964,8 @@ void update_mem_hiwater(void)
 	struct task_struct *tsk = current;
 
 	if (likely(tsk->mm)) {
-		if (tsk->mm->hiwater_rss < tsk->mm->rss)
-			tsk->mm->hiwater_rss = tsk->mm->rss;
+		if (tsk->mm->hiwater_rss < get_mm_counter(tsk->mm, rss))
+			tsk->mm->hiwater_rss = get_mm_counter(tsk->mm, rss);
 		if (tsk->mm->hiwater_vm < tsk->mm->total_vm)
 			tsk->mm->hiwater_vm = tsk->mm->total_vm;
 	}
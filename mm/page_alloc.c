@@ -209,6 +209,33 @@ static inline int page_is_buddy(struct page *page, int order)
        return 0;
 }
 
+/*
+ * Every pageblock of a zone has the migrate type of the allocations it was
+ * given to (see include/linux/mmzone.h), and its free pages go to the free
+ * lists of that type.  All blocks start out movable.
+ */
+static inline int get_pageblock_type(struct zone *zone, struct page *page)
+{
+	return zone->pageblock_type[(page - zone->zone_mem_map) >>
+					PAGEBLOCK_ORDER];
+}
+
+static inline void set_pageblock_type(struct zone *zone, struct page *page,
+					int migratetype)
+{
+	zone->pageblock_type[(page - zone->zone_mem_map) >> PAGEBLOCK_ORDER] =
+					migratetype;
+}
+
+static inline int gfp_to_migratetype(unsigned int gfp_flags)
+{
+	if (gfp_flags & __GFP_MOVABLE)
+		return MIGRATE_MOVABLE;
+	if (gfp_flags & __GFP_RECLAIMABLE)
+		return MIGRATE_RECLAIMABLE;
+	return MIGRATE_UNMOVABLE;
+}
+
 /*
  * Freeing function for a buddy system allocator.
  *
@@ -270,7 +297,8 @@ static inline void __free_pages_bulk (struct page *page, struct page *base,
 	}
 	coalesced = base + page_idx;
 	set_page_order(coalesced, order);
-	list_add(&coalesced->lru, &zone->free_area[order].free_list);
+	list_add(&coalesced->lru, &zone->free_area[order].free_list[
+				get_pageblock_type(zone, coalesced)]);
 	zone->free_area[order].nr_free++;
 }
 
@@ -366,7 +394,7 @@ void __free_pages_ok(struct page *page, unsigned int order)
  */
 static inline struct page *
 expand(struct zone *zone, struct page *page,
- 	int low, int high, struct free_area *area)
+ 	int low, int high, struct free_area *area, int migratetype)
 {
 	unsigned long size = 1 << high;
 
@@ -375,7 +403,7 @@ expand(struct zone *zone, struct page *page,
 		high--;
 		size >>= 1;
 		BUG_ON(bad_range(zone, &page[size]));
-		list_add(&page[size].lru, &area->free_list);
+		list_add(&page[size].lru, &area->free_list[migratetype]);
 		area->nr_free++;
 		set_page_order(&page[size], high);
 	}
@@ -424,11 +452,99 @@ static void prep_new_page(struct page *page, int order)
 	kernel_map_pages(page, 1 << order, 1);
 }
 
+/*
+ * The lists an allocation falls back to, in order, when those of its own
+ * migrate type are empty.
+ */
+static const int fallbacks[MIGRATE_TYPES][MIGRATE_TYPES - 1] = {
+	[MIGRATE_UNMOVABLE]	= { MIGRATE_RECLAIMABLE, MIGRATE_MOVABLE },
+	[MIGRATE_RECLAIMABLE]	= { MIGRATE_UNMOVABLE,   MIGRATE_MOVABLE },
+	[MIGRATE_MOVABLE]	= { MIGRATE_RECLAIMABLE, MIGRATE_UNMOVABLE },
+};
+
+/*
+ * Move the free pages of the pageblock of @page to the lists of
+ * @migratetype.  Returns the number of pages moved.
+ * Call me with the zone->lock already held.
+ */
+static unsigned long move_freepages_block(struct zone *zone,
+				struct page *page, int migratetype)
+{
+	struct page *base = zone->zone_mem_map;
+	unsigned long idx, end_idx, moved = 0;
+	int order;
+
+	idx = (page - base) & ~(PAGEBLOCK_NR_PAGES - 1);
+	end_idx = min(idx + PAGEBLOCK_NR_PAGES, zone->spanned_pages);
+	while (idx < end_idx) {
+		page = base + idx;
+		if (!PagePrivate(page) || PageReserved(page) ||
+		    page_count(page) != 0) {
+			idx++;
+			continue;
+		}
+		order = page_order(page);
+		list_move(&page->lru,
+			&zone->free_area[order].free_list[migratetype]);
+		idx += 1UL << order;
+		moved += 1UL << order;
+	}
+	return moved;
+}
+
+/*
+ * Take a block off the lists of another migrate type.  The largest block
+ * there is goes first, and if it is a large part of a pageblock, the rest
+ * of the free pages of the pageblock come along: the pageblock changes its
+ * type if most of it was free, so that the next allocations of the other
+ * type do not come back to it.  Reclaimable allocations always take the
+ * free pages with them, their pageblocks are the first to empty again.
+ */
+static struct page *__rmqueue_fallback(struct zone *zone, unsigned int order,
+				int start_type)
+{
+	struct free_area *area;
+	int current_order;
+	struct page *page;
+	int migratetype, i;
+
+	for (current_order = MAX_ORDER - 1; current_order >= (int)order;
+						--current_order) {
+		area = zone->free_area + current_order;
+		for (i = 0; i < MIGRATE_TYPES - 1; i++) {
+			migratetype = fallbacks[start_type][i];
+			if (list_empty(&area->free_list[migratetype]))
+				continue;
+
+			page = list_entry(area->free_list[migratetype].next,
+					struct page, lru);
+			if (current_order >= PAGEBLOCK_ORDER / 2 ||
+			    start_type == MIGRATE_RECLAIMABLE) {
+				if (move_freepages_block(zone, page,
+						start_type) >=
+						PAGEBLOCK_NR_PAGES / 2)
+					set_pageblock_type(zone, page,
+							start_type);
+				migratetype = start_type;
+			}
+
+			list_del(&page->lru);
+			rmv_page_order(page);
+			area->nr_free--;
+			zone->free_pages -= 1UL << order;
+			return expand(zone, page, order, current_order, area,
+					migratetype);
+		}
+	}
+	return NULL;
+}
+
 /* 
  * Do the hard work of removing an element from the buddy allocator.
  * Call me with the zone->lock already held.
  */
-static struct page *__rmqueue(struct zone *zone, unsigned int order)
+static struct page *__rmqueue(struct zone *zone, unsigned int order,
+				int migratetype)
 {
 	struct free_area * area;
 	unsigned int current_order;
@@ -436,27 +552,31 @@ static struct page *__rmqueue(struct zone *zone, unsigned int order)
 
 	for (current_order = order; current_order < MAX_ORDER; ++current_order) {
 		area = zone->free_area + current_order;
-		if (list_empty(&area->free_list))
+		if (list_empty(&area->free_list[migratetype]))
 			continue;
 
-		page = list_entry(area->free_list.next, struct page, lru);
+		page = list_entry(area->free_list[migratetype].next,
+				struct page, lru);
 		list_del(&page->lru);
 		rmv_page_order(page);
 		area->nr_free--;
 		zone->free_pages -= 1UL << order;
-		return expand(zone, page, order, current_order, area);
+		return expand(zone, page, order, current_order, area,
+				migratetype);
 	}
 
-	return NULL;
+	return __rmqueue_fallback(zone, order, migratetype);
 }
 
 /* 
  * Obtain a specified number of elements from the buddy allocator, all under
  * a single hold of the lock, for efficiency.  Add them to the supplied list.
  * Returns the number of new pages which were placed at *list.
+ * page->private holds @migratetype while the pages are on the list.
  */
 static int rmqueue_bulk(struct zone *zone, unsigned int order, 
-			unsigned long count, struct list_head *list)
+			unsigned long count, struct list_head *list,
+			int migratetype)
 {
 	unsigned long flags;
 	int i;
@@ -465,17 +585,19 @@ static int rmqueue_bulk(struct zone *zone, unsigned int order,
 	
 	spin_lock_irqsave(&zone->lock, flags);
 	for (i = 0; i < count; ++i) {
-		page = __rmqueue(zone, order);
+		page = __rmqueue(zone, order, migratetype);
 		if (page == NULL)
 			break;
 		allocated++;
+		page->private = migratetype;
 		list_add_tail(&page->lru, list);
 	}
 	spin_unlock_irqrestore(&zone->lock, flags);
 	return allocated;
 }
 
-#if defined(CONFIG_PM) || defined(CONFIG_HOTPLUG_CPU)
+#if defined(CONFIG_PM) || defined(CONFIG_HOTPLUG_CPU) || \
+	defined(CONFIG_COMPACTION)
 static void __drain_pages(unsigned int cpu)
 {
 	struct zone *zone;
@@ -494,14 +616,14 @@ static void __drain_pages(unsigned int cpu)
 		}
 	}
 }
-#endif /* CONFIG_PM || CONFIG_HOTPLUG_CPU */
+#endif /* CONFIG_PM || CONFIG_HOTPLUG_CPU || CONFIG_COMPACTION */
 
 #ifdef CONFIG_PM
 
 void mark_free_pages(struct zone *zone)
 {
 	unsigned long zone_pfn, flags;
-	int order;
+	int order, t;
 	struct list_head *curr;
 
 	if (!zone->spanned_pages)
@@ -512,17 +634,20 @@ void mark_free_pages(struct zone *zone)
 		ClearPageNosaveFree(pfn_to_page(zone_pfn + zone->zone_start_pfn));
 
 	for (order = MAX_ORDER - 1; order >= 0; --order)
-		list_for_each(curr, &zone->free_area[order].free_list) {
-			unsigned long start_pfn, i;
+		for (t = 0; t < MIGRATE_TYPES; t++)
+			list_for_each(curr, &zone->free_area[order].free_list[t]) {
+				unsigned long start_pfn, i;
 
-			start_pfn = page_to_pfn(list_entry(curr, struct page, lru));
+				start_pfn = page_to_pfn(list_entry(curr, struct page, lru));
 
-			for (i=0; i < (1<<order); i++)
-				SetPageNosaveFree(pfn_to_page(start_pfn+i));
-	}
+				for (i=0; i < (1<<order); i++)
+					SetPageNosaveFree(pfn_to_page(start_pfn+i));
+			}
 	spin_unlock_irqrestore(&zone->lock, flags);
 }
+#endif /* CONFIG_PM */
 
+#if defined(CONFIG_PM) || defined(CONFIG_COMPACTION)
 /*
  * Spill all of this CPU's per-cpu pages back into the buddy allocator.
  */
@@ -534,7 +659,7 @@ void drain_local_pages(void)
 	__drain_pages(smp_processor_id());
 	local_irq_restore(flags);	
 }
-#endif /* CONFIG_PM */
+#endif /* CONFIG_PM || CONFIG_COMPACTION */
 
 static void zone_statistics(struct zonelist *zonelist, struct zone *z)
 {
@@ -579,6 +704,7 @@ static void fastcall free_hot_cold_page(struct page *page, int cold)
 	if (PageAnon(page))
 		page->mapping = NULL;
 	free_pages_check(__FUNCTION__, page);
+	page->private = get_pageblock_type(zone, page);
 	pcp = &zone->pageset[get_cpu()].pcp[cold];
 	local_irq_save(flags);
 	if (pcp->count >= pcp->high)
@@ -608,6 +734,206 @@ static inline void prep_zero_page(struct page *page, int order, int gfp_flags)
 		clear_highpage(page + i);
 }
 
+/*
+ * Take up to @nr pages of @migratetype off a per-cpu list, the type being
+ * in page->private while they are on it.  If there are not enough, the
+ * list is refilled with a batch more than missing from the buddy lists.
+ * Call me with interrupts disabled.
+ */
+static unsigned int rmqueue_pcp(struct zone *zone, struct per_cpu_pages *pcp,
+			int migratetype, unsigned int nr, struct page **pages)
+{
+	struct page *page, *next;
+	unsigned int got = 0;
+	int refilled = 0;
+
+	for (;;) {
+		list_for_each_entry_safe(page, next, &pcp->list, lru) {
+			if (got == nr)
+				break;
+			if (page->private != migratetype)
+				continue;
+			list_del(&page->lru);
+			pcp->count--;
+			pages[got++] = page;
+		}
+		if (got == nr || refilled)
+			return got;
+		pcp->count += rmqueue_bulk(zone, 0, nr - got + pcp->batch,
+					&pcp->list, migratetype);
+		refilled = 1;
+	}
+}
+
+/*
+ * Take up to @nr order-0 pages off the per-cpu list of @zone, with
+ * interrupts disabled once, refilling the list from the buddy lists as
+ * needed.  No more than pcp->high pages are taken per call, to bound the
+ * time spent with interrupts off.  Returns the number of pages placed in
+ * @pages.
+ */
+static unsigned int rmqueue_pcp_bulk(struct zone *zone, int gfp_flags,
+			unsigned int nr, struct page **pages)
+{
+	unsigned long flags;
+	struct per_cpu_pages *pcp;
+	int cold = !!(gfp_flags & __GFP_COLD);
+	unsigned int i, got;
+
+	pcp = &zone->pageset[get_cpu()].pcp[cold];
+	if (nr > pcp->high)
+		nr = pcp->high;
+	local_irq_save(flags);
+	got = rmqueue_pcp(zone, pcp, gfp_to_migratetype(gfp_flags), nr, pages);
+	local_irq_restore(flags);
+	put_cpu();
+
+	if (!got)
+		return 0;
+	mod_page_state_zone(zone, pgalloc, got);
+	for (i = 0; i < got; i++) {
+		BUG_ON(bad_range(zone, pages[i]));
+		prep_new_page(pages[i], 0);
+		if (gfp_flags & __GFP_ZERO)
+			prep_zero_page(pages[i], 0, gfp_flags);
+	}
+	return got;
+}
+
+#ifdef CONFIG_PREZERO_PAGES
+/*
+ * Every zone but ZONE_DMA keeps up to pages_high order-0 pages, zeroed in
+ * advance by the kzerod of its node, for the movable __GFP_ZERO
+ * allocations; they come from movable pageblocks.  The pages of the pool
+ * are allocated pages as far as the rest of the allocator is concerned.
+ * kzerod fills the pool only while the zone has more than twice
+ * pages_high free, and the allocator gives it back before it goes into
+ * direct reclaim.
+ */
+#define ZEROED_BATCH	16
+
+static struct page *rmqueue_zeroed(struct zone *zone)
+{
+	pg_data_t *pgdat = zone->zone_pgdat;
+	struct page *page = NULL;
+	unsigned long flags;
+	int refill;
+
+	if (!zone->nr_zeroed)
+		goto out;
+	spin_lock_irqsave(&zone->zeroed_lock, flags);
+	if (zone->nr_zeroed) {
+		page = list_entry(zone->zeroed_list.next, struct page, lru);
+		list_del(&page->lru);
+		zone->nr_zeroed--;
+	}
+	spin_unlock_irqrestore(&zone->zeroed_lock, flags);
+out:
+	refill = zone->nr_zeroed < zone->pages_high / 2 &&
+		 zone->free_pages > 2 * zone->pages_high;
+	if (refill && waitqueue_active(&pgdat->kzerod_wait))
+		wake_up_interruptible(&pgdat->kzerod_wait);
+	return page;
+}
+
+void drain_zeroed_pages(struct zone *zone)
+{
+	LIST_HEAD(list);
+	struct page *page;
+	unsigned long flags;
+
+	if (!zone->nr_zeroed)
+		return;
+	spin_lock_irqsave(&zone->zeroed_lock, flags);
+	list_splice_init(&zone->zeroed_list, &list);
+	zone->nr_zeroed = 0;
+	spin_unlock_irqrestore(&zone->zeroed_lock, flags);
+
+	while (!list_empty(&list)) {
+		page = list_entry(list.next, struct page, lru);
+		list_del(&page->lru);
+		if (put_page_testzero(page))
+			__free_pages_ok(page, 0);
+	}
+}
+
+static void refill_zeroed_pages(pg_data_t *pgdat)
+{
+	struct page *pages[ZEROED_BATCH];
+	unsigned int i, nr;
+	int j;
+
+	for (j = ZONE_NORMAL; j < pgdat->nr_zones; j++) {
+		struct zone *zone = pgdat->node_zones + j;
+
+		while (zone->nr_zeroed < zone->pages_high &&
+		       zone->free_pages > 2 * zone->pages_high) {
+			nr = min_t(unsigned long, ZEROED_BATCH,
+				   zone->pages_high - zone->nr_zeroed);
+			nr = rmqueue_pcp_bulk(zone, __GFP_COLD | __GFP_MOVABLE,
+					      nr, pages);
+			if (!nr)
+				break;
+			for (i = 0; i < nr; i++) {
+				clear_highpage_nocache(pages[i]);
+				cond_resched();
+			}
+			spin_lock_irq(&zone->zeroed_lock);
+			for (i = 0; i < nr; i++)
+				list_add(&pages[i]->lru, &zone->zeroed_list);
+			zone->nr_zeroed += nr;
+			spin_unlock_irq(&zone->zeroed_lock);
+		}
+	}
+}
+
+/*
+ * kzerod runs at the lowest priority, so that it zeroes pages mostly
+ * with cpu time nobody else wants.  It is woken by the allocations which
+ * find the pool of a zone of its node half empty.
+ */
+static int kzerod(void *p)
+{
+	pg_data_t *pgdat = (pg_data_t *)p;
+	DEFINE_WAIT(wait);
+	cpumask_t cpumask;
+
+	daemonize("kzerod%d", pgdat->node_id);
+	cpumask = node_to_cpumask(pgdat->node_id);
+	if (!cpus_empty(cpumask))
+		set_cpus_allowed(current, cpumask);
+	set_user_nice(current, 19);
+
+	for ( ; ; ) {
+		if (current->flags & PF_FREEZE)
+			refrigerator(PF_FREEZE);
+
+		prepare_to_wait(&pgdat->kzerod_wait, &wait, TASK_INTERRUPTIBLE);
+		schedule();
+		finish_wait(&pgdat->kzerod_wait, &wait);
+
+		refill_zeroed_pages(pgdat);
+	}
+	return 0;
+}
+
+static int __init kzerod_init(void)
+{
+	pg_data_t *pgdat;
+
+	for_each_pgdat(pgdat)
+		kernel_thread(kzerod, pgdat, CLONE_KERNEL);
+	return 0;
+}
+
+module_init(kzerod_init)
+#else
+static inline struct page *rmqueue_zeroed(struct zone *zone)
+{
+	return NULL;
+}
+#endif /* CONFIG_PREZERO_PAGES */
+
 /*
  * Really, prep_compound_page() should be called from __rmqueue_bulk().  But
  * we cheat by calling it from here, in the order > 0 path.  Saves a branch
@@ -619,27 +945,29 @@ buffered_rmqueue(struct zone *zone, int order, int gfp_flags)
 	unsigned long flags;
 	struct page *page = NULL;
 	int cold = !!(gfp_flags & __GFP_COLD);
+	int migratetype = gfp_to_migratetype(gfp_flags);
+
+	if (order == 0 && (gfp_flags & __GFP_ZERO) &&
+	    migratetype == MIGRATE_MOVABLE) {
+		page = rmqueue_zeroed(zone);
+		if (page)
+			return page;
+	}
 
 	if (order == 0) {
 		struct per_cpu_pages *pcp;
 
 		pcp = &zone->pageset[get_cpu()].pcp[cold];
 		local_irq_save(flags);
-		if (pcp->count <= pcp->low)
-			pcp->count += rmqueue_bulk(zone, 0,
-						pcp->batch, &pcp->list);
-		if (pcp->count) {
-			page = list_entry(pcp->list.next, struct page, lru);
-			list_del(&page->lru);
-			pcp->count--;
-		}
+		if (!rmqueue_pcp(zone, pcp, migratetype, 1, &page))
+			page = NULL;
 		local_irq_restore(flags);
 		put_cpu();
 	}
 
 	if (page == NULL) {
 		spin_lock_irqsave(&zone->lock, flags);
-		page = __rmqueue(zone, order);
+		page = __rmqueue(zone, order, migratetype);
 		spin_unlock_irqrestore(&zone->lock, flags);
 	}
 
@@ -770,9 +1098,31 @@ __alloc_pages(unsigned int gfp_mask, unsigned int order,
 	if (!wait)
 		goto nopage;
 
+	/*
+	 * The memory may well be free, only scattered: try to empty a
+	 * block of the wanted order by moving pages before reclaiming.
+	 */
+	if (order && (gfp_mask & (__GFP_FS|__GFP_IO)) == (__GFP_FS|__GFP_IO) &&
+	    try_to_compact_pages(zones, order)) {
+		for (i = 0; (z = zones[i]) != NULL; i++) {
+			if (!zone_watermark_ok(z, order, z->pages_min,
+					       classzone_idx, can_try_harder,
+					       gfp_mask & __GFP_HIGH))
+				continue;
+
+			page = buffered_rmqueue(z, order, gfp_mask);
+			if (page)
+				goto got_pg;
+		}
+	}
+
 rebalance:
 	cond_resched();
 
+	/* Pages zeroed in advance are the cheapest to get back */
+	for (i = 0; (z = zones[i]) != NULL; i++)
+		drain_zeroed_pages(z);
+
 	/* We now go into synchronous reclaim */
 	p->flags |= PF_MEMALLOC;
 	reclaim_state.reclaimed_slab = 0;
@@ -857,6 +1207,67 @@ got_pg:
 
 EXPORT_SYMBOL(__alloc_pages);
 
+/**
+ * alloc_pages_bulk - allocate a number of order-0 pages at once
+ * @gfp_mask:	allocation mode
+ * @nr_pages:	the number of pages wanted
+ * @pages:	where the pages are placed
+ *
+ * The pages are taken from the per-cpu lists of the zones of the local
+ * node which are above their low watermark, a list at a time with
+ * interrupts disabled once, rather than a page at a time.  What the fast
+ * path could not provide is allocated page by page by alloc_pages(),
+ * with reclaim if @gfp_mask allows it.
+ *
+ * Returns the number of pages placed at @pages, which is less than
+ * @nr_pages only if an allocation failed.
+ */
+unsigned int fastcall alloc_pages_bulk(unsigned int gfp_mask,
+			unsigned int nr_pages, struct page **pages)
+{
+	struct zonelist *zonelist;
+	struct zone **zones, *z;
+	struct page *page;
+	unsigned int got = 0, nr;
+	int i;
+
+	zonelist = NODE_DATA(numa_node_id())->node_zonelists +
+			(gfp_mask & GFP_ZONEMASK);
+#ifdef CONFIG_NUMA
+	/* Only the slow path follows the memory policy */
+	if (!in_interrupt() && current->mempolicy)
+		goto slow;
+#endif
+	zones = zonelist->zones;
+	for (i = 0; (z = zones[i]) != NULL && got < nr_pages; i++) {
+		while (got < nr_pages &&
+		       zone_watermark_ok(z, 0, z->pages_low + nr_pages - got,
+					 zone_idx(zones[0]), 0, 0)) {
+			nr = rmqueue_pcp_bulk(z, gfp_mask, nr_pages - got,
+					      pages + got);
+			if (!nr)
+				break;
+			got += nr;
+			while (nr--)
+				zone_statistics(zonelist, z);
+			if (gfp_mask & __GFP_WAIT)
+				cond_resched();
+		}
+	}
+#ifdef CONFIG_NUMA
+slow:
+#endif
+	while (got < nr_pages) {
+		page = alloc_pages(gfp_mask, 0);
+		if (!page)
+			break;
+		pages[got++] = page;
+	}
+	return got;
+}
+
+EXPORT_SYMBOL(alloc_pages_bulk);
+
 /*
  * Common helper functions.
  */
@@ -1553,9 +1964,10 @@ void __init memmap_init_zone(unsigned long size, int nid, unsigned long zone,
 void zone_init_free_lists(struct pglist_data *pgdat, struct zone *zone,
 				unsigned long size)
 {
-	int order;
+	int order, t;
 	for (order = 0; order < MAX_ORDER ; order++) {
-		INIT_LIST_HEAD(&zone->free_area[order].free_list);
+		for (t = 0; t < MIGRATE_TYPES; t++)
+			INIT_LIST_HEAD(&zone->free_area[order].free_list[t]);
 		zone->free_area[order].nr_free = 0;
 	}
 }
@@ -1582,11 +1994,14 @@ static void __init free_area_init_core(struct pglist_data *pgdat,
 	pgdat->nr_zones = 0;
 	init_waitqueue_head(&pgdat->kswapd_wait);
 	pgdat->kswapd_max_order = 0;
+#ifdef CONFIG_PREZERO_PAGES
+	init_waitqueue_head(&pgdat->kzerod_wait);
+#endif
 	
 	for (j = 0; j < MAX_NR_ZONES; j++) {
 		struct zone *zone = pgdat->node_zones + j;
 		unsigned long size, realsize;
-		unsigned long batch;
+		unsigned long batch, nr_blocks;
 
 		zone_table[NODEZONE(nid, j)] = zone;
 		realsize = size = zones_size[j];
@@ -1602,6 +2017,15 @@ static void __init free_area_init_core(struct pglist_data *pgdat,
 		zone->name = zone_names[j];
 		spin_lock_init(&zone->lock);
 		spin_lock_init(&zone->lru_lock);
+#ifdef CONFIG_PREZERO_PAGES
+		spin_lock_init(&zone->zeroed_lock);
+		INIT_LIST_HEAD(&zone->zeroed_list);
+		zone->nr_zeroed = 0;
+#endif
+#ifdef CONFIG_COMPACTION
+		zone->compact_considered = 0;
+		zone->compact_defer_shift = 0;
+#endif
 		zone->zone_pgdat = pgdat;
 		zone->free_pages = 0;
 
@@ -1663,6 +2087,10 @@ static void __init free_area_init_core(struct pglist_data *pgdat,
 		for(i = 0; i < zone->wait_table_size; ++i)
 			init_waitqueue_head(zone->wait_table + i);
 
+		nr_blocks = (size + PAGEBLOCK_NR_PAGES - 1) >> PAGEBLOCK_ORDER;
+		zone->pageblock_type = alloc_bootmem_node(pgdat, nr_blocks);
+		memset(zone->pageblock_type, MIGRATE_MOVABLE, nr_blocks);
+
 		pgdat->nr_zones = j+1;
 
 		zone->zone_mem_map = pfn_to_page(zone_start_pfn);
@@ -1776,6 +2204,113 @@ struct seq_operations fragmentation_op = {
 	.show	= frag_show,
 };
 
+static char *migratetype_names[MIGRATE_TYPES] = {
+	"Unmovable",
+	"Reclaimable",
+	"Movable",
+};
+
+/*
+ * For each zone of a node: the free blocks of every order by migrate
+ * type, the number of pageblocks of every type, and the unusable free
+ * space index of every order, the part of the free memory which is in
+ * blocks too small for an allocation of that order.
+ */
+static int pagetype_show(struct seq_file *m, void *arg)
+{
+	pg_data_t *pgdat = (pg_data_t *)arg;
+	struct zone *zone;
+	struct zone *node_zones = pgdat->node_zones;
+	unsigned long nr_free[MAX_ORDER], count[MIGRATE_TYPES];
+	unsigned long flags, free, unusable, idx, nr_blocks;
+	struct list_head *curr;
+	int order, t;
+
+	if (pgdat == pgdat_list)
+		seq_printf(m, "Page block order: %d\nPages per block:  %lu\n",
+			   PAGEBLOCK_ORDER, PAGEBLOCK_NR_PAGES);
+
+	seq_printf(m, "\nFree pages count per migrate type at order ");
+	for (order = 0; order < MAX_ORDER; ++order)
+		seq_printf(m, "%6d ", order);
+	seq_putc(m, '\n');
+	for (zone = node_zones; zone - node_zones < MAX_NR_ZONES; ++zone) {
+		if (!zone->present_pages)
+			continue;
+		for (t = 0; t < MIGRATE_TYPES; t++) {
+			seq_printf(m, "Node %4d, zone %8s, type %12s ",
+				   pgdat->node_id, zone->name,
+				   migratetype_names[t]);
+			spin_lock_irqsave(&zone->lock, flags);
+			for (order = 0; order < MAX_ORDER; ++order) {
+				unsigned long n = 0;
+
+				list_for_each(curr,
+					&zone->free_area[order].free_list[t])
+					n++;
+				seq_printf(m, "%6lu ", n);
+			}
+			spin_unlock_irqrestore(&zone->lock, flags);
+			seq_putc(m, '\n');
+		}
+	}
+
+	seq_printf(m, "\nNumber of blocks type     ");
+	for (t = 0; t < MIGRATE_TYPES; t++)
+		seq_printf(m, "%12s ", migratetype_names[t]);
+	seq_putc(m, '\n');
+	for (zone = node_zones; zone - node_zones < MAX_NR_ZONES; ++zone) {
+		if (!zone->present_pages)
+			continue;
+		memset(count, 0, sizeof(count));
+		nr_blocks = (zone->spanned_pages + PAGEBLOCK_NR_PAGES - 1) >>
+				PAGEBLOCK_ORDER;
+		for (idx = 0; idx < nr_blocks; idx++)
+			count[zone->pageblock_type[idx]]++;
+		seq_printf(m, "Node %d, zone %8s ", pgdat->node_id, zone->name);
+		for (t = 0; t < MIGRATE_TYPES; t++)
+			seq_printf(m, "%12lu ", count[t]);
+		seq_putc(m, '\n');
+	}
+
+	seq_printf(m, "\nUnusable free space index at order ");
+	for (order = 0; order < MAX_ORDER; ++order)
+		seq_printf(m, "%5d ", order);
+	seq_putc(m, '\n');
+	for (zone = node_zones; zone - node_zones < MAX_NR_ZONES; ++zone) {
+		if (!zone->present_pages)
+			continue;
+		spin_lock_irqsave(&zone->lock, flags);
+		for (order = 0; order < MAX_ORDER; ++order)
+			nr_free[order] = zone->free_area[order].nr_free;
+		spin_unlock_irqrestore(&zone->lock, flags);
+
+		free = 0;
+		for (order = 0; order < MAX_ORDER; ++order)
+			free += nr_free[order] << order;
+		seq_printf(m, "Node %d, zone %8s          ",
+			   pgdat->node_id, zone->name);
+		unusable = 0;
+		for (order = 0; order < MAX_ORDER; ++order) {
+			unsigned long index = 0;
+
+			if (free)
+				index = unusable * 1000 / free;
+			seq_printf(m, "%lu.%03lu ", index / 1000, index % 1000);
+			unusable += nr_free[order] << order;
+		}
+		seq_putc(m, '\n');
+	}
+	return 0;
+}
+
+struct seq_operations pagetypeinfo_op = {
+	.start	= frag_start,
+	.next	= frag_next,
+	.stop	= frag_stop,
+	.show	= pagetype_show,
+};
+
 static char *vmstat_text[] = {
 	"nr_dirty",
 	"nr_writeback",
@@ -1821,6 +2356,10 @@ static char *vmstat_text[] = {
 	"allocstall",
 
 	"pgrotated",
+	"pgmigrate_success",
+	"pgmigrate_fail",
+	"compact_stall",
+	"compact_success",
 };
 
 static void *vmstat_start(struct seq_file *m, loff_t *pos)
@@ -32,7 +32,7 @@
  *   page->flags PG_locked (lock_page)
  *     mapping->i_mmap_lock
  *       anon_vma->lock
- *         mm->page_table_lock
+ *         mm->page_table_lock, then pte lock (see pte_lockptr)
  *           zone->lru_lock (in mark_page_accessed)
  *           swap_list_lock (in swap_free etc's swap_info_get)
  *             mmlist_lock (in mmput, drain_mmlist and others)
@@ -256,9 +256,10 @@ static int page_referenced_one(struct page *page,
 	pud_t *pud;
 	pmd_t *pmd;
 	pte_t *pte;
+	spinlock_t *ptl;
 	int referenced = 0;
 
-	if (!mm->rss)
+	if (!get_mm_counter(mm, rss))
 		goto out;
 	address = vma_address(page, vma);
 	if (address == -EFAULT)
@@ -278,6 +279,7 @@ static int page_referenced_one(struct page *page,
 	if (!pmd_present(*pmd))
 		goto out_unlock;
 
+	ptl = pte_lock_nested(mm, pmd);
 	pte = pte_offset_map(pmd, address);
 	if (!pte_present(*pte))
 		goto out_unmap;
@@ -295,6 +297,7 @@ static int page_referenced_one(struct page *page,
 
 out_unmap:
 	pte_unmap(pte);
+	pte_unlock_nested(ptl);
 out_unlock:
 	spin_unlock(&mm->page_table_lock);
 out:
@@ -437,7 +440,7 @@ void page_add_anon_rmap(struct page *page,
 	BUG_ON(PageReserved(page));
 	BUG_ON(!anon_vma);
 
-	vma->vm_mm->anon_rss++;
+	inc_mm_counter(vma->vm_mm, anon_rss);
 
 	anon_vma = (void *) anon_vma + PAGE_MAPPING_ANON;
 	index = (address - vma->vm_start) >> PAGE_SHIFT;
@@ -499,7 +502,8 @@ void page_remove_rmap(struct page *page)
  * Subfunctions of try_to_unmap: try_to_unmap_one called
  * repeatedly from either try_to_unmap_anon or try_to_unmap_file.
  */
-static int try_to_unmap_one(struct page *page, struct vm_area_struct *vma)
+static int try_to_unmap_one(struct page *page, struct vm_area_struct *vma,
+			    int migration)
 {
 	struct mm_struct *mm = vma->vm_mm;
 	unsigned long address;
@@ -508,17 +512,18 @@ static int try_to_unmap_one(struct page *page, struct vm_area_struct *vma)
 	pmd_t *pmd;
 	pte_t *pte;
 	pte_t pteval;
+	spinlock_t *ptl;
 	int ret = SWAP_AGAIN;
 
-	if (!mm->rss)
+	if (!get_mm_counter(mm, rss))
 		goto out;
 	address = vma_address(page, vma);
 	if (address == -EFAULT)
 		goto out;
 
 	/*
-	 * We need the page_table_lock to protect us from page faults,
-	 * munmap, fork, etc...
+	 * We need the page_table_lock to protect us from munmap, fork,
+	 * etc..., and the pte lock from page faults.
 	 */
 	spin_lock(&mm->page_table_lock);
 
@@ -534,6 +539,7 @@ static int try_to_unmap_one(struct page *page, struct vm_area_struct *vma)
 	if (!pmd_present(*pmd))
 		goto out_unlock;
 
+	ptl = pte_lock_nested(mm, pmd);
 	pte = pte_offset_map(pmd, address);
 	if (!pte_present(*pte))
 		goto out_unmap;
@@ -544,10 +550,12 @@ static int try_to_unmap_one(struct page *page, struct vm_area_struct *vma)
 	/*
 	 * If the page is mlock()d, we cannot swap it out.
 	 * If it's recently referenced (perhaps page_referenced
-	 * skipped over this mm) then we should reactivate it.
+	 * skipped over this mm) then we should reactivate it,
+	 * unless it is only being moved.
 	 */
 	if ((vma->vm_flags & (VM_LOCKED|VM_RESERVED)) ||
-			ptep_clear_flush_young(vma, address, pte)) {
+			(!migration &&
+			 ptep_clear_flush_young(vma, address, pte))) {
 		ret = SWAP_FAIL;
 		goto out_unmap;
 	}
@@ -596,16 +604,17 @@ static int try_to_unmap_one(struct page *page, struct vm_area_struct *vma)
 		}
 		set_pte(pte, swp_entry_to_pte(entry));
 		BUG_ON(pte_file(*pte));
-		mm->anon_rss--;
+		dec_mm_counter(mm, anon_rss);
 	}
 
-	mm->rss--;
+	dec_mm_counter(mm, rss);
 	acct_update_integrals();
 	page_remove_rmap(page);
 	page_cache_release(page);
 
 out_unmap:
 	pte_unmap(pte);
+	pte_unlock_nested(ptl);
 out_unlock:
 	spin_unlock(&mm->page_table_lock);
 out:
@@ -643,14 +652,15 @@ static void try_to_unmap_cluster(unsigned long cursor,
 	pmd_t *pmd;
 	pte_t *pte;
 	pte_t pteval;
+	spinlock_t *ptl;
 	struct page *page;
 	unsigned long address;
 	unsigned long end;
 	unsigned long pfn;
 
 	/*
-	 * We need the page_table_lock to protect us from page faults,
-	 * munmap, fork, etc...
+	 * We need the page_table_lock to protect us from munmap, fork,
+	 * etc..., and the pte lock from page faults.
 	 */
 	spin_lock(&mm->page_table_lock);
 
@@ -673,6 +683,7 @@ static void try_to_unmap_cluster(unsigned long cursor,
 	if (!pmd_present(*pmd))
 		goto out_unlock;
 
+	ptl = pte_lock_nested(mm, pmd);
 	for (pte = pte_offset_map(pmd, address);
 			address < end; pte++, address += PAGE_SIZE) {
 
@@ -706,17 +717,18 @@ static void try_to_unmap_cluster(unsigned long cursor,
 		page_remove_rmap(page);
 		page_cache_release(page);
 		acct_update_integrals();
-		mm->rss--;
+		dec_mm_counter(mm, rss);
 		(*mapcount)--;
 	}
 
 	pte_unmap(pte);
+	pte_unlock_nested(ptl);
 
 out_unlock:
 	spin_unlock(&mm->page_table_lock);
 }
 
-static int try_to_unmap_anon(struct page *page)
+static int try_to_unmap_anon(struct page *page, int migration)
 {
 	struct anon_vma *anon_vma;
 	struct vm_area_struct *vma;
@@ -727,7 +739,7 @@ static int try_to_unmap_anon(struct page *page)
 		return ret;
 
 	list_for_each_entry(vma, &anon_vma->head, anon_vma_node) {
-		ret = try_to_unmap_one(page, vma);
+		ret = try_to_unmap_one(page, vma, migration);
 		if (ret == SWAP_FAIL || !page_mapped(page))
 			break;
 	}
@@ -744,7 +756,7 @@ static int try_to_unmap_anon(struct page *page)
  *
  * This function is only called from try_to_unmap for object-based pages.
  */
-static int try_to_unmap_file(struct page *page)
+static int try_to_unmap_file(struct page *page, int migration)
 {
 	struct address_space *mapping = page->mapping;
 	pgoff_t pgoff = page->index << (PAGE_CACHE_SHIFT - PAGE_SHIFT);
@@ -758,7 +770,7 @@ static int try_to_unmap_file(struct page *page)
 
 	spin_lock(&mapping->i_mmap_lock);
 	vma_prio_tree_foreach(vma, &iter, &mapping->i_mmap, pgoff, pgoff) {
-		ret = try_to_unmap_one(page, vma);
+		ret = try_to_unmap_one(page, vma, migration);
 		if (ret == SWAP_FAIL || !page_mapped(page))
 			goto out;
 	}
@@ -805,7 +817,7 @@ static int try_to_unmap_file(struct page *page)
 			if (vma->vm_flags & (VM_LOCKED|VM_RESERVED))
 				continue;
 			cursor = (unsigned long) vma->vm_private_data;
-			while (vma->vm_mm->rss &&
+			while (get_mm_counter(vma->vm_mm, rss) &&
 				cursor < max_nl_cursor &&
 				cursor < vma->vm_end - vma->vm_start) {
 				try_to_unmap_cluster(cursor, &mapcount, vma);
@@ -838,16 +850,19 @@ out:
 /**
  * try_to_unmap - try to remove all page table mappings to a page
  * @page: the page to get unmapped
+ * @migration: the page is being moved, not reclaimed: unmap it even if
+ *	it was referenced recently
  *
  * Tries to remove all the page table entries which are mapping this
- * page, used in the pageout path.  Caller must hold the page lock.
+ * page, used in the pageout path and by page migration.  Caller must
+ * hold the page lock.
  * Return values are:
  *
  * SWAP_SUCCESS	- we succeeded in removing all mappings
  * SWAP_AGAIN	- we missed a mapping, try again later
  * SWAP_FAIL	- the page is unswappable
  */
-int try_to_unmap(struct page *page)
+int try_to_unmap(struct page *page, int migration)
 {
 	int ret;
 
@@ -855,11 +870,163 @@ int try_to_unmap(struct page *page)
 	BUG_ON(!PageLocked(page));
 
 	if (PageAnon(page))
-		ret = try_to_unmap_anon(page);
+		ret = try_to_unmap_anon(page, migration);
 	else
-		ret = try_to_unmap_file(page);
+		ret = try_to_unmap_file(page, migration);
 
 	if (!page_mapped(page))
 		ret = SWAP_SUCCESS;
 	return ret;
 }
+
+/*
+ * Find the pte mapping page at address in mm.  Returns it mapped, with the
+ * page_table_lock and the pte lock (in *ptlp) held, or NULL.
+ */
+static pte_t *page_check_address(struct page *page, struct mm_struct *mm,
+				 unsigned long address, spinlock_t **ptlp)
+{
+	pgd_t *pgd;
+	pud_t *pud;
+	pmd_t *pmd;
+	pte_t *pte;
+
+	spin_lock(&mm->page_table_lock);
+
+	pgd = pgd_offset(mm, address);
+	if (!pgd_present(*pgd))
+		goto out_unlock;
+
+	pud = pud_offset(pgd, address);
+	if (!pud_present(*pud))
+		goto out_unlock;
+
+	pmd = pmd_offset(pud, address);
+	if (!pmd_present(*pmd))
+		goto out_unlock;
+
+	*ptlp = pte_lock_nested(mm, pmd);
+	pte = pte_offset_map(pmd, address);
+	if (pte_present(*pte) && page_to_pfn(page) == pte_pfn(*pte))
+		return pte;
+
+	pte_unmap(pte);
+	pte_unlock_nested(*ptlp);
+out_unlock:
+	spin_unlock(&mm->page_table_lock);
+	return NULL;
+}
+
+static inline void page_unlock_address(struct mm_struct *mm, pte_t *pte,
+				       spinlock_t *ptl)
+{
+	pte_unmap(pte);
+	pte_unlock_nested(ptl);
+	spin_unlock(&mm->page_table_lock);
+}
+
+/**
+ * page_wrprotect_anon - write protect all the ptes mapping an anonymous page
+ * @page: the page, locked
+ *
+ * Used by page migration to keep the page from changing while it is
+ * copied: a write to it faults, and do_wp_page(), unable to lock the
+ * page, gives the writer a copy of its own.  Returns SWAP_FAIL if the
+ * page is mapped in an mlocked or reserved vma, SWAP_SUCCESS otherwise.
+ */
+int page_wrprotect_anon(struct page *page)
+{
+	struct anon_vma *anon_vma;
+	struct vm_area_struct *vma;
+	int ret = SWAP_SUCCESS;
+
+	BUG_ON(!PageLocked(page));
+
+	anon_vma = page_lock_anon_vma(page);
+	if (!anon_vma)
+		return ret;
+
+	list_for_each_entry(vma, &anon_vma->head, anon_vma_node) {
+		struct mm_struct *mm = vma->vm_mm;
+		unsigned long address;
+		spinlock_t *ptl;
+		pte_t *pte;
+
+		address = vma_address(page, vma);
+		if (address == -EFAULT)
+			continue;
+		pte = page_check_address(page, mm, address, &ptl);
+		if (!pte)
+			continue;
+
+		if (vma->vm_flags & (VM_LOCKED|VM_RESERVED))
+			ret = SWAP_FAIL;
+		else if (pte_write(*pte)) {
+			ptep_set_wrprotect(pte);
+			flush_tlb_page(vma, address);
+		}
+
+		page_unlock_address(mm, pte, ptl);
+		if (ret == SWAP_FAIL)
+			break;
+	}
+	spin_unlock(&anon_vma->lock);
+	return ret;
+}
+
+/**
+ * page_move_anon_ptes - point the ptes mapping an anonymous page at a copy
+ * @page: the page, locked and write protected by page_wrprotect_anon()
+ * @newpage: the copy
+ *
+ * @newpage takes over the references and the mapcount of @page, one pte
+ * at a time.  The ptes stay write protected: the first write to them
+ * makes them writable again in do_wp_page().
+ */
+void page_move_anon_ptes(struct page *page, struct page *newpage)
+{
+	struct anon_vma *anon_vma;
+	struct vm_area_struct *vma;
+
+	BUG_ON(!PageLocked(page));
+
+	anon_vma = page_lock_anon_vma(page);
+	if (!anon_vma)
+		return;
+
+	list_for_each_entry(vma, &anon_vma->head, anon_vma_node) {
+		struct mm_struct *mm = vma->vm_mm;
+		unsigned long address;
+		spinlock_t *ptl;
+		pte_t *pte, pteval, entry;
+
+		address = vma_address(page, vma);
+		if (address == -EFAULT)
+			continue;
+		pte = page_check_address(page, mm, address, &ptl);
+		if (!pte)
+			continue;
+
+		flush_cache_page(vma, address);
+		pteval = ptep_clear_flush(vma, address, pte);
+		entry = mk_pte(newpage, vma->vm_page_prot);
+		if (pte_dirty(pteval))
+			entry = pte_mkdirty(entry);
+		if (pte_young(pteval))
+			entry = pte_mkyoung(entry);
+
+		get_page(newpage);
+		page_add_anon_rmap(newpage, vma, address);
+		dec_mm_counter(mm, anon_rss);
+		set_pte(pte, entry);
+		update_mmu_cache(vma, address, entry);
+
+		page_remove_rmap(page);
+		page_cache_release(page);
+
+		page_unlock_address(mm, pte, ptl);
+		if (!page_mapped(page))
+			break;
+	}
+	spin_unlock(&anon_vma->lock);
+}
@@ -432,7 +432,7 @@ static void
 unuse_pte(struct vm_area_struct *vma, unsigned long address, pte_t *dir,
 	swp_entry_t entry, struct page *page)
 {
-	vma->vm_mm->rss++;
+	inc_mm_counter(vma->vm_mm, rss);
 	get_page(page);
 	set_pte(dir, pte_mkold(mk_pte(page, vma->vm_page_prot)));
 	page_add_anon_rmap(page, vma, address);
@@ -448,6 +448,7 @@ static unsigned long unuse_pmd(struct vm_area_struct *vma, pmd_t *dir,
 {
 	pte_t *pte;
 	pte_t swp_pte = swp_entry_to_pte(entry);
+	spinlock_t *ptl;
 
 	if (pmd_none(*dir))
 		return 0;
@@ -456,6 +457,7 @@ static unsigned long unuse_pmd(struct vm_area_struct *vma, pmd_t *dir,
 		pmd_clear(dir);
 		return 0;
 	}
+	ptl = pte_lock_nested(vma->vm_mm, dir);
 	pte = pte_offset_map(dir, address);
 	do {
 		/*
@@ -465,6 +467,7 @@ static unsigned long unuse_pmd(struct vm_area_struct *vma, pmd_t *dir,
 		if (unlikely(pte_same(*pte, swp_pte))) {
 			unuse_pte(vma, address, pte, entry, page);
 			pte_unmap(pte);
+			pte_unlock_nested(ptl);
 
 			/*
 			 * Move the page to the active list so it is not
@@ -479,6 +482,7 @@ static unsigned long unuse_pmd(struct vm_area_struct *vma, pmd_t *dir,
 		pte++;
 	} while (address < end);
 	pte_unmap(pte - 1);
+	pte_unlock_nested(ptl);
 	return 0;
 }
 
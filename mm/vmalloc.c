@@ -520,17 +520,14 @@ void *__vmalloc(unsigned long size, int gfp_mask, pgprot_t prot)
 	}
 	memset(area->pages, 0, array_size); // 当該領域を0クリア
 
-	// 取得した領域にページを割り当てる
-	for (i = 0; i < area->nr_pages; i++) {
-		// ページを割り当て、メモリディスクリプタのメンバであるリストにページディスクリプタを設定する
-		area->pages[i] = alloc_page(gfp_mask);
-
-		// 割り当てに失敗した場合
-		if (unlikely(!area->pages[i])) {
-			/* いくつかのページの割り当てに成功していた場合には__vunmap()関数でそれらを開放する */
-			area->nr_pages = i;
-			goto fail;
-		}
+	// 取得した領域にページをまとめて割り当て、メモリディスクリプタのメンバであるリストにページディスクリプタを設定する
+	i = alloc_pages_bulk(gfp_mask, area->nr_pages, area->pages);
+
+	// 割り当てに失敗した場合
+	if (unlikely(i < area->nr_pages)) {
+		/* いくつかのページの割り当てに成功していた場合には__vunmap()関数でそれらを開放する */
+		area->nr_pages = i;
+		goto fail;
 	}
 
 	// 連続するリニアアドレスを非連続なページフレームに割り当てる。
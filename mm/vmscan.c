@@ -403,7 +403,7 @@ static int shrink_list(struct list_head *page_list, struct scan_control *sc)
 		 * processes. Try to unmap it here.
 		 */
 		if (page_mapped(page) && mapping) {
-			switch (try_to_unmap(page)) {
+			switch (try_to_unmap(page, 0)) {
 			case SWAP_FAIL:
 				goto activate_locked;
 			case SWAP_AGAIN:
@@ -481,8 +481,17 @@ static int shrink_list(struct list_head *page_list, struct scan_control *sc)
 		 * The non-racy check for busy page.  It is critical to check
 		 * PageDirty _after_ making sure that the page is freeable and
 		 * not in use by anybody. 	(pagecache + us == 2)
+		 *
+		 * find_get_page() does not take the tree_lock: freeze the
+		 * count so that it cannot pin the page until it is gone
+		 * from the radix tree.
 		 */
-		if (page_count(page) != 2 || PageDirty(page)) {
+		if (!page_freeze_refs(page, 2)) {
+			spin_unlock_irq(&mapping->tree_lock);
+			goto keep_locked;
+		}
+		if (unlikely(PageDirty(page))) {
+			page_unfreeze_refs(page, 2);
 			spin_unlock_irq(&mapping->tree_lock);
 			goto keep_locked;
 		}
@@ -491,6 +500,7 @@ static int shrink_list(struct list_head *page_list, struct scan_control *sc)
 		if (PageSwapCache(page)) {
 			swp_entry_t swap = { .val = page->private };
 			__delete_from_swap_cache(page);
+			page_unfreeze_refs(page, 2);
 			spin_unlock_irq(&mapping->tree_lock);
 			swap_free(swap);
 			__put_page(page);	/* The pagecache ref */
@@ -499,6 +509,7 @@ static int shrink_list(struct list_head *page_list, struct scan_control *sc)
 #endif /* CONFIG_SWAP */
 
 		__remove_from_page_cache(page);
+		page_unfreeze_refs(page, 2);
 		spin_unlock_irq(&mapping->tree_lock);
 		__put_page(page);
 
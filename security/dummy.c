@@ -361,6 +361,16 @@ static int dummy_inode_permission (struct inode *inode, int mask, struct nameida
 	return 0;
 }
 
+static int dummy_inode_permission_rcu (struct inode *inode, int mask, struct nameidata *nd)
+{
+	return 0;
+}
+
+static int dummy_inode_permission_norcu (struct inode *inode, int mask, struct nameidata *nd)
+{
+	return -EAGAIN;
+}
+
 static int dummy_inode_setattr (struct dentry *dentry, struct iattr *iattr)
 {
 	return 0;
@@ -900,6 +910,16 @@ void security_fixup_ops (struct security_operations *ops)
 	set_to_dummy_if_null(ops, inode_readlink);
 	set_to_dummy_if_null(ops, inode_follow_link);
 	set_to_dummy_if_null(ops, inode_permission);
+	/*
+	 * A module checking inode permissions has to opt in to being
+	 * called from the RCU path walk.
+	 */
+	if (!ops->inode_permission_rcu) {
+		if (ops->inode_permission == dummy_inode_permission)
+			ops->inode_permission_rcu = dummy_inode_permission_rcu;
+		else
+			ops->inode_permission_rcu = dummy_inode_permission_norcu;
+	}
 	set_to_dummy_if_null(ops, inode_setattr);
 	set_to_dummy_if_null(ops, inode_getattr);
 	set_to_dummy_if_null(ops, inode_delete);